@@ -0,0 +1,336 @@
+﻿// BC7の品質の段階ごとに、PSNRと1スレッドの圧縮の速さを測る(GPUは要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread -IDirectXTex BC7Benchmark.cpp DirectXTex/DirectXTexDDS.cpp DirectXTex/DirectXTexTGA.cpp
+//       DirectXTex/DirectXTexUtil.cpp DirectXTex/DirectXTexImage.cpp DirectXTex/DirectXTexConvert.cpp DirectXTex/DirectXTexMipmaps.cpp
+//       DirectXTex/DirectXTexResize.cpp DirectXTex/DirectXTexCompress.cpp DirectXTex/BC.cpp DirectXTex/BC4BC5.cpp
+//       DirectXTex/BC6HBC7.cpp DirectXTex/DirectXTexThreadPool.cpp -o BC7Benchmark
+//   (DirectXMathとDirectX-Headersのincludeも通す。WindowsではDirectXTex.libとole32.libをリンクし、PNGもWICで読める)
+// 使い方
+//   BC7Benchmark [--image FILE] [--crop X,Y,W,H] [--tiers LIST] [--passes P]
+//   FILE(Windowsの既定はResources/Map.png、それ以外はDDSかTGA)の(X,Y)からW x H(既定512,232,256,256)を切り出したものと、
+//   256x256の合成画像2枚(fBmの写真風、平らな色と縁と丸いアルファのUI風)を、LIST(既定ultrafast,fast,quick,default,slow)の
+//   段階で1ブロックずつD3DXEncodeBC7し、展開したRGBAのPSNR(dB)とP回(既定1)で一番速い回のkブロック/秒を表にする
+//   FILEが無ければ切り出しの行は飛ばす(Linuxでは先にMap.pngをTGAかDDSにしておく)
+//   すべての段階を測った時は次も確かめる
+//   ・ultrafastとfastはdefaultより速い
+//   ・slowのPSNRはdefault以上
+//   失敗すると理由を出して1を返す
+#include "DirectXTexP.h"
+#include "BC.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Tier
+	{
+		const char* option;
+		const char* name;
+		uint32_t flags;
+	};
+	const Tier TIERS[] =
+	{
+		{ "ultrafast", "ULTRAFAST", BC_FLAGS_BC7_ULTRAFAST },
+		{ "fast", "FAST", BC_FLAGS_BC7_FAST },
+		{ "quick", "QUICK (mode 6)", BC_FLAGS_FORCE_BC7_MODE6 },
+		{ "default", "DEFAULT", 0 },
+		{ "slow", "SLOW", BC_FLAGS_BC7_SLOW },
+	};
+	const size_t TIER_COUNT = sizeof(TIERS) / sizeof(TIERS[0]);
+
+	struct Options
+	{
+#ifdef _WIN32
+		std::wstring image = L"Resources/Map.png";
+#else
+		std::wstring image;
+#endif
+		size_t crop[4] = { 512, 232, 256, 256 };
+		std::vector<size_t> tiers = { 0, 1, 2, 3, 4 };
+		size_t passes = 1;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--image")
+			{
+				std::string narrow = value;
+				options.image.assign(narrow.begin(), narrow.end());
+			}
+			else if (arg == "--passes") { options.passes = strtoul(value, nullptr, 10); }
+			else if (arg == "--crop")
+			{
+				const char* p = value;
+				for (size_t& v : options.crop)
+				{
+					char* end = nullptr;
+					v = strtoul(p, &end, 10);
+					if (end == p) { return false; }
+					p = *end == ',' ? end + 1 : end;
+				}
+				if (*p || options.crop[2] < 4 || options.crop[3] < 4) { return false; }
+			}
+			else if (arg == "--tiers")
+			{
+				options.tiers.clear();
+				std::string list = value;
+				for (size_t begin = 0; begin <= list.size();)
+				{
+					size_t end = list.find(',', begin);
+					if (end == std::string::npos) { end = list.size(); }
+					std::string name = list.substr(begin, end - begin);
+					size_t t = 0;
+					while (t < TIER_COUNT && name != TIERS[t].option) { t++; }
+					if (t == TIER_COUNT) { return false; }
+					options.tiers.push_back(t);
+					begin = end + 1;
+				}
+			}
+			else { return false; }
+		}
+		return options.passes > 0 && !options.tiers.empty();
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	// RGBA8の画像(幅と高さは4の倍数)
+	struct Picture
+	{
+		std::string name;
+		size_t width = 0, height = 0;
+		std::vector<uint8_t> pixels;
+	};
+
+	// FILEを読んでRGBA8にし、切り出す
+	bool LoadCrop(const Options& options, Picture& picture)
+	{
+		if (options.image.empty()) { return false; }
+		const std::wstring& path = options.image;
+		std::wstring ext = path.substr(path.find_last_of(L'.') + 1);
+		for (wchar_t& c : ext) { c = (wchar_t)towlower(c); }
+
+		ScratchImage loaded;
+		HRESULT result = E_FAIL;
+		if (ext == L"dds") { result = LoadFromDDSFile(path.c_str(), DDS_FLAGS_NONE, nullptr, loaded); }
+		else if (ext == L"tga") { result = LoadFromTGAFile(path.c_str(), TGA_FLAGS_NONE, nullptr, loaded); }
+#ifdef _WIN32
+		else { result = LoadFromWICFile(path.c_str(), WIC_FLAGS_IGNORE_SRGB, nullptr, loaded); }
+#endif
+		if (FAILED(result)) { return false; }
+
+		const Image* source = loaded.GetImage(0, 0, 0);
+		ScratchImage converted;
+		if (IsCompressed(source->format))
+		{
+			if (FAILED(Decompress(*source, DXGI_FORMAT_R8G8B8A8_UNORM, converted))) { return false; }
+			source = converted.GetImage(0, 0, 0);
+		}
+		else if (MakeTypeless(source->format) != DXGI_FORMAT_R8G8B8A8_TYPELESS)
+		{
+			if (FAILED(Convert(*source, DXGI_FORMAT_R8G8B8A8_UNORM, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, converted))) { return false; }
+			source = converted.GetImage(0, 0, 0);
+		}
+
+		size_t x = options.crop[0], y = options.crop[1];
+		size_t width = options.crop[2] & ~size_t(3), height = options.crop[3] & ~size_t(3);
+		if (x + width > source->width || y + height > source->height) { return false; }
+		std::string file;
+		for (wchar_t c : path.substr(path.find_last_of(L"/\\") + 1)) { file += c < 0x80 ? (char)c : '?'; }
+		picture.name = file + " " + std::to_string(width) + "x" + std::to_string(height) + " crop";
+		picture.width = width;
+		picture.height = height;
+		picture.pixels.resize(width * height * 4);
+		for (size_t row = 0; row < height; row++)
+		{
+			memcpy(&picture.pixels[row * width * 4], source->pixels + (y + row) * source->rowPitch + x * 4, width * 4);
+		}
+		return true;
+	}
+
+	float ValueNoise(const std::vector<float>& grid, int size, float x, float y)
+	{
+		int ix = (int)x, iy = (int)y;
+		float fx = x - (float)ix, fy = y - (float)iy;
+		fx = fx * fx * (3.0f - 2.0f * fx);
+		fy = fy * fy * (3.0f - 2.0f * fy);
+		auto at = [&](int a, int b) { return grid[(size_t)((b % size) * size + (a % size))]; };
+		return (at(ix, iy) * (1.0f - fx) + at(ix + 1, iy) * fx) * (1.0f - fy) +
+			(at(ix, iy + 1) * (1.0f - fx) + at(ix + 1, iy + 1) * fx) * fy;
+	}
+
+	// 写真の代わり(4オクターブのfBm、不透明)
+	Picture MakePhoto()
+	{
+		Picture picture{ "synthetic photo (fBm)", 256, 256, std::vector<uint8_t>(256 * 256 * 4) };
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+		std::vector<float> grids[3];
+		for (std::vector<float>& grid : grids)
+		{
+			grid.resize(64 * 64);
+			for (float& f : grid) { f = uniform(rng); }
+		}
+		for (size_t y = 0; y < 256; y++)
+		{
+			for (size_t x = 0; x < 256; x++)
+			{
+				uint8_t* p = &picture.pixels[(y * 256 + x) * 4];
+				for (int c = 0; c < 3; c++)
+				{
+					float sum = 0.0f, amplitude = 0.5f, frequency = 1.0f / 32.0f;
+					for (int octave = 0; octave < 4; octave++)
+					{
+						sum += amplitude * ValueNoise(grids[c], 64, (float)x * frequency, (float)y * frequency);
+						amplitude *= 0.5f;
+						frequency *= 2.0f;
+					}
+					p[c] = (uint8_t)(std::min)(255.0f, sum * 270.0f);
+				}
+				p[3] = 255;
+			}
+		}
+		return picture;
+	}
+
+	// UIの代わり(5色の平らなセルと縁、中央の丸いアルファ)
+	Picture MakeUI()
+	{
+		Picture picture{ "synthetic UI (flat + edges + alpha)", 256, 256, std::vector<uint8_t>(256 * 256 * 4) };
+		const uint8_t palette[5][3] = { { 30, 30, 40 }, { 200, 60, 50 }, { 240, 240, 240 }, { 60, 140, 220 }, { 90, 200, 90 } };
+		for (size_t y = 0; y < 256; y++)
+		{
+			for (size_t x = 0; x < 256; x++)
+			{
+				uint8_t* p = &picture.pixels[(y * 256 + x) * 4];
+				size_t cell = (x / 37 + y / 29) % 5;
+				for (int c = 0; c < 3; c++) { p[c] = palette[cell][c]; }
+				float dx = (float)x - 128.0f, dy = (float)y - 128.0f;
+				float r = sqrtf(dx * dx + dy * dy);
+				p[3] = (uint8_t)(r < 80.0f ? 255.0f : (r > 110.0f ? 0.0f : 255.0f * (110.0f - r) / 30.0f));
+			}
+		}
+		return picture;
+	}
+
+	void LoadBlock(const Picture& picture, size_t bx, size_t by, XMVECTOR colors[NUM_PIXELS_PER_BLOCK])
+	{
+		for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
+		{
+			const uint8_t* p = &picture.pixels[((by + i / 4) * picture.width + bx + i % 4) * 4];
+			colors[i] = XMVectorSet(p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f);
+		}
+	}
+
+	void Encode(const Picture& picture, uint32_t flags, std::vector<uint8_t>& out)
+	{
+		out.resize(picture.width / 4 * picture.height / 4 * 16);
+		size_t b = 0;
+		for (size_t by = 0; by < picture.height; by += 4)
+		{
+			for (size_t bx = 0; bx < picture.width; bx += 4, b++)
+			{
+				XMVECTOR colors[NUM_PIXELS_PER_BLOCK];
+				LoadBlock(picture, bx, by, colors);
+				D3DXEncodeBC7(&out[b * 16], colors, flags);
+			}
+		}
+	}
+
+	// 展開して8bitに丸めたRGBAのPSNR
+	double PSNR(const Picture& picture, const std::vector<uint8_t>& encoded)
+	{
+		double sum = 0.0;
+		size_t b = 0;
+		for (size_t by = 0; by < picture.height; by += 4)
+		{
+			for (size_t bx = 0; bx < picture.width; bx += 4, b++)
+			{
+				XMVECTOR decoded[NUM_PIXELS_PER_BLOCK];
+				D3DXDecodeBC7(decoded, &encoded[b * 16]);
+				for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
+				{
+					XMFLOAT4 e;
+					XMStoreFloat4(&e, decoded[i]);
+					const float result[4] = { e.x, e.y, e.z, e.w };
+					const uint8_t* p = &picture.pixels[((by + i / 4) * picture.width + bx + i % 4) * 4];
+					for (int c = 0; c < 4; c++)
+					{
+						double d = (double)(int)(result[c] * 255.0f + 0.5f) - p[c];
+						sum += d * d;
+					}
+				}
+			}
+		}
+		double mse = sum / ((double)picture.width * picture.height * 4);
+		return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: BC7Benchmark [--image FILE] [--crop X,Y,W,H] [--tiers LIST] [--passes P]\n");
+		return 2;
+	}
+
+	std::vector<Picture> pictures;
+	Picture crop;
+	if (LoadCrop(options, crop)) { pictures.push_back(crop); }
+	else if (!options.image.empty()) { printf("could not load and crop the image, skipping it\n"); }
+	pictures.push_back(MakePhoto());
+	pictures.push_back(MakeUI());
+
+	bool allTiers = options.tiers.size() == TIER_COUNT;
+	printf("| %-35s | %-14s | %6s | %8s |\n", "Image", "Tier", "PSNR", "kblk/s");
+	printf("|-------------------------------------|----------------|--------|----------|\n");
+	for (const Picture& picture : pictures)
+	{
+		double psnr[TIER_COUNT] = {}, rate[TIER_COUNT] = {};
+		size_t blocks = picture.width / 4 * picture.height / 4;
+		for (size_t t : options.tiers)
+		{
+			std::vector<uint8_t> out;
+			double best = 0.0;
+			for (size_t pass = 0; pass < options.passes; pass++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				Encode(picture, TIERS[t].flags, out);
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if (pass == 0 || seconds < best) { best = seconds; }
+			}
+			psnr[t] = PSNR(picture, out);
+			rate[t] = blocks / best * 1e-3;
+			printf("| %-35s | %-14s | %6.2f | %8.3f |\n", picture.name.c_str(), TIERS[t].name, psnr[t], rate[t]);
+			fflush(stdout);
+		}
+		if (allTiers)
+		{
+			Check(rate[0] > rate[3] && rate[1] > rate[3], "the fast tiers should be faster than the default search");
+			Check(psnr[4] >= psnr[3], "the slow tier should not lose quality against the default search");
+		}
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+﻿// BC1/BC3の圧縮を、1ブロックずつの経路とTEX_COMPRESS_BATCH(_FAST)のまとめて圧縮する経路で比べる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -IDirectXTex BCBenchmark.cpp DirectXTex/BC.cpp -o BCBenchmark
+//   (DirectXMathとDirectX-Headersのincludeも通す。Windowsではcl /std:c++17 /O2 /EHsc /IDirectXTexで同じファイルをビルドする)
+// 使い方
+//   BCBenchmark [--blocks N] [--passes P] [--uniform]
+//   グラデーションにノイズを乗せたN個(既定262144)のブロックを、経路ごとにP回(既定3)圧縮して一番速い回のMブロック/秒を出す
+//   展開して元の色との二乗誤差(0から255の目盛り)も出す
+//   batchの結果が1ブロックずつの結果とビット単位で一致しなければ1を返す(batch-fastは一致しなくてよい)
+#include "DirectXTexP.h"
+#include "BC.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Options
+	{
+		size_t blocks = 262144;
+		size_t passes = 3;
+		uint32_t flags = 0;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (arg == "--uniform") { options.flags |= BC_FLAGS_UNIFORM; continue; }
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--blocks") { options.blocks = strtoul(value, nullptr, 10); }
+			else if (arg == "--passes") { options.passes = strtoul(value, nullptr, 10); }
+			else { return false; }
+		}
+		// まとめて圧縮する単位にそろえる
+		options.blocks = (options.blocks + BC_BATCH_SIZE - 1) / BC_BATCH_SIZE * BC_BATCH_SIZE;
+		return options.blocks > 0 && options.passes > 0;
+	}
+
+	// テクスチャらしいブロック(なだらかな色の傾きにノイズ)を作る。alphaが無ければ不透明にする
+	// ノイズの強さは3段階で、平らなブロックから荒れたブロックまで混ぜる
+	void MakeBlocks(std::vector<XMVECTOR>& colors, size_t blocks, bool alpha)
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> base(0.0f, 1.0f);
+		std::normal_distribution<float> normal(0.0f, 1.0f);
+		colors.resize(blocks * NUM_PIXELS_PER_BLOCK);
+		for (size_t b = 0; b < blocks; b++)
+		{
+			float origin[4], slopeX[4], slopeY[4];
+			for (int c = 0; c < 4; c++)
+			{
+				origin[c] = base(rng);
+				slopeX[c] = normal(rng) * 0.05f;
+				slopeY[c] = normal(rng) * 0.05f;
+			}
+			float noise = (float)(b % 3) * 0.02f;
+			for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
+			{
+				float value[4];
+				for (int c = 0; c < 4; c++)
+				{
+					float v = origin[c] + slopeX[c] * (float)(i & 3) + slopeY[c] * (float)(i >> 2) + normal(rng) * noise;
+					value[c] = (std::min)(1.0f, (std::max)(0.0f, v));
+				}
+				colors[b * NUM_PIXELS_PER_BLOCK + i] = XMVectorSet(value[0], value[1], value[2], alpha ? value[3] : 1.0f);
+			}
+		}
+	}
+
+	enum Format { BC1, BC3 };
+
+	struct Path
+	{
+		const char* name;
+		bool batch;
+		uint32_t flags;
+	};
+	const Path PATHS[] =
+	{
+		{ "scalar", false, 0 },
+		{ "batch", true, BC_FLAGS_BATCH },
+		{ "batch-fast", true, BC_FLAGS_BATCH | BC_FLAGS_BATCH_FAST },
+	};
+
+	void Encode(Format format, const Path& path, uint32_t flags, const std::vector<XMVECTOR>& colors, size_t blocks, std::vector<uint8_t>& out)
+	{
+		const size_t blockSize = format == BC1 ? 8 : 16;
+		out.resize(blocks * blockSize);
+		flags |= path.flags;
+		if (path.batch)
+		{
+			if (format == BC1) { D3DXEncodeBC1Batch(out.data(), colors.data(), blocks, TEX_THRESHOLD_DEFAULT, flags); }
+			else { D3DXEncodeBC3Batch(out.data(), colors.data(), blocks, TEX_THRESHOLD_DEFAULT, flags); }
+			return;
+		}
+		for (size_t b = 0; b < blocks; b++)
+		{
+			const XMVECTOR* block = &colors[b * NUM_PIXELS_PER_BLOCK];
+			if (format == BC1) { D3DXEncodeBC1(&out[b * blockSize], block, TEX_THRESHOLD_DEFAULT, flags); }
+			else { D3DXEncodeBC3(&out[b * blockSize], block, flags); }
+		}
+	}
+
+	// 展開して、色(BC1はRGB、BC3はRGBA)の1成分あたりの二乗誤差を0から255の目盛りで返す
+	double MeanSquaredError(Format format, const std::vector<XMVECTOR>& colors, size_t blocks, const std::vector<uint8_t>& encoded)
+	{
+		const size_t blockSize = format == BC1 ? 8 : 16;
+		const int channels = format == BC1 ? 3 : 4;
+		double sum = 0.0;
+		for (size_t b = 0; b < blocks; b++)
+		{
+			XMVECTOR decoded[NUM_PIXELS_PER_BLOCK];
+			if (format == BC1) { D3DXDecodeBC1(decoded, &encoded[b * blockSize]); }
+			else { D3DXDecodeBC3(decoded, &encoded[b * blockSize]); }
+			for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
+			{
+				XMFLOAT4 a, e;
+				XMStoreFloat4(&a, colors[b * NUM_PIXELS_PER_BLOCK + i]);
+				XMStoreFloat4(&e, decoded[i]);
+				const float source[4] = { a.x, a.y, a.z, a.w }, result[4] = { e.x, e.y, e.z, e.w };
+				for (int c = 0; c < channels; c++)
+				{
+					double d = ((double)result[c] - (double)source[c]) * 255.0;
+					sum += d * d;
+				}
+			}
+		}
+		return sum / ((double)blocks * NUM_PIXELS_PER_BLOCK * channels);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: BCBenchmark [--blocks N] [--passes P] [--uniform]\n");
+		return 2;
+	}
+
+	int failures = 0;
+	printf("blocks %zu passes %zu%s\n", options.blocks, options.passes, (options.flags & BC_FLAGS_UNIFORM) ? " uniform" : "");
+	printf("%6s %12s %12s %10s %10s\n", "format", "path", "Mblocks/s", "MSE", "mismatch");
+	for (Format format : { BC1, BC3 })
+	{
+		// BC1はアルファがしきい値を下回ると黒く抜けるので、不透明なブロックで比べる
+		std::vector<XMVECTOR> colors;
+		MakeBlocks(colors, options.blocks, format == BC3);
+		const size_t blockSize = format == BC1 ? 8 : 16;
+		std::vector<uint8_t> reference;
+		for (const Path& path : PATHS)
+		{
+			std::vector<uint8_t> out;
+			double best = 0.0;
+			for (size_t pass = 0; pass < options.passes; pass++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				Encode(format, path, options.flags, colors, options.blocks, out);
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if (pass == 0 || seconds < best) { best = seconds; }
+			}
+			if (!path.batch) { reference = out; }
+
+			// 1ブロックずつの結果と違うブロックを数える
+			size_t mismatch = 0;
+			for (size_t b = 0; b < options.blocks; b++)
+			{
+				if (memcmp(&out[b * blockSize], &reference[b * blockSize], blockSize)) { mismatch++; }
+			}
+			printf("%6s %12s %12.3f %10.4f %10zu\n", format == BC1 ? "BC1" : "BC3", path.name,
+				options.blocks / best * 1e-6, MeanSquaredError(format, colors, options.blocks, out), mismatch);
+			if (path.batch && !(path.flags & BC_FLAGS_BATCH_FAST) && mismatch)
+			{
+				printf("FAIL: %s %s differs from the scalar encoder in %zu blocks\n", format == BC1 ? "BC1" : "BC3", path.name, mismatch);
+				failures++;
+			}
+		}
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -1,4 +1,8 @@
 #include "Buffer.h"
+#include "MyClass.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
 void Buffer::SetResource(size_t width, size_t height, D3D12_RESOURCE_DIMENSION Dimension)
 {
 	resDesc.Dimension = Dimension;
@@ -9,19 +13,168 @@ void Buffer::SetResource(size_t width, size_t height, D3D12_RESOURCE_DIMENSION D
 	resDesc.SampleDesc.Count = 1;
 	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 }
-void Buffer::CreateBuffer(ID3D12Device* device)
+void Buffer::CreateBuffer(ID3D12Device* device, D3D12_RESOURCE_STATES state)
 {
 	assert(SUCCEEDED(
 		device->CreateCommittedResource(
 			&heapProp, D3D12_HEAP_FLAG_NONE,
 			&resDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
+			state,
 			nullptr, IID_PPV_ARGS(&buff))));
 }
+void Buffer::CreateBuffer(UploadRing& ring)
+{
+	UploadAllocation allocation = ring.Allocate((size_t)resDesc.Width);
+	assert(allocation.cpu);
+	buff = (ID3D12Resource*)allocation.resource;
+	offset = allocation.offset;
+	mapped = allocation.cpu;
+}
 void Buffer::Init()
 {
 	resDesc = {};
 	buff = nullptr;
+	offset = 0;
+	mapped = nullptr;
+}
+
+bool UploadHeap::CreatePage(size_t size, UploadPage& page)
+{
+	D3D12_HEAP_PROPERTIES heapProp{};
+	heapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
+	D3D12_RESOURCE_DESC resDesc{};
+	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resDesc.Width = size;
+	resDesc.Height = 1;
+	resDesc.DepthOrArraySize = 1;
+	resDesc.MipLevels = 1;
+	resDesc.SampleDesc.Count = 1;
+	resDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	ID3D12Resource* resource = nullptr;
+	if (FAILED(devicePtr->CreateCommittedResource(
+		&heapProp, D3D12_HEAP_FLAG_NONE, &resDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&resource)))) {
+		return false;
+	}
+
+	// y[W͔j܂Ń}bv܂܂ɂ
+	void* cpu = nullptr;
+	if (FAILED(resource->Map(0, nullptr, &cpu)))
+	{
+		resource->Release();
+		return false;
+	}
+	page.resource = resource;
+	page.cpu = (uint8_t*)cpu;
+	page.gpu = resource->GetGPUVirtualAddress();
+	page.size = size;
+	return true;
+}
+void UploadHeap::DestroyPage(UploadPage& page)
+{
+	ID3D12Resource* resource = (ID3D12Resource*)page.resource;
+	resource->Unmap(0, nullptr);
+	resource->Release();
+}
+
+CopyQueue::CopyQueue(ID3D12Device* device, Fence* fence)
+{
+	devicePtr = device;
+	fencePtr = fence;
+	recording = false;
+
+	D3D12_COMMAND_QUEUE_DESC queueDesc{};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	HRESULT result = devicePtr->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue));
+	assert(SUCCEEDED(result));
+	allocator = nullptr;
+	result = devicePtr->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator));
+	assert(SUCCEEDED(result));
+	list = nullptr;
+	result = devicePtr->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator, nullptr, IID_PPV_ARGS(&list));
+	assert(SUCCEEDED(result));
+	list->Close(); // ŏ̃Rs[ŃZbg܂ŕĂ
+	retired.push_back({ allocator, 0 });
+	allocator = nullptr;
+}
+void CopyQueue::Begin()
+{
+	if (recording) { return; }
+	// Rs[L[gIAP[^g񂵁AΑ₷
+	UINT64 completed = fencePtr->f->GetCompletedValue();
+	for (size_t i = 0; i < retired.size(); i++)
+	{
+		if (retired[i].fenceVal > completed) { continue; }
+		allocator = retired[i].allocator;
+		retired[i] = retired.back();
+		retired.pop_back();
+		break;
+	}
+	HRESULT result = S_OK;
+	if (allocator) { result = allocator->Reset(); }
+	else { result = devicePtr->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator)); }
+	assert(SUCCEEDED(result));
+	result = list->Reset(allocator, nullptr);
+	assert(SUCCEEDED(result));
+	recording = true;
+}
+void CopyQueue::CopyTexture(void* texture, uint32_t subresource, void* staging, const TextureFootprint& footprint)
+{
+	Begin();
+	ID3D12Resource* resource = (ID3D12Resource*)texture;
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+
+	// COMMOÑeNX`̓Rs[L[COPY_DESTɈÖقɏiAsCOMMON֖߂
+	D3D12_TEXTURE_COPY_LOCATION dst{};
+	dst.pResource = resource;
+	dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	dst.SubresourceIndex = subresource;
+
+	D3D12_TEXTURE_COPY_LOCATION src{};
+	src.pResource = (ID3D12Resource*)staging;
+	src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	src.PlacedFootprint.Offset = footprint.offset;
+	src.PlacedFootprint.Footprint.Format = desc.Format;
+	src.PlacedFootprint.Footprint.Width = footprint.width;
+	src.PlacedFootprint.Footprint.Height = footprint.height;
+	src.PlacedFootprint.Footprint.Depth = footprint.depth;
+	src.PlacedFootprint.Footprint.RowPitch = footprint.rowPitch;
+	// k`̓ubNP(4x4)ɐ؂グ
+	if (IsCompressed(desc.Format))
+	{
+		src.PlacedFootprint.Footprint.Width = (footprint.width + 3) & ~3u;
+		src.PlacedFootprint.Footprint.Height = (footprint.height + 3) & ~3u;
+	}
+	list->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+}
+uint64_t CopyQueue::Submit()
+{
+	if (recording)
+	{
+		HRESULT result = list->Close();
+		assert(SUCCEEDED(result));
+		ID3D12CommandList* lists[] = { list };
+		queue->ExecuteCommandLists(1, lists);
+	}
+	UINT64 value = fencePtr->Signal(queue);
+	if (recording)
+	{
+		retired.push_back({ allocator, value });
+		allocator = nullptr;
+		recording = false;
+	}
+	return value;
+}
+uint64_t CopyQueue::GetCompletedValue()
+{
+	return fencePtr->f->GetCompletedValue();
+}
+void CopyQueue::HandOff(ID3D12CommandQueue* directQueue, UINT64 value)
+{
+	if (value == 0) { return; }
+	HRESULT result = directQueue->Wait(fencePtr->f, value);
+	assert(SUCCEEDED(result));
 }
 
 ConstBuf::ConstBuf(Type type)
@@ -45,6 +198,12 @@ ConstBuf::ConstBuf(Type type)
 }
 void ConstBuf::Mapping()
 {
+	if (mapped)
+	{
+		mapMaterial = (ConstBufferDataMaterial*)mapped;
+		mapTransform = (ConstBufferDataTransform*)mapped;
+		return;
+	}
 	switch (type)
 	{
 	case ConstBuf::Material:
@@ -60,65 +219,164 @@ VertexBuf::VertexBuf(UINT size)
 {
 	Init();
 	this->size = size;
+	stride = sizeof(Vertex);
 	map = nullptr;
 	view = {};
 }
 void VertexBuf::Mapping(Vertex* vertices, const int ARRAY_NUM)
 {
+	if (mapped)
+	{
+		map = (Vertex*)mapped;
+		memcpy(map, vertices, sizeof(Vertex) * ARRAY_NUM);
+		return;
+	}
 	assert(SUCCEEDED(buff->Map(0, nullptr, (void**)&map)));
 
-	for (int i = 0; i < ARRAY_NUM; i++) { map[i] = vertices[i]; }
+	memcpy(map, vertices, sizeof(Vertex) * ARRAY_NUM);
 	buff->Unmap(0, nullptr);
 }
 void VertexBuf::CreateView()
 {
-	view.BufferLocation = buff->GetGPUVirtualAddress();
+	view.BufferLocation = GetGPUVirtualAddress();
 	view.SizeInBytes = size;
-	view.StrideInBytes = sizeof(Vertex);
+	view.StrideInBytes = stride;
+}
+void VertexBuf::Create(ID3D12Device* device, const MeshFile& mesh)
+{
+	stride = mesh.GetVertexStride();
+	size = (UINT)(mesh.GetVertexCount() * stride);
+	SetResource(size, 1, D3D12_RESOURCE_DIMENSION_BUFFER);
+	SetHeapProp(D3D12_HEAP_TYPE_UPLOAD);
+	CreateBuffer(device);
+
+	void* dest = nullptr;
+	HRESULT result = buff->Map(0, nullptr, &dest);
+	assert(SUCCEEDED(result));
+	memcpy(dest, mesh.GetVertices(), size);
+	buff->Unmap(0, nullptr);
+	CreateView();
 }
 
 IndexBuf::IndexBuf(UINT size)
 {
 	Init();
 	this->size = size;
+	format = DXGI_FORMAT_R16_UINT;
 	map = nullptr;
 	view = {};
 }
 void IndexBuf::Mapping(uint16_t* indices, const int ARRAY_NUM)
 {
+	if (mapped)
+	{
+		map = (uint16_t*)mapped;
+		memcpy(map, indices, sizeof(uint16_t) * ARRAY_NUM);
+		return;
+	}
 	assert(SUCCEEDED(buff->Map(0, nullptr, (void**)&map)));
 
-	for (int i = 0; i < ARRAY_NUM; i++) { map[i] = indices[i]; }
+	memcpy(map, indices, sizeof(uint16_t) * ARRAY_NUM);
 	buff->Unmap(0, nullptr);
 }
 void IndexBuf::CreateView()
 {
-	view.BufferLocation = buff->GetGPUVirtualAddress();
-	view.Format = DXGI_FORMAT_R16_UINT;
+	view.BufferLocation = GetGPUVirtualAddress();
+	view.Format = format;
 	view.SizeInBytes = size;
 }
+void IndexBuf::Create(ID3D12Device* device, const MeshFile& mesh)
+{
+	const void* lodIndices = nullptr;
+	size_t lodSize = 0;
+	if (!mesh.FindChunk(MeshFile::CHUNK_LOD_INDICES, lodIndices, lodSize)) { lodSize = 0; }
+	size_t indexSize = mesh.GetIndexCount() * mesh.GetIndexSize();
+	format = mesh.GetIndexSize() == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+	size = (UINT)(indexSize + lodSize);
+	SetResource(size, 1, D3D12_RESOURCE_DIMENSION_BUFFER);
+	SetHeapProp(D3D12_HEAP_TYPE_UPLOAD);
+	CreateBuffer(device);
+
+	uint8_t* dest = nullptr;
+	HRESULT result = buff->Map(0, nullptr, (void**)&dest);
+	assert(SUCCEEDED(result));
+	memcpy(dest, mesh.GetIndices(), indexSize);
+	if (lodSize) { memcpy(dest + indexSize, lodIndices, lodSize); }
+	buff->Unmap(0, nullptr);
+	CreateView();
+}
 
-TextureBuf::TextureBuf()
+DynamicVertexBuf::DynamicVertexBuf(DynamicBuffer* buffer)
 {
-	Init();
+	bufferPtr = buffer;
 	view = {};
-	metadata = {};
-	scratchImg = {};
-	mipChain = {};
+}
+VertexBuf::Vertex* DynamicVertexBuf::Map(UINT count)
+{
+	UploadAllocation allocation = bufferPtr->Allocate(sizeof(VertexBuf::Vertex) * count);
+	if (!allocation.cpu) { return nullptr; }
+	view.BufferLocation = allocation.gpu;
+	view.SizeInBytes = (UINT)allocation.size;
+	view.StrideInBytes = sizeof(VertexBuf::Vertex);
+	return (VertexBuf::Vertex*)allocation.cpu;
+}
+bool DynamicVertexBuf::Write(const VertexBuf::Vertex* vertices, UINT count)
+{
+	VertexBuf::Vertex* map = Map(count);
+	if (!map) { return false; }
+	memcpy(map, vertices, sizeof(VertexBuf::Vertex) * count);
+	return true;
+}
 
-	LoadFromWICFile(L"Resources/Map.png", WIC_FLAGS_NONE, &metadata, scratchImg);
+DynamicIndexBuf::DynamicIndexBuf(DynamicBuffer* buffer)
+{
+	bufferPtr = buffer;
+	view = {};
+}
+uint16_t* DynamicIndexBuf::Map(UINT count)
+{
+	UploadAllocation allocation = bufferPtr->Allocate(sizeof(uint16_t) * count);
+	if (!allocation.cpu) { return nullptr; }
+	view.BufferLocation = allocation.gpu;
+	view.Format = DXGI_FORMAT_R16_UINT;
+	view.SizeInBytes = (UINT)allocation.size;
+	return (uint16_t*)allocation.cpu;
+}
+bool DynamicIndexBuf::Write(const uint16_t* indices, UINT count)
+{
+	uint16_t* map = Map(count);
+	if (!map) { return false; }
+	memcpy(map, indices, sizeof(uint16_t) * count);
+	return true;
+}
 
-	HRESULT result = GenerateMipMaps(scratchImg.GetImages(), scratchImg.GetImageCount(),
-		scratchImg.GetMetadata(), TEX_FILTER_DEFAULT, 0, mipChain);
-	if (SUCCEEDED(result))
-	{
-		scratchImg = std::move(mipChain);
-		metadata = scratchImg.GetMetadata();
-	}
+TextureBuf::TextureBuf(ID3D12Device* device, Fence* fence, ShaderResourceView* srv, TextureUploader* uploader)
+{
+	Init();
+	devicePtr = device;
+	fencePtr = fence;
+	srvPtr = srv;
+	uploaderPtr = uploader;
+	viewFenceVal = 0;
+	viewResource = nullptr;
+	index = srvPtr->allocator.Allocate();
+	assert(index != DescriptorAllocator::INVALID);
+	gpuHandle = srvPtr->GetGPUHandle(index);
 
-	metadata.format = MakeSRGB(metadata.format);
+	// ŏ̃~bv͂܂łnull SRVœɕ`
+	view = {};
+	view.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	view.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	view.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	view.Texture2D.MipLevels = 1;
+	devicePtr->CreateShaderResourceView(nullptr, &view, srvPtr->GetCPUHandle(index));
+}
+TextureBuf::~TextureBuf()
+{
+	ReleaseRetired(UINT64_MAX);
+	if (buff) { buff->Release(); }
 }
-void TextureBuf::SetResource()
+void TextureBuf::SetResource(const TexMetadata& metadata)
 {
 	resDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 	resDesc.Format = metadata.format;
@@ -128,33 +386,92 @@ void TextureBuf::SetResource()
 	resDesc.MipLevels = (UINT16)metadata.mipLevels;
 	resDesc.SampleDesc.Count = 1;
 }
-void TextureBuf::CreateMipMap()
+void TextureBuf::ReleaseRetired(UINT64 completed)
 {
-	HRESULT result = GenerateMipMaps(scratchImg.GetImages(), scratchImg.GetImageCount(),
-		scratchImg.GetMetadata(), TEX_FILTER_DEFAULT, 0, mipChain);
-	if (SUCCEEDED(result))
+	for (size_t i = 0; i < retired.size();)
 	{
-		scratchImg = std::move(mipChain);
-		metadata = scratchImg.GetMetadata();
+		if (retired[i].fenceVal > completed) { i++; continue; }
+		retired[i].buff->Release();
+		retired[i] = retired.back();
+		retired.pop_back();
 	}
 }
-void TextureBuf::Transfer()
+void TextureBuf::WriteView(ID3D12Resource* resource)
 {
-	HRESULT result;
+	// L^Ăt[̃tFXl
+	UINT64 frameFenceVal = fencePtr->val + 1;
+	if (viewFenceVal != frameFenceVal)
+	{
+		// GPUǂłSRV͏VԍgAÂԍ
+		// L^̃t[(ɌÂԍEĂ邩Ȃ)IĂ
+		srvPtr->Free(index, frameFenceVal);
+		index = srvPtr->allocator.Allocate();
+		assert(index != DescriptorAllocator::INVALID);
+		gpuHandle = srvPtr->GetGPUHandle(index);
+	}
+	// t[ŏ̂͂܂GPUɓnĂȂ̂ŁÂ܂܏
+	viewFenceVal = frameFenceVal;
+	viewResource = resource;
+	devicePtr->CreateShaderResourceView(resource, &view, srvPtr->GetCPUHandle(index));
+}
+void TextureBuf::Allocate(const TexMetadata& metadata)
+{
+	PROFILE_ZONE("TextureBuf::Allocate");
+	ReleaseRetired(fencePtr->f->GetCompletedValue());
+	// 蒼́AL^̃t[ƃRs[L[gIĂ
+	if (buff) { retired.push_back({ buff, fencePtr->val + 1 }); }
+	buff = nullptr;
 
-	for (size_t i = 0; i < metadata.mipLevels; i++)
+	SetResource(metadata);
+	// Rs[L[悤COMMONō(`L[œǂގSRVֈÖقɏi)
+	CreateBuffer(devicePtr, uploaderPtr ? D3D12_RESOURCE_STATE_COMMON : D3D12_RESOURCE_STATE_GENERIC_READ);
+}
+void TextureBuf::Upload(size_t mip, const Image& image)
+{
+	PROFILE_ZONE("TextureBuf::Upload");
+	// ̂͂܂SRVŌĂȂ~bvȂ̂ŁA`撆̃t[ǂރ~bvƂ͏dȂȂ
+	if (uploaderPtr)
 	{
-		const Image* IMG = scratchImg.GetImage(i, 0, 0);
-		result = buff->WriteToSubresource(
-			(UINT)i, nullptr, IMG->pixels,
-			(UINT)IMG->rowPitch, (UINT)IMG->slicePitch);
-		assert(SUCCEEDED(result));
+		// PrepareUploadƓAImage̒l̂܂܃Tu\[X̓]ɂ
+		TextureSubresource subresource = { image.pixels, image.rowPitch, image.slicePitch, (uint32_t)image.width, (uint32_t)image.height, 1 };
+		bool uploaded = uploaderPtr->Upload(buff, (uint32_t)mip, &subresource, 1);
+		assert(uploaded);
+		return;
 	}
+	HRESULT result = buff->WriteToSubresource(
+		(UINT)mip, nullptr, image.pixels,
+		(UINT)image.rowPitch, (UINT)image.slicePitch);
+	assert(SUCCEEDED(result));
 }
-void TextureBuf::CreateView()
+void TextureBuf::SetMostDetailedMip(size_t mostDetailedMip)
 {
+	// \[X͍蒼A~bv͈̔͂ς
 	view.Format = resDesc.Format;
 	view.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	view.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	view.Texture2D.MipLevels = resDesc.MipLevels;
+	view.Texture2D.MostDetailedMip = (UINT)mostDetailedMip;
+	view.Texture2D.MipLevels = (UINT)(resDesc.MipLevels - mostDetailedMip);
+	view.Texture2D.ResourceMinLODClamp = (FLOAT)mostDetailedMip;
+	WriteView(buff);
+}
+void TextureBuf::Release()
+{
+	ReleaseRetired(fencePtr->f->GetCompletedValue());
+	if (buff) { retired.push_back({ buff, fencePtr->val + 1 }); }
+	buff = nullptr;
+
+	// null SRVɖ߂
+	view.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	view.Texture2D.MostDetailedMip = 0;
+	view.Texture2D.MipLevels = 1;
+	view.Texture2D.ResourceMinLODClamp = 0.0f;
+	WriteView(nullptr);
+}
+D3D12_GPU_DESCRIPTOR_HANDLE TextureBuf::WriteTransientView()
+{
+	// viewResource͌ÂĂtFX҂Ă̂ŁÃt[̊Ԃ͐Ă
+	UINT transient = srvPtr->allocator.AllocateTransient(1);
+	if (transient == DescriptorAllocator::INVALID) { return gpuHandle; }
+	devicePtr->CreateShaderResourceView(viewResource, &view, srvPtr->GetCPUHandle(transient));
+	return srvPtr->GetGPUHandle(transient);
 }
\ No newline at end of file
@@ -3,11 +3,23 @@
 #include <cassert>
 #include <DirectXMath.h>
 #include <DirectXTex.h>
+#include <vector>
+#include "DynamicBuffer.h"
+#include "MeshFile.h"
+#include "TextureStreamer.h"
+#include "TextureUploader.h"
+#include "UploadRing.h"
 using namespace DirectX;
 
+class Fence;
+class ShaderResourceView;
+
 class Buffer
 {
 protected:
+	UINT64 offset; // O؂oꍇbuff̃ItZbg
+	uint8_t* mapped; // O؂oꍇ̃}bvς݃AhX
+
 	void Init();
 public:
 	D3D12_RESOURCE_DESC resDesc;
@@ -23,7 +35,49 @@ public:
 		heapProp.CPUPageProperty = CPUPageProperty;
 		heapProp.MemoryPoolPreference = MemoryPoolPreference;
 	}
-	void CreateBuffer(ID3D12Device* device);
+	void CreateBuffer(ID3D12Device* device, D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_GENERIC_READ);
+	void CreateBuffer(UploadRing& ring); // ̃t[g̈O؂o
+	D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() { return buff->GetGPUVirtualAddress() + offset; }
+};
+
+// UploadRingUPLOADq[ṽy[Wn
+class UploadHeap :public UploadPageProvider
+{
+private:
+	ID3D12Device* devicePtr;
+public:
+	UploadHeap(ID3D12Device* device) { devicePtr = device; }
+	bool CreatePage(size_t size, UploadPage& page) override;
+	void DestroyPage(UploadPage& page) override;
+};
+
+// eNX`𑗂Rs[p̃L[(`L[Ƃ͕ʂɐi݁AtFXŎ󂯓n)
+class CopyQueue :public TextureCopyQueue
+{
+private:
+	struct Retired
+	{
+		ID3D12CommandAllocator* allocator;
+		UINT64 fenceVal;
+	};
+
+	ID3D12Device* devicePtr;
+	Fence* fencePtr;
+	ID3D12CommandAllocator* allocator; // L^̂
+	std::vector<Retired> retired; // o(ėp)
+	bool recording;
+
+	void Begin();
+public:
+	ID3D12CommandQueue* queue;
+	ID3D12GraphicsCommandList* list;
+
+	CopyQueue(ID3D12Device* device, Fence* fence);
+	void CopyTexture(void* texture, uint32_t subresource, void* staging, const TextureFootprint& footprint) override;
+	uint64_t Submit() override;
+	uint64_t GetCompletedValue() override;
+	// directQueueɁǍςރR}h̑Ovalue܂ł̃Rs[҂(GPUő҂̂CPU͎~܂Ȃ)
+	void HandOff(ID3D12CommandQueue* directQueue, UINT64 value);
 };
 
 class ConstBuf :public Buffer
@@ -57,10 +111,13 @@ private:
 public:
 	D3D12_VERTEX_BUFFER_VIEW view;
 	UINT size;
+	UINT stride; // VertexAʎqbVȂPackedVertex
 
 	VertexBuf(UINT size);
 	void Mapping(Vertex* vertices, const int ARRAY_NUM);
 	void CreateView();
+	// mesh̒_UPLOADq[vɒuăr[(sizestridemeshɍ킹)
+	void Create(ID3D12Device* device, const MeshFile& mesh);
 };
 
 class IndexBuf :public Buffer
@@ -70,23 +127,80 @@ private:
 public:
 	D3D12_INDEX_BUFFER_VIEW view;
 	UINT size;
+	DXGI_FORMAT format;
 
 	IndexBuf(UINT size);
 	void Mapping(uint16_t* indices, const int ARRAY_NUM);
 	void CreateView();
+	// mesh̃CfbNXUPLOADq[vɒuăr[
+	// LOD̃CfbNXINDX̌ɑ̂ŁAMeshLod̈ʒuł̂܂ܕ`
+	void Create(ID3D12Device* device, const MeshFile& mesh);
 };
 
-class TextureBuf :public Buffer
+// t[钸_(DynamicBuffer؂oAr[̗͂̈w)
+class DynamicVertexBuf
 {
-	TexMetadata metadata;
-	ScratchImage scratchImg;
-	ScratchImage mipChain;
+private:
+	DynamicBuffer* bufferPtr;
+public:
+	D3D12_VERTEX_BUFFER_VIEW view;
+
+	DynamicVertexBuf(DynamicBuffer* buffer);
+	// count̏ݐ(̂܂ܒ_ΎʂԂ)B܂Ȃnullptr
+	VertexBuf::Vertex* Map(UINT count);
+	bool Write(const VertexBuf::Vertex* vertices, UINT count);
+};
+
+// t[CfbNX
+class DynamicIndexBuf
+{
+private:
+	DynamicBuffer* bufferPtr;
+public:
+	D3D12_INDEX_BUFFER_VIEW view;
+
+	DynamicIndexBuf(DynamicBuffer* buffer);
+	uint16_t* Map(UINT count);
+	bool Write(const uint16_t* indices, UINT count);
+};
+
+class TextureBuf :public Buffer, public TextureUploadSink
+{
+private:
+	struct Retired
+	{
+		ID3D12Resource* buff;
+		UINT64 fenceVal;
+	};
+
+	ID3D12Device* devicePtr;
+	Fence* fencePtr;
+	ShaderResourceView* srvPtr;
+	UINT64 viewFenceVal; // ŌSRVt[̃tFXl
+	ID3D12Resource* viewResource; // ŌSRV\[X(蒼buffƈႤ)
+	std::vector<Retired> retired;
+	TextureUploader* uploaderPtr; // DEFAULTq[vɒuăRs[L[ő
+
+	void ReleaseRetired(UINT64 completed);
+	void WriteView(ID3D12Resource* resource);
 public:
 	D3D12_SHADER_RESOURCE_VIEW_DESC view;
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle;
+	UINT index; // srv̒̔ԍ(oChX̓Y)
 
-	TextureBuf();
-	void SetResource();
-	void CreateMipMap();
-	void Transfer();
-	void CreateView();
+	// uploadernȂDEFAULTq[vAWriteToSubresourceŏCUSTOMq[vSetHeapPropőI
+	TextureBuf(ID3D12Device* device, Fence* fence, ShaderResourceView* srv, TextureUploader* uploader = nullptr);
+	// GPUgIĂj(cĂÂ\[Xŉ)
+	~TextureBuf();
+	TextureBuf(const TextureBuf&) = delete;
+	TextureBuf& operator=(const TextureBuf&) = delete;
+
+	void SetResource(const TexMetadata& metadata);
+	void Allocate(const TexMetadata& metadata) override;
+	void Upload(size_t mip, const Image& image) override;
+	void SetMostDetailedMip(size_t mostDetailedMip) override;
+	void Release() override;
+
+	// 풓̔ԍƓSRVÃt[gꎞ̈ɏẴnhԂ(ȂgpuHandle)
+	D3D12_GPU_DESCRIPTOR_HANDLE WriteTransientView();
 };
\ No newline at end of file
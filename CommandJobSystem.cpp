@@ -0,0 +1,150 @@
+﻿#include "CommandJobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+
+CommandJobSystem::CommandJobSystem(size_t threadCount)
+{
+	func = nullptr;
+	rangeFunc = nullptr;
+	recorders = nullptr;
+	frameIndex = 0;
+	next = 0;
+	generation = 0;
+	wanted = 0;
+	claimed = 0;
+	active = 0;
+	shutdown = false;
+	dispatching = false;
+
+	if (threadCount == 0) { threadCount = (std::max)(std::thread::hardware_concurrency(), 1u); }
+	for (size_t i = 1; i < threadCount; i++) { workers.emplace_back(&CommandJobSystem::WorkerMain, this); }
+}
+CommandJobSystem::~CommandJobSystem()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		shutdown = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) { worker.join(); }
+}
+
+std::vector<CommandJobSystem::Range> CommandJobSystem::Partition(size_t itemCount, size_t count)
+{
+	std::vector<Range> result(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		result[i].begin = itemCount * i / count;
+		result[i].end = itemCount * (i + 1) / count;
+	}
+	return result;
+}
+
+size_t CommandJobSystem::Record(size_t frameIndex, size_t itemCount, size_t minItemsPerList,
+	const std::vector<CommandRecorder*>& recorders, const RecordFunc& func)
+{
+	if (itemCount == 0 || recorders.empty()) { return 0; }
+
+	minItemsPerList = (std::max)(minItemsPerList, size_t(1));
+	size_t count = (std::min)(recorders.size(), (itemCount + minItemsPerList - 1) / minItemsPerList);
+
+	this->func = &func;
+	this->recorders = &recorders;
+	this->frameIndex = frameIndex;
+	ranges = Partition(itemCount, count);
+	Dispatch(count);
+	this->func = nullptr;
+	this->recorders = nullptr;
+	return count;
+}
+size_t CommandJobSystem::ParallelFor(size_t itemCount, size_t minItemsPerJob, const RangeFunc& func)
+{
+	if (itemCount == 0) { return 0; }
+
+	minItemsPerJob = (std::max)(minItemsPerJob, size_t(1));
+	size_t count = (std::min)(GetThreadCount(), (itemCount + minItemsPerJob - 1) / minItemsPerJob);
+
+	rangeFunc = &func;
+	ranges = Partition(itemCount, count);
+	Dispatch(count);
+	rangeFunc = nullptr;
+	return count;
+}
+
+void CommandJobSystem::Dispatch(size_t count)
+{
+	// ジョブの中から呼ぶとrangesやnextを書き換えてしまう
+	bool nested = dispatching.exchange(true);
+	assert(!nested && "CommandJobSystem is not reentrant");
+	next = 0;
+
+	// 1つしか無ければワーカーを起こさない
+	if (count == 1 || workers.empty())
+	{
+		Execute();
+		dispatching = false;
+		return;
+	}
+
+	// 呼び出し元も1つ受け持つので、残りの数だけ起こす
+	size_t wakeCount = (std::min)(count - 1, workers.size());
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		wanted = wakeCount;
+		claimed = 0;
+		active = wakeCount;
+		generation++;
+	}
+	for (size_t i = 0; i < wakeCount; i++) { wake.notify_one(); }
+
+	Execute();
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		done.wait(guard, [&] { return active == 0; });
+	}
+	dispatching = false;
+}
+void CommandJobSystem::Execute()
+{
+	// 空いたスレッドから次の範囲を取っていく(提出順はrecordersの並びで決まる)
+	for (size_t i = next++; i < ranges.size(); i = next++)
+	{
+		PROFILE_ZONE("Job");
+		if (rangeFunc)
+		{
+			(*rangeFunc)(i, ranges[i].begin, ranges[i].end);
+			continue;
+		}
+		CommandRecorder& recorder = *(*recorders)[i];
+		recorder.Begin(frameIndex);
+		(*func)(recorder, ranges[i].begin, ranges[i].end);
+		recorder.End();
+	}
+}
+void CommandJobSystem::WorkerMain()
+{
+	PROFILE_THREAD("CommandJobSystem");
+	uint64_t seen = 0;
+	while (1)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			// 待ちに戻るのが遅れても、枠が残っていれば加わる(起こされなかった分は眠ったまま)
+			wake.wait(guard, [&] { return shutdown || (generation != seen && claimed < wanted); });
+			if (shutdown) { return; }
+			seen = generation;
+			claimed++;
+		}
+
+		Execute();
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			last = (--active == 0);
+		}
+		if (last) { done.notify_one(); }
+	}
+}
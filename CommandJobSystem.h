@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// コマンドリストとアロケータの組(D3D12の実装とテスト用の偽物を差し替えられる)
+class CommandRecorder
+{
+public:
+	virtual ~CommandRecorder() = default;
+	virtual void Begin(size_t frameIndex) = 0; // このフレームのアロケータでリセット
+	virtual void End() = 0; // 記録を閉じる
+};
+
+// 描画をチャンクに分け、ワーカースレッドがそれぞれ別のレコーダーへ並列に記録する
+class CommandJobSystem
+{
+public:
+	struct Range { size_t begin, end; };
+	using RecordFunc = std::function<void(CommandRecorder& recorder, size_t begin, size_t end)>;
+	using RangeFunc = std::function<void(size_t job, size_t begin, size_t end)>;
+
+	// threadCountが0ならコア数に合わせる(呼び出し元のスレッドも記録する)
+	CommandJobSystem(size_t threadCount = 0);
+	~CommandJobSystem();
+
+	CommandJobSystem(const CommandJobSystem&) = delete;
+	CommandJobSystem& operator=(const CommandJobSystem&) = delete;
+
+	// RecordとParallelForは再入できない。ジョブの中や、別のスレッドから同時に呼んではいけない
+
+	// itemCount個の描画を連続した範囲に分け、recorders[i]にi番目の範囲を記録する
+	// 1つのリストにはminItemsPerList個以上を割り当てる
+	// 戻り値は使ったレコーダー数で、recorders[0]から順に提出すれば元の順番になる
+	size_t Record(size_t frameIndex, size_t itemCount, size_t minItemsPerList,
+		const std::vector<CommandRecorder*>& recorders, const RecordFunc& func);
+
+	// コマンドを記録しない処理を同じスレッドで分ける(jobは0から始まる範囲の番号)
+	// 戻り値は分けた数で、範囲はPartition(itemCount, 戻り値)と同じ
+	size_t ParallelFor(size_t itemCount, size_t minItemsPerJob, const RangeFunc& func);
+
+	size_t GetThreadCount() const { return workers.size() + 1; }
+
+	// itemCount個をcount個の連続した範囲に、個数の差が1以下になるよう分ける
+	static std::vector<Range> Partition(size_t itemCount, size_t count);
+
+private:
+	std::vector<std::thread> workers;
+
+	// 実行中の記録(Record中のみ有効)
+	const RecordFunc* func;
+	const RangeFunc* rangeFunc;
+	const std::vector<CommandRecorder*>* recorders;
+	std::vector<Range> ranges;
+	size_t frameIndex;
+	std::atomic<size_t> next;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	uint64_t generation;
+	size_t wanted; // このgenerationで起こすワーカーの数
+	size_t claimed; // そのうち起きた数
+	size_t active;
+	bool shutdown;
+	std::atomic<bool> dispatching; // 再入の検出用
+
+	void Dispatch(size_t count);
+	void WorkerMain();
+	void Execute();
+};
@@ -0,0 +1,261 @@
+﻿// CommandJobSystemの分け方と記録の順番を偽物のレコーダーで確かめ、記録の並列化の伸びを測る(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread CommandJobSystemTest.cpp CommandJobSystem.cpp Profiler.cpp -o CommandJobSystemTest
+// 使い方
+//   CommandJobSystemTest [--threads K] [--cost NS] [--frames F] [--draws N,N,...]
+//   先に次を確かめる
+//   ・Partitionが連続した範囲に、個数の差が1以下になるよう分ける
+//   ・Recordで使ったレコーダーはどれもそのフレームで1回ずつBegin/Endされ、recorders[0]から順に並べると描画が元の順番になる
+//   ・使う数はレコーダーの数とminItemsPerListで決まり、使わなかったレコーダーには触れない
+//   ・ParallelForのjobの番号と範囲がPartitionと一致し、1スレッドなら呼び出し元だけで動く
+//   そのあと1つの描画の記録にNS(既定200)ナノ秒かかるとして、N個(既定1000,10000,100000)の描画をFフレーム(既定5)記録し、
+//   1スレッドとKスレッド(既定はコア数)の時間と伸びを出す
+//   失敗すると理由を出して1を返す
+#include "CommandJobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		size_t threads = 0;
+		double cost = 200.0;
+		size_t frames = 5;
+		std::vector<size_t> draws = { 1000, 10000, 100000 };
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--threads") { options.threads = strtoul(value, nullptr, 10); }
+			else if (arg == "--cost") { options.cost = atof(value); }
+			else if (arg == "--frames") { options.frames = strtoul(value, nullptr, 10); }
+			else if (arg == "--draws")
+			{
+				options.draws.clear();
+				for (const char* p = value; *p;)
+				{
+					char* end = nullptr;
+					size_t count = strtoul(p, &end, 10);
+					if (end == p || count == 0) { return false; }
+					options.draws.push_back(count);
+					p = *end == ',' ? end + 1 : end;
+				}
+			}
+			else { return false; }
+		}
+		return options.frames > 0 && options.cost >= 0.0 && !options.draws.empty();
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	// 記録された描画の番号と、Begin/Endの呼ばれ方を覚える
+	class MockRecorder :public CommandRecorder
+	{
+	public:
+		std::vector<size_t> items;
+		size_t frameIndex = SIZE_MAX;
+		size_t begins = 0;
+		size_t ends = 0;
+		bool open = false;
+		bool misuse = false;
+		std::thread::id thread;
+
+		void Begin(size_t frameIndex) override
+		{
+			if (open) { misuse = true; }
+			open = true;
+			this->frameIndex = frameIndex;
+			items.clear();
+			begins++;
+			thread = std::this_thread::get_id();
+		}
+		void End() override
+		{
+			if (!open) { misuse = true; }
+			open = false;
+			ends++;
+		}
+	};
+
+	// 与えた時間だけ回る(記録の重さの代わり)
+	void Spin(double nanoseconds)
+	{
+		auto start = std::chrono::steady_clock::now();
+		while (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() < nanoseconds) {}
+	}
+
+	void TestPartition()
+	{
+		for (size_t itemCount : { 0, 1, 7, 10, 1000, 1001 })
+		{
+			for (size_t count = 1; count <= 9; count++)
+			{
+				std::vector<CommandJobSystem::Range> ranges = CommandJobSystem::Partition(itemCount, count);
+				bool ok = ranges.size() == count && ranges.front().begin == 0 && ranges.back().end == itemCount;
+				size_t smallest = SIZE_MAX, largest = 0;
+				for (size_t i = 0; i < ranges.size(); i++)
+				{
+					if (i > 0 && ranges[i].begin != ranges[i - 1].end) { ok = false; }
+					smallest = (std::min)(smallest, ranges[i].end - ranges[i].begin);
+					largest = (std::max)(largest, ranges[i].end - ranges[i].begin);
+				}
+				Check(ok && largest - smallest <= 1, "Partition does not split into even contiguous ranges");
+			}
+		}
+	}
+
+	void TestRecord()
+	{
+		const size_t MIN_ITEMS = 16;
+		CommandJobSystem jobs(4);
+		std::vector<MockRecorder> mocks(8);
+		std::vector<CommandRecorder*> recorders;
+		for (MockRecorder& mock : mocks) { recorders.push_back(&mock); }
+
+		std::set<std::thread::id> threads;
+		for (size_t frame = 0; frame < 500; frame++)
+		{
+			size_t frameIndex = frame % 3;
+			size_t itemCount = (frame * 7919) % 3000;
+			std::vector<size_t> beginsBefore;
+			for (MockRecorder& mock : mocks) { beginsBefore.push_back(mock.begins); }
+
+			size_t used = jobs.Record(frameIndex, itemCount, MIN_ITEMS, recorders, [](CommandRecorder& recorder, size_t begin, size_t end)
+			{
+				MockRecorder& mock = static_cast<MockRecorder&>(recorder);
+				for (size_t i = begin; i < end; i++) { mock.items.push_back(i); }
+			});
+			if (itemCount == 0)
+			{
+				Check(used == 0, "Record of no items used a recorder");
+				continue;
+			}
+			Check(used == (std::min)(mocks.size(), (itemCount + MIN_ITEMS - 1) / MIN_ITEMS), "Record used the wrong number of recorders");
+
+			// 使ったレコーダーを順に並べると0から順に全部の描画になる
+			size_t expected = 0;
+			bool ordered = true, paired = true;
+			for (size_t i = 0; i < mocks.size(); i++)
+			{
+				MockRecorder& mock = mocks[i];
+				size_t begins = mock.begins - beginsBefore[i];
+				if (i >= used)
+				{
+					Check(begins == 0, "Record touched an unused recorder");
+					continue;
+				}
+				if (begins != 1 || mock.ends != mock.begins || mock.open || mock.misuse || mock.frameIndex != frameIndex) { paired = false; }
+				for (size_t item : mock.items)
+				{
+					if (item != expected) { ordered = false; }
+					expected++;
+				}
+				threads.insert(mock.thread);
+			}
+			Check(paired, "a recorder was not begun and ended once with the frame index");
+			Check(ordered && expected == itemCount, "the recorders do not hold the items in order");
+		}
+		Check(threads.size() <= jobs.GetThreadCount(), "Record used more threads than it has");
+		printf("record: %zu threads recorded\n", threads.size());
+	}
+
+	void TestParallelFor()
+	{
+		CommandJobSystem jobs(6);
+		for (size_t repeat = 0; repeat < 2000; repeat++)
+		{
+			size_t itemCount = 1 + (repeat * 131) % 700;
+			size_t minItems = 1 + repeat % 50;
+			std::vector<int> hits(itemCount, 0);
+			std::vector<CommandJobSystem::Range> seen(jobs.GetThreadCount(), { SIZE_MAX, SIZE_MAX });
+			std::mutex guard;
+			std::set<std::thread::id> threads;
+			size_t count = jobs.ParallelFor(itemCount, minItems, [&](size_t job, size_t begin, size_t end)
+			{
+				// 範囲は重ならないので、hitsは同期せずに書ける
+				for (size_t i = begin; i < end; i++) { hits[i]++; }
+				std::lock_guard<std::mutex> lock(guard);
+				if (job < seen.size()) { seen[job] = { begin, end }; }
+				threads.insert(std::this_thread::get_id());
+			});
+			Check(count == (std::min)(jobs.GetThreadCount(), (itemCount + minItems - 1) / minItems), "ParallelFor split into the wrong number of jobs");
+			std::vector<CommandJobSystem::Range> expected = CommandJobSystem::Partition(itemCount, count);
+			bool matches = true;
+			for (size_t job = 0; job < count; job++)
+			{
+				if (seen[job].begin != expected[job].begin || seen[job].end != expected[job].end) { matches = false; }
+			}
+			Check(matches, "ParallelFor ranges differ from Partition");
+			Check(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }), "ParallelFor did not run every item once");
+			Check(threads.size() <= count, "ParallelFor used more threads than jobs");
+		}
+
+		// 1スレッドなら呼び出し元だけ
+		CommandJobSystem single(1);
+		std::thread::id self = std::this_thread::get_id();
+		bool other = false;
+		single.ParallelFor(100, 1, [&](size_t, size_t, size_t) { if (std::this_thread::get_id() != self) { other = true; } });
+		Check(single.GetThreadCount() == 1 && !other, "a single-thread job system used another thread");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: CommandJobSystemTest [--threads K] [--cost NS] [--frames F] [--draws N,N,...]\n");
+		return 2;
+	}
+
+	TestPartition();
+	TestRecord();
+	TestParallelFor();
+
+	// main.cppとFrameRendererと同じく、スレッドごとに1つのリストへ、1つに64描画以上ずつ分ける
+	CommandJobSystem many(options.threads);
+	CommandJobSystem one(1);
+	char manyName[32];
+	snprintf(manyName, sizeof(manyName), "%zu (ms)", many.GetThreadCount());
+	printf("%8s %10s %10s %10s %8s\n", "draws", "ns/draw", "1 (ms)", manyName, "speedup");
+	for (size_t draws : options.draws)
+	{
+		double ms[2] = {};
+		CommandJobSystem* systems[2] = { &one, &many };
+		for (int s = 0; s < 2; s++)
+		{
+			std::vector<MockRecorder> mocks(systems[s]->GetThreadCount());
+			std::vector<CommandRecorder*> recorders;
+			for (MockRecorder& mock : mocks) { recorders.push_back(&mock); }
+			auto start = std::chrono::steady_clock::now();
+			for (size_t frame = 0; frame < options.frames; frame++)
+			{
+				systems[s]->Record(frame % 2, draws, 64, recorders, [&](CommandRecorder&, size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++) { Spin(options.cost); }
+				});
+			}
+			ms[s] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / options.frames;
+		}
+		printf("%8zu %10.0f %10.2f %10.2f %7.2fx\n", draws, options.cost, ms[0], ms[1], ms[0] / ms[1]);
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+﻿// LoadFromDDSFileMappedのビューがLoadFromDDSFileと同じになるかを確かめ、読み込みの速さを比べる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread -IDirectXTex DDSMappedBenchmark.cpp DirectXTex/DirectXTexDDS.cpp DirectXTex/DirectXTexUtil.cpp
+//       DirectXTex/DirectXTexImage.cpp DirectXTex/DirectXTexConvert.cpp DirectXTex/DirectXTexMipmaps.cpp DirectXTex/DirectXTexResize.cpp
+//       DirectXTex/DirectXTexCompress.cpp DirectXTex/BC.cpp DirectXTex/BC4BC5.cpp DirectXTex/BC6HBC7.cpp DirectXTex/DirectXTexThreadPool.cpp -o DDSMappedBenchmark
+//   (DirectXMathとDirectX-Headersのincludeも通す。Windowsではcl /std:c++17 /O2 /EHsc /IDirectXTex DDSMappedBenchmark.cpp
+//    DirectXTex\Bin\Desktop_2022_Win10\x64\Release\DirectXTex.lib)
+// 使い方
+//   DDSMappedBenchmark [--dir DIR] [--size N] [--runs R]
+//   一時ファイルはDIR(既定は一時ディレクトリ)に作って消す
+//   先に次を確かめる
+//   ・ミップと配列のあるファイルのビューが元の画素と一致し、範囲外のGetImageはnullptrになる
+//   ・コピーしたMappedImageは元をReleaseしても読める
+//   ・変換の要るファイル(BGRのレガシー形式)はマップせずに読み、LoadFromDDSFileと同じになる
+//   そのあとN×N(既定8192)のRGBAで全部のミップを持つファイルを、読み込みだけと、全部のページに触れるまでの時間で比べる
+//   R回(既定3)の真ん中の値を出す。coldはページキャッシュを捨ててから読む(Linuxだけ)
+//   失敗すると理由を出して1を返す
+#include "DirectXTex.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	void TestViews(const std::filesystem::path& dir)
+	{
+		const std::filesystem::path path = dir / "DDSMappedBenchmark.dds";
+		ScratchImage source;
+		Check(SUCCEEDED(source.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 40, 3, 4)), "cannot create the source image");
+		for (size_t i = 0; i < source.GetPixelsSize(); i++) { source.GetPixels()[i] = (uint8_t)(i * 13); }
+		Check(SUCCEEDED(SaveToDDSFile(source.GetImages(), source.GetImageCount(), source.GetMetadata(), DDS_FLAGS_NONE, path.wstring().c_str())),
+			"SaveToDDSFile failed");
+
+		MappedImage mapped;
+		TexMetadata metadata;
+		Check(SUCCEEDED(LoadFromDDSFileMapped(path.wstring().c_str(), DDS_FLAGS_NONE, &metadata, mapped)), "LoadFromDDSFileMapped failed");
+		Check(mapped.IsMapped(), "a plain RGBA file was not mapped");
+		Check(metadata.mipLevels == 4 && metadata.arraySize == 3, "the metadata differs");
+		Check(mapped.GetImageCount() == source.GetImageCount() && mapped.GetPixelsSize() == source.GetPixelsSize()
+			&& !memcmp(mapped.GetPixels(), source.GetPixels(), source.GetPixelsSize()), "the mapped pixels differ");
+		const Image* view = mapped.GetImage(2, 2, 0);
+		const Image* expected = source.GetImage(2, 2, 0);
+		Check(view && view->width == expected->width && view->rowPitch == expected->rowPitch
+			&& !memcmp(view->pixels, expected->pixels, expected->slicePitch), "GetImage(2, 2, 0) differs");
+		Check(!mapped.GetImage(4, 0, 0) && !mapped.GetImage(0, 3, 0), "GetImage out of range did not return nullptr");
+
+		// コピーがマップを持ち続ける
+		MappedImage copy = mapped;
+		mapped.Release();
+		Check(!mapped.GetImages(), "Release left the images");
+		Check(!memcmp(copy.GetPixels(), source.GetPixels(), source.GetPixelsSize()), "a copy lost the mapping after Release");
+		copy.Release();
+
+		// 並べ替えの要るレガシー形式は読み込みに戻る
+		ScratchImage legacy;
+		Check(SUCCEEDED(legacy.Initialize2D(DXGI_FORMAT_B8G8R8X8_UNORM, 16, 16, 1, 1)), "cannot create the legacy image");
+		for (size_t i = 0; i < legacy.GetPixelsSize(); i++) { legacy.GetPixels()[i] = (uint8_t)i; }
+		Check(SUCCEEDED(SaveToDDSFile(*legacy.GetImage(0, 0, 0), DDS_FLAGS_FORCE_DX9_LEGACY, path.wstring().c_str())), "SaveToDDSFile failed");
+		ScratchImage loaded;
+		Check(SUCCEEDED(LoadFromDDSFileMapped(path.wstring().c_str(), DDS_FLAGS_FORCE_RGB, nullptr, mapped)), "LoadFromDDSFileMapped failed");
+		Check(SUCCEEDED(LoadFromDDSFile(path.wstring().c_str(), DDS_FLAGS_FORCE_RGB, nullptr, loaded)), "LoadFromDDSFile failed");
+		Check(!mapped.IsMapped(), "a file needing conversion was mapped");
+		Check(mapped.GetMetadata().format == loaded.GetMetadata().format && mapped.GetPixelsSize() == loaded.GetPixelsSize()
+			&& !memcmp(mapped.GetPixels(), loaded.GetPixels(), loaded.GetPixelsSize()), "the converted pixels differ from LoadFromDDSFile");
+		mapped.Release();
+
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		Check(FAILED(LoadFromDDSFileMapped(path.wstring().c_str(), DDS_FLAGS_NONE, nullptr, mapped)) && !mapped.GetImages(),
+			"a missing file did not fail");
+	}
+
+	// ファイルをページキャッシュから追い出す
+	bool Evict(const std::filesystem::path& path)
+	{
+#ifdef _WIN32
+		(void)path;
+		return false;
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) { return false; }
+		fdatasync(fd);
+		bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(fd);
+		return evicted;
+#endif
+	}
+
+	// 4KBごとに1バイト読んで、全部のページを実際に読み込ませる
+	uint64_t Touch(const uint8_t* pixels, size_t size)
+	{
+		uint64_t sum = 0;
+		for (size_t i = 0; i < size; i += 4096) { sum += pixels[i]; }
+		return sum;
+	}
+
+	double Median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path dir = std::filesystem::temp_directory_path();
+	size_t size = 8192, runs = 3;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--dir") && i + 1 < argc) { dir = argv[++i]; }
+		else if (!strcmp(argv[i], "--size") && i + 1 < argc) { size = strtoul(argv[++i], nullptr, 10); }
+		else if (!strcmp(argv[i], "--runs") && i + 1 < argc) { runs = strtoul(argv[++i], nullptr, 10); }
+		else
+		{
+			fprintf(stderr, "usage: DDSMappedBenchmark [--dir DIR] [--size N] [--runs R]\n");
+			return 2;
+		}
+	}
+	if (size == 0 || size > 16384 || runs == 0)
+	{
+		fprintf(stderr, "size must be 1 to 16384 and runs at least 1\n");
+		return 2;
+	}
+
+	TestViews(dir);
+
+	const std::filesystem::path path = dir / "DDSMappedBenchmark.big.dds";
+	size_t bytes = 0;
+	{
+		ScratchImage big;
+		if (FAILED(big.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, 1, 0)))
+		{
+			fprintf(stderr, "cannot allocate %zux%zu\n", size, size);
+			return 2;
+		}
+		memset(big.GetPixels(), 0x5a, big.GetPixelsSize());
+		bytes = big.GetPixelsSize();
+		Check(SUCCEEDED(SaveToDDSFile(big.GetImages(), big.GetImageCount(), big.GetMetadata(), DDS_FLAGS_NONE, path.wstring().c_str())),
+			"SaveToDDSFile failed");
+	}
+
+	printf("%zux%zu RGBA with mips (%.1f MB), median of %zu runs\n", size, size, bytes / (1024.0 * 1024.0), runs);
+	printf("%-22s %6s %10s %12s\n", "path", "cache", "load ms", "+touch ms");
+	volatile uint64_t sink = 0;
+	for (int cold = 1; cold >= 0; cold--)
+	{
+		if (cold && !Evict(path))
+		{
+			printf("%-22s %6s (page cache cannot be dropped here)\n", "", "cold");
+			continue;
+		}
+		std::vector<double> load[2], touch[2];
+		for (size_t run = 0; run < runs; run++)
+		{
+			// warmは先に1回読んでおく
+			if (cold) { Evict(path); }
+			else { ScratchImage warm; LoadFromDDSFile(path.wstring().c_str(), DDS_FLAGS_NONE, nullptr, warm); }
+			auto start = std::chrono::steady_clock::now();
+			ScratchImage loaded;
+			Check(SUCCEEDED(LoadFromDDSFile(path.wstring().c_str(), DDS_FLAGS_NONE, nullptr, loaded)), "LoadFromDDSFile failed");
+			auto loadedAt = std::chrono::steady_clock::now();
+			sink = sink + Touch(loaded.GetPixels(), loaded.GetPixelsSize());
+			auto touchedAt = std::chrono::steady_clock::now();
+			load[0].push_back(std::chrono::duration<double, std::milli>(loadedAt - start).count());
+			touch[0].push_back(std::chrono::duration<double, std::milli>(touchedAt - start).count());
+			loaded.Release();
+
+			if (cold) { Evict(path); }
+			start = std::chrono::steady_clock::now();
+			MappedImage mapped;
+			Check(SUCCEEDED(LoadFromDDSFileMapped(path.wstring().c_str(), DDS_FLAGS_NONE, nullptr, mapped)), "LoadFromDDSFileMapped failed");
+			loadedAt = std::chrono::steady_clock::now();
+			sink = sink + Touch(mapped.GetPixels(), mapped.GetPixelsSize());
+			touchedAt = std::chrono::steady_clock::now();
+			load[1].push_back(std::chrono::duration<double, std::milli>(loadedAt - start).count());
+			touch[1].push_back(std::chrono::duration<double, std::milli>(touchedAt - start).count());
+		}
+		const char* names[2] = { "LoadFromDDSFile", "LoadFromDDSFileMapped" };
+		for (int p = 0; p < 2; p++)
+		{
+			printf("%-22s %6s %10.2f %12.2f\n", names[p], cold ? "cold" : "warm", Median(load[p]), Median(touch[p]));
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,308 @@
+﻿// DDSStreamWriter/DDSStreamReaderで帯ごとに書いて読んだ結果を、全体を一度に書くSaveToDDSMemoryと比べて確かめる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread -IDirectXTex DDSStreamTest.cpp DirectXTex/DirectXTexDDS.cpp DirectXTex/DirectXTexUtil.cpp
+//       DirectXTex/DirectXTexImage.cpp DirectXTex/DirectXTexConvert.cpp DirectXTex/DirectXTexMipmaps.cpp DirectXTex/DirectXTexResize.cpp
+//       DirectXTex/DirectXTexCompress.cpp DirectXTex/BC.cpp DirectXTex/BC4BC5.cpp DirectXTex/BC6HBC7.cpp DirectXTex/DirectXTexThreadPool.cpp -o DDSStreamTest
+//   (DirectXMathとDirectX-Headersのincludeも通す。Windowsではcl /std:c++17 /O2 /EHsc /IDirectXTex DDSStreamTest.cpp
+//    DirectXTex\Bin\Desktop_2022_Win10\x64\Release\DirectXTex.lib)
+// 使い方
+//   DDSStreamTest [--dir DIR] [--large GB]
+//   一時ファイルはDIR(既定は一時ディレクトリ)に作って消す
+//   2D配列、キューブではない3D、BC1/BC3の端数のある大きさで、次を確かめる
+//   ・帯ごとに書いたファイルが、SaveToDDSMemoryの結果とバイト単位で一致する
+//   ・行のピッチが違うImageに帯ごとに読んでも同じ画素になり、読み終えた後はEOFになる
+//   ・Seekで最後のミップに飛べて、範囲外は失敗する
+//   ・書き終えないまま捨てたファイルは消え、BCで4の倍数でない帯は拒まれる
+//   ・Compressの帯ごとの圧縮が、全体を一度に圧縮した結果と一致する
+//   --largeを付けると1GBのRGBAの画像をGB枚(5以上で32ビットの大きさの境を越える)並べた配列を帯ごとに書いて読み、速さを出す
+//   失敗すると理由を出して1を返す
+#include "DirectXTex.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	int failures = 0;
+	void Check(bool condition, const char* what, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s: %s\n", what, message);
+		failures++;
+	}
+
+	std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+	{
+		std::vector<uint8_t> data;
+		FILE* file = fopen(path.string().c_str(), "rb");
+		if (!file) { return data; }
+		fseek(file, 0, SEEK_END);
+		data.resize((size_t)ftell(file));
+		fseek(file, 0, SEEK_SET);
+		if (fread(data.data(), 1, data.size(), file) != data.size()) { data.clear(); }
+		fclose(file);
+		return data;
+	}
+
+	// 帯の高さ(BCでは4の倍数)で区切った、imageの一部を指すImageを作る
+	Image Band(const Image& image, size_t y, size_t band)
+	{
+		Image rows = image;
+		rows.height = (std::min)(band, image.height - y);
+		rows.pixels = image.pixels + (IsCompressed(image.format) ? y / 4 : y) * image.rowPitch;
+		rows.slicePitch = ComputeScanlines(image.format, rows.height) * image.rowPitch;
+		return rows;
+	}
+
+	void TestRoundTrip(const char* what, const std::filesystem::path& dir, DXGI_FORMAT format,
+		size_t width, size_t height, size_t mips, size_t arraySize, size_t depth, size_t band)
+	{
+		ScratchImage source;
+		HRESULT hr = depth > 1 ? source.Initialize3D(format, width, height, depth, mips) : source.Initialize2D(format, width, height, arraySize, mips);
+		Check(SUCCEEDED(hr), what, "cannot create the source image");
+		if (FAILED(hr)) { return; }
+		for (size_t i = 0; i < source.GetPixelsSize(); i++) { source.GetPixels()[i] = (uint8_t)(i * 7 + 3); }
+
+		Blob reference;
+		hr = SaveToDDSMemory(source.GetImages(), source.GetImageCount(), source.GetMetadata(), DDS_FLAGS_NONE, reference);
+		Check(SUCCEEDED(hr), what, "SaveToDDSMemory failed");
+
+		// 帯ごとに書く
+		const std::filesystem::path path = dir / "DDSStreamTest.dds";
+		const bool compressed = IsCompressed(format);
+		{
+			DDSStreamWriter writer;
+			Check(SUCCEEDED(writer.Create(path.wstring().c_str(), source.GetMetadata(), DDS_FLAGS_NONE)), what, "Create failed");
+			for (size_t i = 0; i < source.GetImageCount(); i++)
+			{
+				const Image& image = source.GetImages()[i];
+				for (size_t y = 0; y < image.height; y += band)
+				{
+					Check(writer.GetCurrentImage() == i && writer.GetCurrentRow() == y, what, "the writer is at the wrong row");
+					Check(SUCCEEDED(writer.WriteRows(Band(image, y, band))), what, "WriteRows failed");
+				}
+			}
+			Check(writer.WriteRows(source.GetImages()[0]) == E_UNEXPECTED, what, "WriteRows past the end did not fail");
+			Check(SUCCEEDED(writer.Finish()), what, "Finish failed");
+		}
+		std::vector<uint8_t> written = ReadFile(path);
+		Check(written.size() == reference.GetBufferSize() && !memcmp(written.data(), reference.GetBufferPointer(), written.size()),
+			what, "the streamed file differs from SaveToDDSMemory");
+
+		// 行のピッチを広げたImageに帯ごとに読む
+		DDSStreamReader reader;
+		TexMetadata metadata;
+		Check(SUCCEEDED(reader.Open(path.wstring().c_str(), DDS_FLAGS_NONE, &metadata)), what, "Open failed");
+		Check(metadata.mipLevels == mips && metadata.arraySize == arraySize && metadata.depth == depth, what, "the metadata differs");
+		for (size_t i = 0; i < source.GetImageCount(); i++)
+		{
+			const Image& image = source.GetImages()[i];
+			const size_t pitch = image.rowPitch + 16;
+			std::vector<uint8_t> buffer(pitch * (compressed ? (band + 3) / 4 : band));
+			for (size_t y = 0; y < image.height; y += band)
+			{
+				Image rows = Band(image, y, band);
+				rows.rowPitch = pitch;
+				rows.slicePitch = ComputeScanlines(format, rows.height) * pitch;
+				rows.pixels = buffer.data();
+				Check(SUCCEEDED(reader.ReadRows(rows)), what, "ReadRows failed");
+				const size_t lines = ComputeScanlines(format, rows.height);
+				for (size_t j = 0; j < lines; j++)
+				{
+					if (memcmp(buffer.data() + j * pitch, image.pixels + ((compressed ? y / 4 : y) + j) * image.rowPitch, image.rowPitch))
+					{
+						Check(false, what, "ReadRows returned different pixels");
+						break;
+					}
+				}
+			}
+		}
+		Check(FAILED(reader.ReadRows(source.GetImages()[0])), what, "ReadRows past the end did not fail");
+
+		// 最後のミップ(3Dは最後のスライス、配列は最後の要素)に飛ぶ
+		const size_t item = depth > 1 ? 0 : arraySize - 1;
+		const size_t slice = depth > 1 ? (std::max)(size_t(1), depth >> (mips - 1)) - 1 : 0;
+		Check(SUCCEEDED(reader.Seek(mips - 1, item, slice)), what, "Seek failed");
+		const Image* last = source.GetImage(mips - 1, item, slice);
+		std::vector<uint8_t> buffer(last->slicePitch);
+		Image rows = *last;
+		rows.pixels = buffer.data();
+		Check(SUCCEEDED(reader.ReadRows(rows)) && !memcmp(buffer.data(), last->pixels, last->slicePitch), what, "the last mip differs after Seek");
+		Check(FAILED(reader.Seek(mips, 0, 0)), what, "Seek past the last mip did not fail");
+		reader.Release();
+
+		// 書き終えないまま捨てたファイルは消える(ムーブした先で捨てても同じ)
+		const std::filesystem::path part = dir / "DDSStreamTest.part.dds";
+		{
+			DDSStreamWriter writer;
+			Check(SUCCEEDED(writer.Create(part.wstring().c_str(), source.GetMetadata(), DDS_FLAGS_NONE)), what, "Create failed");
+			Check(std::filesystem::exists(part), what, "Create did not create the file");
+			Check(writer.Finish() == E_FAIL, what, "Finish of an incomplete file did not fail");
+		}
+		Check(!std::filesystem::exists(part), what, "an unfinished file was left behind");
+		{
+			DDSStreamWriter writer;
+			Check(SUCCEEDED(writer.Create(part.wstring().c_str(), source.GetMetadata(), DDS_FLAGS_NONE)), what, "Create failed");
+			DDSStreamWriter moved(std::move(writer));
+		}
+		Check(!std::filesystem::exists(part), what, "an unfinished file was left behind after a move");
+
+		// BCの帯は4の倍数の高さ(画像の最後を除く)
+		if (compressed && source.GetImages()[0].height > 6)
+		{
+			DDSStreamWriter writer;
+			Check(SUCCEEDED(writer.Create(part.wstring().c_str(), source.GetMetadata(), DDS_FLAGS_NONE)), what, "Create failed");
+			Image rows = source.GetImages()[0];
+			rows.height = 6;
+			Check(writer.WriteRows(rows) == E_INVALIDARG, what, "a BC band of 6 rows was accepted");
+		}
+
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+	}
+
+	// Compressで帯ごとに圧縮して書いたファイルが、全体を一度に圧縮して保存したものと同じになるか
+	void TestCompressBands(const std::filesystem::path& dir)
+	{
+		const char* what = "Compress to BC1 in bands of 16 rows";
+		ScratchImage source;
+		Check(SUCCEEDED(source.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 100, 70, 1, 1)), what, "cannot create the source image");
+		const Image& image = *source.GetImage(0, 0, 0);
+		for (size_t y = 0; y < image.height; y++)
+		{
+			for (size_t x = 0; x < image.width; x++)
+			{
+				uint8_t* pixel = image.pixels + y * image.rowPitch + x * 4;
+				pixel[0] = (uint8_t)(x * 2);
+				pixel[1] = (uint8_t)(y * 3);
+				pixel[2] = (uint8_t)((x ^ y) * 5);
+				pixel[3] = 255;
+			}
+		}
+
+		ScratchImage whole;
+		Blob reference;
+		Check(SUCCEEDED(Compress(image, DXGI_FORMAT_BC1_UNORM, TEX_COMPRESS_DEFAULT, TEX_THRESHOLD_DEFAULT, whole)), what, "Compress failed");
+		Check(SUCCEEDED(SaveToDDSMemory(whole.GetImages(), whole.GetImageCount(), whole.GetMetadata(), DDS_FLAGS_NONE, reference)), what, "SaveToDDSMemory failed");
+
+		const std::filesystem::path path = dir / "DDSStreamTest.dds";
+		DDSStreamWriter writer;
+		Check(SUCCEEDED(writer.Create(path.wstring().c_str(), whole.GetMetadata(), DDS_FLAGS_NONE)), what, "Create failed");
+		for (size_t y = 0; y < image.height; y += 16)
+		{
+			Check(SUCCEEDED(Compress(Band(image, y, 16), TEX_COMPRESS_DEFAULT, TEX_THRESHOLD_DEFAULT, writer)), what, "Compress of a band failed");
+		}
+		Check(SUCCEEDED(writer.Finish()), what, "Finish failed");
+		std::vector<uint8_t> written = ReadFile(path);
+		Check(written.size() == reference.GetBufferSize() && !memcmp(written.data(), reference.GetBufferPointer(), written.size()),
+			what, "the file differs from compressing the whole image");
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+	}
+
+	// 32ビットの大きさを越えるファイルを、帯の分のメモリだけで書いて読む
+	// Direct3Dの上限(16384)に収まるよう、1GBの16384x16384のRGBAを配列にして大きさを稼ぐ
+	void TestLarge(const std::filesystem::path& dir, size_t gigabytes)
+	{
+		const char* what = "large file";
+		const size_t SIZE = 16384;
+		const size_t BAND = 256;
+		const size_t rowPitch = SIZE * 4;
+		TexMetadata metadata = {};
+		metadata.width = metadata.height = SIZE;
+		metadata.depth = metadata.mipLevels = 1;
+		metadata.arraySize = gigabytes;
+		metadata.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		metadata.dimension = TEX_DIMENSION_TEXTURE2D;
+
+		// 行ごとに違う値で埋める
+		std::vector<uint8_t> buffer(rowPitch * BAND);
+		auto fill = [&](size_t row)
+		{
+			for (size_t j = 0; j < BAND; j++)
+			{
+				uint64_t value = (row + j) * 0x9E3779B97F4A7C15ull;
+				for (size_t x = 0; x < rowPitch; x += 8) { memcpy(&buffer[j * rowPitch + x], &value, 8); }
+			}
+		};
+		Image rows = { SIZE, BAND, metadata.format, rowPitch, rowPitch * BAND, buffer.data() };
+		const size_t totalRows = SIZE * gigabytes;
+
+		const std::filesystem::path path = dir / "DDSStreamTest.large.dds";
+		auto start = std::chrono::steady_clock::now();
+		{
+			DDSStreamWriter writer;
+			Check(SUCCEEDED(writer.Create(path.wstring().c_str(), metadata, DDS_FLAGS_NONE)), what, "Create failed");
+			for (size_t row = 0; row < totalRows && !failures; row += BAND)
+			{
+				fill(row);
+				Check(SUCCEEDED(writer.WriteRows(rows)), what, "WriteRows failed");
+			}
+			Check(SUCCEEDED(writer.Finish()), what, "Finish failed");
+		}
+		double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::error_code ec;
+		const uintmax_t fileSize = std::filesystem::file_size(path, ec);
+		Check(!ec && fileSize > (uintmax_t)totalRows * rowPitch, what, "the file is too small");
+
+		// 最後の要素から読んで、4GBより先の位置にSeekできることも確かめる
+		start = std::chrono::steady_clock::now();
+		{
+			DDSStreamReader reader;
+			TexMetadata read;
+			Check(SUCCEEDED(reader.Open(path.wstring().c_str(), DDS_FLAGS_NONE, &read)), what, "Open failed");
+			Check(read.arraySize == gigabytes, what, "the array size differs");
+			std::vector<uint8_t> expected;
+			for (size_t item = gigabytes; item-- > 0 && !failures;)
+			{
+				Check(SUCCEEDED(reader.Seek(0, item, 0)), what, "Seek failed");
+				for (size_t y = 0; y < SIZE && !failures; y += BAND)
+				{
+					Check(SUCCEEDED(reader.ReadRows(rows)), what, "ReadRows failed");
+					expected = buffer;
+					fill(item * SIZE + y);
+					Check(expected == buffer, what, "ReadRows returned different pixels");
+				}
+			}
+		}
+		double readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::filesystem::remove(path, ec);
+
+		double megabytes = (double)totalRows * rowPitch / (1024.0 * 1024.0);
+		printf("large: %zu x %zux%zu RGBA (%.2f GB), write %.1f MB/s, read %.1f MB/s, %zu KB per band\n",
+			gigabytes, SIZE, SIZE, megabytes / 1024.0, megabytes / writeSeconds, megabytes / readSeconds, rowPitch * BAND / 1024);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path dir = std::filesystem::temp_directory_path();
+	size_t large = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--dir") && i + 1 < argc) { dir = argv[++i]; }
+		else if (!strcmp(argv[i], "--large") && i + 1 < argc) { large = strtoul(argv[++i], nullptr, 10); }
+		else
+		{
+			fprintf(stderr, "usage: DDSStreamTest [--dir DIR] [--large GB]\n");
+			return 2;
+		}
+	}
+
+	TestRoundTrip("R8G8B8A8 64x40 3 mips, 2 items, bands of 7", dir, DXGI_FORMAT_R8G8B8A8_UNORM, 64, 40, 3, 2, 1, 7);
+	TestRoundTrip("BC1 64x40 7 mips, 3 items, bands of 8", dir, DXGI_FORMAT_BC1_UNORM, 64, 40, 7, 3, 1, 8);
+	TestRoundTrip("R16_FLOAT 30x20x8 4 mips, bands of 5", dir, DXGI_FORMAT_R16_FLOAT, 30, 20, 4, 1, 8, 5);
+	TestRoundTrip("BC3 13x9 4 mips, bands of 4", dir, DXGI_FORMAT_BC3_UNORM, 13, 9, 4, 1, 1, 4);
+	TestCompressBands(dir);
+	if (large > 0) { TestLarge(dir, large); }
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
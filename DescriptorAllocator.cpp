@@ -0,0 +1,90 @@
+﻿#include "DescriptorAllocator.h"
+
+DescriptorAllocator::DescriptorAllocator(uint32_t persistentCount, uint32_t transientCount)
+{
+	this->persistentCount = persistentCount;
+	this->transientCount = transientCount;
+
+	// 小さい番号から使うよう逆順に積む
+	freeList.resize(persistentCount);
+	for (uint32_t i = 0; i < persistentCount; i++) { freeList[i] = persistentCount - 1 - i; }
+	used.assign(persistentCount, 0);
+}
+
+uint32_t DescriptorAllocator::Allocate()
+{
+	if (freeList.empty()) { return INVALID; }
+	uint32_t index = freeList.back();
+	freeList.pop_back();
+	used[index] = 1;
+
+	stats.persistentUsed++;
+	if (stats.persistentUsed > stats.persistentPeak) { stats.persistentPeak = stats.persistentUsed; }
+	return index;
+}
+bool DescriptorAllocator::Free(uint32_t index, uint64_t fenceValue)
+{
+	if (index >= persistentCount || !used[index]) { return false; }
+	used[index] = 0;
+
+	// フェンス値が前後しても昇順を保つ(後ろの方が早く終わることはない)
+	if (!pending.empty() && pending.back().fenceValue > fenceValue) { fenceValue = pending.back().fenceValue; }
+	pending.push_back({ index, fenceValue });
+	stats.pendingFrees++;
+	return true;
+}
+void DescriptorAllocator::Reclaim(uint64_t completedValue, std::vector<uint32_t>* reclaimed)
+{
+	while (!pending.empty() && pending.front().fenceValue <= completedValue)
+	{
+		freeList.push_back(pending.front().index);
+		if (reclaimed) { reclaimed->push_back(pending.front().index); }
+		pending.pop_front();
+		stats.pendingFrees--;
+		stats.persistentUsed--;
+	}
+
+	while (!transientFrames.empty() && transientFrames.front().fenceValue <= completedValue)
+	{
+		transientTail = transientFrames.front().end;
+		transientFrames.pop_front();
+	}
+	stats.transientUsed = (uint32_t)(transientHead - transientTail);
+}
+
+uint32_t DescriptorAllocator::AllocateTransient(uint32_t count)
+{
+	// 全部空いていれば先頭に戻し、一時領域をまるごと使えるようにする
+	if (transientCount && transientHead == transientTail && transientHead % transientCount)
+	{
+		transientHead += transientCount - transientHead % transientCount;
+		transientTail = transientHead;
+		frameStart = transientHead;
+	}
+	uint32_t position = (uint32_t)(transientHead % (transientCount ? transientCount : 1));
+	// 末尾をまたぐ時は残りを飛ばして先頭から取る(飛ばした分もこのフレームと一緒に空く)
+	uint32_t skip = position + count > transientCount ? transientCount - position : 0;
+	uint64_t available = transientCount - (transientHead - transientTail);
+	if (count == 0 || count > transientCount || skip + (uint64_t)count > available)
+	{
+		stats.transientFailures++;
+		return INVALID;
+	}
+	transientHead += skip;
+	uint32_t index = persistentCount + (uint32_t)(transientHead % transientCount);
+	transientHead += count;
+
+	stats.transientFrame += count;
+	stats.transientUsed = (uint32_t)(transientHead - transientTail);
+	if (stats.transientUsed > stats.transientPeak) { stats.transientPeak = stats.transientUsed; }
+	return index;
+}
+void DescriptorAllocator::Finish(uint64_t fenceValue)
+{
+	stats.transientFrame = 0;
+	if (transientHead == frameStart) { return; }
+	// Freeと同じく、フェンス値が前後しても昇順を保つ
+	if (!transientFrames.empty() && transientFrames.back().fenceValue > fenceValue) { fenceValue = transientFrames.back().fenceValue; }
+	transientFrames.push_back({ transientHead, fenceValue });
+	frameStart = transientHead;
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// デスクリプタヒープの番号の割り当て(デバイスに依存しない)
+// [0, persistentCount)         : 常駐領域。1個ずつ確保し、解放はフェンスが進むまで遅らせる(番号はそのままバインドレスの添字になる)
+// [persistentCount, 末尾)      : 一時領域。リングとして連続で切り出し、Finishで渡したフェンスが完了したら空ける
+class DescriptorAllocator
+{
+public:
+	static const uint32_t INVALID = UINT32_MAX;
+
+	struct Stats
+	{
+		uint32_t persistentUsed; // 確保中(解放待ちを含む)
+		uint32_t persistentPeak;
+		uint32_t pendingFrees; // フェンス待ちの数
+		uint32_t transientUsed; // 一時領域で使用中(フェンス待ちと、折り返しで飛ばした分を含む)
+		uint32_t transientPeak;
+		uint32_t transientFrame; // 今のフレームで切り出した数
+		uint32_t transientFailures; // 空きが足りずINVALIDを返した回数
+	};
+
+	DescriptorAllocator() = default;
+	explicit DescriptorAllocator(uint32_t persistentCount, uint32_t transientCount = 0);
+
+	uint32_t GetCapacity() const { return persistentCount + transientCount; }
+	uint32_t GetPersistentCount() const { return persistentCount; }
+
+	// 空きが無ければINVALID
+	uint32_t Allocate();
+	// fenceValueの完了まで再利用しない(確保していない番号ならfalse)
+	bool Free(uint32_t index, uint64_t fenceValue);
+	// completedValueまで完了した解放を空きに戻す(戻した番号はreclaimedに足す)
+	// 一時領域もcompletedValueまで完了したフレームの分を空ける
+	void Reclaim(uint64_t completedValue, std::vector<uint32_t>* reclaimed = nullptr);
+
+	// 一時領域からcount個連続で切り出す(足りなければINVALID)
+	uint32_t AllocateTransient(uint32_t count);
+	// このフレームで切り出した一時領域を、fenceValueの完了まで使用中にする
+	void Finish(uint64_t fenceValue);
+
+	Stats GetStats() const { return stats; }
+
+private:
+	struct Pending
+	{
+		uint32_t index;
+		uint64_t fenceValue;
+	};
+	struct TransientFrame
+	{
+		uint64_t end; // このフレームまでに切り出した累計
+		uint64_t fenceValue;
+	};
+
+	uint32_t persistentCount = 0;
+	uint32_t transientCount = 0;
+
+	std::vector<uint32_t> freeList; // 空いている番号(末尾から取る)
+	std::vector<uint8_t> used; // 二重解放の検出用
+	std::deque<Pending> pending; // フェンス値の昇順
+	uint64_t transientHead = 0; // 切り出した累計(一時領域の数で割った余りが次の位置)
+	uint64_t transientTail = 0; // 空けた累計
+	uint64_t frameStart = 0; // 今のフレームの最初のtransientHead
+	std::deque<TransientFrame> transientFrames; // GPUの完了待ち(フェンス値の昇順)
+	Stats stats = {};
+};
@@ -0,0 +1,234 @@
+﻿// DescriptorAllocatorの常駐領域と一時領域の割り当てを、フェンスの進み方を真似て確かめる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 DescriptorAllocatorTest.cpp DescriptorAllocator.cpp -o DescriptorAllocatorTest
+// 使い方
+//   DescriptorAllocatorTest [--frames F] [--latency L]
+//   先に次を確かめる
+//   ・常駐領域は小さい番号から全部取れ、空になるとINVALIDを返す
+//   ・二重解放、確保していない番号、範囲外の番号の解放はfalseになる
+//   ・解放した番号は、そのフェンスが完了するまでReclaimで戻らない
+//   ・後から小さいフェンス値で解放しても、前の解放より先には戻らない
+//   ・一時領域は連続で切り出し、末尾をまたぐ時は先頭へ折り返し、足りなければINVALIDを返して数える
+//   ・一時領域はFinishで渡したフェンスの完了で空き、前後したフェンス値は前のフレームに合わせる
+//   そのあとLフレーム(既定2)先行するGPUを真似てFフレーム(既定10000)ランダムに確保と解放を続け、
+//   使用中の番号が重複せず、一時領域の範囲が完了待ちの範囲と重ならないことを確かめる
+//   失敗すると理由を出して1を返す
+#include "DescriptorAllocator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		size_t frames = 10000;
+		size_t latency = 2;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--frames") { options.frames = strtoul(value, nullptr, 10); }
+			else if (arg == "--latency") { options.latency = strtoul(value, nullptr, 10); }
+			else { return false; }
+		}
+		return options.frames > 0 && options.latency > 0;
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	const uint32_t INVALID = DescriptorAllocator::INVALID;
+
+	void TestPersistent()
+	{
+		DescriptorAllocator allocator(8);
+		bool ascending = true;
+		for (uint32_t i = 0; i < 8; i++) { ascending = ascending && allocator.Allocate() == i; }
+		Check(ascending, "persistent indices should come out from 0 upward");
+		Check(allocator.Allocate() == INVALID, "a full persistent region should return INVALID");
+		Check(allocator.GetStats().persistentUsed == 8 && allocator.GetStats().persistentPeak == 8, "persistent stats should count every allocation");
+
+		Check(allocator.Free(3, 5), "freeing an allocated index should succeed");
+		Check(!allocator.Free(3, 5), "a double free should return false");
+		Check(!allocator.Free(8, 5), "freeing an index out of range should return false");
+		Check(!allocator.Free(INVALID, 5), "freeing INVALID should return false");
+		Check(allocator.GetStats().pendingFrees == 1, "the free should wait for its fence");
+
+		// フェンスが完了するまで戻らない
+		std::vector<uint32_t> reclaimed;
+		allocator.Reclaim(4, &reclaimed);
+		Check(reclaimed.empty() && allocator.Allocate() == INVALID, "a free should not come back before its fence");
+		allocator.Reclaim(5, &reclaimed);
+		Check(reclaimed.size() == 1 && reclaimed[0] == 3, "a free should come back once its fence completes");
+		Check(allocator.Allocate() == 3, "a reclaimed index should be allocated again");
+		Check(allocator.GetStats().pendingFrees == 0 && allocator.GetStats().persistentUsed == 8, "stats should follow the reclaim");
+
+		// 小さいフェンス値の解放は前の解放に合わせる
+		Check(allocator.Free(1, 10) && allocator.Free(6, 7), "freeing with a smaller fence value should still succeed");
+		reclaimed.clear();
+		allocator.Reclaim(7, &reclaimed);
+		Check(reclaimed.empty(), "a free with a smaller fence value should not pass an earlier free");
+		allocator.Reclaim(10, &reclaimed);
+		Check(reclaimed == std::vector<uint32_t>({ 1, 6 }), "clamped frees should come back in order at the later fence");
+		Check(!allocator.Free(1, 11), "a reclaimed index is no longer allocated");
+
+		DescriptorAllocator empty;
+		Check(empty.Allocate() == INVALID && empty.AllocateTransient(1) == INVALID, "an empty allocator should return INVALID");
+	}
+
+	void TestTransient()
+	{
+		const uint32_t PERSISTENT = 4;
+		DescriptorAllocator allocator(PERSISTENT, 16);
+		Check(allocator.GetCapacity() == 20 && allocator.GetPersistentCount() == PERSISTENT, "capacity should include both regions");
+		Check(allocator.AllocateTransient(0) == INVALID && allocator.AllocateTransient(17) == INVALID, "zero and oversized runs should fail");
+
+		// フレーム1: [0, 11)
+		Check(allocator.AllocateTransient(5) == PERSISTENT + 0, "the first run should start at the transient region");
+		Check(allocator.AllocateTransient(6) == PERSISTENT + 5, "runs should be contiguous");
+		Check(allocator.GetStats().transientFrame == 11, "the frame should count its descriptors");
+		allocator.Finish(1);
+		Check(allocator.GetStats().transientFrame == 0, "Finish should start a new frame");
+
+		// フレーム2: [11, 15)、末尾の1個では4個取れず、フレーム1の完了待ち
+		Check(allocator.AllocateTransient(4) == PERSISTENT + 11, "the second frame should continue after the first");
+		uint32_t failuresBefore = allocator.GetStats().transientFailures;
+		Check(allocator.AllocateTransient(4) == INVALID, "a run should fail while the ring is full");
+		Check(allocator.GetStats().transientFailures == failuresBefore + 1, "failures should be counted");
+
+		// フレーム1が完了すれば、末尾の1個を飛ばして先頭から取れる
+		allocator.Reclaim(1);
+		Check(allocator.GetStats().transientUsed == 4, "completing frame 1 should free its descriptors");
+		Check(allocator.AllocateTransient(4) == PERSISTENT + 0, "a run should wrap to the start instead of crossing the end");
+		Check(allocator.GetStats().transientUsed == 9, "the skipped tail should count as used");
+		allocator.Finish(3);
+
+		// フレーム3は前より小さいフェンス値で終える
+		Check(allocator.AllocateTransient(2) == PERSISTENT + 4, "the third frame should continue after the wrap");
+		allocator.Finish(2);
+		allocator.Reclaim(2);
+		Check(allocator.GetStats().transientUsed == 11, "a frame finished with a smaller fence value should wait for the earlier frame");
+		allocator.Reclaim(3);
+		Check(allocator.GetStats().transientUsed == 0, "every frame should be free once the last fence completes");
+
+		// 何も切り出さないフレームは記録しない
+		allocator.Finish(4);
+		allocator.Reclaim(4);
+		Check(allocator.GetStats().transientUsed == 0, "an empty frame should leave nothing in use");
+		Check(allocator.GetStats().transientPeak == 15, "the peak should remember the fullest ring");
+
+		// 1フレームで一時領域を全部使える
+		Check(allocator.AllocateTransient(16) != INVALID, "the whole ring should fit once everything is free");
+	}
+
+	// フレームごとに確保と解放を続け、GPUがlatencyフレーム遅れて完了する様子を真似る
+	void TestRandom(const Options& options)
+	{
+		const uint32_t PERSISTENT = 256, TRANSIENT = 128;
+		DescriptorAllocator allocator(PERSISTENT, TRANSIENT);
+		std::mt19937 rng(1);
+		std::vector<uint32_t> live;
+		std::vector<uint8_t> busy(PERSISTENT, 0); // 使用中か、解放してGPUの完了待ち
+		std::vector<std::pair<uint32_t, uint64_t>> freed; // 番号と、それが完了するフェンス値
+		std::vector<std::pair<uint64_t, std::vector<uint8_t>>> frames; // フレームのフェンス値と、使った一時領域
+		bool unique = true, reclaimOrder = true, transientOverlap = false;
+		size_t transientFailed = 0;
+
+		for (uint64_t fence = 1; fence <= options.frames; fence++)
+		{
+			uint64_t completed = fence > options.latency ? fence - options.latency : 0;
+			std::vector<uint32_t> reclaimed;
+			allocator.Reclaim(completed, &reclaimed);
+			for (uint32_t index : reclaimed)
+			{
+				bool found = false;
+				for (size_t i = 0; i < freed.size() && !found; i++)
+				{
+					if (freed[i].first != index) { continue; }
+					reclaimOrder = reclaimOrder && freed[i].second <= completed;
+					freed.erase(freed.begin() + i);
+					found = true;
+				}
+				reclaimOrder = reclaimOrder && found;
+				busy[index] = 0;
+			}
+			while (!frames.empty() && frames.front().first <= completed) { frames.erase(frames.begin()); }
+
+			size_t allocations = rng() % 8, frees = rng() % 8;
+			for (size_t i = 0; i < allocations; i++)
+			{
+				uint32_t index = allocator.Allocate();
+				if (index == INVALID) { break; }
+				unique = unique && !busy[index];
+				busy[index] = 1;
+				live.push_back(index);
+			}
+			for (size_t i = 0; i < frees && !live.empty(); i++)
+			{
+				size_t at = rng() % live.size();
+				reclaimOrder = reclaimOrder && allocator.Free(live[at], fence);
+				freed.push_back({ live[at], fence });
+				live[at] = live.back();
+				live.pop_back();
+			}
+
+			// 一時領域は完了待ちのフレームと同じ番号を使わない
+			std::vector<uint8_t> used(TRANSIENT, 0);
+			size_t runs = rng() % 4;
+			for (size_t i = 0; i < runs; i++)
+			{
+				uint32_t count = 1 + rng() % 24;
+				uint32_t index = allocator.AllocateTransient(count);
+				if (index == INVALID) { transientFailed++; continue; }
+				if (index < PERSISTENT || index + count > PERSISTENT + TRANSIENT) { transientOverlap = true; continue; }
+				for (uint32_t j = index - PERSISTENT; j < index - PERSISTENT + count; j++)
+				{
+					transientOverlap = transientOverlap || used[j];
+					for (const auto& frame : frames) { transientOverlap = transientOverlap || frame.second[j]; }
+					used[j] = 1;
+				}
+			}
+			allocator.Finish(fence);
+			frames.push_back({ fence, used });
+		}
+
+		DescriptorAllocator::Stats stats = allocator.GetStats();
+		Check(unique, "a persistent index was handed out while still in use or pending");
+		Check(reclaimOrder, "a persistent index came back before its fence");
+		Check(!transientOverlap, "a transient run overlapped a run still in flight");
+		Check(stats.transientFailures == transientFailed, "transient failures should match the INVALID returns");
+		Check(stats.persistentUsed == live.size() + freed.size(), "persistentUsed should count live and pending indices");
+		printf("%zu frames, latency %zu: persistent peak %u/%u, transient peak %u/%u, %u transient failures\n",
+			options.frames, options.latency, stats.persistentPeak, PERSISTENT, stats.transientPeak, TRANSIENT, stats.transientFailures);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: DescriptorAllocatorTest [--frames F] [--latency L]\n");
+		return 2;
+	}
+
+	TestPersistent();
+	TestTransient();
+	TestRandom(options);
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -314,6 +314,296 @@ namespace
     }
 
 
+#ifndef COLOR_WEIGHTS
+    //-------------------------------------------------------------------------------------
+    // OptimizeRGB for BC_BATCH_SIZE blocks at once. Each vector lane holds one block, and
+    // every lane performs the same floating-point operations in the same order as the
+    // scalar version, so with 8 iterations the endpoints are bit-identical to OptimizeRGB.
+    //-------------------------------------------------------------------------------------
+    void OptimizeRGBBatch(
+        _Out_writes_(BC_BATCH_SIZE) HDRColorA *pX,
+        _Out_writes_(BC_BATCH_SIZE) HDRColorA *pY,
+        _In_reads_(BC_BATCH_SIZE) const HDRColorA * const *pPoints,
+        _In_reads_(BC_BATCH_SIZE) const uint32_t *cSteps,
+        uint32_t flags,
+        size_t maxIterations) noexcept
+    {
+        static_assert(BC_BATCH_SIZE == 4, "OptimizeRGBBatch assumes one block per XMVECTOR lane");
+
+        constexpr float fEpsilon = (0.25f / 64.0f) * (0.25f / 64.0f);
+        static const float pC3[] = { 2.0f / 2.0f, 1.0f / 2.0f, 0.0f / 2.0f, 0.0f };
+        static const float pD3[] = { 0.0f / 2.0f, 1.0f / 2.0f, 2.0f / 2.0f, 0.0f };
+        static const float pC4[] = { 3.0f / 3.0f, 2.0f / 3.0f, 1.0f / 3.0f, 0.0f / 3.0f };
+        static const float pD4[] = { 0.0f / 3.0f, 1.0f / 3.0f, 2.0f / 3.0f, 3.0f / 3.0f };
+
+        // Transpose so each vector holds one channel of the same texel from all four blocks
+        XMVECTOR R[NUM_PIXELS_PER_BLOCK];
+        XMVECTOR G[NUM_PIXELS_PER_BLOCK];
+        XMVECTOR B[NUM_PIXELS_PER_BLOCK];
+
+        for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+        {
+            R[iPoint] = XMVectorSet(pPoints[0][iPoint].r, pPoints[1][iPoint].r, pPoints[2][iPoint].r, pPoints[3][iPoint].r);
+            G[iPoint] = XMVectorSet(pPoints[0][iPoint].g, pPoints[1][iPoint].g, pPoints[2][iPoint].g, pPoints[3][iPoint].g);
+            B[iPoint] = XMVectorSet(pPoints[0][iPoint].b, pPoints[1][iPoint].b, pPoints[2][iPoint].b, pPoints[3][iPoint].b);
+        }
+
+        // Per-lane step weights, since each block may use 3 or 4 steps
+        XMVECTOR vC[4];
+        XMVECTOR vD[4];
+
+        for (size_t iStep = 0; iStep < 4; iStep++)
+        {
+            float c[BC_BATCH_SIZE];
+            float d[BC_BATCH_SIZE];
+            for (size_t j = 0; j < BC_BATCH_SIZE; ++j)
+            {
+                c[j] = (3 == cSteps[j]) ? pC3[iStep] : pC4[iStep];
+                d[j] = (3 == cSteps[j]) ? pD3[iStep] : pD4[iStep];
+            }
+            vC[iStep] = XMVectorSet(c[0], c[1], c[2], c[3]);
+            vD[iStep] = XMVectorSet(d[0], d[1], d[2], d[3]);
+        }
+
+        const XMVECTOR fSteps = XMVectorSet(
+            static_cast<float>(cSteps[0] - 1), static_cast<float>(cSteps[1] - 1),
+            static_cast<float>(cSteps[2] - 1), static_cast<float>(cSteps[3] - 1));
+
+        // Find Min and Max points, as starting point
+        const HDRColorA Start = (flags & BC_FLAGS_UNIFORM) ? HDRColorA(1.f, 1.f, 1.f, 1.f) : g_Luminance;
+
+        XMVECTOR Xr = XMVectorReplicate(Start.r);
+        XMVECTOR Xg = XMVectorReplicate(Start.g);
+        XMVECTOR Xb = XMVectorReplicate(Start.b);
+        XMVECTOR Yr = XMVectorZero();
+        XMVECTOR Yg = XMVectorZero();
+        XMVECTOR Yb = XMVectorZero();
+
+        for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+        {
+            Xr = XMVectorSelect(Xr, R[iPoint], XMVectorLess(R[iPoint], Xr));
+            Xg = XMVectorSelect(Xg, G[iPoint], XMVectorLess(G[iPoint], Xg));
+            Xb = XMVectorSelect(Xb, B[iPoint], XMVectorLess(B[iPoint], Xb));
+
+            Yr = XMVectorSelect(Yr, R[iPoint], XMVectorGreater(R[iPoint], Yr));
+            Yg = XMVectorSelect(Yg, G[iPoint], XMVectorGreater(G[iPoint], Yg));
+            Yb = XMVectorSelect(Yb, B[iPoint], XMVectorGreater(B[iPoint], Yb));
+        }
+
+        // Diagonal axis
+        const XMVECTOR ABr = XMVectorSubtract(Yr, Xr);
+        const XMVECTOR ABg = XMVectorSubtract(Yg, Xg);
+        const XMVECTOR ABb = XMVectorSubtract(Yb, Xb);
+
+        const XMVECTOR fAB = XMVectorAdd(XMVectorAdd(XMVectorMultiply(ABr, ABr), XMVectorMultiply(ABg, ABg)), XMVectorMultiply(ABb, ABb));
+
+        // Single color blocks are done; they keep the min/max without axis selection
+        XMVECTOR done = XMVectorLess(fAB, XMVectorReplicate(FLT_MIN));
+
+        // Try all four axis directions, to determine which diagonal best fits data
+        const XMVECTOR fABInv = XMVectorDivide(g_XMOne, fAB);
+
+        const XMVECTOR Dirr = XMVectorMultiply(ABr, fABInv);
+        const XMVECTOR Dirg = XMVectorMultiply(ABg, fABInv);
+        const XMVECTOR Dirb = XMVectorMultiply(ABb, fABInv);
+
+        const XMVECTOR Midr = XMVectorMultiply(XMVectorAdd(Xr, Yr), g_XMOneHalf);
+        const XMVECTOR Midg = XMVectorMultiply(XMVectorAdd(Xg, Yg), g_XMOneHalf);
+        const XMVECTOR Midb = XMVectorMultiply(XMVectorAdd(Xb, Yb), g_XMOneHalf);
+
+        XMVECTOR fDir[4] = { XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+
+        for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+        {
+            const XMVECTOR Ptr = XMVectorMultiply(XMVectorSubtract(R[iPoint], Midr), Dirr);
+            const XMVECTOR Ptg = XMVectorMultiply(XMVectorSubtract(G[iPoint], Midg), Dirg);
+            const XMVECTOR Ptb = XMVectorMultiply(XMVectorSubtract(B[iPoint], Midb), Dirb);
+
+            XMVECTOR f = XMVectorAdd(XMVectorAdd(Ptr, Ptg), Ptb);
+            fDir[0] = XMVectorAdd(fDir[0], XMVectorMultiply(f, f));
+
+            f = XMVectorSubtract(XMVectorAdd(Ptr, Ptg), Ptb);
+            fDir[1] = XMVectorAdd(fDir[1], XMVectorMultiply(f, f));
+
+            f = XMVectorAdd(XMVectorSubtract(Ptr, Ptg), Ptb);
+            fDir[2] = XMVectorAdd(fDir[2], XMVectorMultiply(f, f));
+
+            f = XMVectorSubtract(XMVectorSubtract(Ptr, Ptg), Ptb);
+            fDir[3] = XMVectorAdd(fDir[3], XMVectorMultiply(f, f));
+        }
+
+        XMVECTOR fDirMax = fDir[0];
+        XMVECTOR swapG = XMVectorFalseInt();
+        XMVECTOR swapB = XMVectorFalseInt();
+
+        for (size_t iDir = 1; iDir < 4; iDir++)
+        {
+            const XMVECTOR better = XMVectorGreater(fDir[iDir], fDirMax);
+            fDirMax = XMVectorSelect(fDirMax, fDir[iDir], better);
+            swapG = XMVectorSelect(swapG, (iDir & 2) ? XMVectorTrueInt() : XMVectorFalseInt(), better);
+            swapB = XMVectorSelect(swapB, (iDir & 1) ? XMVectorTrueInt() : XMVectorFalseInt(), better);
+        }
+
+        swapG = XMVectorAndCInt(swapG, done);
+        swapB = XMVectorAndCInt(swapB, done);
+
+        XMVECTOR t = Xg;
+        Xg = XMVectorSelect(Xg, Yg, swapG);
+        Yg = XMVectorSelect(Yg, t, swapG);
+
+        t = Xb;
+        Xb = XMVectorSelect(Xb, Yb, swapB);
+        Yb = XMVectorSelect(Yb, t, swapB);
+
+        // Two color blocks are done as well
+        done = XMVectorOrInt(done, XMVectorLess(fAB, XMVectorReplicate(1.0f / 4096.0f)));
+
+        // Use Newton's Method to find local minima of sum-of-squares error.
+        // Lanes that have converged (or exited early) are masked off and keep their endpoints.
+        XMVECTOR active = XMVectorAndCInt(XMVectorTrueInt(), done);
+
+        const XMVECTOR vEighth = XMVectorReplicate(1.0f / 8.0f);
+        const XMVECTOR vEpsilon = XMVectorReplicate(fEpsilon);
+
+        for (size_t iIteration = 0; iIteration < maxIterations; iIteration++)
+        {
+            if (XMVector4EqualInt(active, XMVectorFalseInt()))
+                break;
+
+            // Calculate new steps
+            XMVECTOR Stepr[4];
+            XMVECTOR Stepg[4];
+            XMVECTOR Stepb[4];
+
+            for (size_t iStep = 0; iStep < 4; iStep++)
+            {
+                Stepr[iStep] = XMVectorAdd(XMVectorMultiply(Xr, vC[iStep]), XMVectorMultiply(Yr, vD[iStep]));
+                Stepg[iStep] = XMVectorAdd(XMVectorMultiply(Xg, vC[iStep]), XMVectorMultiply(Yg, vD[iStep]));
+                Stepb[iStep] = XMVectorAdd(XMVectorMultiply(Xb, vC[iStep]), XMVectorMultiply(Yb, vD[iStep]));
+            }
+
+            // Calculate color direction
+            XMVECTOR DirXr = XMVectorSubtract(Yr, Xr);
+            XMVECTOR DirXg = XMVectorSubtract(Yg, Xg);
+            XMVECTOR DirXb = XMVectorSubtract(Yb, Xb);
+
+            const XMVECTOR fLen = XMVectorAdd(XMVectorAdd(XMVectorMultiply(DirXr, DirXr), XMVectorMultiply(DirXg, DirXg)), XMVectorMultiply(DirXb, DirXb));
+
+            active = XMVectorAndCInt(active, XMVectorLess(fLen, XMVectorReplicate(1.0f / 4096.0f)));
+            if (XMVector4EqualInt(active, XMVectorFalseInt()))
+                break;
+
+            const XMVECTOR fScale = XMVectorDivide(fSteps, fLen);
+
+            DirXr = XMVectorMultiply(DirXr, fScale);
+            DirXg = XMVectorMultiply(DirXg, fScale);
+            DirXb = XMVectorMultiply(DirXb, fScale);
+
+            // Evaluate function, and derivatives
+            XMVECTOR d2X = XMVectorZero();
+            XMVECTOR d2Y = XMVectorZero();
+            XMVECTOR dXr = XMVectorZero();
+            XMVECTOR dXg = XMVectorZero();
+            XMVECTOR dXb = XMVectorZero();
+            XMVECTOR dYr = XMVectorZero();
+            XMVECTOR dYg = XMVectorZero();
+            XMVECTOR dYb = XMVectorZero();
+
+            for (size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+            {
+                const XMVECTOR fDot = XMVectorAdd(XMVectorAdd(
+                    XMVectorMultiply(XMVectorSubtract(R[iPoint], Xr), DirXr),
+                    XMVectorMultiply(XMVectorSubtract(G[iPoint], Xg), DirXg)),
+                    XMVectorMultiply(XMVectorSubtract(B[iPoint], Xb), DirXb));
+
+                XMVECTOR iStep = XMVectorTruncate(XMVectorAdd(fDot, g_XMOneHalf));
+                iStep = XMVectorSelect(iStep, fSteps, XMVectorGreaterOrEqual(fDot, fSteps));
+                iStep = XMVectorSelect(iStep, XMVectorZero(), XMVectorLessOrEqual(fDot, XMVectorZero()));
+
+                // Gather the per-lane step values
+                XMVECTOR C = XMVectorZero();
+                XMVECTOR D = XMVectorZero();
+                XMVECTOR Sr = XMVectorZero();
+                XMVECTOR Sg = XMVectorZero();
+                XMVECTOR Sb = XMVectorZero();
+
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    const XMVECTOR sel = XMVectorEqual(iStep, XMVectorReplicate(static_cast<float>(j)));
+                    C = XMVectorSelect(C, vC[j], sel);
+                    D = XMVectorSelect(D, vD[j], sel);
+                    Sr = XMVectorSelect(Sr, Stepr[j], sel);
+                    Sg = XMVectorSelect(Sg, Stepg[j], sel);
+                    Sb = XMVectorSelect(Sb, Stepb[j], sel);
+                }
+
+                const XMVECTOR Diffr = XMVectorSubtract(Sr, R[iPoint]);
+                const XMVECTOR Diffg = XMVectorSubtract(Sg, G[iPoint]);
+                const XMVECTOR Diffb = XMVectorSubtract(Sb, B[iPoint]);
+
+                const XMVECTOR fC = XMVectorMultiply(C, vEighth);
+                const XMVECTOR fD = XMVectorMultiply(D, vEighth);
+
+                d2X = XMVectorAdd(d2X, XMVectorMultiply(fC, C));
+                dXr = XMVectorAdd(dXr, XMVectorMultiply(fC, Diffr));
+                dXg = XMVectorAdd(dXg, XMVectorMultiply(fC, Diffg));
+                dXb = XMVectorAdd(dXb, XMVectorMultiply(fC, Diffb));
+
+                d2Y = XMVectorAdd(d2Y, XMVectorMultiply(fD, D));
+                dYr = XMVectorAdd(dYr, XMVectorMultiply(fD, Diffr));
+                dYg = XMVectorAdd(dYg, XMVectorMultiply(fD, Diffg));
+                dYb = XMVectorAdd(dYb, XMVectorMultiply(fD, Diffb));
+            }
+
+            // Move endpoints
+            const XMVECTOR moveX = XMVectorAndInt(active, XMVectorGreater(d2X, XMVectorZero()));
+            const XMVECTOR fX = XMVectorDivide(g_XMNegativeOne, d2X);
+
+            Xr = XMVectorSelect(Xr, XMVectorAdd(Xr, XMVectorMultiply(dXr, fX)), moveX);
+            Xg = XMVectorSelect(Xg, XMVectorAdd(Xg, XMVectorMultiply(dXg, fX)), moveX);
+            Xb = XMVectorSelect(Xb, XMVectorAdd(Xb, XMVectorMultiply(dXb, fX)), moveX);
+
+            const XMVECTOR moveY = XMVectorAndInt(active, XMVectorGreater(d2Y, XMVectorZero()));
+            const XMVECTOR fY = XMVectorDivide(g_XMNegativeOne, d2Y);
+
+            Yr = XMVectorSelect(Yr, XMVectorAdd(Yr, XMVectorMultiply(dYr, fY)), moveY);
+            Yg = XMVectorSelect(Yg, XMVectorAdd(Yg, XMVectorMultiply(dYg, fY)), moveY);
+            Yb = XMVectorSelect(Yb, XMVectorAdd(Yb, XMVectorMultiply(dYb, fY)), moveY);
+
+            XMVECTOR converged = XMVectorLess(XMVectorMultiply(dXr, dXr), vEpsilon);
+            converged = XMVectorAndInt(converged, XMVectorLess(XMVectorMultiply(dXg, dXg), vEpsilon));
+            converged = XMVectorAndInt(converged, XMVectorLess(XMVectorMultiply(dXb, dXb), vEpsilon));
+            converged = XMVectorAndInt(converged, XMVectorLess(XMVectorMultiply(dYr, dYr), vEpsilon));
+            converged = XMVectorAndInt(converged, XMVectorLess(XMVectorMultiply(dYg, dYg), vEpsilon));
+            converged = XMVectorAndInt(converged, XMVectorLess(XMVectorMultiply(dYb, dYb), vEpsilon));
+
+            active = XMVectorAndCInt(active, converged);
+        }
+
+        XMFLOAT4A xr, xg, xb, yr, yg, yb;
+        XMStoreFloat4A(&xr, Xr);
+        XMStoreFloat4A(&xg, Xg);
+        XMStoreFloat4A(&xb, Xb);
+        XMStoreFloat4A(&yr, Yr);
+        XMStoreFloat4A(&yg, Yg);
+        XMStoreFloat4A(&yb, Yb);
+
+        const float *pxr = &xr.x;
+        const float *pxg = &xg.x;
+        const float *pxb = &xb.x;
+        const float *pyr = &yr.x;
+        const float *pyg = &yg.x;
+        const float *pyb = &yb.x;
+
+        for (size_t j = 0; j < BC_BATCH_SIZE; ++j)
+        {
+            pX[j].r = pxr[j]; pX[j].g = pxg[j]; pX[j].b = pxb[j]; pX[j].a = 1.0f;
+            pY[j].r = pyr[j]; pY[j].g = pyg[j]; pY[j].b = pyb[j]; pY[j].a = 1.0f;
+        }
+    }
+#endif // !COLOR_WEIGHTS
+
+
     //-------------------------------------------------------------------------------------
     inline void DecodeBC1(
         _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor,
@@ -367,15 +657,17 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    void EncodeBC1(
+    // Determines the number of color steps and quantizes the block to R5G6B5. Returns 0
+    // if the whole block is color keyed, in which case pBC has already been written.
+    uint32_t PrepareBC1(
         _Out_ D3DX_BC1 *pBC,
+        _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA *Color,
         _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
         bool bColorKey,
         float threshold,
         uint32_t flags) noexcept
     {
-        assert(pBC && pColor);
-        static_assert(sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes");
+        assert(pBC && Color && pColor);
 
         // Determine if we need to colorkey this block
         uint32_t uSteps;
@@ -395,7 +687,7 @@ namespace
                 pBC->rgb[0] = 0x0000;
                 pBC->rgb[1] = 0xffff;
                 pBC->bitmap = 0xffffffff;
-                return;
+                return 0;
             }
 
             uSteps = (uColorKey > 0) ? 3u : 4u;
@@ -408,14 +700,12 @@ namespace
         // Quantize block to R56B5, using Floyd Stienberg error diffusion.  This
         // increases the chance that colors will map directly to the quantized
         // axis endpoints.
-        HDRColorA Color[NUM_PIXELS_PER_BLOCK];
         HDRColorA Error[NUM_PIXELS_PER_BLOCK];
 
         if (flags & BC_FLAGS_DITHER_RGB)
             memset(Error, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(HDRColorA));
 
-        size_t i;
-        for (i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
         {
             HDRColorA Clr;
             Clr.r = pColor[i].r;
@@ -489,11 +779,22 @@ namespace
             }
         }
 
-        // Perform 6D root finding function to find two endpoints of color axis.
-        // Then quantize and sort the endpoints depending on mode.
-        HDRColorA ColorA, ColorB, ColorC, ColorD;
+        return uSteps;
+    }
 
-        OptimizeRGB(&ColorA, &ColorB, Color, uSteps, flags);
+    //-------------------------------------------------------------------------------------
+    // Quantizes and sorts the endpoints found by OptimizeRGB, then encodes the color indices
+    void FinishBC1(
+        _Out_ D3DX_BC1 *pBC,
+        _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *Color,
+        _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
+        uint32_t uSteps,
+        HDRColorA ColorA,
+        HDRColorA ColorB,
+        float threshold,
+        uint32_t flags) noexcept
+    {
+        HDRColorA ColorC, ColorD;
 
         if (flags & BC_FLAGS_UNIFORM)
         {
@@ -597,10 +898,11 @@ namespace
 
         // Encode colors
         uint32_t dw = 0;
+        HDRColorA Error[NUM_PIXELS_PER_BLOCK];
         if (flags & BC_FLAGS_DITHER_RGB)
             memset(Error, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(HDRColorA));
 
-        for (i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
         {
             if ((3 == uSteps) && (pColor[i].a < threshold))
             {
@@ -684,6 +986,79 @@ namespace
         pBC->bitmap = dw;
     }
 
+    //-------------------------------------------------------------------------------------
+    void EncodeBC1(
+        _Out_ D3DX_BC1 *pBC,
+        _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
+        bool bColorKey,
+        float threshold,
+        uint32_t flags) noexcept
+    {
+        assert(pBC && pColor);
+        static_assert(sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes");
+
+        HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+        const uint32_t uSteps = PrepareBC1(pBC, Color, pColor, bColorKey, threshold, flags);
+        if (!uSteps)
+            return;
+
+        // Perform 6D root finding function to find two endpoints of color axis.
+        // Then quantize and sort the endpoints depending on mode.
+        HDRColorA ColorA, ColorB;
+        OptimizeRGB(&ColorA, &ColorB, Color, uSteps, flags);
+
+        FinishBC1(pBC, Color, pColor, uSteps, ColorA, ColorB, threshold, flags);
+    }
+
+#ifndef COLOR_WEIGHTS
+    //-------------------------------------------------------------------------------------
+    // Encodes up to BC_BATCH_SIZE blocks, sharing one OptimizeRGBBatch call. Color keyed
+    // blocks drop out after PrepareBC1; unused lanes replicate the first active block.
+    void EncodeBC1Batch(
+        _Out_writes_(count) D3DX_BC1 * const *pBC,
+        _In_reads_(count) const HDRColorA * const *pColor,
+        size_t count,
+        bool bColorKey,
+        float threshold,
+        uint32_t flags) noexcept
+    {
+        assert(pBC && pColor && count > 0 && count <= BC_BATCH_SIZE);
+
+        HDRColorA Color[BC_BATCH_SIZE][NUM_PIXELS_PER_BLOCK];
+        uint32_t uSteps[BC_BATCH_SIZE] = {};
+        size_t lane[BC_BATCH_SIZE] = {};
+        size_t nLanes = 0;
+
+        for (size_t j = 0; j < count; ++j)
+        {
+            uSteps[j] = PrepareBC1(pBC[j], Color[j], pColor[j], bColorKey, threshold, flags);
+            if (uSteps[j])
+                lane[nLanes++] = j;
+        }
+
+        if (!nLanes)
+            return;
+
+        const HDRColorA *pPoints[BC_BATCH_SIZE];
+        uint32_t cSteps[BC_BATCH_SIZE];
+        for (size_t j = 0; j < BC_BATCH_SIZE; ++j)
+        {
+            const size_t k = lane[(j < nLanes) ? j : 0];
+            pPoints[j] = Color[k];
+            cSteps[j] = uSteps[k];
+        }
+
+        HDRColorA ColorA[BC_BATCH_SIZE], ColorB[BC_BATCH_SIZE];
+        OptimizeRGBBatch(ColorA, ColorB, pPoints, cSteps, flags, (flags & BC_FLAGS_BATCH_FAST) ? 2u : 8u);
+
+        for (size_t j = 0; j < nLanes; ++j)
+        {
+            const size_t k = lane[j];
+            FinishBC1(pBC[k], Color[k], pColor[k], uSteps[k], ColorA[j], ColorB[j], threshold, flags);
+        }
+    }
+#endif // !COLOR_WEIGHTS
+
     //-------------------------------------------------------------------------------------
 #ifdef COLOR_WEIGHTS
     void EncodeSolidBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor)
@@ -717,6 +1092,304 @@ namespace
         pBC->bitmap = 0x00000000;
     }
 #endif // COLOR_WEIGHTS
+    //-------------------------------------------------------------------------------------
+    // Converts the block for BC1, applying alpha dithering if requested
+    void LoadBC1(
+        _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA *pOut,
+        _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor,
+        uint32_t flags) noexcept
+    {
+        if (flags & BC_FLAGS_DITHER_A)
+        {
+            float fError[NUM_PIXELS_PER_BLOCK] = {};
+
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                HDRColorA clr;
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&clr), pColor[i]);
+
+                const float fAlph = clr.a + fError[i];
+
+                pOut[i].r = clr.r;
+                pOut[i].g = clr.g;
+                pOut[i].b = clr.b;
+                pOut[i].a = static_cast<float>(static_cast<int32_t>(clr.a + fError[i] + 0.5f));
+
+                const float fDiff = fAlph - pOut[i].a;
+
+                if (3 != (i & 3))
+                {
+                    assert(i < 15);
+                    _Analysis_assume_(i < 15);
+                    fError[i + 1] += fDiff * (7.0f / 16.0f);
+                }
+
+                if (i < 12)
+                {
+                    if (i & 3)
+                        fError[i + 3] += fDiff * (3.0f / 16.0f);
+
+                    fError[i + 4] += fDiff * (5.0f / 16.0f);
+
+                    if (3 != (i & 3))
+                    {
+                        assert(i < 11);
+                        _Analysis_assume_(i < 11);
+                        fError[i + 5] += fDiff * (1.0f / 16.0f);
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&pOut[i]), pColor[i]);
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    // 4-bit alpha part of BC2
+    void EncodeBC2Alpha(
+        _Out_ D3DX_BC2 *pBC2,
+        _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *Color,
+        uint32_t flags) noexcept
+    {
+        // 4-bit alpha part.  Dithered using Floyd Stienberg error diffusion.
+        pBC2->bitmap[0] = 0;
+        pBC2->bitmap[1] = 0;
+
+        float fError[NUM_PIXELS_PER_BLOCK] = {};
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            float fAlph = Color[i].a;
+            if (flags & BC_FLAGS_DITHER_A)
+                fAlph += fError[i];
+
+            const auto u = static_cast<uint32_t>(fAlph * 15.0f + 0.5f);
+
+            pBC2->bitmap[i >> 3] >>= 4;
+            pBC2->bitmap[i >> 3] |= (u << 28);
+
+            if (flags & BC_FLAGS_DITHER_A)
+            {
+                const float fDiff = fAlph - float(u) * (1.0f / 15.0f);
+
+                if (3 != (i & 3))
+                {
+                    assert(i < 15);
+                    _Analysis_assume_(i < 15);
+                    fError[i + 1] += fDiff * (7.0f / 16.0f);
+                }
+
+                if (i < 12)
+                {
+                    if (i & 3)
+                        fError[i + 3] += fDiff * (3.0f / 16.0f);
+
+                    fError[i + 4] += fDiff * (5.0f / 16.0f);
+
+                    if (3 != (i & 3))
+                    {
+                        assert(i < 11);
+                        _Analysis_assume_(i < 11);
+                        fError[i + 5] += fDiff * (1.0f / 16.0f);
+                    }
+                }
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Adaptive 3-bit alpha part of BC3
+    void EncodeBC3Alpha(
+        _Out_ D3DX_BC3 *pBC3,
+        _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *Color,
+        uint32_t flags) noexcept
+    {
+        // Quantize block to A8, using Floyd Stienberg error diffusion.  This
+        // increases the chance that colors will map directly to the quantized
+        // axis endpoints.
+        float fAlpha[NUM_PIXELS_PER_BLOCK] = {};
+        float fError[NUM_PIXELS_PER_BLOCK] = {};
+
+        float fMinAlpha = Color[0].a;
+        float fMaxAlpha = Color[0].a;
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            float fAlph = Color[i].a;
+            if (flags & BC_FLAGS_DITHER_A)
+                fAlph += fError[i];
+
+            fAlpha[i] = static_cast<float>(static_cast<int32_t>(fAlph * 255.0f + 0.5f)) * (1.0f / 255.0f);
+
+            if (fAlpha[i] < fMinAlpha)
+                fMinAlpha = fAlpha[i];
+            else if (fAlpha[i] > fMaxAlpha)
+                fMaxAlpha = fAlpha[i];
+
+            if (flags & BC_FLAGS_DITHER_A)
+            {
+                const float fDiff = fAlph - fAlpha[i];
+
+                if (3 != (i & 3))
+                {
+                    assert(i < 15);
+                    _Analysis_assume_(i < 15);
+                    fError[i + 1] += fDiff * (7.0f / 16.0f);
+                }
+
+                if (i < 12)
+                {
+                    if (i & 3)
+                        fError[i + 3] += fDiff * (3.0f / 16.0f);
+
+                    fError[i + 4] += fDiff * (5.0f / 16.0f);
+
+                    if (3 != (i & 3))
+                    {
+                        assert(i < 11);
+                        _Analysis_assume_(i < 11);
+                        fError[i + 5] += fDiff * (1.0f / 16.0f);
+                    }
+                }
+            }
+        }
+
+    #ifdef COLOR_WEIGHTS
+        if (0.0f == fMaxAlpha)
+        {
+            EncodeSolidBC1(&pBC3->dxt1, Color);
+            pBC3->alpha[0] = 0x00;
+            pBC3->alpha[1] = 0x00;
+            memset(pBC3->bitmap, 0x00, 6);
+        }
+    #endif
+
+        // Alpha part
+        if (1.0f == fMinAlpha)
+        {
+            pBC3->alpha[0] = 0xff;
+            pBC3->alpha[1] = 0xff;
+            memset(pBC3->bitmap, 0x00, 6);
+            return;
+        }
+
+        // Optimize and Quantize Min and Max values
+        const uint32_t uSteps = ((0.0f == fMinAlpha) || (1.0f == fMaxAlpha)) ? 6u : 8u;
+
+        float fAlphaA, fAlphaB;
+        OptimizeAlpha<false>(&fAlphaA, &fAlphaB, fAlpha, uSteps);
+
+        auto const bAlphaA = static_cast<uint8_t>(static_cast<int32_t>(fAlphaA * 255.0f + 0.5f));
+        auto const bAlphaB = static_cast<uint8_t>(static_cast<int32_t>(fAlphaB * 255.0f + 0.5f));
+
+        fAlphaA = static_cast<float>(bAlphaA) * (1.0f / 255.0f);
+        fAlphaB = static_cast<float>(bAlphaB) * (1.0f / 255.0f);
+
+        // Setup block
+        if ((8 == uSteps) && (bAlphaA == bAlphaB))
+        {
+            pBC3->alpha[0] = bAlphaA;
+            pBC3->alpha[1] = bAlphaB;
+            memset(pBC3->bitmap, 0x00, 6);
+            return;
+        }
+
+        static const size_t pSteps6[] = { 0, 2, 3, 4, 5, 1 };
+        static const size_t pSteps8[] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+
+        const size_t *pSteps;
+        float fStep[8] = {};
+
+        if (6 == uSteps)
+        {
+            pBC3->alpha[0] = bAlphaA;
+            pBC3->alpha[1] = bAlphaB;
+
+            fStep[0] = fAlphaA;
+            fStep[1] = fAlphaB;
+
+            for (size_t i = 1; i < 5; ++i)
+                fStep[i + 1] = (fStep[0] * float(5u - i) + fStep[1] * float(i)) * (1.0f / 5.0f);
+
+            fStep[6] = 0.0f;
+            fStep[7] = 1.0f;
+
+            pSteps = pSteps6;
+        }
+        else
+        {
+            pBC3->alpha[0] = bAlphaB;
+            pBC3->alpha[1] = bAlphaA;
+
+            fStep[0] = fAlphaB;
+            fStep[1] = fAlphaA;
+
+            for (size_t i = 1; i < 7; ++i)
+                fStep[i + 1] = (fStep[0] * float(7u - i) + fStep[1] * float(i)) * (1.0f / 7.0f);
+
+            pSteps = pSteps8;
+        }
+
+        // Encode alpha bitmap
+        auto const fSteps = static_cast<float>(uSteps - 1);
+        const float fScale = (fStep[0] != fStep[1]) ? (fSteps / (fStep[1] - fStep[0])) : 0.0f;
+
+        if (flags & BC_FLAGS_DITHER_A)
+            memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
+
+        for (size_t iSet = 0; iSet < 2; iSet++)
+        {
+            uint32_t dw = 0;
+
+            const size_t iMin = iSet * 8;
+            const size_t iLim = iMin + 8;
+
+            for (size_t i = iMin; i < iLim; ++i)
+            {
+                float fAlph = Color[i].a;
+                if (flags & BC_FLAGS_DITHER_A)
+                    fAlph += fError[i];
+                const float fDot = (fAlph - fStep[0]) * fScale;
+
+                uint32_t iStep;
+                if (fDot <= 0.0f)
+                    iStep = ((6 == uSteps) && (fAlph <= fStep[0] * 0.5f)) ? 6u : 0u;
+                else if (fDot >= fSteps)
+                    iStep = ((6 == uSteps) && (fAlph >= (fStep[1] + 1.0f) * 0.5f)) ? 7u : 1u;
+                else
+                    iStep = uint32_t(pSteps[uint32_t(fDot + 0.5f)]);
+
+                dw = (iStep << 21) | (dw >> 3);
+
+                if (flags & BC_FLAGS_DITHER_A)
+                {
+                    const float fDiff = (fAlph - fStep[iStep]);
+
+                    if (3 != (i & 3))
+                        fError[i + 1] += fDiff * (7.0f / 16.0f);
+
+                    if (i < 12)
+                    {
+                        if (i & 3)
+                            fError[i + 3] += fDiff * (3.0f / 16.0f);
+
+                        fError[i + 4] += fDiff * (5.0f / 16.0f);
+
+                        if (3 != (i & 3))
+                            fError[i + 5] += fDiff * (1.0f / 16.0f);
+                    }
+                }
+            }
+
+            pBC3->bitmap[0 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[0];
+            pBC3->bitmap[1 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[1];
+            pBC3->bitmap[2 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[2];
+        }
+    }
 }
 
 
@@ -740,58 +1413,38 @@ void DirectX::D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float threshol
     assert(pBC && pColor);
 
     HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    LoadBC1(Color, pColor, flags);
 
-    if (flags & BC_FLAGS_DITHER_A)
-    {
-        float fError[NUM_PIXELS_PER_BLOCK] = {};
-
-        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-        {
-            HDRColorA clr;
-            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&clr), pColor[i]);
-
-            const float fAlph = clr.a + fError[i];
-
-            Color[i].r = clr.r;
-            Color[i].g = clr.g;
-            Color[i].b = clr.b;
-            Color[i].a = static_cast<float>(static_cast<int32_t>(clr.a + fError[i] + 0.5f));
-
-            const float fDiff = fAlph - Color[i].a;
-
-            if (3 != (i & 3))
-            {
-                assert(i < 15);
-                _Analysis_assume_(i < 15);
-                fError[i + 1] += fDiff * (7.0f / 16.0f);
-            }
-
-            if (i < 12)
-            {
-                if (i & 3)
-                    fError[i + 3] += fDiff * (3.0f / 16.0f);
+    auto pBC1 = reinterpret_cast<D3DX_BC1 *>(pBC);
+    EncodeBC1(pBC1, Color, true, threshold, flags);
+}
 
-                fError[i + 4] += fDiff * (5.0f / 16.0f);
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC1Batch(uint8_t *pBC, const XMVECTOR *pColor, size_t count, float threshold, uint32_t flags) noexcept
+{
+    assert(pBC && pColor);
 
-                if (3 != (i & 3))
-                {
-                    assert(i < 11);
-                    _Analysis_assume_(i < 11);
-                    fError[i + 5] += fDiff * (1.0f / 16.0f);
-                }
-            }
-        }
-    }
-    else
+#ifdef COLOR_WEIGHTS
+    for (size_t i = 0; i < count; ++i)
+        D3DXEncodeBC1(pBC + i * 8, pColor + i * NUM_PIXELS_PER_BLOCK, threshold, flags);
+#else
+    HDRColorA Color[BC_BATCH_SIZE][NUM_PIXELS_PER_BLOCK];
+    D3DX_BC1 *pBlocks[BC_BATCH_SIZE];
+    const HDRColorA *pColors[BC_BATCH_SIZE];
+
+    for (size_t i = 0; i < count; i += BC_BATCH_SIZE)
     {
-        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        const size_t n = std::min<size_t>(BC_BATCH_SIZE, count - i);
+        for (size_t j = 0; j < n; ++j)
         {
-            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&Color[i]), pColor[i]);
+            LoadBC1(Color[j], pColor + (i + j) * NUM_PIXELS_PER_BLOCK, flags);
+            pBlocks[j] = reinterpret_cast<D3DX_BC1 *>(pBC + (i + j) * 8);
+            pColors[j] = Color[j];
         }
-    }
 
-    auto pBC1 = reinterpret_cast<D3DX_BC1 *>(pBC);
-    EncodeBC1(pBC1, Color, true, threshold, flags);
+        EncodeBC1Batch(pBlocks, pColors, n, true, threshold, flags);
+    }
+#endif
 }
 
 
@@ -838,60 +1491,55 @@ void DirectX::D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, uint32_t flags
 
     auto pBC2 = reinterpret_cast<D3DX_BC2 *>(pBC);
 
-    // 4-bit alpha part.  Dithered using Floyd Stienberg error diffusion.
-    pBC2->bitmap[0] = 0;
-    pBC2->bitmap[1] = 0;
+    // Alpha part
+    EncodeBC2Alpha(pBC2, Color, flags);
 
-    float fError[NUM_PIXELS_PER_BLOCK] = {};
-    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    // RGB part
+#ifdef COLOR_WEIGHTS
+    if (!pBC2->bitmap[0] && !pBC2->bitmap[1])
     {
-        float fAlph = Color[i].a;
-        if (flags & BC_FLAGS_DITHER_A)
-            fAlph += fError[i];
+        EncodeSolidBC1(pBC2->dxt1, Color);
+        return;
+    }
+#endif // COLOR_WEIGHTS
 
-        const auto u = static_cast<uint32_t>(fAlph * 15.0f + 0.5f);
+    EncodeBC1(&pBC2->bc1, Color, false, 0.f, flags);
+}
 
-        pBC2->bitmap[i >> 3] >>= 4;
-        pBC2->bitmap[i >> 3] |= (u << 28);
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC2Batch(uint8_t *pBC, const XMVECTOR *pColor, size_t count, float, uint32_t flags) noexcept
+{
+    assert(pBC && pColor);
 
-        if (flags & BC_FLAGS_DITHER_A)
+#ifdef COLOR_WEIGHTS
+    for (size_t i = 0; i < count; ++i)
+        D3DXEncodeBC2(pBC + i * 16, pColor + i * NUM_PIXELS_PER_BLOCK, flags);
+#else
+    HDRColorA Color[BC_BATCH_SIZE][NUM_PIXELS_PER_BLOCK];
+    D3DX_BC1 *pBlocks[BC_BATCH_SIZE];
+    const HDRColorA *pColors[BC_BATCH_SIZE];
+
+    for (size_t i = 0; i < count; i += BC_BATCH_SIZE)
+    {
+        const size_t n = std::min<size_t>(BC_BATCH_SIZE, count - i);
+        for (size_t j = 0; j < n; ++j)
         {
-            const float fDiff = fAlph - float(u) * (1.0f / 15.0f);
-
-            if (3 != (i & 3))
+            const XMVECTOR *pSrc = pColor + (i + j) * NUM_PIXELS_PER_BLOCK;
+            for (size_t k = 0; k < NUM_PIXELS_PER_BLOCK; ++k)
             {
-                assert(i < 15);
-                _Analysis_assume_(i < 15);
-                fError[i + 1] += fDiff * (7.0f / 16.0f);
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&Color[j][k]), pSrc[k]);
             }
 
-            if (i < 12)
-            {
-                if (i & 3)
-                    fError[i + 3] += fDiff * (3.0f / 16.0f);
-
-                fError[i + 4] += fDiff * (5.0f / 16.0f);
+            auto pBC2 = reinterpret_cast<D3DX_BC2 *>(pBC + (i + j) * 16);
+            EncodeBC2Alpha(pBC2, Color[j], flags);
 
-                if (3 != (i & 3))
-                {
-                    assert(i < 11);
-                    _Analysis_assume_(i < 11);
-                    fError[i + 5] += fDiff * (1.0f / 16.0f);
-                }
-            }
+            pBlocks[j] = &pBC2->bc1;
+            pColors[j] = Color[j];
         }
-    }
 
-    // RGB part
-#ifdef COLOR_WEIGHTS
-    if (!pBC2->bitmap[0] && !pBC2->bitmap[1])
-    {
-        EncodeSolidBC1(pBC2->dxt1, Color);
-        return;
+        EncodeBC1Batch(pBlocks, pColors, n, false, 0.f, flags);
     }
-#endif // COLOR_WEIGHTS
-
-    EncodeBC1(&pBC2->bc1, Color, false, 0.f, flags);
+#endif
 }
 
 
@@ -954,188 +1602,45 @@ void DirectX::D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, uint32_t flags
 
     auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC);
 
-    // Quantize block to A8, using Floyd Stienberg error diffusion.  This
-    // increases the chance that colors will map directly to the quantized
-    // axis endpoints.
-    float fAlpha[NUM_PIXELS_PER_BLOCK] = {};
-    float fError[NUM_PIXELS_PER_BLOCK] = {};
-
-    float fMinAlpha = Color[0].a;
-    float fMaxAlpha = Color[0].a;
-
-    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-    {
-        float fAlph = Color[i].a;
-        if (flags & BC_FLAGS_DITHER_A)
-            fAlph += fError[i];
-
-        fAlpha[i] = static_cast<float>(static_cast<int32_t>(fAlph * 255.0f + 0.5f)) * (1.0f / 255.0f);
-
-        if (fAlpha[i] < fMinAlpha)
-            fMinAlpha = fAlpha[i];
-        else if (fAlpha[i] > fMaxAlpha)
-            fMaxAlpha = fAlpha[i];
-
-        if (flags & BC_FLAGS_DITHER_A)
-        {
-            const float fDiff = fAlph - fAlpha[i];
-
-            if (3 != (i & 3))
-            {
-                assert(i < 15);
-                _Analysis_assume_(i < 15);
-                fError[i + 1] += fDiff * (7.0f / 16.0f);
-            }
-
-            if (i < 12)
-            {
-                if (i & 3)
-                    fError[i + 3] += fDiff * (3.0f / 16.0f);
-
-                fError[i + 4] += fDiff * (5.0f / 16.0f);
-
-                if (3 != (i & 3))
-                {
-                    assert(i < 11);
-                    _Analysis_assume_(i < 11);
-                    fError[i + 5] += fDiff * (1.0f / 16.0f);
-                }
-            }
-        }
-    }
-
-#ifdef COLOR_WEIGHTS
-    if (0.0f == fMaxAlpha)
-    {
-        EncodeSolidBC1(&pBC3->dxt1, Color);
-        pBC3->alpha[0] = 0x00;
-        pBC3->alpha[1] = 0x00;
-        memset(pBC3->bitmap, 0x00, 6);
-    }
-#endif
+    // Alpha part
+    EncodeBC3Alpha(pBC3, Color, flags);
 
     // RGB part
     EncodeBC1(&pBC3->bc1, Color, false, 0.f, flags);
+}
 
-    // Alpha part
-    if (1.0f == fMinAlpha)
-    {
-        pBC3->alpha[0] = 0xff;
-        pBC3->alpha[1] = 0xff;
-        memset(pBC3->bitmap, 0x00, 6);
-        return;
-    }
-
-    // Optimize and Quantize Min and Max values
-    const uint32_t uSteps = ((0.0f == fMinAlpha) || (1.0f == fMaxAlpha)) ? 6u : 8u;
-
-    float fAlphaA, fAlphaB;
-    OptimizeAlpha<false>(&fAlphaA, &fAlphaB, fAlpha, uSteps);
-
-    auto const bAlphaA = static_cast<uint8_t>(static_cast<int32_t>(fAlphaA * 255.0f + 0.5f));
-    auto const bAlphaB = static_cast<uint8_t>(static_cast<int32_t>(fAlphaB * 255.0f + 0.5f));
-
-    fAlphaA = static_cast<float>(bAlphaA) * (1.0f / 255.0f);
-    fAlphaB = static_cast<float>(bAlphaB) * (1.0f / 255.0f);
-
-    // Setup block
-    if ((8 == uSteps) && (bAlphaA == bAlphaB))
-    {
-        pBC3->alpha[0] = bAlphaA;
-        pBC3->alpha[1] = bAlphaB;
-        memset(pBC3->bitmap, 0x00, 6);
-        return;
-    }
-
-    static const size_t pSteps6[] = { 0, 2, 3, 4, 5, 1 };
-    static const size_t pSteps8[] = { 0, 2, 3, 4, 5, 6, 7, 1 };
-
-    const size_t *pSteps;
-    float fStep[8] = {};
-
-    if (6 == uSteps)
-    {
-        pBC3->alpha[0] = bAlphaA;
-        pBC3->alpha[1] = bAlphaB;
-
-        fStep[0] = fAlphaA;
-        fStep[1] = fAlphaB;
-
-        for (size_t i = 1; i < 5; ++i)
-            fStep[i + 1] = (fStep[0] * float(5u - i) + fStep[1] * float(i)) * (1.0f / 5.0f);
-
-        fStep[6] = 0.0f;
-        fStep[7] = 1.0f;
-
-        pSteps = pSteps6;
-    }
-    else
-    {
-        pBC3->alpha[0] = bAlphaB;
-        pBC3->alpha[1] = bAlphaA;
-
-        fStep[0] = fAlphaB;
-        fStep[1] = fAlphaA;
-
-        for (size_t i = 1; i < 7; ++i)
-            fStep[i + 1] = (fStep[0] * float(7u - i) + fStep[1] * float(i)) * (1.0f / 7.0f);
-
-        pSteps = pSteps8;
-    }
-
-    // Encode alpha bitmap
-    auto const fSteps = static_cast<float>(uSteps - 1);
-    const float fScale = (fStep[0] != fStep[1]) ? (fSteps / (fStep[1] - fStep[0])) : 0.0f;
-
-    if (flags & BC_FLAGS_DITHER_A)
-        memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC3Batch(uint8_t *pBC, const XMVECTOR *pColor, size_t count, float, uint32_t flags) noexcept
+{
+    assert(pBC && pColor);
 
-    for (size_t iSet = 0; iSet < 2; iSet++)
+#ifdef COLOR_WEIGHTS
+    for (size_t i = 0; i < count; ++i)
+        D3DXEncodeBC3(pBC + i * 16, pColor + i * NUM_PIXELS_PER_BLOCK, flags);
+#else
+    HDRColorA Color[BC_BATCH_SIZE][NUM_PIXELS_PER_BLOCK];
+    D3DX_BC1 *pBlocks[BC_BATCH_SIZE];
+    const HDRColorA *pColors[BC_BATCH_SIZE];
+
+    for (size_t i = 0; i < count; i += BC_BATCH_SIZE)
     {
-        uint32_t dw = 0;
-
-        const size_t iMin = iSet * 8;
-        const size_t iLim = iMin + 8;
-
-        for (size_t i = iMin; i < iLim; ++i)
+        const size_t n = std::min<size_t>(BC_BATCH_SIZE, count - i);
+        for (size_t j = 0; j < n; ++j)
         {
-            float fAlph = Color[i].a;
-            if (flags & BC_FLAGS_DITHER_A)
-                fAlph += fError[i];
-            const float fDot = (fAlph - fStep[0]) * fScale;
-
-            uint32_t iStep;
-            if (fDot <= 0.0f)
-                iStep = ((6 == uSteps) && (fAlph <= fStep[0] * 0.5f)) ? 6u : 0u;
-            else if (fDot >= fSteps)
-                iStep = ((6 == uSteps) && (fAlph >= (fStep[1] + 1.0f) * 0.5f)) ? 7u : 1u;
-            else
-                iStep = uint32_t(pSteps[uint32_t(fDot + 0.5f)]);
-
-            dw = (iStep << 21) | (dw >> 3);
-
-            if (flags & BC_FLAGS_DITHER_A)
+            const XMVECTOR *pSrc = pColor + (i + j) * NUM_PIXELS_PER_BLOCK;
+            for (size_t k = 0; k < NUM_PIXELS_PER_BLOCK; ++k)
             {
-                const float fDiff = (fAlph - fStep[iStep]);
-
-                if (3 != (i & 3))
-                    fError[i + 1] += fDiff * (7.0f / 16.0f);
-
-                if (i < 12)
-                {
-                    if (i & 3)
-                        fError[i + 3] += fDiff * (3.0f / 16.0f);
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&Color[j][k]), pSrc[k]);
+            }
 
-                    fError[i + 4] += fDiff * (5.0f / 16.0f);
+            auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC + (i + j) * 16);
+            EncodeBC3Alpha(pBC3, Color[j], flags);
 
-                    if (3 != (i & 3))
-                        fError[i + 5] += fDiff * (1.0f / 16.0f);
-                }
-            }
+            pBlocks[j] = &pBC3->bc1;
+            pColors[j] = Color[j];
         }
 
-        pBC3->bitmap[0 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[0];
-        pBC3->bitmap[1 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[1];
-        pBC3->bitmap[2 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[2];
+        EncodeBC1Batch(pBlocks, pColors, n, false, 0.f, flags);
     }
+#endif
 }
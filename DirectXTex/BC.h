@@ -45,8 +45,30 @@ namespace DirectX
 
         BC_FLAGS_FORCE_BC7_MODE6 = 0x100000,
         // BC7 should only use mode 6; skip other modes
+
+        BC_FLAGS_BATCH = 0x200000,
+        // BC1-3 are encoded four blocks at a time with SIMD; results are identical to the per-block encoder
+
+        BC_FLAGS_BATCH_FAST = 0x400000,
+        // Used with BC_FLAGS_BATCH; limits the BC1-3 endpoint refinement to two Newton iterations (not bit-identical,
+        // RGB MSE is typically within ~3% of the full refinement)
+
+        BC_FLAGS_BC7_ULTRAFAST = 0x20000000,
+        // BC7 classifies each block and refines one partition per mode with rotation 0 and no endpoint optimization
+
+        BC_FLAGS_BC7_FAST = 0x40000000,
+        // BC7 classifies each block and refines a few partitions per mode with rotation 0 and no exhaustive endpoint search
+
+        BC_FLAGS_BC7_SLOW = 0x60000000,
+        // BC7 refines every partition of every mode, including the 3 subset modes
+
+        BC_FLAGS_BC7_QUALITY_MASK = 0x60000000,
+        // BC7 quality tier; zero keeps the default encoder (partitions/4, all rotations)
     };
 
+    // Number of blocks processed together by the D3DXEncodeBCnBatch functions
+    constexpr size_t BC_BATCH_SIZE = 4;
+
     //-------------------------------------------------------------------------------------
     // Structures
     //-------------------------------------------------------------------------------------
@@ -312,6 +334,7 @@ namespace DirectX
 
     typedef void (*BC_DECODE)(XMVECTOR *pColor, const uint8_t *pBC);
     typedef void (*BC_ENCODE)(uint8_t *pDXT, const XMVECTOR *pColor, uint32_t flags);
+    typedef void (*BC_ENCODE_BATCH)(uint8_t *pDXT, const XMVECTOR *pColor, size_t count, float threshold, uint32_t flags);
 
     void D3DXDecodeBC1(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(8) const uint8_t *pBC) noexcept;
     void D3DXDecodeBC2(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC) noexcept;
@@ -337,4 +360,9 @@ namespace DirectX
     void D3DXEncodeBC6HS(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ uint32_t flags) noexcept;
     void D3DXEncodeBC7(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ uint32_t flags) noexcept;
 
+    void D3DXEncodeBC1Batch(_Out_writes_(8 * count) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * count) const XMVECTOR *pColor, _In_ size_t count, _In_ float threshold, _In_ uint32_t flags) noexcept;
+    void D3DXEncodeBC2Batch(_Out_writes_(16 * count) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * count) const XMVECTOR *pColor, _In_ size_t count, _In_ float threshold, _In_ uint32_t flags) noexcept;
+    void D3DXEncodeBC3Batch(_Out_writes_(16 * count) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * count) const XMVECTOR *pColor, _In_ size_t count, _In_ float threshold, _In_ uint32_t flags) noexcept;
+        // Encodes 'count' consecutive blocks in groups of BC_BATCH_SIZE. threshold is only used by BC1
+
 } // namespace
@@ -44,6 +44,11 @@ namespace
     constexpr size_t BC7_NUM_CHANNELS = 4;
     constexpr size_t BC7_MAX_SHAPES = 64;
 
+    // BC7 fast tier heuristics (block error is the sum of squared 8-bit channel differences)
+    constexpr uint8_t BC7_LOW_VARIANCE_RANGE = 16;
+    constexpr float BC7_ULTRAFAST_GOOD_MSE = 64.0f;
+    constexpr float BC7_FAST_GOOD_MSE = 16.0f;
+
     constexpr int32_t BC67_WEIGHT_MAX = 64;
     constexpr uint32_t BC67_WEIGHT_SHIFT = 6;
     constexpr int32_t BC67_WEIGHT_ROUND = 32;
@@ -782,11 +787,13 @@ namespace
         struct EncodeParams
         {
             uint8_t uMode;
+            uint32_t uQuality;
             LDREndPntPair aEndPts[BC7_MAX_SHAPES][BC7_MAX_REGIONS];
             LDRColorA aLDRPixels[NUM_PIXELS_PER_BLOCK];
             const HDRColorA* const aHDRPixels;
 
-            EncodeParams(const HDRColorA* const aOriginal) noexcept : uMode(0), aEndPts{}, aLDRPixels{}, aHDRPixels(aOriginal) {}
+            EncodeParams(const HDRColorA* const aOriginal, uint32_t quality) noexcept :
+                uMode(0), uQuality(quality), aEndPts{}, aLDRPixels{}, aHDRPixels(aOriginal) {}
         };
     #pragma warning(pop)
 
@@ -2730,10 +2737,15 @@ void D3DX_BC7::Encode(uint32_t flags, const HDRColorA* const pIn) noexcept
 {
     assert(pIn);
 
+    const uint32_t quality = flags & BC_FLAGS_BC7_QUALITY_MASK;
+    const bool bFastTier = (quality == BC_FLAGS_BC7_ULTRAFAST || quality == BC_FLAGS_BC7_FAST);
+
     D3DX_BC7 final = *this;
-    EncodeParams EP(pIn);
+    EncodeParams EP(pIn, quality);
     float fMSEBest = FLT_MAX;
     uint32_t alphaMask = 0xFF;
+    LDRColorA minColor(255, 255, 255, 255);
+    LDRColorA maxColor(0, 0, 0, 0);
 
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
@@ -2742,13 +2754,36 @@ void D3DX_BC7::Encode(uint32_t flags, const HDRColorA* const pIn) noexcept
         EP.aLDRPixels[i].b = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].b * 255.0f + 0.01f)));
         EP.aLDRPixels[i].a = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].a * 255.0f + 0.01f)));
         alphaMask &= EP.aLDRPixels[i].a;
+
+        for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+        {
+            minColor[ch] = std::min(minColor[ch], EP.aLDRPixels[i][ch]);
+            maxColor[ch] = std::max(maxColor[ch], EP.aLDRPixels[i][ch]);
+        }
     }
 
     const bool bHasAlpha = (alphaMask != 0xFF);
 
-    for (EP.uMode = 0; EP.uMode < 8 && fMSEBest > 0; ++EP.uMode)
+    // Block classification for the fast tiers
+    uint8_t uRange = 0;
+    for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+        uRange = std::max<uint8_t>(uRange, static_cast<uint8_t>(maxColor[ch] - minColor[ch]));
+
+    const bool bSolid = (uRange == 0);
+    const bool bLowVariance = (uRange <= BC7_LOW_VARIANCE_RANGE);
+
+    // Fast tiers try the usually-best modes first and stop once the block is good enough
+    static const uint8_t s_aDefaultModeOrder[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    static const uint8_t s_aFastModeOrder[8] = { 6, 1, 3, 5, 4, 7, 2, 0 };
+    const uint8_t* aModeOrder = bFastTier ? s_aFastModeOrder : s_aDefaultModeOrder;
+    const float fMSEGoodEnough = (quality == BC_FLAGS_BC7_ULTRAFAST) ? BC7_ULTRAFAST_GOOD_MSE
+        : (quality == BC_FLAGS_BC7_FAST) ? BC7_FAST_GOOD_MSE : 0.0f;
+
+    for (size_t m = 0; m < 8 && fMSEBest > fMSEGoodEnough; ++m)
     {
-        if (!(flags & BC_FLAGS_USE_3SUBSETS) && (EP.uMode == 0 || EP.uMode == 2))
+        EP.uMode = aModeOrder[m];
+
+        if (!(flags & BC_FLAGS_USE_3SUBSETS) && quality != BC_FLAGS_BC7_SLOW && (EP.uMode == 0 || EP.uMode == 2))
         {
             // 3 subset modes tend to be used rarely and add significant compression time
             continue;
@@ -2766,19 +2801,53 @@ void D3DX_BC7::Encode(uint32_t flags, const HDRColorA* const pIn) noexcept
             continue;
         }
 
+        if (bFastTier)
+        {
+            if (bSolid && EP.uMode != 5 && EP.uMode != 6)
+            {
+                // Solid blocks are reproduced by the single subset modes with the most endpoint precision
+                continue;
+            }
+
+            if (bLowVariance && ms_aInfo[EP.uMode].uPartitions > 0)
+            {
+                // Partitioning gains little when the block barely varies
+                continue;
+            }
+
+            if (!bHasAlpha && (EP.uMode == 4 || EP.uMode == 5))
+            {
+                // Separate alpha only wastes bits on opaque blocks, mode 6 covers them
+                continue;
+            }
+
+            if (bHasAlpha && EP.uMode < 4)
+            {
+                // Modes 0-3 have no alpha channel
+                continue;
+            }
+        }
+
         const size_t uShapes = size_t(1) << ms_aInfo[EP.uMode].uPartitionBits;
         assert(uShapes <= BC7_MAX_SHAPES);
         _Analysis_assume_(uShapes <= BC7_MAX_SHAPES);
 
-        const size_t uNumRots = size_t(1) << ms_aInfo[EP.uMode].uRotationBits;
-        const size_t uNumIdxMode = size_t(1) << ms_aInfo[EP.uMode].uIndexModeBits;
+        const size_t uNumRots = bFastTier ? 1 : size_t(1) << ms_aInfo[EP.uMode].uRotationBits;
+        const size_t uNumIdxMode = (quality == BC_FLAGS_BC7_ULTRAFAST) ? 1 : size_t(1) << ms_aInfo[EP.uMode].uIndexModeBits;
         // Number of rough cases to look at. reasonable values of this are 1, uShapes/4, and uShapes
         // uShapes/4 gets nearly all the cases; you can increase that a bit (say by 3 or 4) if you really want to squeeze the last bit out
-        const size_t uItems = std::max<size_t>(1, uShapes >> 2);
+        size_t uItems;
+        switch (quality)
+        {
+        case BC_FLAGS_BC7_ULTRAFAST:    uItems = 1; break;
+        case BC_FLAGS_BC7_FAST:         uItems = std::max<size_t>(1, uShapes >> 4); break;
+        case BC_FLAGS_BC7_SLOW:         uItems = uShapes; break;
+        default:                        uItems = std::max<size_t>(1, uShapes >> 2); break;
+        }
         float afRoughMSE[BC7_MAX_SHAPES];
         size_t auShape[BC7_MAX_SHAPES];
 
-        for (size_t r = 0; r < uNumRots && fMSEBest > 0; ++r)
+        for (size_t r = 0; r < uNumRots && fMSEBest > fMSEGoodEnough; ++r)
         {
             switch (r)
             {
@@ -2787,7 +2856,7 @@ void D3DX_BC7::Encode(uint32_t flags, const HDRColorA* const pIn) noexcept
             case 3: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(EP.aLDRPixels[i].b, EP.aLDRPixels[i].a); break;
             }
 
-            for (size_t im = 0; im < uNumIdxMode && fMSEBest > 0; ++im)
+            for (size_t im = 0; im < uNumIdxMode && fMSEBest > fMSEGoodEnough; ++im)
             {
                 // pick the best uItems shapes and refine these.
                 for (size_t s = 0; s < uShapes; s++)
@@ -2809,7 +2878,7 @@ void D3DX_BC7::Encode(uint32_t flags, const HDRColorA* const pIn) noexcept
                     }
                 }
 
-                for (size_t i = 0; i < uItems && fMSEBest > 0; i++)
+                for (size_t i = 0; i < uItems && fMSEBest > fMSEGoodEnough; i++)
                 {
                     const float fMSE = Refine(&EP, auShape[i], r, im);
                     if (fMSE < fMSEBest)
@@ -3037,6 +3106,9 @@ void D3DX_BC7::OptimizeOne(const EncodeParams* pEP, const LDRColorA aColors[], s
         }
     }
 
+    if (pEP->uQuality == BC_FLAGS_BC7_FAST)
+        return;
+
     // finally, do a small exhaustive search around what we think is the global minima to be sure
     for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ch++)
         Exhaustive(pEP, aColors, np, uIndexMode, ch, fOptErr, opt);
@@ -3350,6 +3422,17 @@ float D3DX_BC7::Refine(const EncodeParams* pEP, size_t uShape, size_t uRotation,
 
     AssignIndices(pEP, uShape, uIndexMode, newEndPts1, aOrgIdx, aOrgIdx2, aOrgErr);
 
+    float fOrgTotErr = 0, fOptTotErr = 0;
+    for (size_t p = 0; p <= uPartitions; p++)
+        fOrgTotErr += aOrgErr[p];
+
+    if (pEP->uQuality == BC_FLAGS_BC7_ULTRAFAST)
+    {
+        // Keep the quantized rough endpoints
+        EmitBlock(pEP, uShape, uRotation, uIndexMode, newEndPts1, aOrgIdx, aOrgIdx2);
+        return fOrgTotErr;
+    }
+
     OptimizeEndPoints(pEP, uShape, uIndexMode, aOrgErr, newEndPts1, aOptEndPts);
 
     LDREndPntPair newEndPts2[BC7_MAX_REGIONS];
@@ -3357,12 +3440,8 @@ float D3DX_BC7::Refine(const EncodeParams* pEP, size_t uShape, size_t uRotation,
 
     AssignIndices(pEP, uShape, uIndexMode, newEndPts2, aOptIdx, aOptIdx2, aOptErr);
 
-    float fOrgTotErr = 0, fOptTotErr = 0;
     for (size_t p = 0; p <= uPartitions; p++)
-    {
-        fOrgTotErr += aOrgErr[p];
         fOptTotErr += aOptErr[p];
-    }
     if (fOptTotErr < fOrgTotErr)
     {
         EmitBlock(pEP, uShape, uRotation, uIndexMode, newEndPts2, aOptIdx, aOptIdx2);
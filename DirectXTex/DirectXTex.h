@@ -14,6 +14,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -458,6 +459,109 @@ namespace DirectX
         _In_reads_(nimages) const Image* images, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DDS_FLAGS flags, _In_z_ const wchar_t* szFile) noexcept;
 
+    // Streaming DDS operations (images are visited in file order, same as ScratchImage::GetImages, in bands of rows
+    // so only one band needs to be in memory; file sizes are 64-bit)
+    class DDSStreamWriter
+    {
+    public:
+        DDSStreamWriter() noexcept;
+        DDSStreamWriter(DDSStreamWriter&& moveFrom) noexcept;
+        ~DDSStreamWriter();
+
+        DDSStreamWriter& __cdecl operator= (DDSStreamWriter&& moveFrom) noexcept;
+
+        DDSStreamWriter(const DDSStreamWriter&) = delete;
+        DDSStreamWriter& operator=(const DDSStreamWriter&) = delete;
+
+        HRESULT __cdecl Create(_In_z_ const wchar_t* szFile, _In_ const TexMetadata& metadata, _In_ DDS_FLAGS flags) noexcept;
+            // Creates the file and writes the header
+
+        HRESULT __cdecl WriteRows(_In_ const Image& rows) noexcept;
+            // Appends rows to the current image; rows.width must match the image, and for block-compressed formats
+            // rows.height must be a multiple of 4 unless it completes the image
+
+        HRESULT __cdecl Finish() noexcept;
+            // Closes the file; fails if any image is incomplete
+
+        void __cdecl Release() noexcept;
+            // Abandons the file (an unfinished file is deleted)
+
+        const TexMetadata& __cdecl GetMetadata() const noexcept;
+        size_t __cdecl GetCurrentImage() const noexcept;
+        size_t __cdecl GetCurrentRow() const noexcept;
+
+    private:
+        class Impl;
+        std::unique_ptr<Impl> pImpl;
+    };
+
+    class DDSStreamReader
+    {
+    public:
+        DDSStreamReader() noexcept;
+        DDSStreamReader(DDSStreamReader&& moveFrom) noexcept;
+        ~DDSStreamReader();
+
+        DDSStreamReader& __cdecl operator= (DDSStreamReader&& moveFrom) noexcept;
+
+        DDSStreamReader(const DDSStreamReader&) = delete;
+        DDSStreamReader& operator=(const DDSStreamReader&) = delete;
+
+        HRESULT __cdecl Open(_In_z_ const wchar_t* szFile, _In_ DDS_FLAGS flags, _Out_opt_ TexMetadata* metadata) noexcept;
+            // Legacy formats that need expansion or a palette are not supported
+
+        HRESULT __cdecl Seek(_In_ size_t mip, _In_ size_t item, _In_ size_t slice) noexcept;
+            // Moves to the first row of the given image
+
+        HRESULT __cdecl ReadRows(_In_ const Image& rows) noexcept;
+            // Reads rows.height rows of the current image into rows.pixels, then advances (same rules as WriteRows)
+
+        void __cdecl Release() noexcept;
+
+        const TexMetadata& __cdecl GetMetadata() const noexcept;
+        size_t __cdecl GetCurrentImage() const noexcept;
+        size_t __cdecl GetCurrentRow() const noexcept;
+
+    private:
+        class Impl;
+        std::unique_ptr<Impl> pImpl;
+    };
+
+    // Memory-mapped DDS loading
+    class MappedImage
+    {
+    public:
+        void __cdecl Release() noexcept { pImpl.reset(); }
+
+        const TexMetadata& __cdecl GetMetadata() const noexcept;
+        const Image* __cdecl GetImage(_In_ size_t mip, _In_ size_t item, _In_ size_t slice) const noexcept;
+
+        const Image* __cdecl GetImages() const noexcept;
+        size_t __cdecl GetImageCount() const noexcept;
+
+        const uint8_t* __cdecl GetPixels() const noexcept;
+        size_t __cdecl GetPixelsSize() const noexcept;
+
+        bool __cdecl IsMapped() const noexcept;
+            // False when the file needed conversion and was loaded into memory instead
+
+    private:
+        friend HRESULT __cdecl LoadFromDDSFileMapped(
+            _In_z_ const wchar_t* szFile, _In_ DDS_FLAGS flags,
+            _Out_opt_ TexMetadata* metadata, _Out_ MappedImage& image) noexcept;
+
+        class Impl;
+        std::shared_ptr<Impl> pImpl;
+    };
+
+    HRESULT __cdecl LoadFromDDSFileMapped(
+        _In_z_ const wchar_t* szFile,
+        _In_ DDS_FLAGS flags,
+        _Out_opt_ TexMetadata* metadata, _Out_ MappedImage& image) noexcept;
+        // Maps the file read-only and returns Image views into the mapping (pixels must not be written); copies
+        // of the MappedImage share the mapping, which is released with the last copy. Files needing legacy
+        // conversion fall back to a regular load
+
     // HDR operations
     HRESULT __cdecl LoadFromHDRMemory(
         _In_reads_bytes_(size) const void* pSource, _In_ size_t size,
@@ -602,6 +706,9 @@ namespace DirectX
 
         TEX_FILTER_FORCE_WIC = 0x20000000,
         // Forces use of the WIC path even when logic would have picked a non-WIC path when both are an option
+
+        TEX_FILTER_PARALLEL = 0x40000000,
+        // Resize and GenerateMipMaps may split rows across the shared thread pool (non-WIC filter paths only)
     };
 
     constexpr unsigned long TEX_FILTER_DITHER_MASK = 0xF0000;
@@ -703,12 +810,27 @@ namespace DirectX
         TEX_COMPRESS_BC7_QUICK = 0x100000,
         // Minimal modes (usually mode 6) for BC7 compression
 
+        TEX_COMPRESS_BATCH = 0x200000,
+        // Encodes BC1-3 four blocks at a time using SIMD; output is identical to the default encoder
+
+        TEX_COMPRESS_BATCH_FAST = 0x600000,
+        // Batched BC1-3 encoding with endpoint refinement capped at 2 iterations; faster, but output may differ slightly
+
         TEX_COMPRESS_SRGB_IN = 0x1000000,
         TEX_COMPRESS_SRGB_OUT = 0x2000000,
         TEX_COMPRESS_SRGB = (TEX_COMPRESS_SRGB_IN | TEX_COMPRESS_SRGB_OUT),
         // if the input format type is IsSRGB(), then SRGB_IN is on by default
         // if the output format type is IsSRGB(), then SRGB_OUT is on by default
 
+        TEX_COMPRESS_BC7_ULTRAFAST = 0x20000000,
+        // Fastest BC7 tier; classifies each block to prune modes and refines only the best partition candidate
+
+        TEX_COMPRESS_BC7_FAST = 0x40000000,
+        // Faster BC7 tier; prunes modes per block and refines a few partition candidates without rotations
+
+        TEX_COMPRESS_BC7_SLOW = 0x60000000,
+        // Highest quality BC7 tier; refines every partition of every mode (implies TEX_COMPRESS_BC7_USE_3SUBSETS)
+
         TEX_COMPRESS_PARALLEL = 0x10000000,
         // Compress is free to use multithreading to improve performance (by default it does not use multithreading)
     };
@@ -719,7 +841,11 @@ namespace DirectX
     HRESULT __cdecl Compress(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _In_ TEX_COMPRESS_FLAGS compress, _In_ float threshold, _Out_ ScratchImage& cImages) noexcept;
+    HRESULT __cdecl Compress(
+        _In_ const Image& srcRows, _In_ TEX_COMPRESS_FLAGS compress, _In_ float threshold,
+        _Inout_ DDSStreamWriter& writer) noexcept;
         // Note that threshold is only used by BC1. TEX_THRESHOLD_DEFAULT is a typical value to use
+        // The DDSStreamWriter overload compresses a band of rows to the writer's format and appends it to the current image
 
 #if defined(__d3d11_h__) || defined(__d3d11_x_h__)
     HRESULT __cdecl Compress(
@@ -735,6 +861,20 @@ namespace DirectX
     HRESULT __cdecl Decompress(
         _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _Out_ ScratchImage& images) noexcept;
+        // Decoding large images uses the shared thread pool
+
+    void __cdecl SetMaxThreadCount(_In_ size_t count) noexcept;
+    size_t __cdecl GetMaxThreadCount() noexcept;
+        // Caps the threads (including the caller) used by TEX_COMPRESS_PARALLEL, TEX_FILTER_PARALLEL, and Decompress
+        // 0 uses every hardware thread (the default); 1 disables multithreading
+
+    using ProfileBeginCallback = uint64_t(__cdecl*)(_In_z_ const char* name);
+    using ProfileEndCallback = void(__cdecl*)(_In_z_ const char* name, _In_ uint64_t token);
+
+    void __cdecl SetProfileCallbacks(_In_opt_ ProfileBeginCallback begin, _In_opt_ ProfileEndCallback end) noexcept;
+        // Reports Compress, Convert, Resize, GenerateMipMaps, and LoadFrom* to the host's profiler on the calling thread
+        // begin's return value is passed to end for the same call; nullptr (the default) turns the zones off
+        // Set these before other threads use the library
 
     //---------------------------------------------------------------------------------
     // Normal map operations
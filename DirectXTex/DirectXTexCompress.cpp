@@ -11,11 +11,6 @@
 
 #include "DirectXTexP.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#pragma warning(disable : 4616 6993)
-#endif
-
 #include "BC.h"
 
 using namespace DirectX;
@@ -23,6 +18,8 @@ using namespace DirectX::Internal;
 
 namespace
 {
+    constexpr size_t DECOMPRESS_PARALLEL_ROWS = 64;
+
     constexpr uint32_t GetBCFlags(_In_ TEX_COMPRESS_FLAGS compress) noexcept
     {
         static_assert(static_cast<int>(TEX_COMPRESS_RGB_DITHER) == static_cast<int>(BC_FLAGS_DITHER_RGB), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
@@ -31,7 +28,15 @@ namespace
         static_assert(static_cast<int>(TEX_COMPRESS_UNIFORM) == static_cast<int>(BC_FLAGS_UNIFORM), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
         static_assert(static_cast<int>(TEX_COMPRESS_BC7_USE_3SUBSETS) == static_cast<int>(BC_FLAGS_USE_3SUBSETS), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
         static_assert(static_cast<int>(TEX_COMPRESS_BC7_QUICK) == static_cast<int>(BC_FLAGS_FORCE_BC7_MODE6), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        return (compress & (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A | BC_FLAGS_UNIFORM | BC_FLAGS_USE_3SUBSETS | BC_FLAGS_FORCE_BC7_MODE6));
+        static_assert(static_cast<int>(TEX_COMPRESS_BATCH) == static_cast<int>(BC_FLAGS_BATCH), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        static_assert(static_cast<int>(TEX_COMPRESS_BATCH_FAST) == static_cast<int>(BC_FLAGS_BATCH | BC_FLAGS_BATCH_FAST), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        static_assert(static_cast<int>(TEX_COMPRESS_BC7_ULTRAFAST) == static_cast<int>(BC_FLAGS_BC7_ULTRAFAST), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        static_assert(static_cast<int>(TEX_COMPRESS_BC7_FAST) == static_cast<int>(BC_FLAGS_BC7_FAST), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        static_assert(static_cast<int>(TEX_COMPRESS_BC7_SLOW) == static_cast<int>(BC_FLAGS_BC7_SLOW), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        constexpr uint32_t bcMask = BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A | BC_FLAGS_UNIFORM | BC_FLAGS_USE_3SUBSETS | BC_FLAGS_FORCE_BC7_MODE6 | BC_FLAGS_BATCH | BC_FLAGS_BATCH_FAST | BC_FLAGS_BC7_QUALITY_MASK;
+        static_assert((bcMask & TEX_FILTER_SRGB_MASK) == 0, "BC_FLAGS_* must not overlap TEX_COMPRESS_SRGB*");
+        static_assert((bcMask & TEX_COMPRESS_PARALLEL) == 0, "BC_FLAGS_* must not overlap TEX_COMPRESS_PARALLEL");
+        return (compress & bcMask);
     }
 
     constexpr TEX_FILTER_FLAGS GetSRGBFlags(_In_ TEX_COMPRESS_FLAGS compress) noexcept
@@ -67,6 +72,23 @@ namespace
         return true;
     }
 
+    inline BC_ENCODE_BATCH DetermineBatchEncoder(_In_ DXGI_FORMAT format, _In_ uint32_t bcflags) noexcept
+    {
+        if (!(bcflags & BC_FLAGS_BATCH))
+            return nullptr;
+
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    return D3DXEncodeBC1Batch;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    return D3DXEncodeBC2Batch;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    return D3DXEncodeBC3Batch;
+        default:                            return nullptr;
+        }
+    }
+
 
     //-------------------------------------------------------------------------------------
     HRESULT CompressBC(
@@ -74,7 +96,8 @@ namespace
         const Image& result,
         uint32_t bcflags,
         TEX_FILTER_FLAGS srgb,
-        float threshold) noexcept
+        float threshold,
+        bool parallel) noexcept
     {
         if (!image.pixels || !result.pixels)
             return E_POINTER;
@@ -96,8 +119,6 @@ namespace
         // Round to bytes
         sbpp = (sbpp + 7) / 8;
 
-        uint8_t *pDest = result.pixels;
-
         // Determine BC format encoder
         BC_ENCODE pfEncode;
         size_t blocksize;
@@ -105,229 +126,122 @@ namespace
         if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
             return HRESULT_E_NOT_SUPPORTED;
 
-        XM_ALIGNED_DATA(16) XMVECTOR temp[16];
-        const uint8_t *pSrc = image.pixels;
+        // Batched encoders take BC_BATCH_SIZE consecutive blocks of a row at a time
+        const BC_ENCODE_BATCH pfEncodeBatch = DetermineBatchEncoder(result.format, bcflags);
+
         const uint8_t *pEnd = image.pixels + image.slicePitch;
         const size_t rowPitch = image.rowPitch;
-        for (size_t h = 0; h < image.height; h += 4)
+
+        // Each work item is one row of blocks
+        auto compressRows = [&](size_t rowBegin, size_t rowEnd) noexcept -> HRESULT
         {
-            const uint8_t *sptr = pSrc;
-            uint8_t* dptr = pDest;
-            const size_t ph = std::min<size_t>(4, image.height - h);
-            size_t w = 0;
-            for (size_t count = 0; (count < result.rowPitch) && (w < image.width); count += blocksize, w += 4)
+            XM_ALIGNED_DATA(16) XMVECTOR batch[NUM_PIXELS_PER_BLOCK * BC_BATCH_SIZE];
+            const uint8_t *pSrc = image.pixels + rowPitch * 4 * rowBegin;
+            uint8_t *pDest = result.pixels + result.rowPitch * rowBegin;
+            for (size_t h = rowBegin * 4; h < rowEnd * 4; h += 4)
             {
-                const size_t pw = std::min<size_t>(4, image.width - w);
-                assert(pw > 0 && ph > 0);
+                const uint8_t *sptr = pSrc;
+                uint8_t* dptr = pDest;
+                uint8_t* bptr = pDest;
+                size_t nBatch = 0;
+                const size_t ph = std::min<size_t>(4, image.height - h);
+                size_t w = 0;
+                for (size_t count = 0; (count < result.rowPitch) && (w < image.width); count += blocksize, w += 4)
+                {
+                    const size_t pw = std::min<size_t>(4, image.width - w);
+                    assert(pw > 0 && ph > 0);
 
-                const ptrdiff_t bytesLeft = pEnd - sptr;
-                assert(bytesLeft > 0);
-                size_t bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft));
-                if (!LoadScanline(&temp[0], pw, sptr, bytesToRead, format))
-                    return E_FAIL;
+                    XMVECTOR *temp = (pfEncodeBatch) ? &batch[nBatch * NUM_PIXELS_PER_BLOCK] : batch;
 
-                if (ph > 1)
-                {
-                    bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft) - rowPitch);
-                    if (!LoadScanline(&temp[4], pw, sptr + rowPitch, bytesToRead, format))
+                    const ptrdiff_t bytesLeft = pEnd - sptr;
+                    assert(bytesLeft > 0);
+                    size_t bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft));
+                    if (!LoadScanline(&temp[0], pw, sptr, bytesToRead, format))
                         return E_FAIL;
 
-                    if (ph > 2)
+                    if (ph > 1)
                     {
-                        bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft) - rowPitch * 2);
-                        if (!LoadScanline(&temp[8], pw, sptr + rowPitch * 2, bytesToRead, format))
+                        bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft) - rowPitch);
+                        if (!LoadScanline(&temp[4], pw, sptr + rowPitch, bytesToRead, format))
                             return E_FAIL;
 
-                        if (ph > 3)
+                        if (ph > 2)
                         {
-                            bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft) - rowPitch * 3);
-                            if (!LoadScanline(&temp[12], pw, sptr + rowPitch * 3, bytesToRead, format))
+                            bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft) - rowPitch * 2);
+                            if (!LoadScanline(&temp[8], pw, sptr + rowPitch * 2, bytesToRead, format))
                                 return E_FAIL;
+
+                            if (ph > 3)
+                            {
+                                bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft) - rowPitch * 3);
+                                if (!LoadScanline(&temp[12], pw, sptr + rowPitch * 3, bytesToRead, format))
+                                    return E_FAIL;
+                            }
                         }
                     }
-                }
 
-                if (pw != 4 || ph != 4)
-                {
-                    // Replicate pixels for partial block
-                    static const size_t uSrc[] = { 0, 0, 0, 1 };
-
-                    if (pw < 4)
+                    if (pw != 4 || ph != 4)
                     {
-                        for (size_t t = 0; t < ph && t < 4; ++t)
+                        // Replicate pixels for partial block
+                        static const size_t uSrc[] = { 0, 0, 0, 1 };
+
+                        if (pw < 4)
                         {
-                            for (size_t s = pw; s < 4; ++s)
+                            for (size_t t = 0; t < ph && t < 4; ++t)
                             {
-                            #pragma prefast(suppress: 26000, "PREFAST false positive")
-                                temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
+                                for (size_t s = pw; s < 4; ++s)
+                                {
+                                #pragma prefast(suppress: 26000, "PREFAST false positive")
+                                    temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
+                                }
                             }
                         }
-                    }
 
-                    if (ph < 4)
-                    {
-                        for (size_t t = ph; t < 4; ++t)
+                        if (ph < 4)
                         {
-                            for (size_t s = 0; s < 4; ++s)
+                            for (size_t t = ph; t < 4; ++t)
                             {
-                            #pragma prefast(suppress: 26000, "PREFAST false positive")
-                                temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
+                                for (size_t s = 0; s < 4; ++s)
+                                {
+                                #pragma prefast(suppress: 26000, "PREFAST false positive")
+                                    temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
+                                }
                             }
                         }
                     }
-                }
-
-                ConvertScanline(temp, 16, result.format, format, cflags | srgb);
-
-                if (pfEncode)
-                    pfEncode(dptr, temp, bcflags);
-                else
-                    D3DXEncodeBC1(dptr, temp, threshold, bcflags);
-
-                sptr += sbpp * 4;
-                dptr += blocksize;
-            }
-
-            pSrc += rowPitch * 4;
-            pDest += result.rowPitch;
-        }
-
-        return S_OK;
-    }
-
-
-    //-------------------------------------------------------------------------------------
-#ifdef _OPENMP
-    HRESULT CompressBC_Parallel(
-        const Image& image,
-        const Image& result,
-        uint32_t bcflags,
-        TEX_FILTER_FLAGS srgb,
-        float threshold) noexcept
-    {
-        if (!image.pixels || !result.pixels)
-            return E_POINTER;
 
-        assert(image.width == result.width);
-        assert(image.height == result.height);
-
-        const DXGI_FORMAT format = image.format;
-        size_t sbpp = BitsPerPixel(format);
-        if (!sbpp)
-            return E_FAIL;
-
-        if (sbpp < 8)
-        {
-            // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
-            return HRESULT_E_NOT_SUPPORTED;
-        }
-
-        // Round to bytes
-        sbpp = (sbpp + 7) / 8;
-
-        const uint8_t *pEnd = image.pixels + image.slicePitch;
-
-        // Determine BC format encoder
-        BC_ENCODE pfEncode;
-        size_t blocksize;
-        TEX_FILTER_FLAGS cflags;
-        if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
-            return HRESULT_E_NOT_SUPPORTED;
-
-        // Refactored version of loop to support parallel independance
-        const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
-
-        bool fail = false;
-
-    #pragma omp parallel for
-        for (int nb = 0; nb < static_cast<int>(nBlocks); ++nb)
-        {
-            const int nbWidth = std::max<int>(1, int((image.width + 3) / 4));
+                    ConvertScanline(temp, 16, result.format, format, cflags | srgb);
 
-            int y = nb / nbWidth;
-            const int x = (nb - (y*nbWidth)) * 4;
-            y *= 4;
-
-            assert((x >= 0) && (x < int(image.width)));
-            assert((y >= 0) && (y < int(image.height)));
-
-            const size_t rowPitch = image.rowPitch;
-            const uint8_t *pSrc = image.pixels + (size_t(y)*rowPitch) + (size_t(x)*sbpp);
-
-            uint8_t *pDest = result.pixels + (size_t(nb)*blocksize);
-
-            const size_t ph = std::min<size_t>(4, image.height - size_t(y));
-            const size_t pw = std::min<size_t>(4, image.width - size_t(x));
-            assert(pw > 0 && ph > 0);
-
-            const ptrdiff_t bytesLeft = pEnd - pSrc;
-            assert(bytesLeft > 0);
-            size_t bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft));
-
-            XM_ALIGNED_DATA(16) XMVECTOR temp[16];
-            if (!LoadScanline(&temp[0], pw, pSrc, bytesToRead, format))
-                fail = true;
-
-            if (ph > 1)
-            {
-                bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch);
-                if (!LoadScanline(&temp[4], pw, pSrc + rowPitch, bytesToRead, format))
-                    fail = true;
-
-                if (ph > 2)
-                {
-                    bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch * 2);
-                    if (!LoadScanline(&temp[8], pw, pSrc + rowPitch * 2, bytesToRead, format))
-                        fail = true;
-
-                    if (ph > 3)
+                    if (pfEncodeBatch)
                     {
-                        bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch * 3);
-                        if (!LoadScanline(&temp[12], pw, pSrc + rowPitch * 3, bytesToRead, format))
-                            fail = true;
-                    }
-                }
-            }
-
-            if (pw != 4 || ph != 4)
-            {
-                // Replicate pixels for partial block
-                static const size_t uSrc[] = { 0, 0, 0, 1 };
-
-                if (pw < 4)
-                {
-                    for (size_t t = 0; t < ph && t < 4; ++t)
-                    {
-                        for (size_t s = pw; s < 4; ++s)
+                        if (++nBatch == BC_BATCH_SIZE)
                         {
-                            temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
+                            pfEncodeBatch(bptr, batch, nBatch, threshold, bcflags);
+                            bptr += blocksize * nBatch;
+                            nBatch = 0;
                         }
                     }
-                }
+                    else if (pfEncode)
+                        pfEncode(dptr, temp, bcflags);
+                    else
+                        D3DXEncodeBC1(dptr, temp, threshold, bcflags);
 
-                if (ph < 4)
-                {
-                    for (size_t t = ph; t < 4; ++t)
-                    {
-                        for (size_t s = 0; s < 4; ++s)
-                        {
-                            temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
-                        }
-                    }
+                    sptr += sbpp * 4;
+                    dptr += blocksize;
                 }
-            }
 
-            ConvertScanline(temp, 16, result.format, format, cflags | srgb);
+                if (nBatch > 0)
+                    pfEncodeBatch(bptr, batch, nBatch, threshold, bcflags);
 
-            if (pfEncode)
-                pfEncode(pDest, temp, bcflags);
-            else
-                D3DXEncodeBC1(pDest, temp, threshold, bcflags);
-        }
+                pSrc += rowPitch * 4;
+                pDest += result.rowPitch;
+            }
 
-        return (fail) ? E_FAIL : S_OK;
+            return S_OK;
+        };
+
+        return ParallelFor((image.height + 3) / 4, 1, parallel, compressRows);
     }
-#endif // _OPENMP
 
 
     //-------------------------------------------------------------------------------------
@@ -401,10 +315,6 @@ namespace
         // Round to bytes
         dbpp = (dbpp + 7) / 8;
 
-        uint8_t *pDest = result.pixels;
-        if (!pDest)
-            return E_POINTER;
-
         // Promote "typeless" BC formats
         DXGI_FORMAT cformat;
         switch (cImage.format)
@@ -442,53 +352,63 @@ namespace
             return HRESULT_E_NOT_SUPPORTED;
         }
 
-        XM_ALIGNED_DATA(16) XMVECTOR temp[16];
-        const uint8_t *pSrc = cImage.pixels;
         const size_t rowPitch = result.rowPitch;
-        for (size_t h = 0; h < cImage.height; h += 4)
+
+        // Each work item is one row of blocks
+        auto decompressRows = [&](size_t rowBegin, size_t rowEnd) noexcept -> HRESULT
         {
-            const uint8_t *sptr = pSrc;
-            uint8_t* dptr = pDest;
-            const size_t ph = std::min<size_t>(4, cImage.height - h);
-            size_t w = 0;
-            for (size_t count = 0; (count < cImage.rowPitch) && (w < cImage.width); count += sbpp, w += 4)
+            XM_ALIGNED_DATA(16) XMVECTOR temp[16];
+            const uint8_t *pSrc = cImage.pixels + cImage.rowPitch * rowBegin;
+            uint8_t *pDest = result.pixels + rowPitch * 4 * rowBegin;
+            for (size_t h = rowBegin * 4; h < rowEnd * 4; h += 4)
             {
-                pfDecode(temp, sptr);
-                ConvertScanline(temp, 16, format, cformat, TEX_FILTER_DEFAULT);
-
-                const size_t pw = std::min<size_t>(4, cImage.width - w);
-                assert(pw > 0 && ph > 0);
+                const uint8_t *sptr = pSrc;
+                uint8_t* dptr = pDest;
+                const size_t ph = std::min<size_t>(4, cImage.height - h);
+                size_t w = 0;
+                for (size_t count = 0; (count < cImage.rowPitch) && (w < cImage.width); count += sbpp, w += 4)
+                {
+                    pfDecode(temp, sptr);
+                    ConvertScanline(temp, 16, format, cformat, TEX_FILTER_DEFAULT);
 
-                if (!StoreScanline(dptr, rowPitch, format, &temp[0], pw))
-                    return E_FAIL;
+                    const size_t pw = std::min<size_t>(4, cImage.width - w);
+                    assert(pw > 0 && ph > 0);
 
-                if (ph > 1)
-                {
-                    if (!StoreScanline(dptr + rowPitch, rowPitch, format, &temp[4], pw))
+                    if (!StoreScanline(dptr, rowPitch, format, &temp[0], pw))
                         return E_FAIL;
 
-                    if (ph > 2)
+                    if (ph > 1)
                     {
-                        if (!StoreScanline(dptr + rowPitch * 2, rowPitch, format, &temp[8], pw))
+                        if (!StoreScanline(dptr + rowPitch, rowPitch, format, &temp[4], pw))
                             return E_FAIL;
 
-                        if (ph > 3)
+                        if (ph > 2)
                         {
-                            if (!StoreScanline(dptr + rowPitch * 3, rowPitch, format, &temp[12], pw))
+                            if (!StoreScanline(dptr + rowPitch * 2, rowPitch, format, &temp[8], pw))
                                 return E_FAIL;
+
+                            if (ph > 3)
+                            {
+                                if (!StoreScanline(dptr + rowPitch * 3, rowPitch, format, &temp[12], pw))
+                                    return E_FAIL;
+                            }
                         }
                     }
+
+                    sptr += sbpp;
+                    dptr += dbpp * 4;
                 }
 
-                sptr += sbpp;
-                dptr += dbpp * 4;
+                pSrc += cImage.rowPitch;
+                pDest += rowPitch * 4;
             }
 
-            pSrc += cImage.rowPitch;
-            pDest += rowPitch * 4;
-        }
+            return S_OK;
+        };
 
-        return S_OK;
+        // Decoding is cheap, so only hand images with enough rows of blocks to the pool
+        const size_t nrows = (cImage.height + 3) / 4;
+        return ParallelFor(nrows, 1, (nrows >= DECOMPRESS_PARALLEL_ROWS), decompressRows);
     }
 }
 
@@ -593,6 +513,7 @@ HRESULT DirectX::Compress(
     float threshold,
     ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::Compress");
     if (IsCompressed(srcImage.format) || !IsCompressed(format))
         return E_INVALIDARG;
 
@@ -613,18 +534,7 @@ HRESULT DirectX::Compress(
     }
 
     // Compress single image
-    if (compress & TEX_COMPRESS_PARALLEL)
-    {
-    #ifndef _OPENMP
-        return E_NOTIMPL;
-    #else
-        hr = CompressBC_Parallel(srcImage, *img, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
-    #endif // _OPENMP
-    }
-    else
-    {
-        hr = CompressBC(srcImage, *img, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
-    }
+    hr = CompressBC(srcImage, *img, GetBCFlags(compress), GetSRGBFlags(compress), threshold, (compress & TEX_COMPRESS_PARALLEL) != 0);
 
     if (FAILED(hr))
         image.Release();
@@ -642,6 +552,7 @@ HRESULT DirectX::Compress(
     float threshold,
     ScratchImage& cImages) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::Compress");
     if (!srcImages || !nimages)
         return E_INVALIDARG;
 
@@ -685,36 +596,38 @@ HRESULT DirectX::Compress(
             return E_FAIL;
         }
 
-        if ((compress & TEX_COMPRESS_PARALLEL))
-        {
-        #ifndef _OPENMP
-            return E_NOTIMPL;
-        #else
-            if (compress & TEX_COMPRESS_PARALLEL)
-            {
-                hr = CompressBC_Parallel(src, dest[index], GetBCFlags(compress), GetSRGBFlags(compress), threshold);
-                if (FAILED(hr))
-                {
-                    cImages.Release();
-                    return  hr;
-                }
-            }
-        #endif // _OPENMP
-        }
-        else
+        hr = CompressBC(src, dest[index], GetBCFlags(compress), GetSRGBFlags(compress), threshold, (compress & TEX_COMPRESS_PARALLEL) != 0);
+        if (FAILED(hr))
         {
-            hr = CompressBC(src, dest[index], GetBCFlags(compress), GetSRGBFlags(compress), threshold);
-            if (FAILED(hr))
-            {
-                cImages.Release();
-                return hr;
-            }
+            cImages.Release();
+            return hr;
         }
     }
 
     return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT DirectX::Compress(
+    const Image& srcRows,
+    TEX_COMPRESS_FLAGS compress,
+    float threshold,
+    DDSStreamWriter& writer) noexcept
+{
+    DIRECTXTEX_ZONE("DirectX::Compress");
+    // Only the band is staged; it goes straight to the file
+    ScratchImage band;
+    HRESULT hr = Compress(srcRows, writer.GetMetadata().format, compress, threshold, band);
+    if (FAILED(hr))
+        return hr;
+
+    const Image* img = band.GetImage(0, 0, 0);
+    if (!img)
+        return E_POINTER;
+
+    return writer.WriteRows(*img);
+}
+
 
 //-------------------------------------------------------------------------------------
 // Decompression
@@ -4862,6 +4862,7 @@ HRESULT DirectX::Convert(
     float threshold,
     ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::Convert");
     if ((srcImage.format == format) || !IsValid(format))
         return E_INVALIDARG;
 
@@ -4921,6 +4922,7 @@ HRESULT DirectX::Convert(
     float threshold,
     ScratchImage& result) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::Convert");
     if (!srcImages || !nimages || (metadata.format == format) || !IsValid(format))
         return E_INVALIDARG;
 
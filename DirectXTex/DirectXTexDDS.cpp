@@ -13,6 +13,13 @@
 
 #include "DDS.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace DirectX;
 using namespace DirectX::Internal;
 
@@ -804,17 +811,19 @@ HRESULT DirectX::EncodeDDSHeader(
     if (FAILED(hr))
         return hr;
 
-    if (slicePitch > UINT32_MAX
-        || rowPitch > UINT32_MAX)
-        return E_FAIL;
-
     if (IsCompressed(metadata.format))
     {
+        if (slicePitch > UINT32_MAX)
+            return E_FAIL;
+
         header->flags |= DDS_HEADER_FLAGS_LINEARSIZE;
         header->pitchOrLinearSize = static_cast<uint32_t>(slicePitch);
     }
     else
     {
+        if (rowPitch > UINT32_MAX)
+            return E_FAIL;
+
         header->flags |= DDS_HEADER_FLAGS_PITCH;
         header->pitchOrLinearSize = static_cast<uint32_t>(rowPitch);
     }
@@ -1549,6 +1558,61 @@ namespace
 
         return S_OK;
     }
+
+#ifdef _WIN32
+    //-------------------------------------------------------------------------------------
+    // ReadFile/WriteFile move at most 4 GB per call
+    //-------------------------------------------------------------------------------------
+    HRESULT ReadFileFully(_In_ HANDLE hFile, _Out_writes_bytes_(size) void* pData, size_t size) noexcept
+    {
+        auto ptr = static_cast<uint8_t*>(pData);
+        while (size > 0)
+        {
+            const auto chunk = static_cast<DWORD>(std::min<size_t>(size, UINT32_MAX));
+
+            DWORD bytesRead = 0;
+            if (!ReadFile(hFile, ptr, chunk, &bytesRead, nullptr))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            if (bytesRead != chunk)
+            {
+                return E_FAIL;
+            }
+
+            ptr += chunk;
+            size -= chunk;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT WriteFileFully(_In_ HANDLE hFile, _In_reads_bytes_(size) const void* pData, size_t size) noexcept
+    {
+        auto ptr = static_cast<const uint8_t*>(pData);
+        while (size > 0)
+        {
+            const auto chunk = static_cast<DWORD>(std::min<size_t>(size, UINT32_MAX));
+
+            DWORD bytesWritten = 0;
+            if (!WriteFile(hFile, ptr, chunk, &bytesWritten, nullptr))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            if (bytesWritten != chunk)
+            {
+                return E_FAIL;
+            }
+
+            ptr += chunk;
+            size -= chunk;
+        }
+
+        return S_OK;
+    }
+#endif
 }
 
 
@@ -1602,13 +1666,8 @@ HRESULT DirectX::GetMetadataFromDDSFile(
         return HRESULT_FROM_WIN32(GetLastError());
     }
 
-    // File is too big for 32-bit allocation, so reject read (4 GB should be plenty large enough for a valid DDS file)
-    if (fileInfo.EndOfFile.HighPart > 0)
-    {
-        return HRESULT_E_FILE_TOO_LARGE;
-    }
-
-    const size_t len = fileInfo.EndOfFile.LowPart;
+    // Only the header is read, so the file may be any size
+    const auto len = static_cast<uint64_t>(fileInfo.EndOfFile.QuadPart);
 #else // !WIN32
     std::ifstream inFile(std::filesystem::path(szFile), std::ios::in | std::ios::binary | std::ios::ate);
     if (!inFile)
@@ -1618,14 +1677,11 @@ HRESULT DirectX::GetMetadataFromDDSFile(
     if (!inFile)
         return E_FAIL;
 
-    if (fileLen > UINT32_MAX)
-        return HRESULT_E_FILE_TOO_LARGE;
-
     inFile.seekg(0, std::ios::beg);
     if (!inFile)
         return E_FAIL;
 
-    const size_t len = fileLen;
+    const auto len = static_cast<uint64_t>(static_cast<std::streamoff>(fileLen));
 #endif
 
     // Need at least enough data to fill the standard header and magic number to be a valid DDS
@@ -1646,9 +1702,9 @@ HRESULT DirectX::GetMetadataFromDDSFile(
 
     auto const headerLen = static_cast<size_t>(bytesRead);
 #else
-    auto const headerLen = std::min<size_t>(len, MAX_HEADER_SIZE);
+    auto const headerLen = static_cast<size_t>(std::min<uint64_t>(len, MAX_HEADER_SIZE));
 
-    inFile.read(reinterpret_cast<char*>(header), headerLen);
+    inFile.read(reinterpret_cast<char*>(header), static_cast<std::streamsize>(headerLen));
     if (!inFile)
         return E_FAIL;
 #endif
@@ -1669,6 +1725,7 @@ HRESULT DirectX::LoadFromDDSMemory(
     TexMetadata* metadata,
     ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::LoadFromDDSMemory");
     if (!pSource || size == 0)
         return E_INVALIDARG;
 
@@ -1741,6 +1798,7 @@ HRESULT DirectX::LoadFromDDSFile(
     TexMetadata* metadata,
     ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::LoadFromDDSFile");
     if (!szFile)
         return E_INVALIDARG;
 
@@ -1765,11 +1823,15 @@ HRESULT DirectX::LoadFromDDSFile(
         return HRESULT_FROM_WIN32(GetLastError());
     }
 
-    // File is too big for 32-bit allocation, so reject read (4 GB should be plenty large enough for a valid DDS file)
+    // File is too big for the address space, so reject read (DDSStreamReader can still read it in bands)
+#if defined(_M_IX86) || defined(_M_ARM) || defined(_M_HYBRID_X86_ARM64)
     if (fileInfo.EndOfFile.HighPart > 0)
         return HRESULT_E_FILE_TOO_LARGE;
 
     const size_t len = fileInfo.EndOfFile.LowPart;
+#else
+    const auto len = static_cast<size_t>(fileInfo.EndOfFile.QuadPart);
+#endif
 #else // !WIN32
     std::ifstream inFile(std::filesystem::path(szFile), std::ios::in | std::ios::binary | std::ios::ate);
     if (!inFile)
@@ -1779,7 +1841,7 @@ HRESULT DirectX::LoadFromDDSFile(
     if (!inFile)
         return E_FAIL;
 
-    if (fileLen > UINT32_MAX)
+    if (static_cast<uint64_t>(static_cast<std::streamoff>(fileLen)) > SIZE_MAX)
         return HRESULT_E_FILE_TOO_LARGE;
 
     inFile.seekg(0, std::ios::beg);
@@ -1886,19 +1948,14 @@ HRESULT DirectX::LoadFromDDSFile(
         }
 
     #ifdef _WIN32
-        if (!ReadFile(hFile.get(), temp.get(), static_cast<DWORD>(remaining), &bytesRead, nullptr))
-        {
-            image.Release();
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
-
-        if (bytesRead != remaining)
+        hr = ReadFileFully(hFile.get(), temp.get(), remaining);
+        if (FAILED(hr))
         {
             image.Release();
-            return E_FAIL;
+            return hr;
         }
     #else
-        inFile.read(reinterpret_cast<char*>(temp.get()), remaining);
+        inFile.read(reinterpret_cast<char*>(temp.get()), static_cast<std::streamsize>(remaining));
         if (!inFile)
         {
             image.Release();
@@ -1937,27 +1994,15 @@ HRESULT DirectX::LoadFromDDSFile(
             return HRESULT_E_HANDLE_EOF;
         }
 
-        if (image.GetPixelsSize() > UINT32_MAX)
-        {
-            image.Release();
-            return HRESULT_E_ARITHMETIC_OVERFLOW;
-        }
-
     #ifdef _WIN32
-        auto pixelBytes = static_cast<DWORD>(image.GetPixelsSize());
-        if (!ReadFile(hFile.get(), image.GetPixels(), pixelBytes, &bytesRead, nullptr))
-        {
-            image.Release();
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
-
-        if (bytesRead != pixelBytes)
+        hr = ReadFileFully(hFile.get(), image.GetPixels(), image.GetPixelsSize());
+        if (FAILED(hr))
         {
             image.Release();
-            return E_FAIL;
+            return hr;
         }
     #else
-        inFile.read(reinterpret_cast<char*>(image.GetPixels()), image.GetPixelsSize());
+        inFile.read(reinterpret_cast<char*>(image.GetPixels()), static_cast<std::streamsize>(image.GetPixelsSize()));
         if (!inFile)
         {
             image.Release();
@@ -2446,3 +2491,997 @@ HRESULT DirectX::SaveToDDSFile(
 
     return S_OK;
 }
+
+
+//=====================================================================================
+// Streaming DDS reader/writer
+//=====================================================================================
+
+namespace
+{
+    //-------------------------------------------------------------------------------------
+    // File location of one image, in the same order as ScratchImage::GetImages
+    //-------------------------------------------------------------------------------------
+    struct StreamImage
+    {
+        size_t      width;
+        size_t      height;
+        size_t      rowPitch;
+        uint64_t    offset;
+    };
+
+    HRESULT SetupStreamImages(
+        const TexMetadata& metadata,
+        uint64_t offset,
+        std::unique_ptr<StreamImage[]>& images,
+        size_t& nimages) noexcept
+    {
+        images.reset();
+        nimages = 0;
+
+        if (!metadata.width || !metadata.height || !metadata.depth || !metadata.arraySize || !metadata.mipLevels)
+            return E_INVALIDARG;
+
+        if (IsPlanar(metadata.format) || IsPalettized(metadata.format))
+            return HRESULT_E_NOT_SUPPORTED;
+
+        size_t count = 0;
+        switch (metadata.dimension)
+        {
+        case TEX_DIMENSION_TEXTURE1D:
+        case TEX_DIMENSION_TEXTURE2D:
+            if (metadata.depth != 1)
+                return E_INVALIDARG;
+
+            if (metadata.arraySize > SIZE_MAX / metadata.mipLevels)
+                return HRESULT_E_ARITHMETIC_OVERFLOW;
+
+            count = metadata.arraySize * metadata.mipLevels;
+            break;
+
+        case TEX_DIMENSION_TEXTURE3D:
+            {
+                if (metadata.arraySize != 1)
+                    return E_INVALIDARG;
+
+                size_t d = metadata.depth;
+                for (size_t level = 0; level < metadata.mipLevels; ++level)
+                {
+                    count += d;
+
+                    if (d > 1)
+                        d >>= 1;
+                }
+            }
+            break;
+
+        default:
+            return E_INVALIDARG;
+        }
+
+        images.reset(new (std::nothrow) StreamImage[count]);
+        if (!images)
+            return E_OUTOFMEMORY;
+
+        // 1D/2D files store each item's mip chain in turn; volume files store every slice of a level together
+        size_t index = 0;
+        for (size_t item = 0; item < metadata.arraySize; ++item)
+        {
+            size_t w = metadata.width;
+            size_t h = metadata.height;
+            size_t d = metadata.depth;
+
+            for (size_t level = 0; level < metadata.mipLevels; ++level)
+            {
+                size_t rowPitch, slicePitch;
+                const HRESULT hr = ComputePitch(metadata.format, w, h, rowPitch, slicePitch, CP_FLAGS_NONE);
+                if (FAILED(hr))
+                {
+                    images.reset();
+                    return hr;
+                }
+
+                for (size_t slice = 0; slice < d; ++slice)
+                {
+                    assert(index < count);
+                    images[index].width = w;
+                    images[index].height = h;
+                    images[index].rowPitch = rowPitch;
+                    images[index].offset = offset;
+                    ++index;
+
+                    offset += slicePitch;
+                }
+
+                if (h > 1)
+                    h >>= 1;
+
+                if (w > 1)
+                    w >>= 1;
+
+                if (d > 1)
+                    d >>= 1;
+            }
+        }
+
+        assert(index == count);
+        nimages = count;
+        return S_OK;
+    }
+
+    size_t FindStreamImage(const TexMetadata& metadata, size_t mip, size_t item, size_t slice) noexcept
+    {
+        if (mip >= metadata.mipLevels)
+            return SIZE_MAX;
+
+        switch (metadata.dimension)
+        {
+        case TEX_DIMENSION_TEXTURE1D:
+        case TEX_DIMENSION_TEXTURE2D:
+            if (slice > 0 || item >= metadata.arraySize)
+                return SIZE_MAX;
+
+            return item * metadata.mipLevels + mip;
+
+        case TEX_DIMENSION_TEXTURE3D:
+            {
+                if (item > 0)
+                    return SIZE_MAX;
+
+                size_t index = 0;
+                size_t d = metadata.depth;
+                for (size_t level = 0; level < mip; ++level)
+                {
+                    index += d;
+
+                    if (d > 1)
+                        d >>= 1;
+                }
+
+                if (slice >= d)
+                    return SIZE_MAX;
+
+                return index + slice;
+            }
+
+        default:
+            return SIZE_MAX;
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Checks a band of rows against the image being streamed and returns its scanline count
+    //-------------------------------------------------------------------------------------
+    HRESULT ValidateStreamRows(
+        const Image& rows,
+        DXGI_FORMAT format,
+        const StreamImage& image,
+        size_t row,
+        size_t& scanlines) noexcept
+    {
+        if (!rows.pixels)
+            return E_POINTER;
+
+        if (rows.format != format || rows.width != image.width || !rows.height || rows.height > (image.height - row))
+            return E_INVALIDARG;
+
+        // Block-compressed bands must stay on block boundaries
+        if (IsCompressed(format) && (rows.height % 4) != 0 && (row + rows.height) != image.height)
+            return E_INVALIDARG;
+
+        if (rows.rowPitch < image.rowPitch)
+            return E_INVALIDARG;
+
+        scanlines = ComputeScanlines(format, rows.height);
+        return S_OK;
+    }
+
+    const TexMetadata g_emptyMetadata = {};
+}
+
+
+//-------------------------------------------------------------------------------------
+// DDSStreamWriter
+//-------------------------------------------------------------------------------------
+class DDSStreamWriter::Impl
+{
+public:
+#ifdef _WIN32
+    Impl(ScopedHandle&& hFile) noexcept :
+        m_metadata{},
+        m_nimages(0),
+        m_current(0),
+        m_row(0),
+        m_hFile(std::move(hFile)),
+        m_delonfail(m_hFile.get())
+    {
+    }
+#else
+    Impl(const wchar_t* szFile) :
+        m_metadata{},
+        m_nimages(0),
+        m_current(0),
+        m_row(0),
+        m_path(szFile),
+        m_finished(false)
+    {
+        m_outFile.open(m_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+
+    ~Impl()
+    {
+        if (!m_finished)
+        {
+            m_outFile.close();
+
+            std::error_code ec;
+            std::filesystem::remove(m_path, ec);
+        }
+    }
+
+    bool IsOpen() const noexcept { return m_outFile.is_open() && !m_outFile.fail(); }
+#endif
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    HRESULT Write(_In_reads_bytes_(size) const void* pData, size_t size) noexcept
+    {
+    #ifdef _WIN32
+        return WriteFileFully(m_hFile.get(), pData, size);
+    #else
+        m_outFile.write(static_cast<const char*>(pData), static_cast<std::streamsize>(size));
+        return m_outFile ? S_OK : E_FAIL;
+    #endif
+    }
+
+    HRESULT WriteRows(const Image& rows) noexcept
+    {
+        if (m_current >= m_nimages)
+            return E_UNEXPECTED;
+
+        const StreamImage& image = m_images[m_current];
+
+        size_t scanlines;
+        HRESULT hr = ValidateStreamRows(rows, m_metadata.format, image, m_row, scanlines);
+        if (FAILED(hr))
+            return hr;
+
+        if (rows.rowPitch == image.rowPitch)
+        {
+            hr = Write(rows.pixels, image.rowPitch * scanlines);
+        }
+        else
+        {
+            const uint8_t* sPtr = rows.pixels;
+            for (size_t j = 0; j < scanlines && SUCCEEDED(hr); ++j)
+            {
+                hr = Write(sPtr, image.rowPitch);
+                sPtr += rows.rowPitch;
+            }
+        }
+
+        if (FAILED(hr))
+        {
+            // The file no longer matches the header, so refuse any further writes
+            m_nimages = 0;
+            return hr;
+        }
+
+        m_row += rows.height;
+        if (m_row >= image.height)
+        {
+            ++m_current;
+            m_row = 0;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT Finish() noexcept
+    {
+        if (!m_nimages || m_current < m_nimages)
+            return E_FAIL;
+
+    #ifdef _WIN32
+        m_delonfail.clear();
+    #else
+        m_outFile.close();
+        if (m_outFile.fail())
+            return E_FAIL;
+
+        m_finished = true;
+    #endif
+
+        return S_OK;
+    }
+
+    TexMetadata                     m_metadata;
+    std::unique_ptr<StreamImage[]>  m_images;
+    size_t                          m_nimages;
+    size_t                          m_current;
+    size_t                          m_row;
+
+private:
+#ifdef _WIN32
+    ScopedHandle                    m_hFile;
+    auto_delete_file                m_delonfail;
+#else
+    std::filesystem::path           m_path;
+    std::ofstream                   m_outFile;
+    bool                            m_finished;
+#endif
+};
+
+DDSStreamWriter::DDSStreamWriter() noexcept = default;
+DDSStreamWriter::DDSStreamWriter(DDSStreamWriter&&) noexcept = default;
+DDSStreamWriter& DDSStreamWriter::operator= (DDSStreamWriter&&) noexcept = default;
+DDSStreamWriter::~DDSStreamWriter() = default;
+
+_Use_decl_annotations_
+HRESULT DDSStreamWriter::Create(const wchar_t* szFile, const TexMetadata& metadata, DDS_FLAGS flags) noexcept
+{
+    Release();
+
+    if (!szFile)
+        return E_INVALIDARG;
+
+    // Create DDS Header
+    uint8_t header[MAX_HEADER_SIZE];
+    size_t required;
+    HRESULT hr = EncodeDDSHeader(metadata, flags, header, MAX_HEADER_SIZE, required);
+    if (FAILED(hr))
+        return hr;
+
+    std::unique_ptr<StreamImage[]> images;
+    size_t nimages;
+    hr = SetupStreamImages(metadata, required, images, nimages);
+    if (FAILED(hr))
+        return hr;
+
+    // Create file and write header
+#ifdef _WIN32
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile(safe_handle(CreateFile2(szFile,
+        GENERIC_WRITE | DELETE, 0, CREATE_ALWAYS, nullptr)));
+#else
+    ScopedHandle hFile(safe_handle(CreateFileW(szFile,
+        GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+#endif
+    if (!hFile)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    std::unique_ptr<Impl> impl(new (std::nothrow) Impl(std::move(hFile)));
+    if (!impl)
+        return E_OUTOFMEMORY;
+#else
+    std::unique_ptr<Impl> impl;
+    try
+    {
+        impl.reset(new Impl(szFile));
+    }
+    catch (...)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    if (!impl->IsOpen())
+        return E_FAIL;
+#endif
+
+    hr = impl->Write(header, required);
+    if (FAILED(hr))
+        return hr;
+
+    impl->m_metadata = metadata;
+    impl->m_images = std::move(images);
+    impl->m_nimages = nimages;
+
+    pImpl = std::move(impl);
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DDSStreamWriter::WriteRows(const Image& rows) noexcept
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    return pImpl->WriteRows(rows);
+}
+
+HRESULT DDSStreamWriter::Finish() noexcept
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    const HRESULT hr = pImpl->Finish();
+    pImpl.reset();
+    return hr;
+}
+
+void DDSStreamWriter::Release() noexcept
+{
+    pImpl.reset();
+}
+
+const TexMetadata& DDSStreamWriter::GetMetadata() const noexcept
+{
+    return pImpl ? pImpl->m_metadata : g_emptyMetadata;
+}
+
+size_t DDSStreamWriter::GetCurrentImage() const noexcept
+{
+    return pImpl ? pImpl->m_current : 0;
+}
+
+size_t DDSStreamWriter::GetCurrentRow() const noexcept
+{
+    return pImpl ? pImpl->m_row : 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+// DDSStreamReader
+//-------------------------------------------------------------------------------------
+class DDSStreamReader::Impl
+{
+public:
+    Impl() noexcept :
+        m_metadata{},
+        m_convFlags(0),
+        m_nimages(0),
+        m_current(0),
+        m_row(0)
+    {
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    HRESULT Open(const wchar_t* szFile, DDS_FLAGS flags) noexcept
+    {
+    #ifdef _WIN32
+    #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        m_hFile.reset(safe_handle(CreateFile2(szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+    #else
+        m_hFile.reset(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+    #endif
+        if (!m_hFile)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        FILE_STANDARD_INFO fileInfo;
+        if (!GetFileInformationByHandleEx(m_hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        const auto len = static_cast<uint64_t>(fileInfo.EndOfFile.QuadPart);
+    #else
+        try
+        {
+            m_inFile.open(std::filesystem::path(szFile), std::ios::in | std::ios::binary | std::ios::ate);
+        }
+        catch (...)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        if (!m_inFile)
+            return E_FAIL;
+
+        const std::streampos fileLen = m_inFile.tellg();
+        if (!m_inFile)
+            return E_FAIL;
+
+        const auto len = static_cast<uint64_t>(static_cast<std::streamoff>(fileLen));
+    #endif
+
+        // Need at least enough data to fill the standard header and magic number to be a valid DDS
+        if (len < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
+        {
+            return E_FAIL;
+        }
+
+        uint8_t header[MAX_HEADER_SIZE] = {};
+        const auto headerLen = static_cast<size_t>(std::min<uint64_t>(len, MAX_HEADER_SIZE));
+
+        HRESULT hr = SetPosition(0);
+        if (FAILED(hr))
+            return hr;
+
+        hr = Read(header, headerLen);
+        if (FAILED(hr))
+            return hr;
+
+        hr = DecodeDDSHeader(header, headerLen, flags, m_metadata, m_convFlags);
+        if (FAILED(hr))
+            return hr;
+
+        // Only conversions that keep the pixel size can be applied a band at a time
+        if ((m_convFlags & (CONV_FLAGS_EXPAND | CONV_FLAGS_PAL8))
+            || (flags & (DDS_FLAGS_LEGACY_DWORD | DDS_FLAGS_BAD_DXTN_TAILS)))
+        {
+            return HRESULT_E_NOT_SUPPORTED;
+        }
+
+        const size_t offset = (m_convFlags & CONV_FLAGS_DX10)
+            ? MAX_HEADER_SIZE : (sizeof(uint32_t) + sizeof(DDS_HEADER));
+
+        hr = SetupStreamImages(m_metadata, offset, m_images, m_nimages);
+        if (FAILED(hr))
+            return hr;
+
+        const StreamImage& last = m_images[m_nimages - 1];
+        const uint64_t end = last.offset + uint64_t(last.rowPitch) * ComputeScanlines(m_metadata.format, last.height);
+        if (len < end)
+            return HRESULT_E_HANDLE_EOF;
+
+        return SetPosition(m_images[0].offset);
+    }
+
+    HRESULT Seek(size_t index) noexcept
+    {
+        if (index >= m_nimages)
+            return E_INVALIDARG;
+
+        const HRESULT hr = SetPosition(m_images[index].offset);
+        if (FAILED(hr))
+            return hr;
+
+        m_current = index;
+        m_row = 0;
+        return S_OK;
+    }
+
+    HRESULT ReadRows(const Image& rows) noexcept
+    {
+        if (m_current >= m_nimages)
+            return HRESULT_E_HANDLE_EOF;
+
+        const StreamImage& image = m_images[m_current];
+
+        size_t scanlines;
+        HRESULT hr = ValidateStreamRows(rows, m_metadata.format, image, m_row, scanlines);
+        if (FAILED(hr))
+            return hr;
+
+        if (rows.rowPitch == image.rowPitch)
+        {
+            hr = Read(rows.pixels, image.rowPitch * scanlines);
+        }
+        else
+        {
+            uint8_t* dPtr = rows.pixels;
+            for (size_t j = 0; j < scanlines && SUCCEEDED(hr); ++j)
+            {
+                hr = Read(dPtr, image.rowPitch);
+                dPtr += rows.rowPitch;
+            }
+        }
+
+        if (FAILED(hr))
+        {
+            // Position in the file is unknown, so a Seek is needed before reading again
+            m_current = m_nimages;
+            return hr;
+        }
+
+        if (m_convFlags & (CONV_FLAGS_SWIZZLE | CONV_FLAGS_NOALPHA))
+        {
+            uint32_t tflags = (m_convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0u;
+            if (m_convFlags & CONV_FLAGS_SWIZZLE)
+                tflags |= TEXP_SCANLINE_LEGACY;
+
+            uint8_t* pPixels = rows.pixels;
+            for (size_t j = 0; j < scanlines; ++j)
+            {
+                if (m_convFlags & CONV_FLAGS_SWIZZLE)
+                {
+                    SwizzleScanline(pPixels, image.rowPitch, pPixels, image.rowPitch, m_metadata.format, tflags);
+                }
+                else
+                {
+                    CopyScanline(pPixels, image.rowPitch, pPixels, image.rowPitch, m_metadata.format, tflags);
+                }
+
+                pPixels += rows.rowPitch;
+            }
+        }
+
+        m_row += rows.height;
+        if (m_row >= image.height)
+        {
+            ++m_current;
+            m_row = 0;
+        }
+
+        return S_OK;
+    }
+
+    TexMetadata                     m_metadata;
+    uint32_t                        m_convFlags;
+    std::unique_ptr<StreamImage[]>  m_images;
+    size_t                          m_nimages;
+    size_t                          m_current;
+    size_t                          m_row;
+
+private:
+    HRESULT Read(_Out_writes_bytes_(size) void* pData, size_t size) noexcept
+    {
+    #ifdef _WIN32
+        return ReadFileFully(m_hFile.get(), pData, size);
+    #else
+        m_inFile.read(static_cast<char*>(pData), static_cast<std::streamsize>(size));
+        return m_inFile ? S_OK : E_FAIL;
+    #endif
+    }
+
+    HRESULT SetPosition(uint64_t offset) noexcept
+    {
+    #ifdef _WIN32
+        LARGE_INTEGER filePos;
+        filePos.QuadPart = static_cast<LONGLONG>(offset);
+        if (!SetFilePointerEx(m_hFile.get(), filePos, nullptr, FILE_BEGIN))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+    #else
+        m_inFile.clear();
+        m_inFile.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+        if (!m_inFile)
+            return E_FAIL;
+    #endif
+
+        return S_OK;
+    }
+
+#ifdef _WIN32
+    ScopedHandle                    m_hFile;
+#else
+    std::ifstream                   m_inFile;
+#endif
+};
+
+DDSStreamReader::DDSStreamReader() noexcept = default;
+DDSStreamReader::DDSStreamReader(DDSStreamReader&&) noexcept = default;
+DDSStreamReader& DDSStreamReader::operator= (DDSStreamReader&&) noexcept = default;
+DDSStreamReader::~DDSStreamReader() = default;
+
+_Use_decl_annotations_
+HRESULT DDSStreamReader::Open(const wchar_t* szFile, DDS_FLAGS flags, TexMetadata* metadata) noexcept
+{
+    Release();
+
+    if (!szFile)
+        return E_INVALIDARG;
+
+    std::unique_ptr<Impl> impl(new (std::nothrow) Impl);
+    if (!impl)
+        return E_OUTOFMEMORY;
+
+    const HRESULT hr = impl->Open(szFile, flags);
+    if (FAILED(hr))
+        return hr;
+
+    if (metadata)
+        memcpy(metadata, &impl->m_metadata, sizeof(TexMetadata));
+
+    pImpl = std::move(impl);
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DDSStreamReader::Seek(size_t mip, size_t item, size_t slice) noexcept
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    return pImpl->Seek(FindStreamImage(pImpl->m_metadata, mip, item, slice));
+}
+
+_Use_decl_annotations_
+HRESULT DDSStreamReader::ReadRows(const Image& rows) noexcept
+{
+    if (!pImpl)
+        return E_UNEXPECTED;
+
+    return pImpl->ReadRows(rows);
+}
+
+void DDSStreamReader::Release() noexcept
+{
+    pImpl.reset();
+}
+
+const TexMetadata& DDSStreamReader::GetMetadata() const noexcept
+{
+    return pImpl ? pImpl->m_metadata : g_emptyMetadata;
+}
+
+size_t DDSStreamReader::GetCurrentImage() const noexcept
+{
+    return pImpl ? pImpl->m_current : 0;
+}
+
+size_t DDSStreamReader::GetCurrentRow() const noexcept
+{
+    return pImpl ? pImpl->m_row : 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+// MappedImage
+//-------------------------------------------------------------------------------------
+class MappedImage::Impl
+{
+public:
+    Impl() noexcept :
+        m_metadata{},
+        m_pImages(nullptr),
+        m_nimages(0),
+        m_pixels(nullptr),
+        m_size(0),
+        m_view(nullptr),
+        m_viewSize(0)
+    {
+    }
+
+    ~Impl()
+    {
+        Unmap();
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    HRESULT Load(const wchar_t* szFile, DDS_FLAGS flags) noexcept
+    {
+        HRESULT hr = Map(szFile);
+        if (FAILED(hr))
+            return hr;
+
+        uint32_t convFlags = 0;
+        hr = DecodeDDSHeader(m_view, m_viewSize, flags, m_metadata, convFlags);
+        if (FAILED(hr))
+            return hr;
+
+        if ((convFlags & (CONV_FLAGS_EXPAND | CONV_FLAGS_PAL8 | CONV_FLAGS_SWIZZLE | CONV_FLAGS_NOALPHA))
+            || (flags & (DDS_FLAGS_LEGACY_DWORD | DDS_FLAGS_BAD_DXTN_TAILS)))
+        {
+            // Pixels on disk don't match the returned format, so decode a copy and drop the mapping
+            hr = LoadFromDDSMemory(m_view, m_viewSize, flags, nullptr, m_copy);
+            Unmap();
+            if (FAILED(hr))
+                return hr;
+
+            m_metadata = m_copy.GetMetadata();
+            m_pImages = m_copy.GetImages();
+            m_nimages = m_copy.GetImageCount();
+            m_pixels = m_copy.GetPixels();
+            m_size = m_copy.GetPixelsSize();
+            return S_OK;
+        }
+
+        size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+        if (convFlags & CONV_FLAGS_DX10)
+            offset += sizeof(DDS_HEADER_DXT10);
+
+        size_t nimages, pixelSize;
+        if (!DetermineImageArray(m_metadata, CP_FLAGS_NONE, nimages, pixelSize))
+            return HRESULT_E_ARITHMETIC_OVERFLOW;
+
+        if (m_viewSize - offset < pixelSize)
+            return HRESULT_E_HANDLE_EOF;
+
+        m_images.reset(new (std::nothrow) Image[nimages]);
+        if (!m_images)
+            return E_OUTOFMEMORY;
+
+        uint8_t* pixels = static_cast<uint8_t*>(m_view) + offset;
+        if (!SetupImageArray(pixels, pixelSize, m_metadata, CP_FLAGS_NONE, m_images.get(), nimages))
+            return E_FAIL;
+
+        m_pImages = m_images.get();
+        m_nimages = nimages;
+        m_pixels = pixels;
+        m_size = pixelSize;
+        return S_OK;
+    }
+
+    bool IsMapped() const noexcept { return m_view != nullptr; }
+
+    TexMetadata                 m_metadata;
+    const Image*                m_pImages;
+    size_t                      m_nimages;
+    const uint8_t*              m_pixels;
+    size_t                      m_size;
+
+private:
+    HRESULT Map(const wchar_t* szFile) noexcept
+    {
+    #ifdef _WIN32
+    #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+        ScopedHandle hFile(safe_handle(CreateFile2(szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+    #else
+        ScopedHandle hFile(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr)));
+    #endif
+        if (!hFile)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        FILE_STANDARD_INFO fileInfo;
+        if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+    #if defined(_M_IX86) || defined(_M_ARM) || defined(_M_HYBRID_X86_ARM64)
+        if (fileInfo.EndOfFile.HighPart > 0)
+            return HRESULT_E_FILE_TOO_LARGE;
+    #endif
+
+        const auto len = static_cast<size_t>(fileInfo.EndOfFile.QuadPart);
+        if (len < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
+        {
+            return E_FAIL;
+        }
+
+        // The view keeps the mapping object alive, so neither handle is needed afterwards
+        ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        if (!hMapping)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        m_view = MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0);
+        if (!m_view)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+    #else
+        int fd = -1;
+        try
+        {
+            fd = open(std::filesystem::path(szFile).c_str(), O_RDONLY);
+        }
+        catch (...)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        if (fd < 0)
+            return E_FAIL;
+
+        struct stat st = {};
+        if (fstat(fd, &st) != 0
+            || static_cast<uint64_t>(st.st_size) < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
+        {
+            close(fd);
+            return E_FAIL;
+        }
+
+        if (static_cast<uint64_t>(st.st_size) > SIZE_MAX)
+        {
+            close(fd);
+            return HRESULT_E_FILE_TOO_LARGE;
+        }
+
+        const auto len = static_cast<size_t>(st.st_size);
+
+        // The mapping holds its own reference to the file
+        void* view = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (view == MAP_FAILED)
+            return E_FAIL;
+
+        m_view = view;
+    #endif
+
+        m_viewSize = len;
+        return S_OK;
+    }
+
+    void Unmap() noexcept
+    {
+        if (m_view)
+        {
+        #ifdef _WIN32
+            std::ignore = UnmapViewOfFile(m_view);
+        #else
+            std::ignore = munmap(m_view, m_viewSize);
+        #endif
+            m_view = nullptr;
+            m_viewSize = 0;
+        }
+    }
+
+    std::unique_ptr<Image[]>    m_images;
+    ScratchImage                m_copy;
+    void*                       m_view;
+    size_t                      m_viewSize;
+};
+
+const TexMetadata& MappedImage::GetMetadata() const noexcept
+{
+    return pImpl ? pImpl->m_metadata : g_emptyMetadata;
+}
+
+_Use_decl_annotations_
+const Image* MappedImage::GetImage(size_t mip, size_t item, size_t slice) const noexcept
+{
+    if (!pImpl)
+        return nullptr;
+
+    const size_t index = FindStreamImage(pImpl->m_metadata, mip, item, slice);
+    if (index >= pImpl->m_nimages)
+        return nullptr;
+
+    return &pImpl->m_pImages[index];
+}
+
+const Image* MappedImage::GetImages() const noexcept
+{
+    return pImpl ? pImpl->m_pImages : nullptr;
+}
+
+size_t MappedImage::GetImageCount() const noexcept
+{
+    return pImpl ? pImpl->m_nimages : 0;
+}
+
+const uint8_t* MappedImage::GetPixels() const noexcept
+{
+    return pImpl ? pImpl->m_pixels : nullptr;
+}
+
+size_t MappedImage::GetPixelsSize() const noexcept
+{
+    return pImpl ? pImpl->m_size : 0;
+}
+
+bool MappedImage::IsMapped() const noexcept
+{
+    return pImpl ? pImpl->IsMapped() : false;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::LoadFromDDSFileMapped(
+    const wchar_t* szFile,
+    DDS_FLAGS flags,
+    TexMetadata* metadata,
+    MappedImage& image) noexcept
+{
+    if (!szFile)
+        return E_INVALIDARG;
+
+    image.Release();
+
+    std::shared_ptr<MappedImage::Impl> impl;
+    try
+    {
+        impl = std::make_shared<MappedImage::Impl>();
+    }
+    catch (...)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    const HRESULT hr = impl->Load(szFile, flags);
+    if (FAILED(hr))
+        return hr;
+
+    if (metadata)
+        memcpy(metadata, &impl->m_metadata, sizeof(TexMetadata));
+
+    image.pImpl = std::move(impl);
+    return S_OK;
+}
@@ -680,6 +680,7 @@ HRESULT DirectX::GetMetadataFromHDRFile(const wchar_t* szFile, TexMetadata& meta
 _Use_decl_annotations_
 HRESULT DirectX::LoadFromHDRMemory(const void* pSource, size_t size, TexMetadata* metadata, ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::LoadFromHDRMemory");
     if (!pSource || size == 0)
         return E_INVALIDARG;
 
@@ -897,6 +898,7 @@ HRESULT DirectX::LoadFromHDRMemory(const void* pSource, size_t size, TexMetadata
 _Use_decl_annotations_
 HRESULT DirectX::LoadFromHDRFile(const wchar_t* szFile, TexMetadata* metadata, ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::LoadFromHDRFile");
     if (!szFile)
         return E_INVALIDARG;
 
@@ -905,7 +905,7 @@ namespace
     }
 
     //--- 2D Point Filter ---
-    HRESULT Generate2DMipsPointFilter(size_t levels, const ScratchImage& mipChain, size_t item) noexcept
+    HRESULT Generate2DMipsPointFilter(size_t levels, TEX_FILTER_FLAGS filter, const ScratchImage& mipChain, size_t item) noexcept
     {
         if (!mipChain.GetImages())
             return E_INVALIDARG;
@@ -917,22 +917,9 @@ namespace
         size_t width = mipChain.GetMetadata().width;
         size_t height = mipChain.GetMetadata().height;
 
-        // Allocate temporary space (2 scanlines)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 2);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row = target + width;
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
-        #ifdef _DEBUG
-            memset(row, 0xCD, sizeof(XMVECTOR)*width);
-        #endif
-
             // 2D point filter
             const Image* src = mipChain.GetImage(level - 1, item, 0);
             const Image* dest = mipChain.GetImage(level, item, 0);
@@ -940,9 +927,6 @@ namespace
             if (!src || !dest)
                 return E_POINTER;
 
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
             const size_t rowPitch = src->rowPitch;
 
             const size_t nwidth = (width > 1) ? (width >> 1) : 1;
@@ -951,31 +935,56 @@ namespace
             const size_t xinc = (width << 16) / nwidth;
             const size_t yinc = (height << 16) / nheight;
 
-            size_t lasty = size_t(-1);
-
-            size_t sy = 0;
-            for (size_t y = 0; y < nheight; ++y)
+            auto mipRows = [&](size_t yBegin, size_t yEnd) noexcept -> HRESULT
             {
-                if ((lasty ^ sy) >> 16)
+                // Allocate temporary space (2 scanlines)
+                auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 2);
+                if (!scanline)
+                    return E_OUTOFMEMORY;
+
+                XMVECTOR* target = scanline.get();
+
+                XMVECTOR* row = target + width;
+
+            #ifdef _DEBUG
+                memset(row, 0xCD, sizeof(XMVECTOR)*width);
+            #endif
+
+                const uint8_t* pSrc = src->pixels;
+                uint8_t* pDest = dest->pixels + dest->rowPitch * yBegin;
+
+                size_t lasty = size_t(-1);
+
+                size_t sy = yinc * yBegin;
+                for (size_t y = yBegin; y < yEnd; ++y)
                 {
-                    if (!LoadScanline(row, width, pSrc + (rowPitch * (sy >> 16)), rowPitch, src->format))
+                    if ((lasty ^ sy) >> 16)
+                    {
+                        if (!LoadScanline(row, width, pSrc + (rowPitch * (sy >> 16)), rowPitch, src->format))
+                            return E_FAIL;
+                        lasty = sy;
+                    }
+
+                    size_t sx = 0;
+                    for (size_t x = 0; x < nwidth; ++x)
+                    {
+                        target[x] = row[sx >> 16];
+                        sx += xinc;
+                    }
+
+                    if (!StoreScanline(pDest, dest->rowPitch, dest->format, target, nwidth))
                         return E_FAIL;
-                    lasty = sy;
-                }
+                    pDest += dest->rowPitch;
 
-                size_t sx = 0;
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    target[x] = row[sx >> 16];
-                    sx += xinc;
+                    sy += yinc;
                 }
 
-                if (!StoreScanline(pDest, dest->rowPitch, dest->format, target, nwidth))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
+                return S_OK;
+            };
 
-                sy += yinc;
-            }
+            const HRESULT hr = ParallelFor(nheight, PARALLEL_ROWS_PER_CHUNK, (filter & TEX_FILTER_PARALLEL) != 0, mipRows);
+            if (FAILED(hr))
+                return hr;
 
             if (height > 1)
                 height >>= 1;
@@ -1006,33 +1015,9 @@ namespace
         if (!ispow2(width) || !ispow2(height))
             return E_FAIL;
 
-        // Allocate temporary space (3 scanlines)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 3);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* urow0 = target + width;
-        XMVECTOR* urow1 = target + width * 2;
-
-        const XMVECTOR* urow2 = urow0 + 1;
-        const XMVECTOR* urow3 = urow1 + 1;
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
-            if (height <= 1)
-            {
-                urow1 = urow0;
-            }
-
-            if (width <= 1)
-            {
-                urow2 = urow0;
-                urow3 = urow1;
-            }
-
             // 2D box filter
             const Image* src = mipChain.GetImage(level - 1, item, 0);
             const Image* dest = mipChain.GetImage(level, item, 0);
@@ -1040,38 +1025,60 @@ namespace
             if (!src || !dest)
                 return E_POINTER;
 
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
             const size_t rowPitch = src->rowPitch;
 
             const size_t nwidth = (width > 1) ? (width >> 1) : 1;
             const size_t nheight = (height > 1) ? (height >> 1) : 1;
 
-            for (size_t y = 0; y < nheight; ++y)
+            auto mipRows = [&](size_t yBegin, size_t yEnd) noexcept -> HRESULT
             {
-                if (!LoadScanlineLinear(urow0, width, pSrc, rowPitch, src->format, filter))
-                    return E_FAIL;
-                pSrc += rowPitch;
+                // Allocate temporary space (3 scanlines)
+                auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 3);
+                if (!scanline)
+                    return E_OUTOFMEMORY;
+
+                XMVECTOR* target = scanline.get();
+
+                XMVECTOR* urow0 = target + width;
+                XMVECTOR* urow1 = (height > 1) ? (target + width * 2) : urow0;
+
+                const XMVECTOR* urow2 = (width > 1) ? (urow0 + 1) : urow0;
+                const XMVECTOR* urow3 = (width > 1) ? (urow1 + 1) : urow1;
+
+                const uint8_t* pSrc = src->pixels + rowPitch * (yBegin << 1);
+                uint8_t* pDest = dest->pixels + dest->rowPitch * yBegin;
 
-                if (urow0 != urow1)
+                for (size_t y = yBegin; y < yEnd; ++y)
                 {
-                    if (!LoadScanlineLinear(urow1, width, pSrc, rowPitch, src->format, filter))
+                    if (!LoadScanlineLinear(urow0, width, pSrc, rowPitch, src->format, filter))
                         return E_FAIL;
                     pSrc += rowPitch;
-                }
 
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    const size_t x2 = x << 1;
+                    if (urow0 != urow1)
+                    {
+                        if (!LoadScanlineLinear(urow1, width, pSrc, rowPitch, src->format, filter))
+                            return E_FAIL;
+                        pSrc += rowPitch;
+                    }
 
-                    AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2])
+                    for (size_t x = 0; x < nwidth; ++x)
+                    {
+                        const size_t x2 = x << 1;
+
+                        AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2])
+                    }
+
+                    if (!StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
+                        return E_FAIL;
+                    pDest += dest->rowPitch;
                 }
 
-                if (!StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
-            }
+                return S_OK;
+            };
+
+            const HRESULT hr = ParallelFor(nheight, PARALLEL_ROWS_PER_CHUNK, (filter & TEX_FILTER_PARALLEL) != 0, mipRows);
+            if (FAILED(hr))
+                return hr;
 
             if (height > 1)
                 height >>= 1;
@@ -1099,11 +1106,7 @@ namespace
         size_t width = mipChain.GetMetadata().width;
         size_t height = mipChain.GetMetadata().height;
 
-        // Allocate temporary space (3 scanlines, plus X and Y filters)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 3);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
+        // Allocate X and Y filters
         std::unique_ptr<LinearFilter[]> lf(new (std::nothrow) LinearFilter[width + height]);
         if (!lf)
             return E_OUTOFMEMORY;
@@ -1111,11 +1114,6 @@ namespace
         LinearFilter* lfX = lf.get();
         LinearFilter* lfY = lf.get() + width;
 
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row0 = target + width;
-        XMVECTOR* row1 = target + width * 2;
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
@@ -1126,9 +1124,6 @@ namespace
             if (!src || !dest)
                 return E_POINTER;
 
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
             const size_t rowPitch = src->rowPitch;
 
             const size_t nwidth = (width > 1) ? (width >> 1) : 1;
@@ -1137,55 +1132,77 @@ namespace
             const size_t nheight = (height > 1) ? (height >> 1) : 1;
             CreateLinearFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, lfY);
 
-        #ifdef _DEBUG
-            memset(row0, 0xCD, sizeof(XMVECTOR)*width);
-            memset(row1, 0xDD, sizeof(XMVECTOR)*width);
-        #endif
+            auto mipRows = [&](size_t yBegin, size_t yEnd) noexcept -> HRESULT
+            {
+                // Allocate temporary space (3 scanlines)
+                auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 3);
+                if (!scanline)
+                    return E_OUTOFMEMORY;
 
-            size_t u0 = size_t(-1);
-            size_t u1 = size_t(-1);
+                XMVECTOR* target = scanline.get();
 
-            for (size_t y = 0; y < nheight; ++y)
-            {
-                auto const& toY = lfY[y];
+                XMVECTOR* row0 = target + width;
+                XMVECTOR* row1 = target + width * 2;
+
+            #ifdef _DEBUG
+                memset(row0, 0xCD, sizeof(XMVECTOR)*width);
+                memset(row1, 0xDD, sizeof(XMVECTOR)*width);
+            #endif
+
+                const uint8_t* pSrc = src->pixels;
+                uint8_t* pDest = dest->pixels + dest->rowPitch * yBegin;
+
+                size_t u0 = size_t(-1);
+                size_t u1 = size_t(-1);
 
-                if (toY.u0 != u0)
+                for (size_t y = yBegin; y < yEnd; ++y)
                 {
-                    if (toY.u0 != u1)
+                    auto const& toY = lfY[y];
+
+                    if (toY.u0 != u0)
                     {
-                        u0 = toY.u0;
+                        if (toY.u0 != u1)
+                        {
+                            u0 = toY.u0;
 
-                        if (!LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
-                            return E_FAIL;
+                            if (!LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
+                                return E_FAIL;
+                        }
+                        else
+                        {
+                            u0 = u1;
+                            u1 = size_t(-1);
+
+                            std::swap(row0, row1);
+                        }
                     }
-                    else
+
+                    if (toY.u1 != u1)
                     {
-                        u0 = u1;
-                        u1 = size_t(-1);
+                        u1 = toY.u1;
 
-                        std::swap(row0, row1);
+                        if (!LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
+                            return E_FAIL;
                     }
-                }
 
-                if (toY.u1 != u1)
-                {
-                    u1 = toY.u1;
+                    for (size_t x = 0; x < nwidth; ++x)
+                    {
+                        auto const& toX = lfX[x];
 
-                    if (!LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
+                        BILINEAR_INTERPOLATE(target[x], toX, toY, row0, row1)
+                    }
+
+                    if (!StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
                         return E_FAIL;
+                    pDest += dest->rowPitch;
                 }
 
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    auto const& toX = lfX[x];
+                return S_OK;
+            };
 
-                    BILINEAR_INTERPOLATE(target[x], toX, toY, row0, row1)
-                }
-
-                if (!StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
-            }
+            const HRESULT hr = ParallelFor(nheight, PARALLEL_ROWS_PER_CHUNK, (filter & TEX_FILTER_PARALLEL) != 0, mipRows);
+            if (FAILED(hr))
+                return hr;
 
             if (height > 1)
                 height >>= 1;
@@ -1216,11 +1233,7 @@ namespace
         size_t width = mipChain.GetMetadata().width;
         size_t height = mipChain.GetMetadata().height;
 
-        // Allocate temporary space (5 scanlines, plus X and Y filters)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 5);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
+        // Allocate X and Y filters
         std::unique_ptr<CubicFilter[]> cf(new (std::nothrow) CubicFilter[width + height]);
         if (!cf)
             return E_OUTOFMEMORY;
@@ -1228,13 +1241,6 @@ namespace
         CubicFilter* cfX = cf.get();
         CubicFilter* cfY = cf.get() + width;
 
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row0 = target + width;
-        XMVECTOR* row1 = target + width * 2;
-        XMVECTOR* row2 = target + width * 3;
-        XMVECTOR* row3 = target + width * 4;
-
         // Resize base image to each target mip level
         for (size_t level = 1; level < levels; ++level)
         {
@@ -1245,9 +1251,6 @@ namespace
             if (!src || !dest)
                 return E_POINTER;
 
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
             const size_t rowPitch = src->rowPitch;
 
             const size_t nwidth = (width > 1) ? (width >> 1) : 1;
@@ -1256,127 +1259,151 @@ namespace
             const size_t nheight = (height > 1) ? (height >> 1) : 1;
             CreateCubicFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, (filter & TEX_FILTER_MIRROR_V) != 0, cfY);
 
-        #ifdef _DEBUG
-            memset(row0, 0xCD, sizeof(XMVECTOR)*width);
-            memset(row1, 0xDD, sizeof(XMVECTOR)*width);
-            memset(row2, 0xED, sizeof(XMVECTOR)*width);
-            memset(row3, 0xFD, sizeof(XMVECTOR)*width);
-        #endif
+            auto mipRows = [&](size_t yBegin, size_t yEnd) noexcept -> HRESULT
+            {
+                // Allocate temporary space (5 scanlines)
+                auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 5);
+                if (!scanline)
+                    return E_OUTOFMEMORY;
 
-            size_t u0 = size_t(-1);
-            size_t u1 = size_t(-1);
-            size_t u2 = size_t(-1);
-            size_t u3 = size_t(-1);
+                XMVECTOR* target = scanline.get();
 
-            for (size_t y = 0; y < nheight; ++y)
-            {
-                auto const& toY = cfY[y];
+                XMVECTOR* row0 = target + width;
+                XMVECTOR* row1 = target + width * 2;
+                XMVECTOR* row2 = target + width * 3;
+                XMVECTOR* row3 = target + width * 4;
 
-                // Scanline 1
-                if (toY.u0 != u0)
+            #ifdef _DEBUG
+                memset(row0, 0xCD, sizeof(XMVECTOR)*width);
+                memset(row1, 0xDD, sizeof(XMVECTOR)*width);
+                memset(row2, 0xED, sizeof(XMVECTOR)*width);
+                memset(row3, 0xFD, sizeof(XMVECTOR)*width);
+            #endif
+
+                const uint8_t* pSrc = src->pixels;
+                uint8_t* pDest = dest->pixels + dest->rowPitch * yBegin;
+
+                size_t u0 = size_t(-1);
+                size_t u1 = size_t(-1);
+                size_t u2 = size_t(-1);
+                size_t u3 = size_t(-1);
+
+                for (size_t y = yBegin; y < yEnd; ++y)
                 {
-                    if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
-                    {
-                        u0 = toY.u0;
+                    auto const& toY = cfY[y];
 
-                        if (!LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
-                            return E_FAIL;
-                    }
-                    else if (toY.u0 == u1)
+                    // Scanline 1
+                    if (toY.u0 != u0)
                     {
-                        u0 = u1;
-                        u1 = size_t(-1);
+                        if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
+                        {
+                            u0 = toY.u0;
 
-                        std::swap(row0, row1);
-                    }
-                    else if (toY.u0 == u2)
-                    {
-                        u0 = u2;
-                        u2 = size_t(-1);
+                            if (!LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
+                                return E_FAIL;
+                        }
+                        else if (toY.u0 == u1)
+                        {
+                            u0 = u1;
+                            u1 = size_t(-1);
 
-                        std::swap(row0, row2);
-                    }
-                    else if (toY.u0 == u3)
-                    {
-                        u0 = u3;
-                        u3 = size_t(-1);
+                            std::swap(row0, row1);
+                        }
+                        else if (toY.u0 == u2)
+                        {
+                            u0 = u2;
+                            u2 = size_t(-1);
+
+                            std::swap(row0, row2);
+                        }
+                        else if (toY.u0 == u3)
+                        {
+                            u0 = u3;
+                            u3 = size_t(-1);
 
-                        std::swap(row0, row3);
+                            std::swap(row0, row3);
+                        }
                     }
-                }
 
-                // Scanline 2
-                if (toY.u1 != u1)
-                {
-                    if (toY.u1 != u2 && toY.u1 != u3)
+                    // Scanline 2
+                    if (toY.u1 != u1)
                     {
-                        u1 = toY.u1;
+                        if (toY.u1 != u2 && toY.u1 != u3)
+                        {
+                            u1 = toY.u1;
 
-                        if (!LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
-                            return E_FAIL;
-                    }
-                    else if (toY.u1 == u2)
-                    {
-                        u1 = u2;
-                        u2 = size_t(-1);
+                            if (!LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
+                                return E_FAIL;
+                        }
+                        else if (toY.u1 == u2)
+                        {
+                            u1 = u2;
+                            u2 = size_t(-1);
+
+                            std::swap(row1, row2);
+                        }
+                        else if (toY.u1 == u3)
+                        {
+                            u1 = u3;
+                            u3 = size_t(-1);
 
-                        std::swap(row1, row2);
+                            std::swap(row1, row3);
+                        }
                     }
-                    else if (toY.u1 == u3)
+
+                    // Scanline 3
+                    if (toY.u2 != u2)
                     {
-                        u1 = u3;
-                        u3 = size_t(-1);
+                        if (toY.u2 != u3)
+                        {
+                            u2 = toY.u2;
 
-                        std::swap(row1, row3);
+                            if (!LoadScanlineLinear(row2, width, pSrc + (rowPitch * u2), rowPitch, src->format, filter))
+                                return E_FAIL;
+                        }
+                        else
+                        {
+                            u2 = u3;
+                            u3 = size_t(-1);
+
+                            std::swap(row2, row3);
+                        }
                     }
-                }
 
-                // Scanline 3
-                if (toY.u2 != u2)
-                {
-                    if (toY.u2 != u3)
+                    // Scanline 4
+                    if (toY.u3 != u3)
                     {
-                        u2 = toY.u2;
+                        u3 = toY.u3;
 
-                        if (!LoadScanlineLinear(row2, width, pSrc + (rowPitch * u2), rowPitch, src->format, filter))
+                        if (!LoadScanlineLinear(row3, width, pSrc + (rowPitch * u3), rowPitch, src->format, filter))
                             return E_FAIL;
                     }
-                    else
+
+                    for (size_t x = 0; x < nwidth; ++x)
                     {
-                        u2 = u3;
-                        u3 = size_t(-1);
+                        auto const& toX = cfX[x];
 
-                        std::swap(row2, row3);
-                    }
-                }
+                        XMVECTOR C0, C1, C2, C3;
 
-                // Scanline 4
-                if (toY.u3 != u3)
-                {
-                    u3 = toY.u3;
+                        CUBIC_INTERPOLATE(C0, toX.x, row0[toX.u0], row0[toX.u1], row0[toX.u2], row0[toX.u3]);
+                        CUBIC_INTERPOLATE(C1, toX.x, row1[toX.u0], row1[toX.u1], row1[toX.u2], row1[toX.u3]);
+                        CUBIC_INTERPOLATE(C2, toX.x, row2[toX.u0], row2[toX.u1], row2[toX.u2], row2[toX.u3]);
+                        CUBIC_INTERPOLATE(C3, toX.x, row3[toX.u0], row3[toX.u1], row3[toX.u2], row3[toX.u3]);
+
+                        CUBIC_INTERPOLATE(target[x], toY.x, C0, C1, C2, C3);
+                    }
 
-                    if (!LoadScanlineLinear(row3, width, pSrc + (rowPitch * u3), rowPitch, src->format, filter))
+                    if (!StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
                         return E_FAIL;
+                    pDest += dest->rowPitch;
                 }
 
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    auto const& toX = cfX[x];
-
-                    XMVECTOR C0, C1, C2, C3;
+                return S_OK;
+            };
 
-                    CUBIC_INTERPOLATE(C0, toX.x, row0[toX.u0], row0[toX.u1], row0[toX.u2], row0[toX.u3]);
-                    CUBIC_INTERPOLATE(C1, toX.x, row1[toX.u0], row1[toX.u1], row1[toX.u2], row1[toX.u3]);
-                    CUBIC_INTERPOLATE(C2, toX.x, row2[toX.u0], row2[toX.u1], row2[toX.u2], row2[toX.u3]);
-                    CUBIC_INTERPOLATE(C3, toX.x, row3[toX.u0], row3[toX.u1], row3[toX.u2], row3[toX.u3]);
-
-                    CUBIC_INTERPOLATE(target[x], toY.x, C0, C1, C2, C3);
-                }
-
-                if (!StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
-            }
+            const HRESULT hr = ParallelFor(nheight, PARALLEL_ROWS_PER_CHUNK, (filter & TEX_FILTER_PARALLEL) != 0, mipRows);
+            if (FAILED(hr))
+                return hr;
 
             if (height > 1)
                 height >>= 1;
@@ -2815,6 +2842,7 @@ HRESULT DirectX::GenerateMipMaps(
     ScratchImage& mipChain,
     bool allow1D) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::GenerateMipMaps");
     if (!IsValid(baseImage.format))
         return E_INVALIDARG;
 
@@ -2958,7 +2986,7 @@ HRESULT DirectX::GenerateMipMaps(
             if (FAILED(hr))
                 return hr;
 
-            hr = Generate2DMipsPointFilter(levels, mipChain, 0);
+            hr = Generate2DMipsPointFilter(levels, filter, mipChain, 0);
             if (FAILED(hr))
                 mipChain.Release();
             return hr;
@@ -3008,6 +3036,7 @@ HRESULT DirectX::GenerateMipMaps(
     size_t levels,
     ScratchImage& mipChain)
 {
+    DIRECTXTEX_ZONE("DirectX::GenerateMipMaps");
     if (!srcImages || !nimages || !IsValid(metadata.format))
         return E_INVALIDARG;
 
@@ -3178,7 +3207,7 @@ HRESULT DirectX::GenerateMipMaps(
 
             for (size_t item = 0; item < metadata.arraySize; ++item)
             {
-                hr = Generate2DMipsPointFilter(levels, mipChain, item);
+                hr = Generate2DMipsPointFilter(levels, filter, mipChain, item);
                 if (FAILED(hr))
                     mipChain.Release();
             }
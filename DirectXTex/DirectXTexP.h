@@ -419,6 +419,32 @@ namespace DirectX
             _Inout_updates_all_(count) XMVECTOR* pBuffer, _In_ size_t count,
             _In_ DXGI_FORMAT outFormat, _In_ DXGI_FORMAT inFormat, _In_ TEX_FILTER_FLAGS flags) noexcept;
 
+        //---------------------------------------------------------------------------------
+        // Thread pool helper functions
+        using PARALLEL_FOR_FUNC = HRESULT(*)(_In_opt_ void* context, _In_ size_t begin, _In_ size_t end);
+
+        HRESULT __cdecl ParallelFor(
+            _In_ size_t count, _In_ size_t grain,
+            _In_ PARALLEL_FOR_FUNC pfBody, _In_opt_ void* context) noexcept;
+            // Runs pfBody over [0, count) in chunks of 'grain' items on the shared work-stealing pool, including the calling thread.
+            // Returns the first failure; runs inline when nested, when the pool is busy, or when capped to a single thread
+
+        template<typename F>
+        HRESULT ParallelFor(_In_ size_t count, _In_ size_t grain, _In_ bool parallel, F& body) noexcept
+        {
+            if (!parallel)
+                return body(size_t(0), count);
+
+            return ParallelFor(count, grain,
+                [](void* context, size_t begin, size_t end) noexcept -> HRESULT
+                {
+                    return (*static_cast<F*>(context))(begin, end);
+                }, &body);
+        }
+
+        constexpr size_t PARALLEL_ROWS_PER_CHUNK = 16;
+            // Scanlines per work item for the filtering paths (BC codecs use one row of blocks per item)
+
         //---------------------------------------------------------------------------------
         // Misc helper functions
         bool __cdecl IsAlphaAllOpaqueBC(_In_ const Image& cImage) noexcept;
@@ -434,5 +460,42 @@ namespace DirectX
             _Inout_ const Image* img) noexcept;
     #endif
 
+        //---------------------------------------------------------------------------------
+        // Profiling zones reported through SetProfileCallbacks (two null checks when none are set)
+        extern ProfileBeginCallback g_profileBegin;
+        extern ProfileEndCallback g_profileEnd;
+
+        class ProfileZone
+        {
+        public:
+            explicit ProfileZone(_In_z_ const char* name) noexcept :
+                m_name(name), m_end(nullptr), m_token(0)
+            {
+                const ProfileBeginCallback begin = g_profileBegin;
+                if (begin)
+                {
+                    m_end = g_profileEnd;
+                    m_token = begin(name);
+                }
+            }
+
+            ~ProfileZone()
+            {
+                if (m_end)
+                    m_end(m_name, m_token);
+            }
+
+            ProfileZone(const ProfileZone&) = delete;
+            ProfileZone& operator=(const ProfileZone&) = delete;
+
+        private:
+            const char*         m_name;
+            ProfileEndCallback  m_end;
+            uint64_t            m_token;
+        };
+
     } // namespace Internal
 } // namespace DirectX
+
+// Times the rest of the enclosing scope as one zone
+#define DIRECTXTEX_ZONE(name) DirectX::Internal::ProfileZone directxtexZone(name)
@@ -252,59 +252,64 @@ namespace
     //-------------------------------------------------------------------------------------
 
     //--- Point Filter ---
-    HRESULT ResizePointFilter(const Image& srcImage, const Image& destImage) noexcept
+    HRESULT ResizePointFilter(const Image& srcImage, TEX_FILTER_FLAGS filter, const Image& destImage) noexcept
     {
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
 
-        // Allocate temporary space (2 scanlines)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) + destImage.width);
-        if (!scanline)
-            return E_OUTOFMEMORY;
+        const size_t rowPitch = srcImage.rowPitch;
 
-        XMVECTOR* target = scanline.get();
+        const size_t xinc = (srcImage.width << 16) / destImage.width;
+        const size_t yinc = (srcImage.height << 16) / destImage.height;
 
-        XMVECTOR* row = target + destImage.width;
+        auto resizeRows = [&](size_t yBegin, size_t yEnd) noexcept -> HRESULT
+        {
+            // Allocate temporary space (2 scanlines)
+            auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) + destImage.width);
+            if (!scanline)
+                return E_OUTOFMEMORY;
 
-    #ifdef _DEBUG
-        memset(row, 0xCD, sizeof(XMVECTOR)*srcImage.width);
-    #endif
+            XMVECTOR* target = scanline.get();
 
-        const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
+            XMVECTOR* row = target + destImage.width;
 
-        const size_t rowPitch = srcImage.rowPitch;
+        #ifdef _DEBUG
+            memset(row, 0xCD, sizeof(XMVECTOR)*srcImage.width);
+        #endif
 
-        const size_t xinc = (srcImage.width << 16) / destImage.width;
-        const size_t yinc = (srcImage.height << 16) / destImage.height;
+            const uint8_t* pSrc = srcImage.pixels;
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * yBegin;
 
-        size_t lasty = size_t(-1);
+            size_t lasty = size_t(-1);
 
-        size_t sy = 0;
-        for (size_t y = 0; y < destImage.height; ++y)
-        {
-            if ((lasty ^ sy) >> 16)
+            size_t sy = yinc * yBegin;
+            for (size_t y = yBegin; y < yEnd; ++y)
             {
-                if (!LoadScanline(row, srcImage.width, pSrc + (rowPitch * (sy >> 16)), rowPitch, srcImage.format))
+                if ((lasty ^ sy) >> 16)
+                {
+                    if (!LoadScanline(row, srcImage.width, pSrc + (rowPitch * (sy >> 16)), rowPitch, srcImage.format))
+                        return E_FAIL;
+                    lasty = sy;
+                }
+
+                size_t sx = 0;
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    target[x] = row[sx >> 16];
+                    sx += xinc;
+                }
+
+                if (!StoreScanline(pDest, destImage.rowPitch, destImage.format, target, destImage.width))
                     return E_FAIL;
-                lasty = sy;
-            }
+                pDest += destImage.rowPitch;
 
-            size_t sx = 0;
-            for (size_t x = 0; x < destImage.width; ++x)
-            {
-                target[x] = row[sx >> 16];
-                sx += xinc;
+                sy += yinc;
             }
 
-            if (!StoreScanline(pDest, destImage.rowPitch, destImage.format, target, destImage.width))
-                return E_FAIL;
-            pDest += destImage.rowPitch;
-
-            sy += yinc;
-        }
+            return S_OK;
+        };
 
-        return S_OK;
+        return ParallelFor(destImage.height, PARALLEL_ROWS_PER_CHUNK, (filter & TEX_FILTER_PARALLEL) != 0, resizeRows);
     }
 
 
@@ -319,55 +324,60 @@ namespace
         if (((destImage.width << 1) != srcImage.width) || ((destImage.height << 1) != srcImage.height))
             return E_FAIL;
 
-        // Allocate temporary space (3 scanlines)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) * 2 + destImage.width);
-        if (!scanline)
-            return E_OUTOFMEMORY;
+        const size_t rowPitch = srcImage.rowPitch;
 
-        XMVECTOR* target = scanline.get();
+        auto resizeRows = [&](size_t yBegin, size_t yEnd) noexcept -> HRESULT
+        {
+            // Allocate temporary space (3 scanlines)
+            auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) * 2 + destImage.width);
+            if (!scanline)
+                return E_OUTOFMEMORY;
 
-        XMVECTOR* urow0 = target + destImage.width;
-        XMVECTOR* urow1 = urow0 + srcImage.width;
+            XMVECTOR* target = scanline.get();
 
-    #ifdef _DEBUG
-        memset(urow0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
-        memset(urow1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
-    #endif
+            XMVECTOR* urow0 = target + destImage.width;
+            XMVECTOR* urow1 = urow0 + srcImage.width;
 
-        const XMVECTOR* urow2 = urow0 + 1;
-        const XMVECTOR* urow3 = urow1 + 1;
+        #ifdef _DEBUG
+            memset(urow0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
+            memset(urow1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
+        #endif
 
-        const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
+            const XMVECTOR* urow2 = urow0 + 1;
+            const XMVECTOR* urow3 = urow1 + 1;
 
-        const size_t rowPitch = srcImage.rowPitch;
+            const uint8_t* pSrc = srcImage.pixels + rowPitch * (yBegin << 1);
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * yBegin;
 
-        for (size_t y = 0; y < destImage.height; ++y)
-        {
-            if (!LoadScanlineLinear(urow0, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
-                return E_FAIL;
-            pSrc += rowPitch;
-
-            if (urow0 != urow1)
+            for (size_t y = yBegin; y < yEnd; ++y)
             {
-                if (!LoadScanlineLinear(urow1, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
+                if (!LoadScanlineLinear(urow0, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
                     return E_FAIL;
                 pSrc += rowPitch;
-            }
 
-            for (size_t x = 0; x < destImage.width; ++x)
-            {
-                const size_t x2 = x << 1;
+                if (urow0 != urow1)
+                {
+                    if (!LoadScanlineLinear(urow1, srcImage.width, pSrc, rowPitch, srcImage.format, filter))
+                        return E_FAIL;
+                    pSrc += rowPitch;
+                }
+
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    const size_t x2 = x << 1;
+
+                    AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2])
+                }
 
-                AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2])
+                if (!StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
+                    return E_FAIL;
+                pDest += destImage.rowPitch;
             }
 
-            if (!StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
-                return E_FAIL;
-            pDest += destImage.rowPitch;
-        }
+            return S_OK;
+        };
 
-        return S_OK;
+        return ParallelFor(destImage.height, PARALLEL_ROWS_PER_CHUNK, (filter & TEX_FILTER_PARALLEL) != 0, resizeRows);
     }
 
 
@@ -379,11 +389,7 @@ namespace
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
 
-        // Allocate temporary space (3 scanlines, plus X and Y filters)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) * 2 + destImage.width);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
+        // Allocate X and Y filters (shared by all rows)
         std::unique_ptr<LinearFilter[]> lf(new (std::nothrow) LinearFilter[destImage.width + destImage.height]);
         if (!lf)
             return E_OUTOFMEMORY;
@@ -394,67 +400,77 @@ namespace
         CreateLinearFilter(srcImage.width, destImage.width, (filter & TEX_FILTER_WRAP_U) != 0, lfX);
         CreateLinearFilter(srcImage.height, destImage.height, (filter & TEX_FILTER_WRAP_V) != 0, lfY);
 
-        XMVECTOR* target = scanline.get();
+        const size_t rowPitch = srcImage.rowPitch;
 
-        XMVECTOR* row0 = target + destImage.width;
-        XMVECTOR* row1 = row0 + srcImage.width;
+        auto resizeRows = [&](size_t yBegin, size_t yEnd) noexcept -> HRESULT
+        {
+            // Allocate temporary space (3 scanlines)
+            auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) * 2 + destImage.width);
+            if (!scanline)
+                return E_OUTOFMEMORY;
 
-    #ifdef _DEBUG
-        memset(row0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
-        memset(row1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
-    #endif
+            XMVECTOR* target = scanline.get();
 
-        const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
+            XMVECTOR* row0 = target + destImage.width;
+            XMVECTOR* row1 = row0 + srcImage.width;
 
-        const size_t rowPitch = srcImage.rowPitch;
+        #ifdef _DEBUG
+            memset(row0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
+            memset(row1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
+        #endif
 
-        size_t u0 = size_t(-1);
-        size_t u1 = size_t(-1);
+            const uint8_t* pSrc = srcImage.pixels;
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * yBegin;
 
-        for (size_t y = 0; y < destImage.height; ++y)
-        {
-            auto const& toY = lfY[y];
+            size_t u0 = size_t(-1);
+            size_t u1 = size_t(-1);
 
-            if (toY.u0 != u0)
+            for (size_t y = yBegin; y < yEnd; ++y)
             {
-                if (toY.u0 != u1)
+                auto const& toY = lfY[y];
+
+                if (toY.u0 != u0)
                 {
-                    u0 = toY.u0;
+                    if (toY.u0 != u1)
+                    {
+                        u0 = toY.u0;
 
-                    if (!LoadScanlineLinear(row0, srcImage.width, pSrc + (rowPitch * u0), rowPitch, srcImage.format, filter))
-                        return E_FAIL;
+                        if (!LoadScanlineLinear(row0, srcImage.width, pSrc + (rowPitch * u0), rowPitch, srcImage.format, filter))
+                            return E_FAIL;
+                    }
+                    else
+                    {
+                        u0 = u1;
+                        u1 = size_t(-1);
+
+                        std::swap(row0, row1);
+                    }
                 }
-                else
+
+                if (toY.u1 != u1)
                 {
-                    u0 = u1;
-                    u1 = size_t(-1);
+                    u1 = toY.u1;
 
-                    std::swap(row0, row1);
+                    if (!LoadScanlineLinear(row1, srcImage.width, pSrc + (rowPitch * u1), rowPitch, srcImage.format, filter))
+                        return E_FAIL;
                 }
-            }
 
-            if (toY.u1 != u1)
-            {
-                u1 = toY.u1;
-
-                if (!LoadScanlineLinear(row1, srcImage.width, pSrc + (rowPitch * u1), rowPitch, srcImage.format, filter))
-                    return E_FAIL;
-            }
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    auto const& toX = lfX[x];
 
-            for (size_t x = 0; x < destImage.width; ++x)
-            {
-                auto const& toX = lfX[x];
+                    BILINEAR_INTERPOLATE(target[x], toX, toY, row0, row1)
+                }
 
-                BILINEAR_INTERPOLATE(target[x], toX, toY, row0, row1)
+                if (!StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
+                    return E_FAIL;
+                pDest += destImage.rowPitch;
             }
 
-            if (!StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
-                return E_FAIL;
-            pDest += destImage.rowPitch;
-        }
+            return S_OK;
+        };
 
-        return S_OK;
+        return ParallelFor(destImage.height, PARALLEL_ROWS_PER_CHUNK, (filter & TEX_FILTER_PARALLEL) != 0, resizeRows);
     }
 
 
@@ -470,11 +486,7 @@ namespace
         assert(srcImage.pixels && destImage.pixels);
         assert(srcImage.format == destImage.format);
 
-        // Allocate temporary space (5 scanlines, plus X and Y filters)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) * 4 + destImage.width);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
+        // Allocate X and Y filters (shared by all rows)
         std::unique_ptr<CubicFilter[]> cf(new (std::nothrow) CubicFilter[destImage.width + destImage.height]);
         if (!cf)
             return E_OUTOFMEMORY;
@@ -485,141 +497,151 @@ namespace
         CreateCubicFilter(srcImage.width, destImage.width, (filter & TEX_FILTER_WRAP_U) != 0, (filter & TEX_FILTER_MIRROR_U) != 0, cfX);
         CreateCubicFilter(srcImage.height, destImage.height, (filter & TEX_FILTER_WRAP_V) != 0, (filter & TEX_FILTER_MIRROR_V) != 0, cfY);
 
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row0 = target + destImage.width;
-        XMVECTOR* row1 = row0 + srcImage.width;
-        XMVECTOR* row2 = row0 + srcImage.width * 2;
-        XMVECTOR* row3 = row0 + srcImage.width * 3;
-
-    #ifdef _DEBUG
-        memset(row0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
-        memset(row1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
-        memset(row2, 0xED, sizeof(XMVECTOR)*srcImage.width);
-        memset(row3, 0xFD, sizeof(XMVECTOR)*srcImage.width);
-    #endif
-
-        const uint8_t* pSrc = srcImage.pixels;
-        uint8_t* pDest = destImage.pixels;
-
         const size_t rowPitch = srcImage.rowPitch;
 
-        size_t u0 = size_t(-1);
-        size_t u1 = size_t(-1);
-        size_t u2 = size_t(-1);
-        size_t u3 = size_t(-1);
-
-        for (size_t y = 0; y < destImage.height; ++y)
+        auto resizeRows = [&](size_t yBegin, size_t yEnd) noexcept -> HRESULT
         {
-            auto const& toY = cfY[y];
-
-            // Scanline 1
-            if (toY.u0 != u0)
+            // Allocate temporary space (5 scanlines)
+            auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) * 4 + destImage.width);
+            if (!scanline)
+                return E_OUTOFMEMORY;
+
+            XMVECTOR* target = scanline.get();
+
+            XMVECTOR* row0 = target + destImage.width;
+            XMVECTOR* row1 = row0 + srcImage.width;
+            XMVECTOR* row2 = row0 + srcImage.width * 2;
+            XMVECTOR* row3 = row0 + srcImage.width * 3;
+
+        #ifdef _DEBUG
+            memset(row0, 0xCD, sizeof(XMVECTOR)*srcImage.width);
+            memset(row1, 0xDD, sizeof(XMVECTOR)*srcImage.width);
+            memset(row2, 0xED, sizeof(XMVECTOR)*srcImage.width);
+            memset(row3, 0xFD, sizeof(XMVECTOR)*srcImage.width);
+        #endif
+
+            const uint8_t* pSrc = srcImage.pixels;
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * yBegin;
+
+            size_t u0 = size_t(-1);
+            size_t u1 = size_t(-1);
+            size_t u2 = size_t(-1);
+            size_t u3 = size_t(-1);
+
+            for (size_t y = yBegin; y < yEnd; ++y)
             {
-                if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
-                {
-                    u0 = toY.u0;
+                auto const& toY = cfY[y];
 
-                    if (!LoadScanlineLinear(row0, srcImage.width, pSrc + (rowPitch * u0), rowPitch, srcImage.format, filter))
-                        return E_FAIL;
-                }
-                else if (toY.u0 == u1)
+                // Scanline 1
+                if (toY.u0 != u0)
                 {
-                    u0 = u1;
-                    u1 = size_t(-1);
+                    if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
+                    {
+                        u0 = toY.u0;
 
-                    std::swap(row0, row1);
-                }
-                else if (toY.u0 == u2)
-                {
-                    u0 = u2;
-                    u2 = size_t(-1);
+                        if (!LoadScanlineLinear(row0, srcImage.width, pSrc + (rowPitch * u0), rowPitch, srcImage.format, filter))
+                            return E_FAIL;
+                    }
+                    else if (toY.u0 == u1)
+                    {
+                        u0 = u1;
+                        u1 = size_t(-1);
 
-                    std::swap(row0, row2);
-                }
-                else if (toY.u0 == u3)
-                {
-                    u0 = u3;
-                    u3 = size_t(-1);
+                        std::swap(row0, row1);
+                    }
+                    else if (toY.u0 == u2)
+                    {
+                        u0 = u2;
+                        u2 = size_t(-1);
 
-                    std::swap(row0, row3);
+                        std::swap(row0, row2);
+                    }
+                    else if (toY.u0 == u3)
+                    {
+                        u0 = u3;
+                        u3 = size_t(-1);
+
+                        std::swap(row0, row3);
+                    }
                 }
-            }
 
-            // Scanline 2
-            if (toY.u1 != u1)
-            {
-                if (toY.u1 != u2 && toY.u1 != u3)
+                // Scanline 2
+                if (toY.u1 != u1)
                 {
-                    u1 = toY.u1;
+                    if (toY.u1 != u2 && toY.u1 != u3)
+                    {
+                        u1 = toY.u1;
 
-                    if (!LoadScanlineLinear(row1, srcImage.width, pSrc + (rowPitch * u1), rowPitch, srcImage.format, filter))
-                        return E_FAIL;
-                }
-                else if (toY.u1 == u2)
-                {
-                    u1 = u2;
-                    u2 = size_t(-1);
+                        if (!LoadScanlineLinear(row1, srcImage.width, pSrc + (rowPitch * u1), rowPitch, srcImage.format, filter))
+                            return E_FAIL;
+                    }
+                    else if (toY.u1 == u2)
+                    {
+                        u1 = u2;
+                        u2 = size_t(-1);
 
-                    std::swap(row1, row2);
-                }
-                else if (toY.u1 == u3)
-                {
-                    u1 = u3;
-                    u3 = size_t(-1);
+                        std::swap(row1, row2);
+                    }
+                    else if (toY.u1 == u3)
+                    {
+                        u1 = u3;
+                        u3 = size_t(-1);
 
-                    std::swap(row1, row3);
+                        std::swap(row1, row3);
+                    }
                 }
-            }
 
-            // Scanline 3
-            if (toY.u2 != u2)
-            {
-                if (toY.u2 != u3)
+                // Scanline 3
+                if (toY.u2 != u2)
                 {
-                    u2 = toY.u2;
+                    if (toY.u2 != u3)
+                    {
+                        u2 = toY.u2;
 
-                    if (!LoadScanlineLinear(row2, srcImage.width, pSrc + (rowPitch * u2), rowPitch, srcImage.format, filter))
-                        return E_FAIL;
+                        if (!LoadScanlineLinear(row2, srcImage.width, pSrc + (rowPitch * u2), rowPitch, srcImage.format, filter))
+                            return E_FAIL;
+                    }
+                    else
+                    {
+                        u2 = u3;
+                        u3 = size_t(-1);
+
+                        std::swap(row2, row3);
+                    }
                 }
-                else
+
+                // Scanline 4
+                if (toY.u3 != u3)
                 {
-                    u2 = u3;
-                    u3 = size_t(-1);
+                    u3 = toY.u3;
 
-                    std::swap(row2, row3);
+                    if (!LoadScanlineLinear(row3, srcImage.width, pSrc + (rowPitch * u3), rowPitch, srcImage.format, filter))
+                        return E_FAIL;
                 }
-            }
-
-            // Scanline 4
-            if (toY.u3 != u3)
-            {
-                u3 = toY.u3;
 
-                if (!LoadScanlineLinear(row3, srcImage.width, pSrc + (rowPitch * u3), rowPitch, srcImage.format, filter))
-                    return E_FAIL;
-            }
+                for (size_t x = 0; x < destImage.width; ++x)
+                {
+                    auto const& toX = cfX[x];
 
-            for (size_t x = 0; x < destImage.width; ++x)
-            {
-                auto const& toX = cfX[x];
+                    XMVECTOR C0, C1, C2, C3;
 
-                XMVECTOR C0, C1, C2, C3;
+                    CUBIC_INTERPOLATE(C0, toX.x, row0[toX.u0], row0[toX.u1], row0[toX.u2], row0[toX.u3]);
+                    CUBIC_INTERPOLATE(C1, toX.x, row1[toX.u0], row1[toX.u1], row1[toX.u2], row1[toX.u3]);
+                    CUBIC_INTERPOLATE(C2, toX.x, row2[toX.u0], row2[toX.u1], row2[toX.u2], row2[toX.u3]);
+                    CUBIC_INTERPOLATE(C3, toX.x, row3[toX.u0], row3[toX.u1], row3[toX.u2], row3[toX.u3]);
 
-                CUBIC_INTERPOLATE(C0, toX.x, row0[toX.u0], row0[toX.u1], row0[toX.u2], row0[toX.u3]);
-                CUBIC_INTERPOLATE(C1, toX.x, row1[toX.u0], row1[toX.u1], row1[toX.u2], row1[toX.u3]);
-                CUBIC_INTERPOLATE(C2, toX.x, row2[toX.u0], row2[toX.u1], row2[toX.u2], row2[toX.u3]);
-                CUBIC_INTERPOLATE(C3, toX.x, row3[toX.u0], row3[toX.u1], row3[toX.u2], row3[toX.u3]);
+                    CUBIC_INTERPOLATE(target[x], toY.x, C0, C1, C2, C3);
+                }
 
-                CUBIC_INTERPOLATE(target[x], toY.x, C0, C1, C2, C3);
+                if (!StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
+                    return E_FAIL;
+                pDest += destImage.rowPitch;
             }
 
-            if (!StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, target, destImage.width, filter))
-                return E_FAIL;
-            pDest += destImage.rowPitch;
-        }
+            return S_OK;
+        };
 
-        return S_OK;
+        return ParallelFor(destImage.height, PARALLEL_ROWS_PER_CHUNK, (filter & TEX_FILTER_PARALLEL) != 0, resizeRows);
     }
 
 
@@ -822,7 +844,7 @@ namespace
         switch (filter_select)
         {
         case TEX_FILTER_POINT:
-            return ResizePointFilter(srcImage, destImage);
+            return ResizePointFilter(srcImage, filter, destImage);
 
         case TEX_FILTER_BOX:
             return ResizeBoxFilter(srcImage, filter, destImage);
@@ -858,6 +880,7 @@ HRESULT DirectX::Resize(
     TEX_FILTER_FLAGS filter,
     ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::Resize");
     if (width == 0 || height == 0)
         return E_INVALIDARG;
 
@@ -949,6 +972,7 @@ HRESULT DirectX::Resize(
     TEX_FILTER_FLAGS filter,
     ScratchImage& result) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::Resize");
     if (!srcImages || !nimages || width == 0 || height == 0)
         return E_INVALIDARG;
 
@@ -1639,6 +1639,7 @@ HRESULT DirectX::LoadFromTGAMemory(
     TexMetadata* metadata,
     ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::LoadFromTGAMemory");
     if (!pSource || size == 0)
         return E_INVALIDARG;
 
@@ -1744,6 +1745,7 @@ HRESULT DirectX::LoadFromTGAFile(
     TexMetadata* metadata,
     ScratchImage& image) noexcept
 {
+    DIRECTXTEX_ZONE("DirectX::LoadFromTGAFile");
     if (!szFile)
         return E_INVALIDARG;
 
@@ -0,0 +1,381 @@
+//-------------------------------------------------------------------------------------
+// DirectXTexThreadPool.cpp
+//
+// DirectX Texture Library - Work-stealing thread pool for CPU texture processing
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexP.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::Internal;
+
+namespace
+{
+    constexpr size_t MAX_POOL_THREADS = 256;
+
+    // Set while a thread is running a parallel loop so nested loops run inline
+    thread_local bool s_inParallelFor = false;
+
+    //---------------------------------------------------------------------------------
+    // Contiguous run of chunks owned by one participant. The owner takes chunks from
+    // the front while idle participants steal the back half.
+    struct alignas(64) WorkRange
+    {
+        std::mutex  lock;
+        size_t      begin;
+        size_t      end;
+
+        WorkRange() noexcept : begin(0), end(0) {}
+    };
+
+    class ThreadPool
+    {
+    public:
+        ThreadPool() noexcept :
+            m_maxThreads(0),
+            m_pfBody(nullptr),
+            m_context(nullptr),
+            m_count(0),
+            m_grain(0),
+            m_rangeCount(0),
+            m_result(S_OK),
+            m_generation(0),
+            m_participants(0),
+            m_active(0),
+            m_shutdown(false)
+        {
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_stateLock);
+                m_shutdown = true;
+            }
+            m_wake.notify_all();
+
+            for (auto& it : m_workers)
+            {
+                if (it.joinable())
+                    it.join();
+            }
+        }
+
+        void SetMaxThreads(size_t count) noexcept
+        {
+            m_maxThreads = std::min(count, MAX_POOL_THREADS);
+        }
+
+        size_t GetMaxThreads() const noexcept
+        {
+            size_t count = m_maxThreads;
+            if (!count)
+            {
+                count = std::thread::hardware_concurrency();
+                if (!count)
+                    count = 1;
+            }
+            return std::min(count, MAX_POOL_THREADS);
+        }
+
+        HRESULT Run(size_t count, size_t grain, PARALLEL_FOR_FUNC pfBody, void* context) noexcept;
+
+    private:
+        void WorkerMain(size_t index, uint64_t generation) noexcept;
+        void Execute(size_t slot) noexcept;
+        bool Steal(size_t slot, size_t& chunk) noexcept;
+        size_t EnsureWorkers(size_t count) noexcept;
+
+        std::atomic<size_t>             m_maxThreads;
+
+        // Only one parallel loop runs on the pool at a time; others run inline
+        std::mutex                      m_jobLock;
+
+        // Current job (written by the caller only while holding m_jobLock and no workers are active)
+        PARALLEL_FOR_FUNC               m_pfBody;
+        void*                           m_context;
+        size_t                          m_count;
+        size_t                          m_grain;
+        std::unique_ptr<WorkRange[]>    m_ranges;
+        size_t                          m_rangeCount;
+        std::atomic<HRESULT>            m_result;
+
+        // Worker wake-up and completion
+        std::mutex                      m_stateLock;
+        std::condition_variable         m_wake;
+        std::condition_variable         m_done;
+        uint64_t                        m_generation;
+        size_t                          m_participants;
+        size_t                          m_active;
+        bool                            m_shutdown;
+
+        std::vector<std::thread>        m_workers;
+    };
+
+    ThreadPool& GetThreadPool() noexcept
+    {
+        static ThreadPool s_pool;
+        return s_pool;
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// Spawns worker threads on demand, returning how many are available (may be less
+// than requested if thread creation fails)
+//-------------------------------------------------------------------------------------
+size_t ThreadPool::EnsureWorkers(size_t count) noexcept
+{
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_stateLock);
+        generation = m_generation;
+    }
+
+    try
+    {
+        while (m_workers.size() < count)
+        {
+            const size_t index = m_workers.size();
+            m_workers.emplace_back(&ThreadPool::WorkerMain, this, index, generation);
+        }
+    }
+    catch (...)
+    {
+        // Fall back to however many workers we already have
+    }
+
+    return std::min(count, m_workers.size());
+}
+
+
+//-------------------------------------------------------------------------------------
+// Worker thread loop; worker 'index' runs as participant slot index + 1
+//-------------------------------------------------------------------------------------
+void ThreadPool::WorkerMain(size_t index, uint64_t generation) noexcept
+{
+    s_inParallelFor = true;
+
+    for (;;)
+    {
+        size_t participants;
+        {
+            std::unique_lock<std::mutex> lock(m_stateLock);
+            m_wake.wait(lock, [&] { return m_shutdown || m_generation != generation; });
+
+            if (m_shutdown)
+                return;
+
+            generation = m_generation;
+            participants = m_participants;
+        }
+
+        if (index + 1 >= participants)
+            continue;
+
+        Execute(index + 1);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(m_stateLock);
+            last = (--m_active == 0);
+        }
+
+        if (last)
+            m_done.notify_one();
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// Drains this participant's range, then steals from the others until no work is left
+//-------------------------------------------------------------------------------------
+void ThreadPool::Execute(size_t slot) noexcept
+{
+    WorkRange& own = m_ranges[slot];
+
+    for (;;)
+    {
+        if (FAILED(m_result.load(std::memory_order_relaxed)))
+            return;
+
+        size_t chunk = 0;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> lock(own.lock);
+            if (own.begin < own.end)
+            {
+                chunk = own.begin++;
+                found = true;
+            }
+        }
+
+        if (!found && !Steal(slot, chunk))
+            return;
+
+        const size_t begin = chunk * m_grain;
+        const size_t end = std::min(begin + m_grain, m_count);
+
+        const HRESULT hr = m_pfBody(m_context, begin, end);
+        if (FAILED(hr))
+        {
+            HRESULT expected = S_OK;
+            m_result.compare_exchange_strong(expected, hr);
+            return;
+        }
+    }
+}
+
+bool ThreadPool::Steal(size_t slot, size_t& chunk) noexcept
+{
+    const size_t participants = m_participants;
+
+    for (size_t j = 1; j < participants; ++j)
+    {
+        WorkRange& victim = m_ranges[(slot + j) % participants];
+
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.lock);
+            const size_t avail = victim.end - victim.begin;
+            if (!avail)
+                continue;
+
+            // Take the back half, leaving the victim the chunks it is about to reach
+            end = victim.end;
+            begin = end - ((avail + 1) >> 1);
+            victim.end = begin;
+        }
+
+        chunk = begin;
+
+        WorkRange& own = m_ranges[slot];
+        std::lock_guard<std::mutex> lock(own.lock);
+        own.begin = begin + 1;
+        own.end = end;
+        return true;
+    }
+
+    return false;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Runs pfBody over [0, count) in chunks of 'grain' items, with the calling thread
+// acting as participant 0
+//-------------------------------------------------------------------------------------
+HRESULT ThreadPool::Run(size_t count, size_t grain, PARALLEL_FOR_FUNC pfBody, void* context) noexcept
+{
+    if (!count)
+        return S_OK;
+
+    if (!grain)
+        grain = 1;
+
+    const size_t chunks = (count + grain - 1) / grain;
+    size_t participants = std::min(chunks, GetMaxThreads());
+
+    if (participants <= 1 || s_inParallelFor)
+        return pfBody(context, 0, count);
+
+    std::unique_lock<std::mutex> job(m_jobLock, std::try_to_lock);
+    if (!job.owns_lock())
+    {
+        // Pool is busy with another caller's loop
+        return pfBody(context, 0, count);
+    }
+
+    participants = EnsureWorkers(participants - 1) + 1;
+    if (participants <= 1)
+    {
+        job.unlock();
+        return pfBody(context, 0, count);
+    }
+
+    if (m_rangeCount < participants)
+    {
+        std::unique_ptr<WorkRange[]> ranges(new (std::nothrow) WorkRange[participants]);
+        if (!ranges)
+        {
+            job.unlock();
+            return pfBody(context, 0, count);
+        }
+
+        m_ranges = std::move(ranges);
+        m_rangeCount = participants;
+    }
+
+    for (size_t j = 0; j < participants; ++j)
+    {
+        m_ranges[j].begin = (chunks * j) / participants;
+        m_ranges[j].end = (chunks * (j + 1)) / participants;
+    }
+
+    m_pfBody = pfBody;
+    m_context = context;
+    m_count = count;
+    m_grain = grain;
+    m_result = S_OK;
+
+    {
+        std::lock_guard<std::mutex> lock(m_stateLock);
+        m_participants = participants;
+        m_active = participants - 1;
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    s_inParallelFor = true;
+    Execute(0);
+    s_inParallelFor = false;
+
+    {
+        std::unique_lock<std::mutex> lock(m_stateLock);
+        m_done.wait(lock, [&] { return m_active == 0; });
+    }
+
+    return m_result;
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+_Use_decl_annotations_
+HRESULT DirectX::Internal::ParallelFor(
+    size_t count,
+    size_t grain,
+    PARALLEL_FOR_FUNC pfBody,
+    void* context) noexcept
+{
+    if (!pfBody)
+        return E_INVALIDARG;
+
+    return GetThreadPool().Run(count, grain, pfBody, context);
+}
+
+_Use_decl_annotations_
+void DirectX::SetMaxThreadCount(size_t count) noexcept
+{
+    GetThreadPool().SetMaxThreads(count);
+}
+
+size_t DirectX::GetMaxThreadCount() noexcept
+{
+    return GetThreadPool().GetMaxThreads();
+}
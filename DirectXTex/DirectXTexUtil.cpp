@@ -30,6 +30,9 @@ static_assert(WIN10_DXGI_FORMAT_V408 == DXGI_FORMAT_V408, "Windows SDK mismatch
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
+ProfileBeginCallback DirectX::Internal::g_profileBegin = nullptr;
+ProfileEndCallback DirectX::Internal::g_profileEnd = nullptr;
+
 namespace
 {
 #ifdef _WIN32
@@ -338,6 +341,19 @@ void DirectX::SetWICFactory(_In_opt_ IWICImagingFactory* pWIC) noexcept
 #endif // WIN32
 
 
+//=====================================================================================
+// Profiling hooks
+//=====================================================================================
+
+_Use_decl_annotations_
+void DirectX::SetProfileCallbacks(ProfileBeginCallback begin, ProfileEndCallback end) noexcept
+{
+    // A zone needs both halves, so one without the other turns profiling off
+    Internal::g_profileEnd = (begin && end) ? end : nullptr;
+    Internal::g_profileBegin = (begin && end) ? begin : nullptr;
+}
+
+
 //=====================================================================================
 // DXGI Format Utilities
 //=====================================================================================
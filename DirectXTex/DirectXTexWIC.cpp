@@ -1314,6 +1314,7 @@ HRESULT DirectX::LoadFromWICMemory(
     ScratchImage& image,
     std::function<void(IWICMetadataQueryReader*)> getMQR)
 {
+    DIRECTXTEX_ZONE("DirectX::LoadFromWICMemory");
     if (!pSource || size == 0)
         return E_INVALIDARG;
 
@@ -1388,6 +1389,7 @@ HRESULT DirectX::LoadFromWICFile(
     ScratchImage& image,
     std::function<void(IWICMetadataQueryReader*)> getMQR)
 {
+    DIRECTXTEX_ZONE("DirectX::LoadFromWICFile");
     if (!szFile)
         return E_INVALIDARG;
 
@@ -0,0 +1,97 @@
+﻿#include "DynamicBuffer.h"
+#include <cstring>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DYNAMIC_BUFFER_SSE2 1
+#endif
+
+namespace
+{
+	// 16バイト単位は非一時的ストアで書き、端はmemcpyで書く
+	void StreamCopy(uint8_t* dst, const uint8_t* src, size_t size)
+	{
+#ifdef DYNAMIC_BUFFER_SSE2
+		if (((uintptr_t)dst & 15) == 0)
+		{
+			size_t blocks = size / 64;
+			for (size_t i = 0; i < blocks; i++)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i*)(src + 0));
+				__m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+				__m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+				__m128i d = _mm_loadu_si128((const __m128i*)(src + 48));
+				_mm_stream_si128((__m128i*)(dst + 0), a);
+				_mm_stream_si128((__m128i*)(dst + 16), b);
+				_mm_stream_si128((__m128i*)(dst + 32), c);
+				_mm_stream_si128((__m128i*)(dst + 48), d);
+				src += 64;
+				dst += 64;
+			}
+			// GPUに渡す前に書き込みを見えるようにする
+			_mm_sfence();
+			size -= blocks * 64;
+		}
+#endif
+		memcpy(dst, src, size);
+	}
+}
+
+DynamicBuffer::DynamicBuffer(UploadPageProvider* provider, size_t frameCapacity, size_t frameCount)
+{
+	this->provider = provider;
+	this->frameCapacity = (frameCapacity + UploadRing::ALIGNMENT - 1) & ~(UploadRing::ALIGNMENT - 1);
+	this->frameCount = frameCount == 0 ? 1 : frameCount;
+	frameBegin = 0;
+	head = 0;
+	stats = {};
+	// 全フレーム分を1つのページにまとめ、破棄するまでマップしたままにする
+	if (!provider->CreatePage(this->frameCapacity * this->frameCount, page)) { page = {}; }
+}
+DynamicBuffer::~DynamicBuffer()
+{
+	// GPUが全て使い終わってから破棄すること
+	if (page.cpu) { provider->DestroyPage(page); }
+}
+
+void DynamicBuffer::Begin(size_t frameIndex)
+{
+	frameBegin = frameIndex % frameCount * frameCapacity;
+	head = 0;
+	stats.frameBytes = 0;
+}
+
+UploadAllocation DynamicBuffer::Allocate(size_t size, size_t alignment)
+{
+	UploadAllocation result;
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) { alignment = ALIGNMENT; }
+	size_t offset = (head + alignment - 1) & ~(alignment - 1);
+	if (!page.cpu || offset > frameCapacity || size > frameCapacity - offset)
+	{
+		stats.failedAllocations++;
+		return result;
+	}
+	head = offset + size;
+
+	result.resource = page.resource;
+	result.cpu = page.cpu + frameBegin + offset;
+	result.gpu = page.gpu + frameBegin + offset;
+	result.offset = frameBegin + offset;
+	result.size = size;
+
+	stats.allocations++;
+	stats.frameBytes = head;
+	if (stats.frameBytes > stats.peakFrameBytes) { stats.peakFrameBytes = stats.frameBytes; }
+	return result;
+}
+UploadAllocation DynamicBuffer::Write(const void* data, size_t size, size_t alignment)
+{
+	UploadAllocation result = Allocate(size, alignment);
+	if (result.cpu) { memcpy(result.cpu, data, size); }
+	return result;
+}
+UploadAllocation DynamicBuffer::Stream(const void* data, size_t size, size_t alignment)
+{
+	UploadAllocation result = Allocate(size, alignment);
+	if (result.cpu) { StreamCopy(result.cpu, static_cast<const uint8_t*>(data), size); }
+	return result;
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "UploadRing.h"
+
+// 毎フレーム書き換える頂点やインデックスのバッファ
+// UPLOADヒープを1つ作ってマップしたままにし、フレームの数の区画に分けて線形に切り出す
+// 区画はGraphicsQueue::NextFrameがそのフレームの完了を待った後にBeginで使い回す
+class DynamicBuffer
+{
+public:
+	static const size_t ALIGNMENT = 16; // ストリーミングストアの単位
+
+	struct Stats
+	{
+		size_t allocations; // 累計の切り出し回数
+		size_t failedAllocations; // 区画に収まらなかった回数
+		size_t frameBytes; // 今のフレームで切り出した量
+		size_t peakFrameBytes; // frameBytesの最大値
+	};
+
+	DynamicBuffer(UploadPageProvider* provider, size_t frameCapacity, size_t frameCount);
+	~DynamicBuffer();
+
+	DynamicBuffer(const DynamicBuffer&) = delete;
+	DynamicBuffer& operator=(const DynamicBuffer&) = delete;
+
+	// ページを作れなければfalse(Allocateは全て失敗する)
+	bool IsValid() const { return page.cpu != nullptr; }
+	// frameIndexの区画を先頭から使い直す
+	void Begin(size_t frameIndex);
+	// 呼び出し側が直接書く領域(収まらなければcpuがnullptr)
+	// 書き込み結合のメモリなので、書くだけにして読み返さないこと
+	UploadAllocation Allocate(size_t size, size_t alignment = ALIGNMENT);
+	// dataをmemcpyで書き込む
+	UploadAllocation Write(const void* data, size_t size, size_t alignment = ALIGNMENT);
+	// キャッシュを通さずに書き込む(大きな転送でCPUのキャッシュを追い出さない)
+	UploadAllocation Stream(const void* data, size_t size, size_t alignment = ALIGNMENT);
+
+	size_t GetFrameCapacity() const { return frameCapacity; }
+	Stats GetStats() const { return stats; }
+
+private:
+	UploadPageProvider* provider;
+	UploadPage page;
+	size_t frameCapacity;
+	size_t frameCount;
+	size_t frameBegin; // 今の区画の先頭(page内のオフセット)
+	size_t head; // 今の区画の次の空き位置
+	Stats stats;
+};
@@ -0,0 +1,167 @@
+﻿// 毎フレームの頂点の書き換えを、書き方ごとに1から100MB/フレームで測る(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread DynamicBufferBenchmark.cpp DynamicBuffer.cpp NullGraphics.cpp UploadRing.cpp -o DynamicBufferBenchmark
+// 使い方
+//   DynamicBufferBenchmark [--frames F] [--update-kb K] [--sizes MB,MB,...]
+//   1フレームをK KB(既定64)ずつのバッファの更新に分ける
+// 書き方
+//   loop:   一時配列に頂点を作り、要素ごとに写す(VertexBuf::Mappingの以前のやり方、Map/Unmapは含まない)
+//   memcpy: 一時配列に頂点を作り、DynamicBuffer::Writeで写す
+//   stream: 一時配列に頂点を作り、DynamicBuffer::Streamで写す
+//   direct: DynamicBuffer::Allocateした領域に直接頂点を作る
+// Linuxのヒープは書き込み結合ではないので、実機のUPLOADヒープとは差の出方が違う(CPU側の手間の比較として見る)
+#include "DynamicBuffer.h"
+#include "NullGraphics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// VertexBuf::Vertexと同じ並び(DirectXMathを使わないため)
+	struct Vertex
+	{
+		float pos[3];
+		float uv[2];
+	};
+
+	struct Options
+	{
+		size_t frames = 60;
+		size_t updateBytes = 64 * 1024;
+		std::vector<size_t> sizes = { 1, 4, 16, 64, 100 }; // MB
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--frames") { options.frames = strtoul(value, nullptr, 10); }
+			else if (arg == "--update-kb") { options.updateBytes = strtoul(value, nullptr, 10) * 1024; }
+			else if (arg == "--sizes")
+			{
+				options.sizes.clear();
+				for (const char* p = value; *p;)
+				{
+					char* end = nullptr;
+					size_t size = strtoul(p, &end, 10);
+					if (end == p || size == 0) { return false; }
+					options.sizes.push_back(size);
+					p = *end == ',' ? end + 1 : end;
+				}
+			}
+			else { return false; }
+		}
+		return options.frames > 0 && options.updateBytes >= sizeof(Vertex) && !options.sizes.empty();
+	}
+
+	// 動く頂点を作る(写す手間が見えるよう、作る手間は軽くしておく)
+	void MakeVertices(Vertex* vertices, size_t count, size_t first, float time)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			float x = (float)((first + i) & 1023), z = (float)((first + i) >> 10);
+			vertices[i].pos[0] = x;
+			vertices[i].pos[1] = (x + z) * 0.01f + time;
+			vertices[i].pos[2] = z;
+			vertices[i].uv[0] = x * (1.0f / 1024.0f);
+			vertices[i].uv[1] = z * (1.0f / 1024.0f);
+		}
+	}
+
+	enum Mode { LOOP, MEMCPY, STREAM, DIRECT, MODE_COUNT };
+	const char* MODE_NAMES[MODE_COUNT] = { "loop", "memcpy", "stream", "direct" };
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: DynamicBufferBenchmark [--frames F] [--update-kb K] [--sizes MB,MB,...]\n");
+		return 2;
+	}
+
+	// main.cppと同じ2フレーム先行
+	const size_t FRAME_COUNT = 2;
+	const size_t WARMUP = (std::min)(options.frames, size_t(3)); // ページに初めて触れる分は数えない
+	const size_t updateVertices = options.updateBytes / sizeof(Vertex);
+	std::vector<Vertex> staging(updateVertices);
+	volatile uint32_t sink = 0; // 書いた結果を使ったことにする
+
+	printf("frames %zu update %zu KB (%zu vertices)\n", options.frames, updateVertices * sizeof(Vertex) / 1024, updateVertices);
+	printf("%8s %8s %10s %10s %8s\n", "MB/frame", "mode", "ms/frame", "GB/s", "updates");
+	for (size_t megabytes : options.sizes)
+	{
+		size_t frameBytes = megabytes * 1024 * 1024;
+		size_t updates = (std::max)(frameBytes / (updateVertices * sizeof(Vertex)), size_t(1));
+		size_t updateSize = updateVertices * sizeof(Vertex);
+
+		NullUploadPages pages;
+		DynamicBuffer buffer(&pages, updates * ((updateSize + DynamicBuffer::ALIGNMENT - 1) & ~(DynamicBuffer::ALIGNMENT - 1)), FRAME_COUNT);
+		if (!buffer.IsValid())
+		{
+			fprintf(stderr, "cannot allocate %zu MB\n", megabytes * FRAME_COUNT);
+			return 2;
+		}
+		for (size_t mode = 0; mode < MODE_COUNT; mode++)
+		{
+			NullQueue queue(FRAME_COUNT);
+			double totalMs = 0.0;
+			for (size_t frame = 0; frame < options.frames + WARMUP; frame++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				buffer.Begin(queue.GetFrameIndex());
+				float time = frame * 0.016f;
+				for (size_t u = 0; u < updates; u++)
+				{
+					UploadAllocation allocation;
+					switch (mode)
+					{
+					case LOOP:
+					{
+						MakeVertices(staging.data(), updateVertices, u * updateVertices, time);
+						allocation = buffer.Allocate(updateSize);
+						Vertex* map = (Vertex*)allocation.cpu;
+						if (map) { for (size_t i = 0; i < updateVertices; i++) { map[i] = staging[i]; } }
+						break;
+					}
+					case MEMCPY:
+						MakeVertices(staging.data(), updateVertices, u * updateVertices, time);
+						allocation = buffer.Write(staging.data(), updateSize);
+						break;
+					case STREAM:
+						MakeVertices(staging.data(), updateVertices, u * updateVertices, time);
+						allocation = buffer.Stream(staging.data(), updateSize);
+						break;
+					default:
+						allocation = buffer.Allocate(updateSize);
+						if (allocation.cpu) { MakeVertices((Vertex*)allocation.cpu, updateVertices, u * updateVertices, time); }
+						break;
+					}
+					if (!allocation.cpu)
+					{
+						fprintf(stderr, "dynamic buffer overflow\n");
+						return 2;
+					}
+					sink = sink + allocation.cpu[updateSize - 1];
+				}
+				queue.Signal();
+				queue.NextFrame();
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				if (frame >= WARMUP) { totalMs += ms; }
+			}
+			double ms = totalMs / options.frames;
+			double bytes = (double)updates * updateSize;
+			printf("%8zu %8s %10.3f %10.2f %8zu\n", megabytes, MODE_NAMES[mode], ms, bytes / (ms * 1e6), updates);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,228 @@
+﻿// 描画を記録だけするバックエンドで、main.cppと同じFrameRendererのフレームを繰り返し、CPUの負荷を測る(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread FrameBenchmark.cpp FrameRenderer.cpp NullGraphics.cpp SpriteBatch.cpp UploadRing.cpp
+//       CommandJobSystem.cpp RenderGraph.cpp ResourceStateTracker.cpp Profiler.cpp -o FrameBenchmark
+// 使い方
+//   FrameBenchmark [--frames F] [--draws D] [--sprites N] [--states M] [--textures T] [--bindless] [--threads K]
+//                  [--max-ms X] [--max-allocs A]
+//   Dはメッシュのインデックスの範囲(見えたメッシュレット)を描く数、Mはレイヤーの数で、レイヤーごとにブレンドを切り替えるのでパイプラインの切り替えになる
+//   --max-msか--max-allocsを超えたら1を返す(CIの判定に使う)
+#include "FrameRenderer.h"
+#include "NullGraphics.h"
+#include "SpriteBatch.h"
+#include "UploadRing.h"
+#include "CommandJobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+// ヒープの確保を数える
+static std::atomic<size_t> allocationCount(0);
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1)) { return p; }
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace
+{
+	struct Options
+	{
+		size_t frames = 300;
+		size_t draws = 1;
+		size_t sprites = 10000;
+		size_t states = 16;
+		size_t textures = 64;
+		bool bindless = false;
+		size_t threads = 0;
+		double maxMs = 0.0; // 0なら判定しない
+		double maxAllocs = -1.0; // 負なら判定しない
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (arg == "--bindless")
+			{
+				options.bindless = true;
+				continue;
+			}
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--frames") { options.frames = strtoul(value, nullptr, 10); }
+			else if (arg == "--draws") { options.draws = strtoul(value, nullptr, 10); }
+			else if (arg == "--sprites") { options.sprites = strtoul(value, nullptr, 10); }
+			else if (arg == "--states") { options.states = strtoul(value, nullptr, 10); }
+			else if (arg == "--textures") { options.textures = strtoul(value, nullptr, 10); }
+			else if (arg == "--threads") { options.threads = strtoul(value, nullptr, 10); }
+			else if (arg == "--max-ms") { options.maxMs = strtod(value, nullptr); }
+			else if (arg == "--max-allocs") { options.maxAllocs = strtod(value, nullptr); }
+			else { return false; }
+		}
+		options.states = (std::max)(options.states, size_t(1));
+		options.textures = (std::max)(options.textures, size_t(1));
+		return options.frames > 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: FrameBenchmark [--frames F] [--draws D] [--sprites N] [--states M] [--textures T] [--bindless] [--threads K] [--max-ms X] [--max-allocs A]\n");
+		return 2;
+	}
+
+	// main.cppと同じ組み立て(ワーカーごとのリスト、アップロードリング、ブレンドごとのパイプライン、バックバッファだけのグラフ)
+	const size_t FRAME_COUNT = 2;
+	const size_t BLEND_COUNT = 4;
+	const size_t WARMUP = (std::min)(options.frames, size_t(10)); // ページやリストの容量が揃うまでは数えない
+	const uint32_t STATE_PRESENT = 0x0; // D3D12_RESOURCE_STATEと同じ値
+	const uint32_t STATE_RENDER_TARGET = 0x4;
+
+	NullQueue queue(FRAME_COUNT);
+	NullUploadPages pages;
+	UploadRing uploadRing(&pages);
+	CommandJobSystem jobSystem(options.threads);
+	std::vector<NullCommandList> lists(jobSystem.GetThreadCount());
+	std::vector<GraphicsCommandList*> workers;
+	for (NullCommandList& list : lists) { workers.push_back(&list); }
+	NullCommandList pre;
+	NullCommandList post;
+	PipelineId pipelines[BLEND_COUNT] = { 1, 2, 3, 4 };
+
+	RenderGraph graph;
+	RenderGraph::ResourceId backBuffer = graph.Import("BackBuffer", STATE_PRESENT, STATE_PRESENT);
+	RenderGraph::PassId scenePass = graph.AddPass("Scene");
+	graph.Write(scenePass, backBuffer, STATE_RENDER_TARGET);
+	graph.Compile();
+
+	FrameRenderer renderer(jobSystem, queue, uploadRing, workers, pre, post, graph, scenePass);
+	SpriteBatch spriteBatch;
+	spriteBatch.bindless = options.bindless;
+	FrameScene scene{};
+	scene.renderTarget = 0x2000;
+	scene.width = 1280;
+	scene.height = 720;
+	scene.material = 0x1000;
+	scene.transform = 0x1100;
+	scene.bindless = 0x100000;
+	scene.texture = 0x100000;
+	scene.pipeline = 0;
+	scene.vertexBuffer = 0;
+	scene.indexBuffer = 1;
+	std::vector<ClusterDraw> draws;
+	for (size_t i = 0; i < options.draws; i++) { draws.push_back({ (uint32_t)(i * 372), 372 }); } // 124三角形のメッシュレット
+	scene.draws = draws.data();
+	scene.drawCount = draws.size();
+	scene.sprites = &spriteBatch;
+	scene.spriteTargets.pipelines = pipelines;
+	scene.spriteTargets.constants = 0x1200;
+	scene.spriteTargets.textures = 0x100000;
+	scene.spriteTargets.descriptorSize = 32;
+
+	std::vector<double> frameMs;
+	size_t measuredAllocations = 0;
+	size_t measuredCommands = 0;
+	size_t measuredDraws = 0;
+	size_t measuredStateChanges = 0;
+	size_t measuredBarriers = 0;
+	size_t measuredBatches = 0;
+	for (size_t frame = 0; frame < options.frames; frame++)
+	{
+		size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+		auto start = std::chrono::steady_clock::now();
+
+		uploadRing.Reclaim(queue.GetCompletedValue());
+
+		// スプライトは毎フレーム動かし、並べ替えと詰め直しを含める
+		spriteBatch.Begin();
+		float time = frame * 0.016f;
+		for (size_t i = 0; i < options.sprites; i++)
+		{
+			Sprite sprite;
+			sprite.position[0] = (float)(i % 256) * 5.0f + sinf(time + i) * 2.0f;
+			sprite.position[1] = (float)(i / 256 % 144) * 5.0f;
+			sprite.size[0] = sprite.size[1] = 4.0f;
+			sprite.rotation = time + i * 0.01f;
+			sprite.layer = (uint32_t)(i % options.states);
+			sprite.blendMode = (uint32_t)(sprite.layer % BLEND_COUNT);
+			sprite.texture = (uint32_t)(i * 7 % options.textures);
+			spriteBatch.Draw(sprite);
+		}
+		UploadAllocation instances = uploadRing.Allocate(spriteBatch.GetSpriteCount() * sizeof(SpriteInstance), 16);
+		if (!instances.cpu)
+		{
+			fprintf(stderr, "upload allocation failed\n");
+			return 2;
+		}
+		spriteBatch.End((SpriteInstance*)instances.cpu);
+		scene.spriteTargets.instances = instances.gpu;
+
+		renderer.Record(scene);
+		renderer.Submit();
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (frame < WARMUP) { continue; }
+		frameMs.push_back(ms);
+		measuredAllocations += allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+		NullQueue::Stats stats = queue.GetFrameStats();
+		measuredCommands += stats.commands;
+		measuredDraws += stats.draws;
+		measuredStateChanges += stats.stateChanges;
+		measuredBarriers += stats.barriers;
+		measuredBatches += spriteBatch.GetBatches().size();
+	}
+	if (frameMs.empty())
+	{
+		fprintf(stderr, "no frames measured (frames must exceed %zu)\n", WARMUP);
+		return 2;
+	}
+
+	size_t measured = frameMs.size();
+	double total = 0.0;
+	for (double ms : frameMs) { total += ms; }
+	std::sort(frameMs.begin(), frameMs.end());
+	double average = total / measured;
+	double allocations = (double)measuredAllocations / measured;
+
+	printf("frames %zu draws %zu sprites %zu states %zu textures %zu bindless %d threads %zu\n", measured, options.draws, options.sprites,
+		options.states, options.textures, options.bindless ? 1 : 0, jobSystem.GetThreadCount());
+	printf("cpu_ms_per_frame avg %.3f median %.3f p95 %.3f max %.3f\n", average, frameMs[measured / 2],
+		frameMs[(std::min)(measured - 1, measured * 95 / 100)], frameMs.back());
+	printf("allocations_per_frame %.2f\n", allocations);
+	printf("commands_per_frame %.1f draws %.1f state_changes %.1f barriers %.1f batches %.1f\n", (double)measuredCommands / measured,
+		(double)measuredDraws / measured, (double)measuredStateChanges / measured, (double)measuredBarriers / measured,
+		(double)measuredBatches / measured);
+	printf("upload_pages %zu peak_frame_bytes %zu\n", uploadRing.GetStats().pageCount, uploadRing.GetStats().peakFrameBytes);
+
+	bool failed = false;
+	if (options.maxMs > 0.0 && average > options.maxMs)
+	{
+		printf("FAIL cpu_ms_per_frame %.3f > %.3f\n", average, options.maxMs);
+		failed = true;
+	}
+	if (options.maxAllocs >= 0.0 && allocations > options.maxAllocs)
+	{
+		printf("FAIL allocations_per_frame %.2f > %.2f\n", allocations, options.maxAllocs);
+		failed = true;
+	}
+	return failed ? 1 : 0;
+}
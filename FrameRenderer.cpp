@@ -0,0 +1,78 @@
+﻿#include "FrameRenderer.h"
+#include <algorithm>
+
+FrameRenderer::FrameRenderer(CommandJobSystem& jobSystem, GraphicsQueue& queue, UploadRing& uploadRing,
+	const std::vector<GraphicsCommandList*>& workers, GraphicsCommandList& pre, GraphicsCommandList& post,
+	const RenderGraph& graph, RenderGraph::PassId pass) :
+	jobSystem(jobSystem), queue(queue), uploadRing(uploadRing), workers(workers), pre(pre), post(post),
+	graph(graph), pass(pass)
+{
+	for (GraphicsCommandList* worker : this->workers) { recorders.push_back(worker); }
+}
+
+size_t FrameRenderer::Record(const FrameScene& scene)
+{
+	size_t frameIndex = queue.GetFrameIndex();
+
+	// リソースバリアで書き込み可能にして、画面をクリアする
+	pre.Begin(frameIndex);
+	pre.Barrier(graph.GetBarriers(pass));
+	pre.ClearRenderTarget(scene.renderTarget, scene.clearColor);
+	pre.End();
+
+	// 描画を範囲ごとに分けて並列に記録する(スプライトのバッチはメッシュの後に続く)
+	size_t spriteCount = scene.sprites ? scene.sprites->GetBatches().size() : 0;
+	size_t listCount = jobSystem.Record(frameIndex, scene.drawCount + spriteCount, MIN_DRAWS_PER_LIST, recorders,
+		[&](CommandRecorder& recorder, size_t begin, size_t end)
+		{
+			RecordRange(static_cast<GraphicsCommandList&>(recorder), scene, begin, end);
+		});
+
+	// リソースバリアを戻す
+	post.Begin(frameIndex);
+	post.Barrier(graph.GetFinalBarriers());
+	post.End();
+
+	lists.clear();
+	lists.push_back(&pre);
+	for (size_t i = 0; i < listCount; i++) { lists.push_back(workers[i]); }
+	lists.push_back(&post);
+	return listCount;
+}
+
+void FrameRenderer::Submit()
+{
+	queue.Submit(lists.data(), lists.size());
+	// 画面に表示するバッファをフリップ(裏表の入替え)
+	queue.Present();
+	// 完了を待たずに次のフレームへ進む
+	uploadRing.Finish(queue.Signal());
+	queue.NextFrame();
+}
+
+void FrameRenderer::RecordRange(GraphicsCommandList& list, const FrameScene& scene, size_t begin, size_t end)
+{
+	// 状態はリストをまたいで引き継がれないので、それぞれ設定し直す
+	// ルート引数はルートシグネチャの後に設定する
+	list.SetRenderTarget(scene.renderTarget);
+	list.SetViewport(scene.width, scene.height);
+	list.SetRootSignature(scene.rootSignature);
+	list.SetVertexBuffer(scene.vertexBuffer);
+	list.SetIndexBuffer(scene.indexBuffer);
+	list.SetConstantBuffer(MATERIAL, scene.material);
+	list.SetShaderResource(INSTANCES, scene.spriteTargets.instances);
+	list.SetDescriptorTable(BINDLESS, scene.bindless);
+
+	size_t meshEnd = (std::min)(end, scene.drawCount);
+	if (begin < meshEnd)
+	{
+		list.SetPipeline(scene.pipeline);
+		list.SetConstantBuffer(TRANSFORM, scene.transform);
+		list.SetDescriptorTable(TEXTURE, scene.texture);
+		for (size_t i = begin; i < meshEnd; i++) { list.DrawIndexed(scene.draws[i].indexCount, 1, scene.draws[i].indexOffset, 0); }
+	}
+	if (scene.drawCount < end)
+	{
+		scene.sprites->Record(list, (std::max)(begin, scene.drawCount) - scene.drawCount, end - scene.drawCount, scene.spriteTargets);
+	}
+}
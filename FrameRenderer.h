@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GraphicsBackend.h"
+#include "Meshlet.h"
+#include "SpriteBatch.h"
+
+// 1フレームに描く物(アドレスはGraphicsCommandListと同じ)
+struct FrameScene
+{
+	// 描画先
+	uint64_t renderTarget; // バックバッファのCPUデスクリプタハンドル
+	float clearColor[4];
+	uint32_t width;
+	uint32_t height;
+
+	RootSignatureId rootSignature;
+	uint64_t material; // マテリアルの定数バッファ
+	uint64_t bindless; // ヒープの先頭(シェーダはテクスチャを番号で引く)
+
+	// メッシュ(インデックスの範囲をdrawCount回のDrawIndexedで描く)
+	PipelineId pipeline;
+	BufferId vertexBuffer;
+	BufferId indexBuffer;
+	const ClusterDraw* draws; // ClusterCullerで見えた範囲か、LODの範囲
+	size_t drawCount;
+	uint64_t transform; // 変換行列の定数バッファ
+	uint64_t texture; // テクスチャのデスクリプタテーブル
+
+	// スプライト(End()の後のバッチをメッシュの後に描く)
+	const SpriteBatch* sprites;
+	SpriteDrawTargets spriteTargets;
+};
+
+// FrameSceneをワーカーごとのリストへ並列に記録し、提出する
+// main.cppはD3D12、FrameBenchmarkはNullGraphicsのリストとキューを渡し、同じコードでフレームを回す
+class FrameRenderer
+{
+public:
+	// ルートパラメータの番号(RootSignature::SetParamの並び)
+	enum RootParam : uint32_t
+	{
+		MATERIAL,
+		TEXTURE,
+		TRANSFORM,
+		INSTANCES,
+		BINDLESS,
+	};
+
+	static const size_t MIN_DRAWS_PER_LIST = 64; // これより少なければリストを分けない
+
+	// workersはjobSystemのスレッドの数だけ渡す
+	// preはpassの前のバリアとクリア、postはフレームの最後のバリアを記録する
+	FrameRenderer(CommandJobSystem& jobSystem, GraphicsQueue& queue, UploadRing& uploadRing,
+		const std::vector<GraphicsCommandList*>& workers, GraphicsCommandList& pre, GraphicsCommandList& post,
+		const RenderGraph& graph, RenderGraph::PassId pass);
+
+	// 戻り値は描画を記録したワーカーのリストの数
+	size_t Record(const FrameScene& scene);
+	// Recordしたリストを記録した順に1回で実行して表示し、FRAME_COUNTフレーム先行した時だけ待つ
+	void Submit();
+
+private:
+	CommandJobSystem& jobSystem;
+	GraphicsQueue& queue;
+	UploadRing& uploadRing;
+	std::vector<GraphicsCommandList*> workers;
+	std::vector<CommandRecorder*> recorders;
+	GraphicsCommandList& pre;
+	GraphicsCommandList& post;
+	const RenderGraph& graph;
+	RenderGraph::PassId pass;
+	std::vector<GraphicsCommandList*> lists; // 容量はフレームをまたいで使い回す
+
+	void RecordRange(GraphicsCommandList& list, const FrameScene& scene, size_t begin, size_t end);
+};
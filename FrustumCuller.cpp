@@ -0,0 +1,271 @@
+﻿#include "FrustumCuller.h"
+#include "CommandJobSystem.h"
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+#if defined(__AVX__)
+const size_t FrustumCuller::LANES = 8;
+#else
+const size_t FrustumCuller::LANES = 4;
+#endif
+
+size_t BoundingSpheres::Add(float centerX, float centerY, float centerZ, float r)
+{
+	x.push_back(centerX);
+	y.push_back(centerY);
+	z.push_back(centerZ);
+	radius.push_back(r);
+	return x.size() - 1;
+}
+void BoundingSpheres::Clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	radius.clear();
+}
+
+size_t BoundingBoxes::Add(const float center[3], const float extent[3])
+{
+	x.push_back(center[0]);
+	y.push_back(center[1]);
+	z.push_back(center[2]);
+	extentX.push_back(extent[0]);
+	extentY.push_back(extent[1]);
+	extentZ.push_back(extent[2]);
+	return x.size() - 1;
+}
+void BoundingBoxes::Clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+}
+
+namespace
+{
+	// マスクの立っている要素の番号を分岐せずに詰める
+	inline size_t Compact(int mask, size_t lanes, size_t first, uint32_t* visible, size_t count)
+	{
+		for (size_t lane = 0; lane < lanes; lane++)
+		{
+			visible[count] = (uint32_t)(first + lane);
+			count += (mask >> lane) & 1;
+		}
+		return count;
+	}
+}
+
+FrustumCuller::FrustumCuller()
+{
+	memset(planes, 0, sizeof(planes));
+}
+
+void FrustumCuller::SetViewProjection(const float matrix[16])
+{
+	// クリップ座標の各成分は行列の列との内積なので、列の和と差が平面になる
+	float column[4][4];
+	for (size_t c = 0; c < 4; c++)
+	{
+		for (size_t r = 0; r < 4; r++) { column[c][r] = matrix[r * 4 + c]; }
+	}
+	for (size_t i = 0; i < 4; i++)
+	{
+		planes[0][i] = column[3][i] + column[0][i]; // 左
+		planes[1][i] = column[3][i] - column[0][i]; // 右
+		planes[2][i] = column[3][i] + column[1][i]; // 下
+		planes[3][i] = column[3][i] - column[1][i]; // 上
+		planes[4][i] = column[2][i]; // 手前(0 <= z)
+		planes[5][i] = column[3][i] - column[2][i]; // 奥
+	}
+	for (float* plane : planes)
+	{
+		float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length <= 0.0f) { continue; }
+		for (size_t i = 0; i < 4; i++) { plane[i] /= length; }
+	}
+}
+
+size_t FrustumCuller::Cull(const BoundingSpheres& bounds, size_t begin, size_t end, uint32_t* visible) const
+{
+	const float* x = bounds.x.data();
+	const float* y = bounds.y.data();
+	const float* z = bounds.z.data();
+	const float* r = bounds.radius.data();
+	size_t count = 0;
+	size_t i = begin;
+
+	// 全ての平面で 距離 + 半径 >= 0 なら見える(最小値を1回だけ比べる)
+#if defined(__AVX__)
+	__m256 p8[6][4];
+	for (size_t k = 0; k < 6; k++)
+	{
+		for (size_t c = 0; c < 4; c++) { p8[k][c] = _mm256_set1_ps(planes[k][c]); }
+	}
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+		__m256 vr = _mm256_loadu_ps(r + i);
+		__m256 m = _mm256_set1_ps(INFINITY);
+		for (size_t k = 0; k < 6; k++)
+		{
+			__m256 d = _mm256_add_ps(_mm256_mul_ps(p8[k][0], vx), _mm256_mul_ps(p8[k][1], vy));
+			d = _mm256_add_ps(d, _mm256_mul_ps(p8[k][2], vz));
+			d = _mm256_add_ps(d, _mm256_add_ps(p8[k][3], vr));
+			m = _mm256_min_ps(m, d);
+		}
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(m, _mm256_setzero_ps(), _CMP_GE_OQ));
+		count = Compact(mask, 8, i, visible, count);
+	}
+#endif
+	__m128 p4[6][4];
+	for (size_t k = 0; k < 6; k++)
+	{
+		for (size_t c = 0; c < 4; c++) { p4[k][c] = _mm_set1_ps(planes[k][c]); }
+	}
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+		__m128 vr = _mm_loadu_ps(r + i);
+		__m128 m = _mm_set1_ps(INFINITY);
+		for (size_t k = 0; k < 6; k++)
+		{
+			__m128 d = _mm_add_ps(_mm_mul_ps(p4[k][0], vx), _mm_mul_ps(p4[k][1], vy));
+			d = _mm_add_ps(d, _mm_mul_ps(p4[k][2], vz));
+			d = _mm_add_ps(d, _mm_add_ps(p4[k][3], vr));
+			m = _mm_min_ps(m, d);
+		}
+		int mask = _mm_movemask_ps(_mm_cmpge_ps(m, _mm_setzero_ps()));
+		count = Compact(mask, 4, i, visible, count);
+	}
+	// 端数
+	for (; i < end; i++)
+	{
+		float m = INFINITY;
+		for (const float* p : planes) { m = fminf(m, p[0] * x[i] + p[1] * y[i] + p[2] * z[i] + (p[3] + r[i])); }
+		visible[count] = (uint32_t)i;
+		count += m >= 0.0f;
+	}
+	return count;
+}
+
+size_t FrustumCuller::Cull(const BoundingBoxes& bounds, size_t begin, size_t end, uint32_t* visible) const
+{
+	const float* x = bounds.x.data();
+	const float* y = bounds.y.data();
+	const float* z = bounds.z.data();
+	const float* ex = bounds.extentX.data();
+	const float* ey = bounds.extentY.data();
+	const float* ez = bounds.extentZ.data();
+	size_t count = 0;
+	size_t i = begin;
+
+	// 箱の平面方向への広がりは |法線|・半分の大きさ なので、球の半径の代わりに足す
+	float absPlanes[6][3];
+	for (size_t k = 0; k < 6; k++)
+	{
+		for (size_t c = 0; c < 3; c++) { absPlanes[k][c] = fabsf(planes[k][c]); }
+	}
+#if defined(__AVX__)
+	__m256 p8[6][7];
+	for (size_t k = 0; k < 6; k++)
+	{
+		for (size_t c = 0; c < 4; c++) { p8[k][c] = _mm256_set1_ps(planes[k][c]); }
+		for (size_t c = 0; c < 3; c++) { p8[k][4 + c] = _mm256_set1_ps(absPlanes[k][c]); }
+	}
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+		__m256 vex = _mm256_loadu_ps(ex + i), vey = _mm256_loadu_ps(ey + i), vez = _mm256_loadu_ps(ez + i);
+		__m256 m = _mm256_set1_ps(INFINITY);
+		for (size_t k = 0; k < 6; k++)
+		{
+			__m256 d = _mm256_add_ps(_mm256_mul_ps(p8[k][0], vx), _mm256_mul_ps(p8[k][1], vy));
+			d = _mm256_add_ps(d, _mm256_mul_ps(p8[k][2], vz));
+			__m256 e = _mm256_add_ps(_mm256_mul_ps(p8[k][4], vex), _mm256_mul_ps(p8[k][5], vey));
+			e = _mm256_add_ps(e, _mm256_mul_ps(p8[k][6], vez));
+			d = _mm256_add_ps(_mm256_add_ps(d, p8[k][3]), e);
+			m = _mm256_min_ps(m, d);
+		}
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(m, _mm256_setzero_ps(), _CMP_GE_OQ));
+		count = Compact(mask, 8, i, visible, count);
+	}
+#endif
+	__m128 p4[6][7];
+	for (size_t k = 0; k < 6; k++)
+	{
+		for (size_t c = 0; c < 4; c++) { p4[k][c] = _mm_set1_ps(planes[k][c]); }
+		for (size_t c = 0; c < 3; c++) { p4[k][4 + c] = _mm_set1_ps(absPlanes[k][c]); }
+	}
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+		__m128 vex = _mm_loadu_ps(ex + i), vey = _mm_loadu_ps(ey + i), vez = _mm_loadu_ps(ez + i);
+		__m128 m = _mm_set1_ps(INFINITY);
+		for (size_t k = 0; k < 6; k++)
+		{
+			__m128 d = _mm_add_ps(_mm_mul_ps(p4[k][0], vx), _mm_mul_ps(p4[k][1], vy));
+			d = _mm_add_ps(d, _mm_mul_ps(p4[k][2], vz));
+			__m128 e = _mm_add_ps(_mm_mul_ps(p4[k][4], vex), _mm_mul_ps(p4[k][5], vey));
+			e = _mm_add_ps(e, _mm_mul_ps(p4[k][6], vez));
+			d = _mm_add_ps(_mm_add_ps(d, p4[k][3]), e);
+			m = _mm_min_ps(m, d);
+		}
+		int mask = _mm_movemask_ps(_mm_cmpge_ps(m, _mm_setzero_ps()));
+		count = Compact(mask, 4, i, visible, count);
+	}
+	// 端数
+	for (; i < end; i++)
+	{
+		float m = INFINITY;
+		for (size_t k = 0; k < 6; k++)
+		{
+			const float* p = planes[k];
+			float d = p[0] * x[i] + p[1] * y[i] + p[2] * z[i];
+			float e = absPlanes[k][0] * ex[i] + absPlanes[k][1] * ey[i] + absPlanes[k][2] * ez[i];
+			m = fminf(m, (d + p[3]) + e);
+		}
+		visible[count] = (uint32_t)i;
+		count += m >= 0.0f;
+	}
+	return count;
+}
+
+template<class Bounds>
+size_t FrustumCuller::CullParallel(CommandJobSystem& jobSystem, const Bounds& bounds, std::vector<uint32_t>& visible, size_t minItemsPerJob)
+{
+	// 範囲ごとに自分の場所へ書き、後で前へ詰める
+	visible.resize(bounds.Size());
+	jobCounts.resize(jobSystem.GetThreadCount());
+	size_t jobs = jobSystem.ParallelFor(bounds.Size(), minItemsPerJob,
+		[&](size_t job, size_t begin, size_t end)
+		{
+			jobCounts[job] = Cull(bounds, begin, end, visible.data() + begin);
+		});
+
+	std::vector<CommandJobSystem::Range> ranges = CommandJobSystem::Partition(bounds.Size(), jobs);
+	size_t count = 0;
+	for (size_t job = 0; job < jobs; job++)
+	{
+		if (count != ranges[job].begin)
+		{
+			memmove(visible.data() + count, visible.data() + ranges[job].begin, jobCounts[job] * sizeof(uint32_t));
+		}
+		count += jobCounts[job];
+	}
+	visible.resize(count);
+	return count;
+}
+
+size_t FrustumCuller::Cull(CommandJobSystem& jobSystem, const BoundingSpheres& bounds, std::vector<uint32_t>& visible, size_t minItemsPerJob)
+{
+	return CullParallel(jobSystem, bounds, visible, minItemsPerJob);
+}
+size_t FrustumCuller::Cull(CommandJobSystem& jobSystem, const BoundingBoxes& bounds, std::vector<uint32_t>& visible, size_t minItemsPerJob)
+{
+	return CullParallel(jobSystem, bounds, visible, minItemsPerJob);
+}
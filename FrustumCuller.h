@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CommandJobSystem;
+
+// 境界球をSoAで持つ(SIMDで並びのまま複数個ずつ読む)
+struct BoundingSpheres
+{
+	std::vector<float> x, y, z, radius;
+
+	size_t Add(float centerX, float centerY, float centerZ, float r);
+	void Clear();
+	size_t Size() const { return x.size(); }
+};
+
+// 軸に沿った箱(中心と各軸の半分の大きさ)をSoAで持つ
+struct BoundingBoxes
+{
+	std::vector<float> x, y, z, extentX, extentY, extentZ;
+
+	size_t Add(const float center[3], const float extent[3]);
+	void Clear();
+	size_t Size() const { return x.size(); }
+};
+
+// ビュープロジェクション行列から視錐台の6平面を取り出し、境界をまとめて判定する(デバイスに依存しない)
+// AVXが有効なビルドなら8個、それ以外はSSEで4個ずつ判定する
+class FrustumCuller
+{
+public:
+	static const size_t LANES;
+
+	FrustumCuller();
+
+	// 行ベクトル(v * M)の行列で、並びはDirectXMathのXMFLOAT4X4と同じ
+	// 深度が0~1のD3Dの射影を前提にする
+	void SetViewProjection(const float matrix[16]);
+	// ax+by+cz+d(法線は内向きで長さ1)
+	const float* GetPlane(size_t i) const { return planes[i]; }
+
+	// [begin, end)のうち見えるものの番号を、見つけた順にvisibleへ書く(visibleはend-begin個分)
+	// 戻り値は見えた数
+	size_t Cull(const BoundingSpheres& bounds, size_t begin, size_t end, uint32_t* visible) const;
+	size_t Cull(const BoundingBoxes& bounds, size_t begin, size_t end, uint32_t* visible) const;
+
+	// jobSystemのスレッドで分けて判定し、visibleを見えるものの番号だけにする(順番は元の通り)
+	size_t Cull(CommandJobSystem& jobSystem, const BoundingSpheres& bounds, std::vector<uint32_t>& visible,
+		size_t minItemsPerJob = 16384);
+	size_t Cull(CommandJobSystem& jobSystem, const BoundingBoxes& bounds, std::vector<uint32_t>& visible,
+		size_t minItemsPerJob = 16384);
+
+private:
+	float planes[6][4];
+	std::vector<size_t> jobCounts; // ParallelForの範囲ごとに見えた数
+
+	template<class Bounds>
+	size_t CullParallel(CommandJobSystem& jobSystem, const Bounds& bounds, std::vector<uint32_t>& visible, size_t minItemsPerJob);
+};
@@ -0,0 +1,234 @@
+﻿// FrustumCullerの判定をスカラーの参照と比べ、1個あたりの時間を測る(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 [-mavx] -pthread FrustumCullerBenchmark.cpp FrustumCuller.cpp CommandJobSystem.cpp Profiler.cpp -o FrustumCullerBenchmark
+// 使い方
+//   FrustumCullerBenchmark [--threads K] [--passes P] [--counts N,N,...]
+//   先に次を確かめる
+//   ・原点の球は見え、カメラの後ろと横に離れた球は見えない
+//   ・球と箱のどちらも、見えた数がスカラーで6平面を調べた数と一致し、番号は小さい順に並ぶ
+//   ・jobSystemで分けた判定も同じ数と順番になる
+//   そのあとN個(既定100000,1000000)の球と箱をランダムに置き、球、箱、Kスレッド(既定はコア数)の球、
+//   枝分かれするスカラーの球をそれぞれP回(既定20)測って、一番速い回の1個あたりのナノ秒を出す
+//   失敗すると理由を出して1を返す
+#include "FrustumCuller.h"
+#include "CommandJobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		size_t threads = 0;
+		size_t passes = 20;
+		std::vector<size_t> counts = { 100000, 1000000 };
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--threads") { options.threads = strtoul(value, nullptr, 10); }
+			else if (arg == "--passes") { options.passes = strtoul(value, nullptr, 10); }
+			else if (arg == "--counts")
+			{
+				options.counts.clear();
+				for (const char* p = value; *p;)
+				{
+					char* end = nullptr;
+					size_t count = strtoul(p, &end, 10);
+					if (end == p || count == 0) { return false; }
+					options.counts.push_back(count);
+					p = *end == ',' ? end + 1 : end;
+				}
+			}
+			else { return false; }
+		}
+		return options.passes > 0 && !options.counts.empty();
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	void Multiply(const float a[16], const float b[16], float out[16])
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++) { sum += a[r * 4 + k] * b[k * 4 + c]; }
+				out[r * 4 + c] = sum;
+			}
+		}
+	}
+
+	// (0,100,-100)から原点を見下ろす、XMMatrixLookAtLH * XMMatrixPerspectiveFovLHと同じ行列
+	void MakeViewProjection(float out[16])
+	{
+		const float eye[3] = { 0.0f, 100.0f, -100.0f };
+		const float length = sqrtf(2.0f);
+		const float zAxis[3] = { 0.0f, -1.0f / length, 1.0f / length };
+		const float xAxis[3] = { 1.0f, 0.0f, 0.0f };
+		const float yAxis[3] = {
+			zAxis[1] * xAxis[2] - zAxis[2] * xAxis[1],
+			zAxis[2] * xAxis[0] - zAxis[0] * xAxis[2],
+			zAxis[0] * xAxis[1] - zAxis[1] * xAxis[0] };
+		auto dot = [](const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+		const float view[16] = {
+			xAxis[0], yAxis[0], zAxis[0], 0.0f,
+			xAxis[1], yAxis[1], zAxis[1], 0.0f,
+			xAxis[2], yAxis[2], zAxis[2], 0.0f,
+			-dot(xAxis, eye), -dot(yAxis, eye), -dot(zAxis, eye), 1.0f };
+		const float fovY = 0.785398163f, aspect = 1280.0f / 720.0f, nearZ = 0.1f, farZ = 1000.0f;
+		const float h = 1.0f / tanf(fovY * 0.5f);
+		const float projection[16] = {
+			h / aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, h, 0.0f, 0.0f,
+			0.0f, 0.0f, farZ / (farZ - nearZ), 1.0f,
+			0.0f, 0.0f, -nearZ * farZ / (farZ - nearZ), 0.0f };
+		Multiply(view, projection, out);
+	}
+
+	// 平面ごとの距離を素直に計算して数える(判定の参照)
+	void CountReference(const FrustumCuller& culler, const BoundingSpheres& spheres, const BoundingBoxes& boxes,
+		size_t& sphereCount, size_t& boxCount)
+	{
+		sphereCount = 0;
+		boxCount = 0;
+		for (size_t i = 0; i < spheres.Size(); i++)
+		{
+			bool sphereIn = true, boxIn = true;
+			for (size_t p = 0; p < 6; p++)
+			{
+				const float* plane = culler.GetPlane(p);
+				float distance = plane[0] * spheres.x[i] + plane[1] * spheres.y[i] + plane[2] * spheres.z[i] + plane[3];
+				float reach = fabsf(plane[0]) * boxes.extentX[i] + fabsf(plane[1]) * boxes.extentY[i] + fabsf(plane[2]) * boxes.extentZ[i];
+				if (distance < -spheres.radius[i]) { sphereIn = false; }
+				if (distance + reach < 0.0f) { boxIn = false; }
+			}
+			sphereCount += sphereIn;
+			boxCount += boxIn;
+		}
+	}
+
+	bool Ascending(const uint32_t* indices, size_t count)
+	{
+		for (size_t i = 1; i < count; i++)
+		{
+			if (indices[i] <= indices[i - 1]) { return false; }
+		}
+		return true;
+	}
+
+	// 最初に外れた平面で抜ける、SIMDにしない場合の書き方
+	size_t CullBranchy(const FrustumCuller& culler, const BoundingSpheres& spheres, uint32_t* visible)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < spheres.Size(); i++)
+		{
+			bool in = true;
+			for (size_t p = 0; p < 6 && in; p++)
+			{
+				const float* plane = culler.GetPlane(p);
+				in = plane[0] * spheres.x[i] + plane[1] * spheres.y[i] + plane[2] * spheres.z[i] + plane[3] >= -spheres.radius[i];
+			}
+			if (in) { visible[count++] = static_cast<uint32_t>(i); }
+		}
+		return count;
+	}
+
+	template<class F>
+	double BestNanoseconds(size_t passes, F&& body)
+	{
+		double best = 1e300;
+		for (size_t pass = 0; pass < passes; pass++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			body();
+			best = (std::min)(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: FrustumCullerBenchmark [--threads K] [--passes P] [--counts N,N,...]\n");
+		return 2;
+	}
+
+	float viewProjection[16];
+	MakeViewProjection(viewProjection);
+	FrustumCuller culler;
+	culler.SetViewProjection(viewProjection);
+
+	BoundingSpheres known;
+	known.Add(0.0f, 0.0f, 0.0f, 1.0f);
+	known.Add(0.0f, 100.0f, -200.0f, 1.0f);
+	known.Add(0.0f, 100.0f, -100.05f, 0.01f);
+	known.Add(5000.0f, 0.0f, 0.0f, 1.0f);
+	uint32_t knownVisible[4] = {};
+	size_t knownCount = culler.Cull(known, 0, known.Size(), knownVisible);
+	Check(knownCount == 1 && knownVisible[0] == 0, "only the sphere at the origin should be visible");
+
+	CommandJobSystem jobs(options.threads);
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> position(-1000.0f, 1000.0f), size(0.1f, 20.0f);
+	printf("lanes %zu, %zu threads\n", FrustumCuller::LANES, jobs.GetThreadCount());
+	printf("%8s %8s %8s %10s %10s %10s %10s\n", "count", "spheres", "boxes", "sphere ns", "box ns", "parallel", "branchy");
+	for (size_t count : options.counts)
+	{
+		BoundingSpheres spheres;
+		BoundingBoxes boxes;
+		for (size_t i = 0; i < count; i++)
+		{
+			float center[3] = { position(rng), position(rng) * 0.1f, position(rng) };
+			float r = size(rng);
+			float extent[3] = { r, r * 0.5f, r };
+			spheres.Add(center[0], center[1], center[2], r);
+			boxes.Add(center, extent);
+		}
+
+		size_t sphereCount = 0, boxCount = 0;
+		CountReference(culler, spheres, boxes, sphereCount, boxCount);
+		std::vector<uint32_t> visible(count), parallel;
+		size_t got = culler.Cull(spheres, 0, count, visible.data());
+		Check(got == sphereCount && Ascending(visible.data(), got), "sphere culling differs from the reference");
+		got = culler.Cull(boxes, 0, count, visible.data());
+		Check(got == boxCount && Ascending(visible.data(), got), "box culling differs from the reference");
+		got = culler.Cull(jobs, spheres, parallel, 1024);
+		Check(got == sphereCount && parallel.size() == got && Ascending(parallel.data(), got), "parallel sphere culling differs from the reference");
+		got = culler.Cull(jobs, boxes, parallel, 1024);
+		Check(got == boxCount && parallel.size() == got && Ascending(parallel.data(), got), "parallel box culling differs from the reference");
+		got = CullBranchy(culler, spheres, visible.data());
+		Check(got == sphereCount, "the branchy loop differs from the reference");
+
+		double sphereNs = BestNanoseconds(options.passes, [&] { culler.Cull(spheres, 0, count, visible.data()); });
+		double boxNs = BestNanoseconds(options.passes, [&] { culler.Cull(boxes, 0, count, visible.data()); });
+		double parallelNs = BestNanoseconds(options.passes, [&] { culler.Cull(jobs, spheres, parallel); });
+		volatile size_t sink = 0;
+		double branchyNs = BestNanoseconds(options.passes, [&] { sink = CullBranchy(culler, spheres, visible.data()); });
+		printf("%8zu %8zu %8zu %10.2f %10.2f %10.2f %10.2f\n", count, sphereCount, boxCount,
+			sphereNs / count, boxNs / count, parallelNs / count, branchyNs / count);
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
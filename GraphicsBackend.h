@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CommandJobSystem.h"
+#include "RenderGraph.h"
+#include "UploadRing.h"
+
+// パイプライン(形状を含む)、ルートシグネチャ、バッファはバックエンドの表の番号で指す
+using PipelineId = uint32_t;
+using RootSignatureId = uint32_t;
+using BufferId = uint32_t;
+
+// 描画コマンドの記録先(D3D12の実装と、Linuxでも動く記録だけの偽物を差し替えられる)
+// 引数のアドレスはGPU仮想アドレスとGPUデスクリプタハンドル(描画先だけCPUデスクリプタハンドル)
+class GraphicsCommandList :public CommandRecorder
+{
+public:
+	// RenderGraphのバリア(ResourceIdからリソースを引くのはバックエンド)
+	virtual void Barrier(const std::vector<RenderGraph::Barrier>& barriers) = 0;
+	virtual void SetRenderTarget(uint64_t cpuHandle) = 0;
+	virtual void ClearRenderTarget(uint64_t cpuHandle, const float color[4]) = 0;
+	// ビューポートとシザー矩形を同じ大きさで設定する
+	virtual void SetViewport(uint32_t width, uint32_t height) = 0;
+	virtual void SetVertexBuffer(BufferId buffer) = 0;
+	virtual void SetIndexBuffer(BufferId buffer) = 0;
+	// 変えるとルート引数は全て設定し直しになる
+	virtual void SetRootSignature(RootSignatureId rootSignature) = 0;
+	virtual void SetPipeline(PipelineId pipeline) = 0;
+	virtual void SetConstantBuffer(uint32_t rootParam, uint64_t gpu) = 0;
+	virtual void SetShaderResource(uint32_t rootParam, uint64_t gpu) = 0;
+	virtual void SetDescriptorTable(uint32_t rootParam, uint64_t gpuHandle) = 0;
+	virtual void Draw(uint32_t vertexCount, uint32_t instanceCount) = 0;
+	// startIndexはインデックスの開始位置、baseVertexは引いた番号に足す値
+	virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex) = 0;
+};
+
+// コマンドキュー、フェンス、スワップチェーンをまとめたもの
+class GraphicsQueue
+{
+public:
+	virtual ~GraphicsQueue() = default;
+	// listsを記録した順に1回で実行する
+	virtual void Submit(GraphicsCommandList* const* lists, size_t count) = 0;
+	virtual uint64_t Signal() = 0;
+	virtual uint64_t GetCompletedValue() = 0;
+	virtual void Present() = 0;
+	// 次のフレームのアロケータが空くまで待つ
+	virtual void NextFrame() = 0;
+	virtual size_t GetFrameIndex() = 0;
+};
@@ -8,6 +8,17 @@ void DirectInput::Initialize(WNDCLASSEX w)
 			IID_IDirectInput8, (void**)&input, nullptr)));
 }
 
+Keyboard::Keyboard()
+{
+	device = nullptr;
+	notify = nullptr;
+	running = false;
+}
+Keyboard::~Keyboard()
+{
+	StopEventThread();
+}
+
 void Keyboard::GetInstance(WNDCLASSEX w)
 {
 	Initialize(w);
@@ -39,4 +50,76 @@ bool Keyboard::isTrigger(const int KEY)
 {
 	return (!oldkey[KEY] && key[KEY]);
 	return false;
-}
\ No newline at end of file
+}
+
+void Keyboard::StartEventThread(InputQueue& queue, DWORD bufferSize)
+{
+	StopEventThread();
+
+	// obt@̑傫ƒʒm͎擾ĂȂԂɂݒłȂ
+	device->Unacquire();
+	DIPROPDWORD prop{};
+	prop.diph.dwSize = sizeof(DIPROPDWORD);
+	prop.diph.dwHeaderSize = sizeof(DIPROPHEADER);
+	prop.diph.dwHow = DIPH_DEVICE;
+	prop.dwData = bufferSize;
+	HRESULT result = device->SetProperty(DIPROP_BUFFERSIZE, &prop.diph);
+	assert(SUCCEEDED(result));
+	notify = CreateEvent(nullptr, false, false, nullptr);
+	assert(notify);
+	result = device->SetEventNotification(notify);
+	assert(SUCCEEDED(result));
+	device->Acquire();
+
+	running = true;
+	eventThread = std::thread([this, &queue]
+		{
+			while (running)
+			{
+				// ANeBuŎ擾łȂԂAX擾
+				WaitForSingleObject(notify, 16);
+				ReadEvents(queue);
+			}
+		});
+}
+void Keyboard::StopEventThread()
+{
+	if (!eventThread.joinable()) { return; }
+	running = false;
+	SetEvent(notify);
+	eventThread.join();
+	device->Unacquire();
+	device->SetEventNotification(nullptr);
+	CloseHandle(notify);
+	notify = nullptr;
+}
+void Keyboard::ReadEvents(InputQueue& queue)
+{
+	DIDEVICEOBJECTDATA data[64];
+	while (1)
+	{
+		DWORD count = _countof(data);
+		HRESULT result = device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), data, &count, 0);
+		if (result == DIERR_INPUTLOST || result == DIERR_NOTACQUIRED)
+		{
+			device->Acquire();
+			return;
+		}
+		if (FAILED(result)) { return; }
+
+		// dwTimeStampGetTickCount(15.6ms)Ȃ̂Ŏg킸Aǂ񂾎QueryPerformanceCounterŕt
+		// ʒm󂯂Ăǂނ̂ŁAǂ񂾎ƋN̍͒ʒm̒xꂾɂȂ
+		uint64_t now = InputQueue::Now();
+		for (DWORD i = 0; i < count; i++)
+		{
+			InputEvent event{};
+			event.timestamp = now;
+			event.key = (uint16_t)data[i].dwOfs;
+			event.type = (data[i].dwData & 0x80) ? InputEvent::KEY_DOWN : InputEvent::KEY_UP;
+			event.sequence = data[i].dwSequence;
+			queue.Push(event);
+		}
+		// obt@Ă(DI_BUFFEROVERFLOW)ǂ߂͑
+		if (count < _countof(data)) { return; }
+	}
+}
@@ -1,5 +1,8 @@
 #pragma once
 #include <dinput.h>
+#include <atomic>
+#include <thread>
+#include "InputQueue.h"
 
 class DirectInput
 {
@@ -14,10 +17,17 @@ class Keyboard :DirectInput
 private:
 	BYTE key[256];
 	BYTE oldkey[256];
+	HANDLE notify;
+	std::thread eventThread;
+	std::atomic<bool> running;
+
+	void ReadEvents(InputQueue& queue);
 
 public:
 	IDirectInputDevice8* device;
 
+	Keyboard();
+	~Keyboard();
 	void GetInstance(WNDCLASSEX w);
 	void SetDataStdFormat();
 	void SetCooperativeLevel(HWND hwnd);
@@ -25,4 +35,9 @@ public:
 	void TransferOldkey();
 	bool isInput(const int KEY);
 	bool isTrigger(const int KEY);
+
+	// A^CX^vtŃobt@ɗ߂Ă炢AʃXbhqueue֑
+	// t[ZȂ(StopEventThread܂queue𐶂Ă)
+	void StartEventThread(InputQueue& queue, DWORD bufferSize = 256);
+	void StopEventThread();
 };
@@ -0,0 +1,109 @@
+﻿#include "InputQueue.h"
+#include <chrono>
+#include <cstring>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+InputQueue::InputQueue(size_t capacity)
+{
+	size_t size = 1;
+	while (size < capacity) { size <<= 1; }
+	events.resize(size);
+	mask = size - 1;
+	head = 0;
+	tail = 0;
+	dropped = 0;
+}
+
+uint64_t InputQueue::Now()
+{
+#ifdef _WIN32
+	// 入力スレッドが読んだ時刻と同じQueryPerformanceCounterで測る
+	static const uint64_t frequency = []
+		{
+			LARGE_INTEGER f;
+			QueryPerformanceFrequency(&f);
+			return (uint64_t)f.QuadPart;
+		}();
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	uint64_t ticks = (uint64_t)counter.QuadPart;
+	return ticks / frequency * 1000000 + ticks % frequency * 1000000 / frequency;
+#else
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+bool InputQueue::Push(const InputEvent& event)
+{
+	size_t t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) > mask)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	events[t & mask] = event;
+	// 中身を書いてから位置を進める(読み手は位置を見てから中身を読む)
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+bool InputQueue::Peek(InputEvent& event) const
+{
+	size_t h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire)) { return false; }
+	event = events[h & mask];
+	return true;
+}
+bool InputQueue::Pop(InputEvent& event)
+{
+	if (!Peek(event)) { return false; }
+	head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	return true;
+}
+
+InputState::InputState()
+{
+	memset(down, 0, sizeof(down));
+	memset(pressed, 0, sizeof(pressed));
+	memset(released, 0, sizeof(released));
+	latency = {};
+}
+
+void InputState::BeginTick()
+{
+	memset(pressed, 0, sizeof(pressed));
+	memset(released, 0, sizeof(released));
+}
+void InputState::Apply(const InputEvent& event)
+{
+	if (event.key >= KEY_COUNT) { return; }
+	if (event.type == InputEvent::KEY_DOWN)
+	{
+		// キーリピートは押したことにしない
+		if (!down[event.key]) { pressed[event.key] = 1; }
+		down[event.key] = 1;
+	}
+	else
+	{
+		if (down[event.key]) { released[event.key] = 1; }
+		down[event.key] = 0;
+	}
+}
+size_t InputState::Consume(InputQueue& queue, uint64_t tickEnd, uint64_t now)
+{
+	size_t count = 0;
+	InputEvent event;
+	while (queue.Peek(event) && event.timestamp <= tickEnd)
+	{
+		queue.Pop(event);
+		Apply(event);
+		uint64_t delay = now > event.timestamp ? now - event.timestamp : 0;
+		latency.count++;
+		latency.total += delay;
+		if (latency.max < delay) { latency.max = delay; }
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 入力イベント1つ(timestampは入力が起きた時刻でInputQueue::Now()と同じ単位)
+struct InputEvent
+{
+	enum Type : uint8_t { KEY_DOWN, KEY_UP };
+
+	uint64_t timestamp;
+	uint16_t key; // DIK_*
+	Type type;
+	uint32_t sequence; // 元のデバイスの通し番号
+};
+
+// 入力スレッドが積み、シミュレーションが取り出すイベントの列(書き手1つ、読み手1つでロックしない)
+class InputQueue
+{
+public:
+	// capacityは2の累乗に切り上げる
+	InputQueue(size_t capacity = 1024);
+
+	InputQueue(const InputQueue&) = delete;
+	InputQueue& operator=(const InputQueue&) = delete;
+
+	// 単調増加する時刻(マイクロ秒、WindowsではQueryPerformanceCounter)
+	static uint64_t Now();
+
+	// 書き手だけが呼ぶ(一杯なら捨ててfalse)
+	bool Push(const InputEvent& event);
+	// 読み手だけが呼ぶ
+	bool Peek(InputEvent& event) const;
+	bool Pop(InputEvent& event);
+
+	size_t GetDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	std::vector<InputEvent> events;
+	size_t mask;
+	// 書き手と読み手が別のキャッシュラインを触るように離す
+	alignas(64) std::atomic<size_t> head; // 次に読む位置
+	alignas(64) std::atomic<size_t> tail; // 次に書く位置
+	std::atomic<size_t> dropped;
+};
+
+// シミュレーションの1tickから見たキーの状態
+// 1tickの中で押して離しても、押されたことは失われない
+class InputState
+{
+public:
+	static const size_t KEY_COUNT = 256;
+
+	// 入力が起きてからシミュレーションに反映されるまでの時間(マイクロ秒)
+	struct Latency
+	{
+		size_t count;
+		uint64_t total;
+		uint64_t max;
+	};
+
+	InputState();
+
+	// tickの始めに押した、離したの記録を消す
+	void BeginTick();
+	void Apply(const InputEvent& event);
+	// tickEndまでに起きたイベントをqueueから反映し、それより後のものは次のtickへ残す
+	// nowは反映した時刻で、遅延の計測に使う
+	size_t Consume(InputQueue& queue, uint64_t tickEnd, uint64_t now);
+
+	bool IsDown(size_t key) const { return down[key] != 0; }
+	bool IsPressed(size_t key) const { return pressed[key] != 0; } // このtickで押された
+	bool IsReleased(size_t key) const { return released[key] != 0; } // このtickで離された
+	Latency GetLatency() const { return latency; }
+
+private:
+	uint8_t down[KEY_COUNT];
+	uint8_t pressed[KEY_COUNT];
+	uint8_t released[KEY_COUNT];
+	Latency latency;
+};
@@ -0,0 +1,202 @@
+﻿// InputQueueの書き手と読み手を別スレッドで動かし、InputStateのtickへの振り分けを確かめる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread InputQueueTest.cpp InputQueue.cpp -o InputQueueTest
+// 使い方
+//   InputQueueTest [--events N] [--capacity C]
+//   ・容量は2の累乗に切り上がり、一杯ならPushがfalseを返してGetDroppedが増え、読めばまた積める
+//   ・N個(既定1000000)のイベントを容量C(既定64)の列に別スレッドから積み、
+//     捨てずに待った場合は全部が順番どおりに届き、待たずに捨てた場合も届いたものは順番どおりで、
+//     届いた数と捨てた数の合計がNになる
+//   ・1tickの中で押して離したキーは、押されたことと離されたことの両方が残る
+//   ・tickEndより後のイベントは列に残り、次のtickで反映される
+//   ・キーリピートは押したことにならず、遅延は反映した時刻との差で数える
+//   失敗すると理由を出して1を返す
+#include "InputQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace
+{
+	struct Options
+	{
+		size_t events = 1000000;
+		size_t capacity = 64;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--events") { options.events = strtoul(value, nullptr, 10); }
+			else if (arg == "--capacity") { options.capacity = strtoul(value, nullptr, 10); }
+			else { return false; }
+		}
+		return options.events > 0 && options.capacity > 0;
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	InputEvent MakeEvent(uint64_t timestamp, uint16_t key, InputEvent::Type type, uint32_t sequence)
+	{
+		InputEvent event{};
+		event.timestamp = timestamp;
+		event.key = key;
+		event.type = type;
+		event.sequence = sequence;
+		return event;
+	}
+
+	void TestFull()
+	{
+		InputQueue queue(5);
+		size_t pushed = 0;
+		while (queue.Push(MakeEvent(0, 0, InputEvent::KEY_DOWN, (uint32_t)pushed))) { pushed++; }
+		Check(pushed == 8, "the capacity should round up to a power of two");
+		Check(queue.GetDropped() == 1, "a push into a full queue should count as dropped");
+		Check(!queue.Push(MakeEvent(0, 0, InputEvent::KEY_DOWN, 99)) && queue.GetDropped() == 2, "every rejected push should be counted");
+
+		InputEvent event{};
+		Check(queue.Pop(event) && event.sequence == 0, "the oldest event should come out first");
+		Check(queue.Push(MakeEvent(0, 0, InputEvent::KEY_DOWN, 8)), "popping should make room again");
+		uint32_t expected = 1;
+		bool ordered = true;
+		while (queue.Pop(event)) { ordered = ordered && event.sequence == expected++; }
+		Check(ordered && expected == 9, "events should come out in push order across the wrap");
+		Check(!queue.Peek(event), "an empty queue should have nothing to peek");
+	}
+
+	// 書き手を別スレッドで回し、読み手は時々休んで列を一杯にさせる
+	void TestThreads(const Options& options, bool retry)
+	{
+		InputQueue queue(options.capacity);
+		std::atomic<bool> done{ false };
+		size_t rejected = 0;
+		std::thread writer([&]
+			{
+				for (uint32_t i = 0; i < options.events; i++)
+				{
+					InputEvent event = MakeEvent(i, (uint16_t)(i & 0xff), (i & 1) ? InputEvent::KEY_UP : InputEvent::KEY_DOWN, i);
+					while (!queue.Push(event))
+					{
+						rejected++;
+						if (!retry) { break; }
+						std::this_thread::yield();
+					}
+					// 捨てる方も時々譲り、届くものと捨てるものが混ざるようにする
+					if (!retry && (i & 0x1f) == 0) { std::this_thread::yield(); }
+				}
+				done = true;
+			});
+
+		size_t received = 0;
+		bool ordered = true, intact = true;
+		int64_t last = -1;
+		InputEvent event{};
+		while (true)
+		{
+			bool finished = done.load();
+			while (queue.Pop(event))
+			{
+				ordered = ordered && (int64_t)event.sequence > last;
+				intact = intact && event.timestamp == event.sequence && event.key == (event.sequence & 0xff) &&
+					event.type == ((event.sequence & 1) ? InputEvent::KEY_UP : InputEvent::KEY_DOWN);
+				last = event.sequence;
+				received++;
+				if ((received & 0xfff) == 0) { std::this_thread::sleep_for(std::chrono::microseconds(50)); }
+			}
+			if (finished) { break; }
+			std::this_thread::yield();
+		}
+		writer.join();
+
+		Check(ordered, "events should arrive in push order");
+		Check(intact, "an event arrived torn");
+		Check(queue.GetDropped() == rejected, "GetDropped should match the rejected pushes");
+		if (retry)
+		{
+			Check(received == options.events && last == (int64_t)options.events - 1, "retrying the writer should deliver every event");
+			printf("retry: %zu events through %zu slots, %zu pushes rejected and retried\n", received, options.capacity, rejected);
+		}
+		else
+		{
+			Check(received + rejected == options.events, "received and dropped events should add up to all events");
+			printf("drop:  %zu events through %zu slots, %zu received, %zu dropped\n", options.events, options.capacity, received, rejected);
+		}
+	}
+
+	void TestTicks()
+	{
+		const uint16_t KEY_A = 0x1e, KEY_D = 0x20, KEY_W = 0x11;
+		InputQueue queue;
+		InputState state;
+
+		// tick 1 [0, 100]: Aを押して離す、Dを押す(リピートが来る)
+		// tick 2 (100, 200]: Dを離す、Wを押す
+		queue.Push(MakeEvent(10, KEY_A, InputEvent::KEY_DOWN, 0));
+		queue.Push(MakeEvent(20, KEY_A, InputEvent::KEY_UP, 1));
+		queue.Push(MakeEvent(30, KEY_D, InputEvent::KEY_DOWN, 2));
+		queue.Push(MakeEvent(60, KEY_D, InputEvent::KEY_DOWN, 3));
+		queue.Push(MakeEvent(100, KEY_W, InputEvent::KEY_DOWN, 4));
+		queue.Push(MakeEvent(150, KEY_D, InputEvent::KEY_UP, 5));
+		queue.Push(MakeEvent(180, KEY_W, InputEvent::KEY_UP, 6));
+		queue.Push(MakeEvent(250, KEY_A, InputEvent::KEY_DOWN, 7));
+
+		state.BeginTick();
+		Check(state.Consume(queue, 100, 130) == 5, "the first tick should take the events up to its end");
+		Check(state.IsPressed(KEY_A) && state.IsReleased(KEY_A) && !state.IsDown(KEY_A), "a press and release inside one tick should both be seen");
+		Check(state.IsPressed(KEY_D) && state.IsDown(KEY_D) && !state.IsReleased(KEY_D), "a held key should be pressed and down");
+		Check(state.IsPressed(KEY_W) && state.IsDown(KEY_W), "an event exactly at the tick end belongs to that tick");
+		InputEvent next{};
+		Check(queue.Peek(next) && next.sequence == 5, "later events should stay in the queue");
+		InputState::Latency latency = state.GetLatency();
+		Check(latency.count == 5 && latency.total == 120 + 110 + 100 + 70 + 30 && latency.max == 120, "latency should be measured against the consume time");
+
+		// 押されたままのキーは次のtickでは押したことにならない
+		state.BeginTick();
+		Check(state.Consume(queue, 200, 200) == 2, "the second tick should take its two events");
+		Check(!state.IsPressed(KEY_D) && state.IsReleased(KEY_D) && !state.IsDown(KEY_D), "a release in a later tick should not repeat the press");
+		Check(!state.IsPressed(KEY_W) && state.IsReleased(KEY_W), "the press should not carry into the next tick");
+		Check(!state.IsPressed(KEY_A) && !state.IsReleased(KEY_A), "the previous tick's flags should be cleared");
+
+		// 何も起きないtick
+		state.BeginTick();
+		Check(state.Consume(queue, 240, 240) == 0 && queue.Peek(next) && next.sequence == 7, "an event after the tick should wait");
+		state.BeginTick();
+		Check(state.Consume(queue, 300, 300) == 1 && state.IsPressed(KEY_A), "the held-back event should apply in its own tick");
+
+		// 範囲外のキーは無視する
+		queue.Push(MakeEvent(310, 0x1ff, InputEvent::KEY_DOWN, 8));
+		state.BeginTick();
+		Check(state.Consume(queue, 400, 400) == 1, "an out-of-range key should still be consumed");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: InputQueueTest [--events N] [--capacity C]\n");
+		return 2;
+	}
+
+	TestFull();
+	TestThreads(options, true);
+	TestThreads(options, false);
+	TestTicks();
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,484 @@
+﻿#include "MeshCook.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	std::string Narrow(const std::wstring& str) { return std::string(str.begin(), str.end()); }
+
+	const char* SkipSpace(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) { p++; }
+		return p;
+	}
+
+	// strtofは終端が無いと読み過ぎるので範囲を見て自前で読む
+	bool ParseFloat(const char*& p, const char* end, float& value)
+	{
+		p = SkipSpace(p, end);
+		const char* start = p;
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) { negative = *p++ == '-'; }
+		double result = 0.0;
+		int digits = 0;
+		while (p < end && *p >= '0' && *p <= '9') { result = result * 10.0 + (*p++ - '0'); digits++; }
+		if (p < end && *p == '.')
+		{
+			p++;
+			double scale = 0.1;
+			while (p < end && *p >= '0' && *p <= '9') { result += (*p++ - '0') * scale; scale *= 0.1; digits++; }
+		}
+		if (digits == 0)
+		{
+			p = start;
+			return false;
+		}
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* e = p + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+')) { negativeExponent = *e++ == '-'; }
+			int exponent = 0;
+			bool any = false;
+			while (e < end && *e >= '0' && *e <= '9') { exponent = (std::min)(exponent * 10 + (*e++ - '0'), 400); any = true; }
+			if (any)
+			{
+				result *= pow(10.0, negativeExponent ? -exponent : exponent);
+				p = e;
+			}
+		}
+		value = (float)(negative ? -result : result);
+		return true;
+	}
+
+	bool ParseInt(const char*& p, const char* end, long long& value)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) { negative = *p++ == '-'; }
+		if (p >= end || *p < '0' || *p > '9') { return false; }
+		long long result = 0;
+		while (p < end && *p >= '0' && *p <= '9') { result = (std::min)(result * 10 + (*p++ - '0'), 1LL << 40); }
+		value = negative ? -result : result;
+		return true;
+	}
+
+	// 1から始まる番号と、末尾からの負の番号を0から始まる番号に直す
+	bool ResolveIndex(long long index, size_t count, size_t& result)
+	{
+		if (index > 0 && (size_t)index <= count) { result = (size_t)index - 1; return true; }
+		if (index < 0 && (size_t)-index <= count) { result = count - (size_t)-index; return true; }
+		return false;
+	}
+
+	struct VertexKey
+	{
+		uint32_t bits[5];
+		bool operator==(const VertexKey& other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+	};
+	struct VertexKeyHash
+	{
+		size_t operator()(const VertexKey& key) const
+		{
+			uint64_t h = 14695981039346656037ull;
+			for (uint32_t bits : key.bits) { h = (h ^ bits) * 1099511628211ull; }
+			return (size_t)h;
+		}
+	};
+
+	VertexKey MakeKey(const MeshVertex& vertex)
+	{
+		VertexKey key;
+		float values[5] = { vertex.position[0], vertex.position[1], vertex.position[2], vertex.uv[0], vertex.uv[1] };
+		for (size_t i = 0; i < 5; i++)
+		{
+			if (values[i] == 0.0f) { values[i] = 0.0f; } // -0と0は同じ頂点
+			memcpy(&key.bits[i], &values[i], sizeof(uint32_t));
+		}
+		return key;
+	}
+
+	// Forsythの頂点の点数(キャッシュの先頭ほど、残りの三角形が少ないほど高い)
+	const size_t SCORE_CACHE_SIZE = 32;
+	float VertexScore(int32_t cachePosition, uint32_t remaining)
+	{
+		if (remaining == 0) { return 0.0f; }
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// 直前の三角形の頂点は、同じ三角形を続けて使いにくくするため少し下げる
+			if (cachePosition < 3) { score = 0.75f; }
+			else { score = powf(1.0f - (cachePosition - 3) / (float)(SCORE_CACHE_SIZE - 3), 1.5f); }
+		}
+		return score + 2.0f / sqrtf((float)remaining);
+	}
+}
+
+bool ParseObj(const char* text, size_t size, MeshData& mesh)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	std::vector<MeshVertex> corners; // 多角形1つ分
+
+	const char* p = text;
+	const char* end = text + size;
+	while (p < end)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (!lineEnd) { lineEnd = end; }
+		p = SkipSpace(p, lineEnd);
+
+		if (lineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p += 2;
+			float xyz[3];
+			for (float& value : xyz)
+			{
+				if (!ParseFloat(p, lineEnd, value)) { return false; }
+			}
+			positions.insert(positions.end(), xyz, xyz + 3);
+		}
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			p += 3;
+			float uv[2] = {};
+			if (!ParseFloat(p, lineEnd, uv[0])) { return false; }
+			ParseFloat(p, lineEnd, uv[1]); // 1次元のテクスチャ座標もある
+			uvs.insert(uvs.end(), uv, uv + 2);
+		}
+		else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p += 2;
+			corners.clear();
+			while ((p = SkipSpace(p, lineEnd)) < lineEnd)
+			{
+				long long position = 0, uv = 0;
+				if (!ParseInt(p, lineEnd, position)) { return false; }
+				bool hasUv = false;
+				if (p < lineEnd && *p == '/')
+				{
+					p++;
+					hasUv = ParseInt(p, lineEnd, uv);
+					// 法線は使わない
+					if (p < lineEnd && *p == '/')
+					{
+						p++;
+						long long normal;
+						ParseInt(p, lineEnd, normal);
+					}
+				}
+
+				size_t positionIndex, uvIndex = 0;
+				if (!ResolveIndex(position, positions.size() / 3, positionIndex)) { return false; }
+				if (hasUv && !ResolveIndex(uv, uvs.size() / 2, uvIndex)) { return false; }
+
+				MeshVertex vertex;
+				vertex.position[0] = positions[positionIndex * 3];
+				vertex.position[1] = positions[positionIndex * 3 + 1];
+				vertex.position[2] = -positions[positionIndex * 3 + 2];
+				vertex.uv[0] = hasUv ? uvs[uvIndex * 2] : 0.0f;
+				vertex.uv[1] = hasUv ? 1.0f - uvs[uvIndex * 2 + 1] : 0.0f;
+				corners.push_back(vertex);
+			}
+			for (size_t i = 1; i + 1 < corners.size(); i++)
+			{
+				// zを反転したので巻きも逆にする
+				const MeshVertex* triangle[3] = { &corners[0], &corners[i + 1], &corners[i] };
+				for (const MeshVertex* vertex : triangle)
+				{
+					mesh.indices.push_back((uint32_t)mesh.vertices.size());
+					mesh.vertices.push_back(*vertex);
+				}
+			}
+		}
+		p = lineEnd + 1;
+	}
+	return true;
+}
+
+bool LoadObj(const std::wstring& path, MeshData& mesh)
+{
+#ifdef _WIN32
+	FILE* fp = nullptr;
+	if (_wfopen_s(&fp, path.c_str(), L"rb") != 0) { fp = nullptr; }
+#else
+	FILE* fp = fopen(Narrow(path).c_str(), "rb");
+#endif
+	if (!fp) { return false; }
+	std::string text;
+	char buffer[64 * 1024];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0) { text.append(buffer, read); }
+	fclose(fp);
+	return ParseObj(text.data(), text.size(), mesh);
+}
+
+size_t WeldVertices(MeshData& mesh)
+{
+	std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
+	unique.reserve(mesh.vertices.size());
+	std::vector<uint32_t> remap(mesh.vertices.size());
+	std::vector<MeshVertex> welded;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		auto inserted = unique.emplace(MakeKey(mesh.vertices[i]), (uint32_t)welded.size());
+		if (inserted.second) { welded.push_back(mesh.vertices[i]); }
+		remap[i] = inserted.first->second;
+	}
+	for (uint32_t& index : mesh.indices) { index = remap[index]; }
+	mesh.vertices.swap(welded);
+	return mesh.vertices.size();
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) { return; }
+
+	// 頂点ごとに、まだ出していない三角形の一覧
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) { remaining[indices[i]]++; }
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) { offsets[v + 1] = offsets[v] + remaining[v]; }
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++) { adjacency[fill[indices[i]]++] = (uint32_t)(i / 3); }
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) { vertexScore[v] = VertexScore(-1, remaining[v]); }
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+	std::vector<uint8_t> emitted(triangleCount, 0);
+
+	uint32_t cache[SCORE_CACHE_SIZE + 3];
+	size_t cacheCount = 0;
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	size_t cursor = 0;
+	size_t best = SIZE_MAX;
+	for (size_t n = 0; n < triangleCount; n++)
+	{
+		// キャッシュの頂点に候補が無ければ、入力の順で次の三角形から始め直す
+		if (best == SIZE_MAX)
+		{
+			while (emitted[cursor]) { cursor++; }
+			best = cursor;
+		}
+		const uint32_t triangle[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+		emitted[best] = 1;
+		result.insert(result.end(), triangle, triangle + 3);
+
+		for (uint32_t v : triangle)
+		{
+			uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t i = 0; i < remaining[v]; i++)
+			{
+				if (list[i] != best) { continue; }
+				list[i] = list[remaining[v] - 1];
+				break;
+			}
+			remaining[v]--;
+		}
+
+		// 使った頂点を先頭に入れ、押し出されたものはキャッシュから外す
+		uint32_t next[SCORE_CACHE_SIZE + 3];
+		size_t nextCount = 0;
+		for (size_t k = 0; k < 3; k++)
+		{
+			if (std::find(next, next + nextCount, triangle[k]) == next + nextCount) { next[nextCount++] = triangle[k]; }
+		}
+		for (size_t i = 0; i < cacheCount; i++)
+		{
+			if (std::find(triangle, triangle + 3, cache[i]) == triangle + 3) { next[nextCount++] = cache[i]; }
+		}
+		for (size_t i = 0; i < nextCount; i++) { cachePosition[next[i]] = i < SCORE_CACHE_SIZE ? (int32_t)i : -1; }
+
+		// 点数が変わった頂点の三角形だけを直し、その中から次を選ぶ
+		for (size_t i = 0; i < nextCount; i++)
+		{
+			uint32_t v = next[i];
+			float score = VertexScore(cachePosition[v], remaining[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+			for (uint32_t j = 0; j < remaining[v]; j++) { triangleScore[adjacency[offsets[v] + j]] += delta; }
+		}
+		best = SIZE_MAX;
+		float bestScore = -1.0f;
+		cacheCount = (std::min)(nextCount, SCORE_CACHE_SIZE);
+		for (size_t i = 0; i < cacheCount; i++)
+		{
+			uint32_t v = next[i];
+			cache[i] = v;
+			for (uint32_t j = 0; j < remaining[v]; j++)
+			{
+				uint32_t t = adjacency[offsets[v] + j];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+	}
+	std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void OptimizeVertexFetch(MeshData& mesh)
+{
+	std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+	std::vector<MeshVertex> ordered;
+	ordered.reserve(mesh.vertices.size());
+	for (uint32_t& index : mesh.indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = (uint32_t)ordered.size();
+			ordered.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh.vertices.swap(ordered);
+}
+
+double ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) { return 0.0; }
+
+	// 入った時刻を覚えておき、cacheSize回より前に入ったものは押し出されたとみなす
+	std::vector<size_t> timestamps(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	size_t misses = 0;
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		uint32_t index = indices[i];
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			misses++;
+		}
+	}
+	return (double)misses / triangleCount;
+}
+
+float QuantizeVertices(const std::vector<MeshVertex>& vertices, std::vector<PackedVertex>& packed,
+	MeshQuantization& quantization)
+{
+	float minimum[3] = { 0.0f, 0.0f, 0.0f };
+	float maximum[3] = { 0.0f, 0.0f, 0.0f };
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			float value = vertices[i].position[axis];
+			minimum[axis] = i == 0 ? value : (std::min)(minimum[axis], value);
+			maximum[axis] = i == 0 ? value : (std::max)(maximum[axis], value);
+		}
+	}
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		quantization.offset[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+		quantization.scale[axis] = (maximum[axis] - minimum[axis]) * 0.5f;
+	}
+
+	float maxError = 0.0f;
+	packed.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			float scale = quantization.scale[axis];
+			float normalized = scale > 0.0f ? (vertices[i].position[axis] - quantization.offset[axis]) / scale : 0.0f;
+			normalized = (std::min)((std::max)(normalized, -1.0f), 1.0f);
+			packed[i].position[axis] = (int16_t)lroundf(normalized * 32767.0f);
+			float restored = packed[i].position[axis] / 32767.0f * scale + quantization.offset[axis];
+			maxError = (std::max)(maxError, fabsf(restored - vertices[i].position[axis]));
+		}
+		packed[i].position[3] = 32767;
+		packed[i].uv[0] = FloatToHalf(vertices[i].uv[0]);
+		packed[i].uv[1] = FloatToHalf(vertices[i].uv[1]);
+	}
+	return maxError;
+}
+
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+	if (exponent == 0xff) { return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0)); }
+
+	// 丸めは最近接偶数
+	int32_t halfExponent = (int32_t)exponent - 127 + 15;
+	if (halfExponent >= 31) { return (uint16_t)(sign | 0x7c00); }
+	if (halfExponent <= 0)
+	{
+		// 非正規化数
+		if (halfExponent < -10) { return (uint16_t)sign; }
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) { half++; }
+		return (uint16_t)(sign | half);
+	}
+	uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) { half++; } // 繰り上がりで指数が増えても正しい
+	return (uint16_t)(sign | half);
+}
+
+float HalfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	uint32_t bits;
+	if (exponent == 0x1f) { bits = sign | 0x7f800000 | (mantissa << 13); }
+	else if (exponent != 0) { bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13); }
+	else if (mantissa == 0) { bits = sign; }
+	else
+	{
+		// 非正規化数は正規化し直す
+		exponent = 127 - 15 + 1;
+		while (!(mantissa & 0x400))
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+	}
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void CookMesh(MeshData& mesh, MeshCookStats* stats, size_t cacheSize)
+{
+	size_t inputVertices = mesh.vertices.size();
+	WeldVertices(mesh);
+	double acmrBefore = ComputeACMR(mesh.indices, mesh.vertices.size(), cacheSize);
+	OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+	OptimizeVertexFetch(mesh);
+	if (stats)
+	{
+		stats->inputVertices = inputVertices;
+		stats->vertices = mesh.vertices.size();
+		stats->triangles = mesh.indices.size() / 3;
+		stats->acmrBefore = acmrBefore;
+		stats->acmrAfter = ComputeACMR(mesh.indices, mesh.vertices.size(), cacheSize);
+	}
+}
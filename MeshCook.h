@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// メッシュを読み込んで描画しやすい形に直す(実行時ではなく事前に行う、Windowsも要らない)
+//   溶接 -> 頂点キャッシュに合わせた三角形の並べ替え -> 頂点を使う順に並べ替え -> (量子化してMeshFileに書く)
+
+// VertexBuf::Vertexと同じ並び(20バイト)
+struct MeshVertex
+{
+	float position[3];
+	float uv[2];
+};
+
+// 量子化した頂点(12バイト)
+// positionはバウンディングボックスで正規化したsnorm16でwは1.0、uvはhalf
+// DXGI_FORMAT_R16G16B16A16_SNORMとDXGI_FORMAT_R16G16_FLOATで読み、MeshQuantizationの拡大と平行移動をワールド行列に掛ける
+struct PackedVertex
+{
+	int16_t position[4];
+	uint16_t uv[2];
+};
+
+// position = packed / 32767 * scale + offset
+struct MeshQuantization
+{
+	float scale[3];
+	float offset[3];
+};
+
+struct MeshData
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices; // 三角形リスト
+};
+
+// Wavefront OBJのv、vt、fだけを読む(法線、マテリアル、グループは読み飛ばす)
+// 多角形は扇形に分け、右手系を左手系に直す(zを反転して巻きを逆にする)、vは上下を反転する
+// 頂点は三角形の角ごとに作るので、WeldVerticesでまとめる
+bool ParseObj(const char* text, size_t size, MeshData& mesh);
+bool LoadObj(const std::wstring& path, MeshData& mesh);
+
+// 値が全く同じ頂点をまとめる(まとめた後の頂点数を返す)
+size_t WeldVertices(MeshData& mesh);
+// 変換後の頂点キャッシュに当たりやすいよう三角形を並べ替える(Tom Forsythの線形時間のアルゴリズム)
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+// 頂点をインデックスで最初に使われる順に並べ替える(使われない頂点は捨てる)
+void OptimizeVertexFetch(MeshData& mesh);
+// 三角形あたりに頂点シェーダが動く回数(FIFOのキャッシュで数える、最良で0.5くらい、最悪で3)
+double ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = 16);
+
+// 戻り値は最大の誤差(ワールド座標)
+float QuantizeVertices(const std::vector<MeshVertex>& vertices, std::vector<PackedVertex>& packed,
+	MeshQuantization& quantization);
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+struct MeshCookStats
+{
+	size_t inputVertices; // 溶接前(三角形の角の数)
+	size_t vertices;
+	size_t triangles;
+	double acmrBefore; // 溶接した後、並べ替える前
+	double acmrAfter;
+};
+
+// 溶接、キャッシュ、フェッチの順に直す(ACMRはcacheSizeのFIFOで数える)
+void CookMesh(MeshData& mesh, MeshCookStats* stats = nullptr, size_t cacheSize = 16);
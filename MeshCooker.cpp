@@ -0,0 +1,425 @@
+﻿// OBJを読み込み、溶接、キャッシュとフェッチの並べ替え、量子化をしてMeshFileに書き出す
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread MeshCooker.cpp MeshCook.cpp MeshFile.cpp Meshlet.cpp MeshLod.cpp FrustumCuller.cpp
+//       CommandJobSystem.cpp Profiler.cpp -o MeshCooker
+// 使い方
+//   MeshCooker [--quantize] [--meshlets] [--lods] [--cache N] [-o DIR] [input.obj ...]
+//   出力はinput.meshで、-oがあればDIRに書く
+//   入力が無ければ組み込みのテスト用メッシュ(球、トーラス、格子と、三角形の順を混ぜたもの)で報告だけする
+//   ACMRはFIFOでNエントリのキャッシュ(既定16)で数える
+//   --meshletsはメッシュレットも作って書き、作ったものの質と、周りから見た時のクラスタカリングの速さを出す
+//   --lodsは1/2から1/16までのLODも作って書き、簡略化の速さと、main.cppと同じ射影で並べた場面で減った三角形を出す
+#include "MeshCook.h"
+#include "MeshFile.h"
+#include "Meshlet.h"
+#include "MeshLod.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		bool quantize = false;
+		bool meshlets = false;
+		bool lods = false;
+		size_t cacheSize = 16;
+		std::string outputDirectory;
+		std::vector<std::string> inputs;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (arg == "--quantize") { options.quantize = true; }
+			else if (arg == "--meshlets") { options.meshlets = true; }
+			else if (arg == "--lods") { options.lods = true; }
+			else if (arg == "--cache" && i + 1 < argc) { options.cacheSize = strtoul(argv[++i], nullptr, 10); }
+			else if (arg == "-o" && i + 1 < argc) { options.outputDirectory = argv[++i]; }
+			else if (!arg.empty() && arg[0] == '-') { return false; }
+			else { options.inputs.push_back(arg); }
+		}
+		return options.cacheSize > 0;
+	}
+
+	std::wstring Widen(const std::string& str) { return std::wstring(str.begin(), str.end()); }
+
+	// テスト用のOBJ(縦横にsegments分割し、継ぎ目のuvは別の頂点にする)
+	std::string MakeObj(const char* shape, int columns, int rows, bool shuffle)
+	{
+		const float PI = 3.14159265f;
+		std::string obj;
+		char line[128];
+		for (int y = 0; y <= rows; y++)
+		{
+			for (int x = 0; x <= columns; x++)
+			{
+				float u = (float)x / columns, v = (float)y / rows;
+				float px, py, pz;
+				if (shape[0] == 's') // 球
+				{
+					float theta = u * 2.0f * PI, phi = v * PI;
+					px = sinf(phi) * cosf(theta);
+					py = cosf(phi);
+					pz = sinf(phi) * sinf(theta);
+				}
+				else if (shape[0] == 't') // トーラス
+				{
+					float theta = u * 2.0f * PI, phi = v * 2.0f * PI;
+					px = (1.0f + 0.3f * cosf(phi)) * cosf(theta);
+					py = 0.3f * sinf(phi);
+					pz = (1.0f + 0.3f * cosf(phi)) * sinf(theta);
+				}
+				else // 格子
+				{
+					px = u * 2.0f - 1.0f;
+					py = 0.05f * sinf(u * 20.0f) * cosf(v * 20.0f);
+					pz = v * 2.0f - 1.0f;
+				}
+				snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\n", px, py, pz, u, 1.0f - v);
+				obj += line;
+			}
+		}
+
+		// 格子は四角形のまま書き、扇形の分割も通す
+		std::vector<std::string> faces;
+		for (int y = 0; y < rows; y++)
+		{
+			for (int x = 0; x < columns; x++)
+			{
+				int a = y * (columns + 1) + x + 1, b = a + 1, c = a + columns + 1, d = c + 1;
+				if (shape[0] == 'g')
+				{
+					snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n", a, a, c, c, d, d, b, b);
+					faces.push_back(line);
+					continue;
+				}
+				snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d\n", a, a, c, c, b, b);
+				faces.push_back(line);
+				snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d\n", b, b, c, c, d, d);
+				faces.push_back(line);
+			}
+		}
+		// 書き出したツールによっては三角形の順がばらばらになる
+		if (shuffle) { std::shuffle(faces.begin(), faces.end(), std::mt19937(1)); }
+		for (const std::string& face : faces) { obj += face; }
+		return obj;
+	}
+
+	// 行ベクトルの行列(DirectXMathのXMMatrixLookAtLH、XMMatrixPerspectiveFovLHと同じ)
+	void LookAt(const float eye[3], const float target[3], float m[16])
+	{
+		float z[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+		float length = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+		for (float& value : z) { value /= length; }
+		// 真上や真下を見ないようにupはzに合わせて選ぶ
+		float up[3] = { 0.0f, 1.0f, 0.0f };
+		if (fabsf(z[1]) > 0.99f) { up[1] = 0.0f; up[2] = 1.0f; }
+		float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+		length = sqrtf(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+		for (float& value : x) { value /= length; }
+		float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+		float result[16] =
+		{
+			x[0], y[0], z[0], 0.0f,
+			x[1], y[1], z[1], 0.0f,
+			x[2], y[2], z[2], 0.0f,
+			-(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]),
+			-(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]),
+			-(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1.0f,
+		};
+		memcpy(m, result, sizeof(result));
+	}
+	void Perspective(float fovY, float aspect, float nearZ, float farZ, float m[16])
+	{
+		float h = 1.0f / tanf(fovY * 0.5f), w = h / aspect, range = farZ / (farZ - nearZ);
+		float result[16] = { w, 0, 0, 0, 0, h, 0, 0, 0, 0, range, 1, 0, 0, -range * nearZ, 0 };
+		memcpy(m, result, sizeof(result));
+	}
+	void Multiply(const float a[16], const float b[16], float m[16])
+	{
+		for (size_t r = 0; r < 4; r++)
+		{
+			for (size_t c = 0; c < 4; c++)
+			{
+				m[r * 4 + c] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] + a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c];
+			}
+		}
+	}
+
+	// 周りを回る視点(全体が見える距離と、はみ出す距離を半分ずつ)からカリングし、速さと消えた割合を出す
+	void ReportClusterCulling(const MeshFile& file, const MeshData& mesh)
+	{
+		float minimum[3], maximum[3];
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				float value = mesh.vertices[i].position[axis];
+				minimum[axis] = i == 0 ? value : (std::min)(minimum[axis], value);
+				maximum[axis] = i == 0 ? value : (std::max)(maximum[axis], value);
+			}
+		}
+		float center[3], radius = 0.0f;
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+			radius += (maximum[axis] - center[axis]) * (maximum[axis] - center[axis]);
+		}
+		radius = sqrtf(radius);
+
+		ClusterCuller culler;
+		culler.SetMeshlets(file.GetMeshlets(), file.GetMeshletBounds(), file.GetMeshletCount());
+		const size_t VIEW_COUNT = 256;
+		std::vector<FrustumCuller> frustums(VIEW_COUNT);
+		std::vector<float> cameras(VIEW_COUNT * 3);
+		float projection[16];
+		Perspective(45.0f * 3.14159265f / 180.0f, 16.0f / 9.0f, radius * 0.01f, radius * 10.0f, projection);
+		for (size_t v = 0; v < VIEW_COUNT; v++)
+		{
+			float distance = radius * (v % 2 ? 1.3f : 3.0f);
+			float yaw = v * 2.399963f, pitch = sinf(v * 0.7f) * 1.2f; // 黄金角で散らす
+			float* eye = &cameras[v * 3];
+			eye[0] = center[0] + distance * cosf(pitch) * sinf(yaw);
+			eye[1] = center[1] + distance * sinf(pitch);
+			eye[2] = center[2] + distance * cosf(pitch) * cosf(yaw);
+			float view[16], viewProjection[16];
+			LookAt(eye, center, view);
+			Multiply(view, projection, viewProjection);
+			frustums[v].SetViewProjection(viewProjection);
+		}
+
+		std::vector<ClusterDraw> draws;
+		size_t tested = 0, frustumCulled = 0, backfaceCulled = 0, triangles = 0, drawCount = 0, rounds = 0;
+		auto start = std::chrono::steady_clock::now();
+		double elapsed = 0.0;
+		while (elapsed < 50.0 || rounds == 0)
+		{
+			for (size_t v = 0; v < VIEW_COUNT; v++)
+			{
+				culler.Cull(frustums[v], &cameras[v * 3], draws);
+				ClusterCuller::Stats stats = culler.GetStats();
+				tested += stats.tested;
+				frustumCulled += stats.frustumCulled;
+				backfaceCulled += stats.backfaceCulled;
+				triangles += stats.triangles;
+				drawCount += draws.size();
+			}
+			rounds++;
+			elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		size_t views = VIEW_COUNT * rounds;
+		size_t totalTriangles = file.GetIndexCount() / 3 * views;
+		printf("  cull: %.1f Mclusters/s (%.1f ns/cluster)  frustum %.1f%%  backface %.1f%%  triangles kept %.1f%%  draws/view %.1f\n",
+			tested / elapsed / 1000.0, elapsed * 1e6 / (std::max)(tested, size_t(1)),
+			100.0 * frustumCulled / (std::max)(tested, size_t(1)), 100.0 * backfaceCulled / (std::max)(tested, size_t(1)),
+			100.0 * triangles / (std::max)(totalTriangles, size_t(1)), (double)drawCount / views);
+	}
+
+	// 距離を対数で散らして同じメッシュを並べ、1ピクセルの誤差で選んだLODの三角形を数える
+	void ReportLodScene(const MeshFile& file, float radius)
+	{
+		// main.cppの射影(縦45度、1280x720)
+		LodSelector selector;
+		selector.SetProjection(45.0f * 3.14159265f / 180.0f, 720.0f);
+		selector.SetThreshold(1.0f);
+
+		const size_t INSTANCE_COUNT = 1000;
+		const float NEAREST = 2.0f, FARTHEST = 200.0f; // 半径の何倍か
+		std::vector<MeshLod> lods(file.GetLodCount());
+		for (size_t i = 0; i < lods.size(); i++) { lods[i] = file.GetLod(i); }
+		std::vector<size_t> histogram(lods.size(), 0);
+		size_t full = 0, drawn = 0;
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> distribution(logf(NEAREST), logf(FARTHEST));
+		for (size_t i = 0; i < INSTANCE_COUNT; i++)
+		{
+			float distance = expf(distribution(random)) * radius;
+			size_t lod = selector.Select(lods.data(), lods.size(), 1.0f, distance, radius);
+			histogram[lod]++;
+			full += lods[0].indexCount / 3;
+			drawn += lods[lod].indexCount / 3;
+		}
+		printf("  scene: %zu instances at %.0f-%.0fx radius, 1 px: triangles %zu -> %zu (%.1f%% saved)  lod use",
+			INSTANCE_COUNT, NEAREST, FARTHEST, full, drawn, 100.0 - 100.0 * drawn / (std::max)(full, size_t(1)));
+		for (size_t count : histogram) { printf(" %zu", count); }
+		printf("\n");
+	}
+
+	float BoundingRadius(const MeshData& mesh)
+	{
+		float minimum[3], maximum[3];
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				float value = mesh.vertices[i].position[axis];
+				minimum[axis] = i == 0 ? value : (std::min)(minimum[axis], value);
+				maximum[axis] = i == 0 ? value : (std::max)(maximum[axis], value);
+			}
+		}
+		float radius = 0.0f;
+		for (size_t axis = 0; axis < 3 && !mesh.vertices.empty(); axis++)
+		{
+			radius += (maximum[axis] - minimum[axis]) * (maximum[axis] - minimum[axis]) * 0.25f;
+		}
+		return sqrtf(radius);
+	}
+
+	std::string OutputPath(const Options& options, const std::string& input)
+	{
+		std::string name = input;
+		size_t dot = name.find_last_of('.');
+		size_t slash = name.find_last_of("/\\");
+		if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) { name.resize(dot); }
+		if (!options.outputDirectory.empty())
+		{
+			name = options.outputDirectory + "/" + (slash == std::string::npos ? name : name.substr(slash + 1));
+		}
+		return name + ".mesh";
+	}
+
+	// 直す前は溶接したfloatの頂点と32ビットのインデックス
+	bool Cook(const Options& options, const std::string& name, MeshData& mesh, const std::string& outputPath)
+	{
+		size_t triangles = mesh.indices.size() / 3;
+		auto start = std::chrono::steady_clock::now();
+		MeshCookStats stats{};
+		CookMesh(mesh, &stats, options.cacheSize);
+		double cookMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// メッシュレットの順にインデックスを並べ直す(中は近い三角形なのでキャッシュの効きはほぼ変わらない)
+		MeshletData meshlets;
+		double buildMs = 0.0;
+		if (options.meshlets)
+		{
+			auto buildStart = std::chrono::steady_clock::now();
+			BuildMeshlets(mesh, meshlets);
+			buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+			mesh.indices = BuildMeshletIndices(meshlets);
+		}
+
+		// LODは頂点を共有し、インデックスだけを持つ
+		std::vector<MeshLod> lods;
+		std::vector<uint32_t> lodIndices;
+		double lodMs = 0.0;
+		if (options.lods)
+		{
+			const float RATIOS[] = { 1.0f / 2, 1.0f / 4, 1.0f / 8, 1.0f / 16 };
+			auto lodStart = std::chrono::steady_clock::now();
+			BuildLodChain(mesh, RATIOS, sizeof(RATIOS) / sizeof(RATIOS[0]), lods, lodIndices);
+			lodMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lodStart).count();
+		}
+
+		MeshFileWriter writer;
+		float maxError = writer.SetMesh(mesh, options.quantize);
+		if (options.meshlets) { writer.SetMeshlets(meshlets); }
+		if (options.lods) { writer.SetLods(lods, lodIndices); }
+		std::vector<uint8_t> bytes = writer.Serialize();
+
+		// 書いたものを読み戻して同じか確かめる
+		MeshFile file;
+		if (!file.Load(bytes) || file.GetVertexCount() != mesh.vertices.size() || file.GetIndexCount() != mesh.indices.size()
+			|| file.GetMeshletCount() != meshlets.meshlets.size() || (options.lods && file.GetLodCount() != lods.size()))
+		{
+			fprintf(stderr, "%s: round trip failed\n", name.c_str());
+			return false;
+		}
+		if (!outputPath.empty() && !writer.Save(Widen(outputPath)))
+		{
+			fprintf(stderr, "%s: cannot write %s\n", name.c_str(), outputPath.c_str());
+			return false;
+		}
+
+		// 前はOBJのまま(三角形の角ごとの頂点と32ビットのインデックス)、後は書いたファイルの基本のメッシュ
+		double vertexKbBefore = stats.inputVertices * sizeof(MeshVertex) / 1024.0;
+		double indexKbBefore = triangles * 3 * sizeof(uint32_t) / 1024.0;
+		double vertexKbAfter = (double)file.GetVertexCount() * file.GetVertexStride() / 1024.0;
+		double indexKbAfter = (double)file.GetIndexCount() * file.GetIndexSize() / 1024.0;
+		printf("%-16s tris %7zu verts %7zu -> %7zu  acmr %.3f -> %.3f  stride %zu -> %u  vertex KB %.1f -> %.1f  index KB %.1f -> %.1f"
+			"  cook %.1f ms (%.1f Mtri/s)",
+			name.c_str(), triangles, stats.inputVertices, stats.vertices, stats.acmrBefore, stats.acmrAfter,
+			sizeof(MeshVertex), file.GetVertexStride(), vertexKbBefore, vertexKbAfter, indexKbBefore, indexKbAfter, cookMs,
+			cookMs > 0.0 ? triangles / cookMs / 1000.0 : 0.0);
+		if (options.quantize) { printf("  max error %.2e", maxError); }
+		printf("\n");
+		if (options.meshlets)
+		{
+			MeshletStats meshletStats = ComputeMeshletStats(meshlets);
+			printf("  meshlets %zu  verts %.1f (%.0f%%)  tris %.1f (%.0f%%)  vertex redundancy %.2f  no cone %zu  acmr %.3f  build %.1f ms (%.1f Mtri/s)\n",
+				meshletStats.meshletCount, meshletStats.averageVertices, meshletStats.vertexFill * 100.0,
+				meshletStats.averageTriangles, meshletStats.triangleFill * 100.0, meshletStats.vertexRedundancy,
+				meshletStats.degenerateCones, ComputeACMR(mesh.indices, mesh.vertices.size(), options.cacheSize), buildMs,
+				buildMs > 0.0 ? triangles / buildMs / 1000.0 : 0.0);
+			ReportClusterCulling(file, mesh);
+		}
+		if (options.lods)
+		{
+			// 速さは入力の三角形で数える(各LODは1つ前から作る)
+			size_t simplified = 0;
+			for (size_t i = 0; i + 1 < lods.size(); i++) { simplified += lods[i].indexCount / 3; }
+			float radius = BoundingRadius(mesh);
+			printf("  lods %zu  simplify %.1f ms (%.2f Mtri/s)  tris/error(radius):", lods.size(), lodMs,
+				lodMs > 0.0 ? simplified / lodMs / 1000.0 : 0.0);
+			for (const MeshLod& lod : lods) { printf(" %u/%.4f", lod.indexCount / 3, radius > 0.0f ? lod.error / radius : 0.0f); }
+			printf("\n");
+			ReportLodScene(file, radius);
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: MeshCooker [--quantize] [--meshlets] [--lods] [--cache N] [-o DIR] [input.obj ...]\n");
+		return 2;
+	}
+
+	bool failed = false;
+	if (options.inputs.empty())
+	{
+		struct Corpus { const char* name; const char* shape; int columns, rows; bool shuffle; };
+		const Corpus CORPUS[] =
+		{
+			{ "sphere", "sphere", 128, 64, false },
+			{ "torus", "torus", 192, 96, false },
+			{ "grid", "grid", 256, 256, false },
+			{ "sphere_shuffled", "sphere", 128, 64, true },
+			{ "torus_shuffled", "torus", 192, 96, true },
+			{ "grid_shuffled", "grid", 256, 256, true },
+		};
+		for (const Corpus& corpus : CORPUS)
+		{
+			std::string obj = MakeObj(corpus.shape, corpus.columns, corpus.rows, corpus.shuffle);
+			MeshData mesh;
+			if (!ParseObj(obj.data(), obj.size(), mesh)) { return 2; }
+			failed |= !Cook(options, corpus.name, mesh, "");
+		}
+		return failed ? 1 : 0;
+	}
+
+	for (const std::string& input : options.inputs)
+	{
+		MeshData mesh;
+		if (!LoadObj(Widen(input), mesh))
+		{
+			fprintf(stderr, "%s: cannot read\n", input.c_str());
+			failed = true;
+			continue;
+		}
+		failed |= !Cook(options, input, mesh, OutputPath(options, input));
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,351 @@
+﻿#include "MeshFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const size_t HEADER_SIZE = 16;
+	const size_t ENTRY_SIZE = 24;
+	const size_t CHUNK_ALIGNMENT = 16;
+
+	std::string Narrow(const std::wstring& str) { return std::string(str.begin(), str.end()); }
+
+	uint64_t Read(const uint8_t* p, size_t size)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < size; i++) { value |= (uint64_t)p[i] << (i * 8); }
+		return value;
+	}
+	void Write32(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (size_t i = 0; i < 4; i++) { out.push_back((uint8_t)(value >> (i * 8))); }
+	}
+	void Write64(std::vector<uint8_t>& out, uint64_t value)
+	{
+		for (size_t i = 0; i < 8; i++) { out.push_back((uint8_t)(value >> (i * 8))); }
+	}
+}
+
+bool MeshFile::Load(const std::wstring& path)
+{
+#ifdef _WIN32
+	FILE* fp = nullptr;
+	if (_wfopen_s(&fp, path.c_str(), L"rb") != 0) { fp = nullptr; }
+#else
+	FILE* fp = fopen(Narrow(path).c_str(), "rb");
+#endif
+	if (!fp) { return false; }
+	// 大きさを見てから1回で読む
+	std::vector<uint8_t> bytes;
+	bool ok = fseek(fp, 0, SEEK_END) == 0;
+	long size = ok ? ftell(fp) : -1;
+	ok = size > 0 && fseek(fp, 0, SEEK_SET) == 0;
+	if (ok)
+	{
+		bytes.resize((size_t)size);
+		ok = fread(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+	}
+	fclose(fp);
+	return ok && Load(std::move(bytes));
+}
+
+bool MeshFile::Load(std::vector<uint8_t> bytes)
+{
+	data = std::move(bytes);
+	flags = 0;
+	chunkCount = 0;
+	vertices = nullptr;
+	vertexCount = 0;
+	indices = nullptr;
+	indexCount = 0;
+	quantization = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	meshlets = nullptr;
+	meshletBounds = nullptr;
+	meshletCount = 0;
+	lods = nullptr;
+	lodCount = 0;
+	lodIndices = nullptr;
+
+	// 目次が全て範囲内か確かめる
+	bool ok = data.size() >= HEADER_SIZE && Read(data.data(), 4) == MAGIC && Read(data.data() + 4, 4) == VERSION;
+	if (ok)
+	{
+		flags = (uint32_t)Read(data.data() + 8, 4);
+		chunkCount = (size_t)Read(data.data() + 12, 4);
+		ok = chunkCount <= (data.size() - HEADER_SIZE) / ENTRY_SIZE;
+	}
+	for (size_t i = 0; ok && i < chunkCount; i++)
+	{
+		const uint8_t* entry = data.data() + HEADER_SIZE + ENTRY_SIZE * i;
+		uint64_t offset = Read(entry + 8, 8);
+		uint64_t size = Read(entry + 16, 8);
+		ok = offset <= data.size() && size <= data.size() - offset && offset % CHUNK_ALIGNMENT == 0;
+	}
+
+	size_t size = 0;
+	if (ok && FindChunk(CHUNK_VERTICES, vertices, size))
+	{
+		ok = size % GetVertexStride() == 0;
+		vertexCount = size / GetVertexStride();
+	}
+	if (ok && FindChunk(CHUNK_INDICES, indices, size))
+	{
+		ok = size % (GetIndexSize() * 3) == 0;
+		indexCount = size / GetIndexSize();
+	}
+	if (ok && (flags & QUANTIZED))
+	{
+		const void* chunk = nullptr;
+		ok = FindChunk(CHUNK_QUANTIZATION, chunk, size) && size == sizeof(MeshQuantization);
+		if (ok) { memcpy(&quantization, chunk, sizeof(quantization)); }
+	}
+	// インデックスが頂点の範囲を超えていないか
+	for (size_t i = 0; ok && i < indexCount; i++)
+	{
+		uint32_t index = (flags & INDEX32) ? static_cast<const uint32_t*>(indices)[i] : static_cast<const uint16_t*>(indices)[i];
+		ok = index < vertexCount;
+	}
+	ok = ok && LoadMeshlets() && LoadLods();
+	if (!ok)
+	{
+		data.clear();
+		chunkCount = 0;
+		vertices = nullptr;
+		vertexCount = 0;
+		indices = nullptr;
+		indexCount = 0;
+		meshlets = nullptr;
+		meshletBounds = nullptr;
+		meshletCount = 0;
+		lods = nullptr;
+		lodCount = 0;
+		lodIndices = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool MeshFile::LoadMeshlets()
+{
+	const void* chunk = nullptr;
+	size_t size = 0;
+	if (!FindChunk(CHUNK_MESHLETS, chunk, size)) { return true; }
+	if (size % sizeof(Meshlet) != 0) { return false; }
+	meshlets = static_cast<const Meshlet*>(chunk);
+	meshletCount = size / sizeof(Meshlet);
+
+	const void* boundsChunk = nullptr;
+	if (!FindChunk(CHUNK_MESHLET_BOUNDS, boundsChunk, size) || size != meshletCount * sizeof(MeshletBounds)) { return false; }
+	meshletBounds = static_cast<const MeshletBounds*>(boundsChunk);
+
+	// 範囲がINDX(とあればMSVT、MSTR)に収まっているか
+	size_t localVertices = 0, localTriangles = 0;
+	const void* unused = nullptr;
+	bool hasVertices = FindChunk(CHUNK_MESHLET_VERTICES, unused, localVertices);
+	bool hasTriangles = FindChunk(CHUNK_MESHLET_TRIANGLES, unused, localTriangles);
+	for (size_t i = 0; i < meshletCount; i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		if ((uint64_t)meshlet.triangleOffset * 3 + (uint64_t)meshlet.triangleCount * 3 > indexCount) { return false; }
+		if (hasVertices && (uint64_t)meshlet.vertexOffset + meshlet.vertexCount > localVertices / sizeof(uint32_t)) { return false; }
+		if (hasTriangles && ((uint64_t)meshlet.triangleOffset + meshlet.triangleCount) * 3 > localTriangles) { return false; }
+	}
+	return true;
+}
+
+bool MeshFile::LoadLods()
+{
+	const void* chunk = nullptr;
+	size_t size = 0;
+	if (!FindChunk(CHUNK_LODS, chunk, size)) { return true; }
+	if (size % sizeof(MeshLod) != 0 || size == 0) { return false; }
+	const MeshLod* table = static_cast<const MeshLod*>(chunk);
+	size_t count = size / sizeof(MeshLod);
+
+	// 先頭はINDX全体で、後はLIDXを隙間なく順に使う
+	if (table[0].indexOffset != 0 || table[0].indexCount != indexCount) { return false; }
+	const void* extra = nullptr;
+	size_t extraSize = 0;
+	if (count > 1 && !FindChunk(CHUNK_LOD_INDICES, extra, extraSize)) { return false; }
+	uint64_t offset = indexCount;
+	for (size_t i = 1; i < count; i++)
+	{
+		if (table[i].indexOffset != offset || table[i].indexCount % 3 != 0) { return false; }
+		offset += table[i].indexCount;
+	}
+	if ((offset - indexCount) * GetIndexSize() != extraSize) { return false; }
+	for (size_t i = 0; i < offset - indexCount; i++)
+	{
+		uint32_t index = (flags & INDEX32) ? static_cast<const uint32_t*>(extra)[i] : static_cast<const uint16_t*>(extra)[i];
+		if (index >= vertexCount) { return false; }
+	}
+	lods = table;
+	lodCount = count;
+	lodIndices = extra;
+	return true;
+}
+
+void MeshFile::GetBoundingSphere(float center[3], float& radius) const
+{
+	// 量子化していれば箱はoffset±scale
+	float minimum[3], maximum[3];
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		minimum[axis] = quantization.offset[axis] - quantization.scale[axis];
+		maximum[axis] = quantization.offset[axis] + quantization.scale[axis];
+	}
+	if (!(flags & QUANTIZED))
+	{
+		const MeshVertex* meshVertices = static_cast<const MeshVertex*>(vertices);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				float value = meshVertices[i].position[axis];
+				minimum[axis] = i == 0 ? value : (std::min)(minimum[axis], value);
+				maximum[axis] = i == 0 ? value : (std::max)(maximum[axis], value);
+			}
+		}
+	}
+	radius = 0.0f;
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+		radius += (maximum[axis] - minimum[axis]) * (maximum[axis] - minimum[axis]) * 0.25f;
+	}
+	radius = sqrtf(radius);
+}
+
+MeshLod MeshFile::GetLod(size_t lod) const
+{
+	if (!lods) { return { 0, (uint32_t)indexCount, 0.0f, 0 }; }
+	return lods[lod];
+}
+
+const void* MeshFile::GetLodIndices(size_t lod) const
+{
+	if (lod == 0) { return indices; }
+	return static_cast<const uint8_t*>(lodIndices) + (size_t)(lods[lod].indexOffset - indexCount) * GetIndexSize();
+}
+
+bool MeshFile::FindChunk(uint32_t id, const void*& chunk, size_t& size) const
+{
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const uint8_t* entry = data.data() + HEADER_SIZE + ENTRY_SIZE * i;
+		if (Read(entry, 4) != id) { continue; }
+		chunk = data.data() + Read(entry + 8, 8);
+		size = (size_t)Read(entry + 16, 8);
+		return true;
+	}
+	return false;
+}
+
+float MeshFileWriter::SetMesh(const MeshData& mesh, bool quantize)
+{
+	float maxError = 0.0f;
+	flags = 0;
+	if (quantize)
+	{
+		std::vector<PackedVertex> packed;
+		MeshQuantization quantization;
+		maxError = QuantizeVertices(mesh.vertices, packed, quantization);
+		AddChunk(MeshFile::CHUNK_VERTICES, packed.data(), packed.size() * sizeof(PackedVertex));
+		AddChunk(MeshFile::CHUNK_QUANTIZATION, &quantization, sizeof(quantization));
+		flags |= MeshFile::QUANTIZED;
+	}
+	else
+	{
+		AddChunk(MeshFile::CHUNK_VERTICES, mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshVertex));
+	}
+
+	if (mesh.vertices.size() > 65536)
+	{
+		AddChunk(MeshFile::CHUNK_INDICES, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+		flags |= MeshFile::INDEX32;
+	}
+	else
+	{
+		std::vector<uint16_t> narrow(mesh.indices.begin(), mesh.indices.end());
+		AddChunk(MeshFile::CHUNK_INDICES, narrow.data(), narrow.size() * sizeof(uint16_t));
+	}
+	return maxError;
+}
+
+void MeshFileWriter::SetMeshlets(const MeshletData& meshlets)
+{
+	AddChunk(MeshFile::CHUNK_MESHLETS, meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(Meshlet));
+	AddChunk(MeshFile::CHUNK_MESHLET_BOUNDS, meshlets.bounds.data(), meshlets.bounds.size() * sizeof(MeshletBounds));
+	AddChunk(MeshFile::CHUNK_MESHLET_VERTICES, meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t));
+	AddChunk(MeshFile::CHUNK_MESHLET_TRIANGLES, meshlets.triangles.data(), meshlets.triangles.size());
+}
+
+void MeshFileWriter::SetLods(const std::vector<MeshLod>& lods, const std::vector<uint32_t>& lodIndices)
+{
+	AddChunk(MeshFile::CHUNK_LODS, lods.data(), lods.size() * sizeof(MeshLod));
+	if (flags & MeshFile::INDEX32)
+	{
+		AddChunk(MeshFile::CHUNK_LOD_INDICES, lodIndices.data(), lodIndices.size() * sizeof(uint32_t));
+	}
+	else
+	{
+		std::vector<uint16_t> narrow(lodIndices.begin(), lodIndices.end());
+		AddChunk(MeshFile::CHUNK_LOD_INDICES, narrow.data(), narrow.size() * sizeof(uint16_t));
+	}
+}
+
+void MeshFileWriter::AddChunk(uint32_t id, const void* data, size_t size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	for (Chunk& chunk : chunks)
+	{
+		if (chunk.id == id)
+		{
+			chunk.data.assign(p, p + size);
+			return;
+		}
+	}
+	chunks.push_back({ id, std::vector<uint8_t>(p, p + size) });
+}
+
+std::vector<uint8_t> MeshFileWriter::Serialize() const
+{
+	std::vector<uint8_t> out;
+	Write32(out, MeshFile::MAGIC);
+	Write32(out, MeshFile::VERSION);
+	Write32(out, flags);
+	Write32(out, (uint32_t)chunks.size());
+
+	uint64_t offset = HEADER_SIZE + ENTRY_SIZE * chunks.size();
+	for (const Chunk& chunk : chunks)
+	{
+		offset = (offset + CHUNK_ALIGNMENT - 1) & ~(uint64_t)(CHUNK_ALIGNMENT - 1);
+		Write32(out, chunk.id);
+		Write32(out, 0);
+		Write64(out, offset);
+		Write64(out, chunk.data.size());
+		offset += chunk.data.size();
+	}
+	for (const Chunk& chunk : chunks)
+	{
+		out.resize((out.size() + CHUNK_ALIGNMENT - 1) & ~(CHUNK_ALIGNMENT - 1));
+		out.insert(out.end(), chunk.data.begin(), chunk.data.end());
+	}
+	return out;
+}
+
+bool MeshFileWriter::Save(const std::wstring& path) const
+{
+	std::vector<uint8_t> bytes = Serialize();
+#ifdef _WIN32
+	FILE* fp = nullptr;
+	if (_wfopen_s(&fp, path.c_str(), L"wb") != 0) { fp = nullptr; }
+#else
+	FILE* fp = fopen(Narrow(path).c_str(), "wb");
+#endif
+	if (!fp) { return false; }
+	bool ok = fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+	return (fclose(fp) == 0) && ok;
+}
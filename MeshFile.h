@@ -0,0 +1,116 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshCook.h"
+#include "Meshlet.h"
+#include "MeshLod.h"
+
+// 事前に直したメッシュのファイル(1回の読み込みで全体をメモリに置き、そのまま指す)
+// ファイルの形式(リトルエンディアン)
+//   ヘッダ: magic "MESH", version(4), flags(4), chunkCount(4)
+//   目次: chunkCount個の { id(4), reserved(4), offset(8), size(8) }
+//   本体: 各チャンクを16バイト境界に並べる(offsetはファイル先頭から)
+// チャンク
+//   VERT: MeshVertexの配列(QUANTIZEDならPackedVertex)
+//   INDX: 三角形リスト、uint16(INDEX32ならuint32)
+//   QUAN: MeshQuantization(QUANTIZEDの時だけ)
+//   MSLT, MSBD: MeshletとMeshletBoundsの配列(あればINDXはメッシュレットの順に並べる)
+//   MSVT, MSTR: MeshletData::verticesとtriangles(メッシュシェーダ用)
+//   LODS: MeshLodの配列(先頭はINDX全体)
+//   LIDX: LOD1から後のインデックスを続けたもの(INDXと同じ幅。INDXの後ろに置けばMeshLodの位置でそのまま描ける)
+class MeshFile
+{
+public:
+	static const uint32_t MAGIC = 0x4853454d; // "MESH"
+	static const uint32_t VERSION = 1;
+	static const uint32_t CHUNK_VERTICES = 0x54524556; // "VERT"
+	static const uint32_t CHUNK_INDICES = 0x58444e49; // "INDX"
+	static const uint32_t CHUNK_QUANTIZATION = 0x4e415551; // "QUAN"
+	static const uint32_t CHUNK_MESHLETS = 0x544c534d; // "MSLT"
+	static const uint32_t CHUNK_MESHLET_BOUNDS = 0x4442534d; // "MSBD"
+	static const uint32_t CHUNK_MESHLET_VERTICES = 0x5456534d; // "MSVT"
+	static const uint32_t CHUNK_MESHLET_TRIANGLES = 0x5254534d; // "MSTR"
+	static const uint32_t CHUNK_LODS = 0x53444f4c; // "LODS"
+	static const uint32_t CHUNK_LOD_INDICES = 0x5844494c; // "LIDX"
+
+	enum Flags : uint32_t
+	{
+		QUANTIZED = 1 << 0,
+		INDEX32 = 1 << 1,
+	};
+
+	// 無いか壊れていればfalse
+	bool Load(const std::wstring& path);
+	bool Load(std::vector<uint8_t> bytes);
+
+	// 無ければfalse(dataはLoadし直すまで有効)
+	bool FindChunk(uint32_t id, const void*& data, size_t& size) const;
+
+	uint32_t GetFlags() const { return flags; }
+	const void* GetVertices() const { return vertices; }
+	size_t GetVertexCount() const { return vertexCount; }
+	uint32_t GetVertexStride() const { return (flags & QUANTIZED) ? sizeof(PackedVertex) : sizeof(MeshVertex); }
+	const void* GetIndices() const { return indices; }
+	size_t GetIndexCount() const { return indexCount; }
+	uint32_t GetIndexSize() const { return (flags & INDEX32) ? 4 : 2; }
+	// QUANTIZEDでなければ拡大1、平行移動0
+	const MeshQuantization& GetQuantization() const { return quantization; }
+	// 頂点を囲む箱の中心と、中心から角までの距離(物体の座標)
+	void GetBoundingSphere(float center[3], float& radius) const;
+	// 無ければ0
+	size_t GetMeshletCount() const { return meshletCount; }
+	const Meshlet* GetMeshlets() const { return meshlets; }
+	const MeshletBounds* GetMeshletBounds() const { return meshletBounds; }
+	// LODが無ければINDX全体の1つ
+	size_t GetLodCount() const { return lods ? lodCount : 1; }
+	MeshLod GetLod(size_t lod) const;
+	// LODの先頭のインデックス(幅はGetIndexSize)
+	const void* GetLodIndices(size_t lod) const;
+
+private:
+	std::vector<uint8_t> data;
+	uint32_t flags = 0;
+	size_t chunkCount = 0;
+	const void* vertices = nullptr;
+	size_t vertexCount = 0;
+	const void* indices = nullptr;
+	size_t indexCount = 0;
+	MeshQuantization quantization = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	const Meshlet* meshlets = nullptr;
+	const MeshletBounds* meshletBounds = nullptr;
+	size_t meshletCount = 0;
+	const MeshLod* lods = nullptr;
+	size_t lodCount = 0;
+	const void* lodIndices = nullptr;
+
+	bool LoadMeshlets();
+	bool LoadLods();
+};
+
+// MeshFileのファイルを作る
+class MeshFileWriter
+{
+public:
+	// 頂点が65536個以下ならインデックスは16ビットにする
+	// 戻り値は量子化の最大誤差(しなければ0)
+	float SetMesh(const MeshData& mesh, bool quantize);
+	// meshのインデックスはBuildMeshletIndicesで並べ直したものにする
+	void SetMeshlets(const MeshletData& meshlets);
+	// BuildLodChainの結果(SetMeshの後に呼ぶ、インデックスの幅を合わせる)
+	void SetLods(const std::vector<MeshLod>& lods, const std::vector<uint32_t>& lodIndices);
+	// 同じidは置き換える
+	void AddChunk(uint32_t id, const void* data, size_t size);
+	std::vector<uint8_t> Serialize() const;
+	bool Save(const std::wstring& path) const;
+
+private:
+	struct Chunk
+	{
+		uint32_t id;
+		std::vector<uint8_t> data;
+	};
+	uint32_t flags = 0;
+	std::vector<Chunk> chunks;
+};
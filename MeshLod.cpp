@@ -0,0 +1,453 @@
+﻿#include "MeshLod.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	const uint32_t NONE = ~0u;
+	// 縁の形を保つための面の重み(三角形の面積に対する倍率)
+	const double BORDER_WEIGHT = 10.0;
+
+	// 頂点のつぶし方
+	enum VertexKind : uint8_t
+	{
+		KIND_MANIFOLD, // 周りが閉じている。どこへでもつぶせる
+		KIND_BORDER, // 穴の縁。縁に沿って縁の頂点へだけ
+		KIND_SEAM, // uvの継ぎ目で同じ位置に2つある。継ぎ目に沿って両方一緒に
+		KIND_LOCKED, // 角や3つ以上の継ぎ目が集まる所。動かさない
+	};
+
+	// 平面からの距離の二乗の和 (p^T A p + 2 b^T p + c) と重みの合計
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	void AddPlane(Quadric& q, const double n[3], double d, double weight)
+	{
+		q.a00 += weight * n[0] * n[0];
+		q.a01 += weight * n[0] * n[1];
+		q.a02 += weight * n[0] * n[2];
+		q.a11 += weight * n[1] * n[1];
+		q.a12 += weight * n[1] * n[2];
+		q.a22 += weight * n[2] * n[2];
+		q.b0 += weight * n[0] * d;
+		q.b1 += weight * n[1] * d;
+		q.b2 += weight * n[2] * d;
+		q.c += weight * d * d;
+		q.weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00; q.a01 += other.a01; q.a02 += other.a02;
+		q.a11 += other.a11; q.a12 += other.a12; q.a22 += other.a22;
+		q.b0 += other.b0; q.b1 += other.b1; q.b2 += other.b2;
+		q.c += other.c;
+		q.weight += other.weight;
+	}
+
+	// 重み付きの平均(距離の二乗)
+	double QuadricError(const Quadric& q, const float p[3])
+	{
+		double x = p[0], y = p[1], z = p[2];
+		double error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+			+ 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+			+ 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+		return q.weight > 0.0 ? fabs(error) / q.weight : 0.0;
+	}
+
+	void Cross(const double a[3], const double b[3], double out[3])
+	{
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	// 面積の2倍の長さを持つ法線(時計回りでcross(b - a, c - a))
+	void TriangleNormal(const float* a, const float* b, const float* c, double out[3])
+	{
+		double e1[3] = { (double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2] };
+		double e2[3] = { (double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2] };
+		Cross(e1, e2, out);
+	}
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b) { return (uint64_t)a << 32 | b; }
+
+	struct PositionHash
+	{
+		size_t operator()(const std::array<uint32_t, 3>& key) const
+		{
+			uint64_t h = 14695981039346656037ull;
+			for (uint32_t bits : key) { h = (h ^ bits) * 1099511628211ull; }
+			return (size_t)h;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	// 頂点の分類と、縁(継ぎ目)を回る隣の頂点
+	struct Topology
+	{
+		std::vector<uint32_t> remap; // 同じ位置の頂点の代表
+		std::vector<uint32_t> wedge; // 同じ位置の頂点を輪にしたもの
+		std::vector<uint32_t> loop; // 開いた辺の先(無ければNONE)
+		std::vector<uint32_t> loopback; // 開いた辺の元
+		std::vector<VertexKind> kind;
+	};
+
+	void BuildTopology(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, Topology& topology)
+	{
+		const size_t vertexCount = vertices.size();
+		topology.remap.resize(vertexCount);
+		topology.wedge.resize(vertexCount);
+		std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> positions;
+		positions.reserve(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			std::array<uint32_t, 3> key;
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				float value = vertices[i].position[axis] == 0.0f ? 0.0f : vertices[i].position[axis];
+				memcpy(&key[axis], &value, sizeof(uint32_t));
+			}
+			auto inserted = positions.emplace(key, i);
+			uint32_t first = inserted.first->second;
+			topology.remap[i] = first;
+			// firstの輪に差し込む
+			topology.wedge[i] = i;
+			if (first != i)
+			{
+				topology.wedge[i] = topology.wedge[first];
+				topology.wedge[first] = i;
+			}
+		}
+
+		// 頂点の番号で逆向きの辺が無いものが開いた辺(穴の縁かuvの継ぎ目)
+		std::unordered_set<uint64_t> edges, positionEdges;
+		edges.reserve(indices.size());
+		positionEdges.reserve(indices.size());
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			for (size_t e = 0; e < 3; e++)
+			{
+				uint32_t a = indices[t + e], b = indices[t + (e + 1) % 3];
+				edges.insert(EdgeKey(a, b));
+				positionEdges.insert(EdgeKey(topology.remap[a], topology.remap[b]));
+			}
+		}
+		topology.loop.assign(vertexCount, NONE);
+		topology.loopback.assign(vertexCount, NONE);
+		std::vector<uint32_t> openOut(vertexCount, 0), openIn(vertexCount, 0);
+		std::vector<uint8_t> border(vertexCount, 0); // 位置で見ても開いている(継ぎ目ではない)
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			for (size_t e = 0; e < 3; e++)
+			{
+				uint32_t a = indices[t + e], b = indices[t + (e + 1) % 3];
+				if (edges.count(EdgeKey(b, a))) { continue; }
+				topology.loop[a] = b;
+				topology.loopback[b] = a;
+				openOut[a]++;
+				openIn[b]++;
+				if (!positionEdges.count(EdgeKey(topology.remap[b], topology.remap[a]))) { border[a] = border[b] = 1; }
+			}
+		}
+
+		topology.kind.resize(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			uint32_t other = topology.wedge[i];
+			VertexKind kind = KIND_LOCKED;
+			if (other == i)
+			{
+				if (openOut[i] == 0 && openIn[i] == 0) { kind = KIND_MANIFOLD; }
+				else if (openOut[i] == 1 && openIn[i] == 1) { kind = KIND_BORDER; }
+			}
+			else if (topology.wedge[other] == i && !border[i] && !border[other]
+				&& openOut[i] == 1 && openIn[i] == 1 && openOut[other] == 1 && openIn[other] == 1)
+			{
+				// 両側の開いた辺が同じ位置を逆向きに通っていれば継ぎ目
+				const std::vector<uint32_t>& remap = topology.remap;
+				if (remap[topology.loop[i]] == remap[topology.loopback[other]]
+					&& remap[topology.loopback[i]] == remap[topology.loop[other]])
+				{
+					kind = KIND_SEAM;
+				}
+			}
+			topology.kind[i] = kind;
+		}
+	}
+
+	// 位置の代表ごとの二次誤差
+	void BuildQuadrics(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+		const Topology& topology, std::vector<Quadric>& quadrics)
+	{
+		quadrics.assign(vertices.size(), Quadric{});
+		std::unordered_set<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			for (size_t e = 0; e < 3; e++)
+			{
+				edges.insert(EdgeKey(topology.remap[indices[t + e]], topology.remap[indices[t + (e + 1) % 3]]));
+			}
+		}
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			const float* p[3];
+			for (size_t k = 0; k < 3; k++) { p[k] = vertices[indices[t + k]].position; }
+			double n[3];
+			TriangleNormal(p[0], p[1], p[2], n);
+			double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length <= 0.0) { continue; }
+			for (double& axis : n) { axis /= length; }
+			double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+			double area = length * 0.5;
+			for (size_t k = 0; k < 3; k++) { AddPlane(quadrics[topology.remap[indices[t + k]]], n, d, area); }
+
+			// 穴の縁には面に垂直な面を足して、縁が内側に縮まないようにする
+			for (size_t e = 0; e < 3; e++)
+			{
+				uint32_t a = topology.remap[indices[t + e]], b = topology.remap[indices[t + (e + 1) % 3]];
+				if (edges.count(EdgeKey(b, a))) { continue; }
+				const float* pa = p[e];
+				const float* pb = p[(e + 1) % 3];
+				double edge[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+				double m[3];
+				Cross(edge, n, m);
+				double edgeLength = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+				if (edgeLength <= 0.0) { continue; }
+				for (double& axis : m) { axis /= edgeLength; }
+				double md = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+				double weight = edgeLength * edgeLength * BORDER_WEIGHT;
+				AddPlane(quadrics[a], m, md, weight);
+				AddPlane(quadrics[b], m, md, weight);
+			}
+		}
+	}
+
+	bool CanCollapse(const Topology& topology, uint32_t from, uint32_t to)
+	{
+		switch (topology.kind[from])
+		{
+		case KIND_MANIFOLD:
+			return true;
+		case KIND_BORDER:
+		case KIND_SEAM:
+			// 同じ種類の頂点へ、開いた辺に沿ってだけ
+			return topology.kind[to] == topology.kind[from]
+				&& (topology.loop[from] == to || topology.loopback[from] == to);
+		default:
+			return false;
+		}
+	}
+
+	// fromをtoの位置へ動かすと、残る三角形が裏返るか
+	bool HasFlip(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, const Topology& topology,
+		const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& triangles, uint32_t from, uint32_t to)
+	{
+		uint32_t group = topology.remap[from];
+		uint32_t target = topology.remap[to];
+		const float* moved = vertices[to].position;
+		for (uint32_t i = offsets[group]; i < offsets[group + 1]; i++)
+		{
+			const uint32_t* triangle = &indices[triangles[i] * 3];
+			const float* before[3];
+			const float* after[3];
+			bool removed = false;
+			for (size_t k = 0; k < 3; k++)
+			{
+				uint32_t corner = topology.remap[triangle[k]];
+				removed = removed || corner == target;
+				before[k] = vertices[triangle[k]].position;
+				after[k] = corner == group ? moved : before[k];
+			}
+			if (removed) { continue; } // 辺を含む三角形は消える
+			double n0[3], n1[3];
+			TriangleNormal(before[0], before[1], before[2], n0);
+			TriangleNormal(after[0], after[1], after[2], n1);
+			if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0) { return true; }
+		}
+		return false;
+	}
+
+	// つぶした頂点を指していた縁の隣を付け替える
+	void RemapLoops(std::vector<uint32_t>& loop, const std::vector<uint32_t>& collapseRemap)
+	{
+		for (uint32_t i = 0; i < loop.size(); i++)
+		{
+			if (loop[i] == NONE) { continue; }
+			uint32_t next = loop[i];
+			uint32_t target = collapseRemap[next];
+			// 縁の向きと逆につぶした時は自分を指すので、1つ先へ進める
+			loop[i] = target == i ? loop[next] : target;
+		}
+	}
+}
+
+float SimplifyMesh(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float targetError, std::vector<uint32_t>& result)
+{
+	result = indices;
+	if (indices.size() <= targetIndexCount || vertices.empty()) { return 0.0f; }
+
+	Topology topology;
+	BuildTopology(vertices, indices, topology);
+	std::vector<Quadric> quadrics;
+	BuildQuadrics(vertices, indices, topology, quadrics);
+
+	const size_t vertexCount = vertices.size();
+	const double errorLimit = (double)targetError * targetError;
+	double maxError = 0.0;
+	std::vector<uint32_t> offsets(vertexCount + 1);
+	std::vector<uint32_t> triangles;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<uint8_t> locked(vertexCount);
+	while (result.size() > targetIndexCount)
+	{
+		// 位置の代表ごとに周りの三角形を並べる(裏返りを調べる)
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (uint32_t index : result) { offsets[topology.remap[index] + 1]++; }
+		for (size_t i = 0; i < vertexCount; i++) { offsets[i + 1] += offsets[i]; }
+		triangles.resize(result.size());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++) { triangles[fill[topology.remap[result[i]]]++] = (uint32_t)(i / 3); }
+
+		// 辺ごとに安い方の向きを候補にする(閉じた辺は2つの三角形に出てくるので、位置の番号が小さい方からだけ見る)
+		collapses.clear();
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			for (size_t e = 0; e < 3; e++)
+			{
+				uint32_t a = result[t + e], b = result[t + (e + 1) % 3];
+				uint32_t ra = topology.remap[a], rb = topology.remap[b];
+				if (ra > rb && topology.loop[a] != b) { continue; } // 縁と継ぎ目の辺は片側にしか出てこない
+				bool forward = CanCollapse(topology, a, b);
+				bool backward = CanCollapse(topology, b, a);
+				if (!forward && !backward) { continue; }
+				double errorForward = forward ? QuadricError(quadrics[ra], vertices[b].position) : DBL_MAX;
+				double errorBackward = backward ? QuadricError(quadrics[rb], vertices[a].position) : DBL_MAX;
+				if (errorForward <= errorBackward) { collapses.push_back({ a, b, errorForward }); }
+				else { collapses.push_back({ b, a, errorBackward }); }
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+		// 1回のつぶしで三角形は2つくらい減る。減らし過ぎないよう目標までの半分ずつ進める
+		size_t goal = (std::max)((result.size() - targetIndexCount) / 3 / 2, size_t(1));
+		for (uint32_t i = 0; i < vertexCount; i++) { collapseRemap[i] = i; }
+		std::fill(locked.begin(), locked.end(), 0);
+		size_t applied = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (applied >= goal || collapse.error > errorLimit) { break; }
+			uint32_t from = collapse.from, to = collapse.to;
+			uint32_t groupFrom = topology.remap[from], groupTo = topology.remap[to];
+			// 同じ回で周りが動いた頂点は、誤差と裏返りの見積もりが古いので次の回にする
+			if (locked[groupFrom] || locked[groupTo]) { continue; }
+			if (HasFlip(vertices, result, topology, offsets, triangles, from, to)) { continue; }
+
+			if (topology.kind[from] == KIND_SEAM)
+			{
+				// 反対側の頂点も、反対側の継ぎ目に沿って同じ位置へ
+				uint32_t sibling = topology.wedge[from];
+				uint32_t siblingTo = topology.loop[from] == to ? topology.loopback[sibling] : topology.loop[sibling];
+				if (siblingTo == NONE || topology.remap[siblingTo] != groupTo) { continue; }
+				collapseRemap[sibling] = siblingTo;
+			}
+			collapseRemap[from] = to;
+			AddQuadric(quadrics[groupTo], quadrics[groupFrom]);
+			locked[groupFrom] = locked[groupTo] = 1;
+			maxError = (std::max)(maxError, collapse.error);
+			applied++;
+		}
+		if (applied == 0) { break; }
+
+		// 付け替えて、面積の無くなった三角形を捨てる
+		size_t write = 0;
+		for (size_t t = 0; t < result.size(); t += 3)
+		{
+			uint32_t a = collapseRemap[result[t]], b = collapseRemap[result[t + 1]], c = collapseRemap[result[t + 2]];
+			uint32_t ra = topology.remap[a], rb = topology.remap[b], rc = topology.remap[c];
+			if (ra == rb || rb == rc || rc == ra) { continue; }
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+		RemapLoops(topology.loop, collapseRemap);
+		RemapLoops(topology.loopback, collapseRemap);
+	}
+	return (float)sqrt(maxError);
+}
+
+void BuildLodChain(const MeshData& mesh, const float* ratios, size_t ratioCount,
+	std::vector<MeshLod>& lods, std::vector<uint32_t>& lodIndices)
+{
+	lods.clear();
+	lodIndices.clear();
+	lods.push_back({ 0, (uint32_t)mesh.indices.size(), 0.0f, 0 });
+
+	std::vector<uint32_t> previous = mesh.indices;
+	std::vector<uint32_t> simplified;
+	float error = 0.0f;
+	for (size_t i = 0; i < ratioCount; i++)
+	{
+		size_t target = (size_t)(mesh.indices.size() / 3 * ratios[i]) * 3;
+		if (target >= previous.size()) { continue; }
+		// 前のLODからの誤差を足していくので、元からの誤差を超えない
+		error += SimplifyMesh(mesh.vertices, previous, target, FLT_MAX, simplified);
+		// 1割も減らなければ(継ぎ目や縁で止まった)これ以上作らない
+		if (simplified.empty() || simplified.size() > previous.size() * 9 / 10) { break; }
+		OptimizeVertexCache(simplified, mesh.vertices.size());
+		lods.push_back({ (uint32_t)(mesh.indices.size() + lodIndices.size()), (uint32_t)simplified.size(), error, 0 });
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+		previous.swap(simplified);
+	}
+}
+
+LodSelector::LodSelector()
+{
+	projectionScale = 1.0f;
+	threshold = 1.0f;
+}
+
+void LodSelector::SetProjection(float fovAngleY, float viewportHeight)
+{
+	// 射影後の-1から1が画面の高さになる
+	projectionScale = viewportHeight * 0.5f / tanf(fovAngleY * 0.5f);
+}
+
+float LodSelector::GetScreenError(float error, float scale, float distance, float radius) const
+{
+	// 境界球の中にいる時は一番細かいLODにする
+	float nearest = distance - radius * scale;
+	if (nearest <= 0.0f) { return FLT_MAX; }
+	return error * scale * projectionScale / nearest;
+}
+
+size_t LodSelector::Select(const MeshLod* lods, size_t count, float scale, float distance, float radius) const
+{
+	size_t selected = 0;
+	for (size_t i = 1; i < count; i++)
+	{
+		if (GetScreenError(lods[i].error, scale, distance, radius) > threshold) { break; }
+		selected = i;
+	}
+	return selected;
+}
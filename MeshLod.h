@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshCook.h"
+
+// 遠くで使う粗いメッシュ(LOD)を作り、画面上の誤差で選ぶ
+
+// インデックスの範囲はMeshFileのINDXの後にLIDXを続けた通しの位置(LOD0はINDXそのもの)
+// errorは元のメッシュからのずれ(物体の座標の距離)
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;
+	uint32_t reserved;
+};
+
+// 辺をつぶしてtargetIndexCountまで三角形を減らす(Garlandの二次誤差、頂点は動かさず端点に寄せる)
+// 頂点バッファはそのまま共有し、新しいインデックスをresultに書く
+// uvの継ぎ目は継ぎ目に沿ってのみ、穴の縁は縁に沿ってのみつぶす(両側のuvが崩れない)
+// 誤差がtargetErrorを超えるものはつぶさない。戻り値は実際の誤差
+float SimplifyMesh(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float targetError, std::vector<uint32_t>& result);
+
+// ratiosは元の三角形の数に対する割合(大きい順)。それぞれ1つ前のLODから減らす
+// 減らなくなったらそこで止める。lods[0]は元のメッシュ、lodIndicesにはLOD1から後を続けて書く
+void BuildLodChain(const MeshData& mesh, const float* ratios, size_t ratioCount,
+	std::vector<MeshLod>& lods, std::vector<uint32_t>& lodIndices);
+
+// 射影した時の誤差(ピクセル)が閾値以下で一番粗いLODを選ぶ
+class LodSelector
+{
+public:
+	LodSelector();
+
+	// XMMatrixPerspectiveFovLHに渡したfovAngleY(ラジアン)と、描画先の高さ(ピクセル)
+	void SetProjection(float fovAngleY, float viewportHeight);
+	void SetThreshold(float pixels) { threshold = pixels; }
+
+	// scaleはワールド行列の拡大、distanceはカメラから境界球の中心まで、radiusは境界球の半径(どちらもワールド)
+	// 境界球の一番手前で見積もる
+	float GetScreenError(float error, float scale, float distance, float radius) const;
+	size_t Select(const MeshLod* lods, size_t count, float scale, float distance, float radius) const;
+
+private:
+	float projectionScale; // 距離1で物体の大きさ1が何ピクセルか
+	float threshold;
+};
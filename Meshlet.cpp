@@ -0,0 +1,315 @@
+﻿#include "Meshlet.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const float* Position(const float* positions, size_t stride, uint32_t index)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + stride * index);
+	}
+
+	MeshletBounds ComputeBounds(const float* positions, size_t stride, const uint32_t* vertices, const Meshlet& meshlet,
+		const uint8_t* triangles)
+	{
+		MeshletBounds bounds{};
+
+		// 球は箱の中心から一番遠い頂点まで
+		float minimum[3], maximum[3];
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			const float* p = Position(positions, stride, vertices[meshlet.vertexOffset + i]);
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				minimum[axis] = i == 0 ? p[axis] : (std::min)(minimum[axis], p[axis]);
+				maximum[axis] = i == 0 ? p[axis] : (std::max)(maximum[axis], p[axis]);
+			}
+		}
+		float radiusSquared = 0.0f;
+		for (size_t axis = 0; axis < 3; axis++) { bounds.center[axis] = (minimum[axis] + maximum[axis]) * 0.5f; }
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			const float* p = Position(positions, stride, vertices[meshlet.vertexOffset + i]);
+			float dx = p[0] - bounds.center[0], dy = p[1] - bounds.center[1], dz = p[2] - bounds.center[2];
+			radiusSquared = (std::max)(radiusSquared, dx * dx + dy * dy + dz * dz);
+		}
+		bounds.radius = sqrtf(radiusSquared);
+
+		// 表の法線は時計回りの巻きでcross(b - a, c - a)(左手系)
+		std::vector<float> normals;
+		normals.reserve(meshlet.triangleCount * 3);
+		float axisSum[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			const uint8_t* triangle = triangles + (meshlet.triangleOffset + t) * 3;
+			const float* a = Position(positions, stride, vertices[meshlet.vertexOffset + triangle[0]]);
+			const float* b = Position(positions, stride, vertices[meshlet.vertexOffset + triangle[1]]);
+			const float* c = Position(positions, stride, vertices[meshlet.vertexOffset + triangle[2]]);
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length <= 0.0f) { continue; } // 面積の無い三角形は向きを持たない
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				n[axis] /= length;
+				axisSum[axis] += n[axis];
+			}
+			normals.insert(normals.end(), n, n + 3);
+		}
+
+		bounds.coneCutoff = 1.0f;
+		float axisLength = sqrtf(axisSum[0] * axisSum[0] + axisSum[1] * axisSum[1] + axisSum[2] * axisSum[2]);
+		if (normals.empty() || axisLength <= 0.0f) { return bounds; }
+		float axis[3] = { axisSum[0] / axisLength, axisSum[1] / axisLength, axisSum[2] / axisLength };
+		float minDot = 1.0f;
+		for (size_t i = 0; i < normals.size(); i += 3)
+		{
+			minDot = (std::min)(minDot, axis[0] * normals[i] + axis[1] * normals[i + 1] + axis[2] * normals[i + 2]);
+		}
+		// 円錐の半角が90度近くになると、ほとんど消えないので判定しない
+		if (minDot <= 0.1f) { return bounds; }
+		memcpy(bounds.coneAxis, axis, sizeof(axis));
+		bounds.coneCutoff = sqrtf(1.0f - minDot * minDot);
+		return bounds;
+	}
+}
+
+void BuildMeshlets(const float* positions, size_t stride, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount, MeshletData& result, size_t maxVertices, size_t maxTriangles)
+{
+	result = {};
+	maxVertices = (std::min)((std::max)(maxVertices, size_t(3)), size_t(256)); // 中の番号は1バイト
+	maxTriangles = (std::max)(maxTriangles, size_t(1));
+	const size_t triangleCount = indexCount / 3;
+
+	// 頂点ごとの三角形の一覧
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) { offsets[indices[i] + 1]++; }
+	for (size_t v = 0; v < vertexCount; v++) { offsets[v + 1] += offsets[v]; }
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++) { adjacency[fill[indices[i]]++] = (uint32_t)(i / 3); }
+	}
+	std::vector<float> centroids(triangleCount * 3);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			const float* p = Position(positions, stride, indices[t * 3 + k]);
+			for (size_t axis = 0; axis < 3; axis++) { centroids[t * 3 + axis] += p[axis] / 3.0f; }
+		}
+	}
+
+	std::vector<uint8_t> used(triangleCount, 0);
+	// 頂点ごとの残りの三角形の数(少ない所から埋めると取り残された小さな島ができにくい)
+	std::vector<uint32_t> live(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) { live[v] = offsets[v + 1] - offsets[v]; }
+	std::vector<uint32_t> previous; // 直前のメッシュレットの頂点(次の種を隣から探す)
+	std::vector<uint8_t> local(vertexCount, 0xff); // 今のメッシュレットの中の番号
+	Meshlet current{};
+	float centerSum[3] = { 0.0f, 0.0f, 0.0f };
+	size_t cursor = 0;
+
+	auto finish = [&]()
+	{
+		if (current.triangleCount == 0) { return; }
+		previous.assign(result.vertices.begin() + current.vertexOffset, result.vertices.end());
+		for (uint32_t v : previous) { local[v] = 0xff; }
+		result.meshlets.push_back(current);
+		result.bounds.push_back(ComputeBounds(positions, stride, result.vertices.data(), current, result.triangles.data()));
+		current = {};
+		current.vertexOffset = (uint32_t)result.vertices.size();
+		current.triangleOffset = (uint32_t)(result.triangles.size() / 3);
+		centerSum[0] = centerSum[1] = centerSum[2] = 0.0f;
+	};
+	auto newVertices = [&](size_t t)
+	{
+		return (size_t)(local[indices[t * 3]] == 0xff) + (local[indices[t * 3 + 1]] == 0xff) + (local[indices[t * 3 + 2]] == 0xff);
+	};
+	auto liveCount = [&](size_t t) { return live[indices[t * 3]] + live[indices[t * 3 + 1]] + live[indices[t * 3 + 2]]; };
+
+	for (size_t emitted = 0; emitted < triangleCount; emitted++)
+	{
+		// 今の頂点を使う三角形から、足す頂点が少なく、周りが埋まっていて、中心に近いものを選ぶ
+		size_t best = SIZE_MAX;
+		size_t bestNew = 4;
+		uint32_t bestLive = UINT32_MAX;
+		float bestDistance = INFINITY;
+		if (current.triangleCount > 0)
+		{
+			float center[3] = { centerSum[0] / current.triangleCount, centerSum[1] / current.triangleCount, centerSum[2] / current.triangleCount };
+			for (uint32_t i = 0; i < current.vertexCount; i++)
+			{
+				uint32_t v = result.vertices[current.vertexOffset + i];
+				for (uint32_t j = offsets[v]; j < offsets[v + 1]; j++)
+				{
+					uint32_t t = adjacency[j];
+					if (used[t]) { continue; }
+					size_t extra = newVertices(t);
+					if (current.vertexCount + extra > maxVertices || extra > bestNew) { continue; }
+					uint32_t liveSum = liveCount(t);
+					if (extra == bestNew && liveSum > bestLive) { continue; }
+					float dx = centroids[t * 3] - center[0], dy = centroids[t * 3 + 1] - center[1], dz = centroids[t * 3 + 2] - center[2];
+					float distance = dx * dx + dy * dy + dz * dz;
+					if (extra < bestNew || liveSum < bestLive || distance < bestDistance)
+					{
+						best = t;
+						bestNew = extra;
+						bestLive = liveSum;
+						bestDistance = distance;
+					}
+				}
+			}
+		}
+		// 隣が無ければ閉じ、直前のメッシュレットに接していて周りが一番埋まっている三角形から始める
+		// (接していなければ入力の順で次のもの)
+		if (best == SIZE_MAX)
+		{
+			finish();
+			for (uint32_t v : previous)
+			{
+				for (uint32_t j = offsets[v]; j < offsets[v + 1]; j++)
+				{
+					uint32_t t = adjacency[j];
+					if (used[t]) { continue; }
+					uint32_t liveSum = liveCount(t);
+					if (liveSum < bestLive)
+					{
+						best = t;
+						bestLive = liveSum;
+					}
+				}
+			}
+			if (best == SIZE_MAX)
+			{
+				while (used[cursor]) { cursor++; }
+				best = cursor;
+			}
+		}
+
+		used[best] = 1;
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t v = indices[best * 3 + k];
+			live[v]--;
+			if (local[v] == 0xff)
+			{
+				local[v] = (uint8_t)current.vertexCount++;
+				result.vertices.push_back(v);
+			}
+			result.triangles.push_back(local[v]);
+		}
+		current.triangleCount++;
+		for (size_t axis = 0; axis < 3; axis++) { centerSum[axis] += centroids[best * 3 + axis]; }
+
+		if (current.triangleCount >= maxTriangles) { finish(); }
+	}
+	finish();
+}
+
+void BuildMeshlets(const MeshData& mesh, MeshletData& result, size_t maxVertices, size_t maxTriangles)
+{
+	BuildMeshlets(mesh.vertices.empty() ? nullptr : mesh.vertices[0].position, sizeof(MeshVertex), mesh.vertices.size(),
+		mesh.indices.data(), mesh.indices.size(), result, maxVertices, maxTriangles);
+}
+
+std::vector<uint32_t> BuildMeshletIndices(const MeshletData& meshlets)
+{
+	std::vector<uint32_t> indices(meshlets.triangles.size());
+	for (const Meshlet& meshlet : meshlets.meshlets)
+	{
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+		{
+			size_t position = meshlet.triangleOffset * 3 + i;
+			indices[position] = meshlets.vertices[meshlet.vertexOffset + meshlets.triangles[position]];
+		}
+	}
+	return indices;
+}
+
+MeshletStats ComputeMeshletStats(const MeshletData& meshlets, size_t maxVertices, size_t maxTriangles)
+{
+	MeshletStats stats{};
+	stats.meshletCount = meshlets.meshlets.size();
+	if (stats.meshletCount == 0) { return stats; }
+
+	size_t vertices = 0, triangles = 0;
+	for (const Meshlet& meshlet : meshlets.meshlets)
+	{
+		vertices += meshlet.vertexCount;
+		triangles += meshlet.triangleCount;
+	}
+	for (const MeshletBounds& bounds : meshlets.bounds)
+	{
+		stats.averageRadius += bounds.radius;
+		stats.degenerateCones += bounds.coneCutoff >= 1.0f;
+	}
+	std::vector<uint32_t> unique(meshlets.vertices);
+	std::sort(unique.begin(), unique.end());
+	size_t uniqueCount = std::unique(unique.begin(), unique.end()) - unique.begin();
+
+	stats.averageVertices = (double)vertices / stats.meshletCount;
+	stats.averageTriangles = (double)triangles / stats.meshletCount;
+	stats.vertexFill = stats.averageVertices / maxVertices;
+	stats.triangleFill = stats.averageTriangles / maxTriangles;
+	stats.vertexRedundancy = uniqueCount ? (double)vertices / uniqueCount : 0.0;
+	stats.averageRadius /= stats.meshletCount;
+	return stats;
+}
+
+void ClusterCuller::SetMeshlets(const Meshlet* meshlets, const MeshletBounds* bounds, size_t count)
+{
+	spheres.Clear();
+	axisX.clear();
+	axisY.clear();
+	axisZ.clear();
+	cutoff.clear();
+	triangleOffsets.clear();
+	triangleCounts.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		const MeshletBounds& b = bounds[i];
+		spheres.Add(b.center[0], b.center[1], b.center[2], b.radius);
+		axisX.push_back(b.coneAxis[0]);
+		axisY.push_back(b.coneAxis[1]);
+		axisZ.push_back(b.coneAxis[2]);
+		cutoff.push_back(b.coneCutoff);
+		triangleOffsets.push_back(meshlets[i].triangleOffset);
+		triangleCounts.push_back(meshlets[i].triangleCount);
+	}
+	visible.resize(count);
+}
+
+size_t ClusterCuller::Cull(const FrustumCuller& frustum, const float camera[3], std::vector<ClusterDraw>& draws)
+{
+	draws.clear();
+	stats = {};
+	size_t count = spheres.Size();
+	stats.tested = count;
+
+	// 視錐台はSIMDでまとめて判定し、残ったものだけ円錐を見る
+	size_t inside = frustum.Cull(spheres, 0, count, visible.data());
+	stats.frustumCulled = count - inside;
+	for (size_t i = 0; i < inside; i++)
+	{
+		uint32_t m = visible[i];
+		float dx = spheres.x[m] - camera[0], dy = spheres.y[m] - camera[1], dz = spheres.z[m] - camera[2];
+		float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+		if (dx * axisX[m] + dy * axisY[m] + dz * axisZ[m] >= cutoff[m] * distance + spheres.radius[m])
+		{
+			stats.backfaceCulled++;
+			continue;
+		}
+
+		// 直前の範囲に続いていればまとめる
+		uint32_t offset = triangleOffsets[m] * 3, indexCount = triangleCounts[m] * 3;
+		if (!draws.empty() && draws.back().indexOffset + draws.back().indexCount == offset) { draws.back().indexCount += indexCount; }
+		else { draws.push_back({ offset, indexCount }); }
+		stats.visible++;
+		stats.triangles += triangleCounts[m];
+	}
+	return stats.visible;
+}
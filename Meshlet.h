@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FrustumCuller.h"
+#include "MeshCook.h"
+
+// 三角形を頂点と三角形の数に上限のある塊(メッシュレット)に分け、塊ごとに見えるか判定する
+
+// verticesとtrianglesの範囲
+struct Meshlet
+{
+	uint32_t vertexOffset;
+	uint32_t triangleOffset; // 三角形の番号(trianglesは3バイトずつ)
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+
+// 境界球と法線の円錐
+// dot(center - camera, coneAxis) >= coneCutoff * |center - camera| + radius なら全て裏向き
+// 法線が広がりすぎていればconeAxisは0、coneCutoffは1(裏向きでは消えない)
+struct MeshletBounds
+{
+	float center[3];
+	float radius;
+	float coneAxis[3];
+	float coneCutoff;
+};
+
+struct MeshletData
+{
+	static const size_t MAX_VERTICES = 64;
+	static const size_t MAX_TRIANGLES = 124;
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> vertices; // 元のメッシュの頂点番号
+	std::vector<uint8_t> triangles; // メッシュレットの中の頂点番号を3つずつ
+	std::vector<MeshletBounds> bounds;
+};
+
+// positionsはstrideバイトおきのfloat3、indicesは三角形リスト
+// 同じ頂点を使う三角形を、新しい頂点が少なく中心に近い順に足していく
+// (OptimizeVertexCacheの後に呼ぶと、隣が無くなった時の次の種も近くなる)
+void BuildMeshlets(const float* positions, size_t stride, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount, MeshletData& result,
+	size_t maxVertices = MeshletData::MAX_VERTICES, size_t maxTriangles = MeshletData::MAX_TRIANGLES);
+void BuildMeshlets(const MeshData& mesh, MeshletData& result,
+	size_t maxVertices = MeshletData::MAX_VERTICES, size_t maxTriangles = MeshletData::MAX_TRIANGLES);
+// メッシュレットの順に三角形を並べたインデックス(Meshlet::triangleOffset * 3から始まる)
+// メッシュシェーダが無くても、見えた範囲だけをDrawIndexedで描ける
+std::vector<uint32_t> BuildMeshletIndices(const MeshletData& meshlets);
+
+struct MeshletStats
+{
+	size_t meshletCount;
+	double averageVertices;
+	double averageTriangles;
+	double vertexFill; // 上限に対する平均(1で満杯)
+	double triangleFill;
+	double vertexRedundancy; // メッシュレットの頂点の合計 / 使われている頂点の数
+	double averageRadius;
+	size_t degenerateCones; // 裏向きでは消せないもの
+};
+MeshletStats ComputeMeshletStats(const MeshletData& meshlets, size_t maxVertices = MeshletData::MAX_VERTICES,
+	size_t maxTriangles = MeshletData::MAX_TRIANGLES);
+
+// DrawIndexedの範囲(隣り合う見えたメッシュレットはまとめる)
+struct ClusterDraw
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+};
+
+// メッシュレットを視錐台と法線の円錐で判定し、見えたものを描画の範囲に詰める
+// 座標は全てメッシュのローカル座標(視錐台はワールドとビュープロジェクションを掛けた行列から作り、
+// カメラの位置はワールド行列の逆で戻す)
+class ClusterCuller
+{
+public:
+	struct Stats
+	{
+		size_t tested;
+		size_t frustumCulled;
+		size_t backfaceCulled;
+		size_t visible;
+		size_t triangles; // 見えたものの三角形の数
+	};
+
+	// 境界をSoAに並べ直して持つ(読み込んだ時に1回)
+	void SetMeshlets(const Meshlet* meshlets, const MeshletBounds* bounds, size_t count);
+
+	// 見えたメッシュレットの数を返す
+	size_t Cull(const FrustumCuller& frustum, const float camera[3], std::vector<ClusterDraw>& draws);
+
+	Stats GetStats() const { return stats; }
+
+private:
+	BoundingSpheres spheres;
+	std::vector<float> axisX, axisY, axisZ, cutoff;
+	std::vector<uint32_t> triangleOffsets, triangleCounts;
+	std::vector<uint32_t> visible; // 容量は使い回す
+	Stats stats = {};
+};
@@ -1,19 +1,30 @@
 #include "MyClass.h"
+#include "Profiler.h"
 
-ShaderBlob::ShaderBlob(const LPCWSTR fileName, const LPCSTR target, ID3DBlob* errorBlob)
+namespace
 {
-	HRESULT result;
+	HRESULT CompileShader(const LPCWSTR fileName, const LPCSTR target, const std::vector<ShaderDefine>& defines,
+		UINT flags, ID3DBlob** blob, ID3DBlob** errorBlob)
+	{
+		PROFILE_ZONE("CompileShader");
+		// }N̔znullptrŏI
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (const ShaderDefine& define : defines) { macros.push_back({ define.name.c_str(),define.value.c_str() }); }
+		macros.push_back({ nullptr,nullptr });
 
-	result = D3DCompileFromFile(
-		fileName, // VF[_t@C
-		nullptr,
-		D3D_COMPILE_STANDARD_FILE_INCLUDE, // CN[h\ɂ
-		"main", target, // Gg[|CgAVF[_[fw
-		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // fobOpݒ
-		0,
-		&blob, &errorBlob);
+		return D3DCompileFromFile(
+			fileName, // VF[_t@C
+			macros.data(),
+			D3D_COMPILE_STANDARD_FILE_INCLUDE, // CN[h\ɂ
+			"main", target, // Gg[|CgAVF[_[fw
+			flags,
+			0,
+			blob, errorBlob);
+	}
 
-	if (FAILED(result)) {
+	void OutputCompileError(ID3DBlob* errorBlob)
+	{
+		if (!errorBlob) { return; }
 		// errorBlobG[estring^ɃRs[
 		std::string error;
 		error.resize(errorBlob->GetBufferSize());
@@ -23,8 +34,71 @@ ShaderBlob::ShaderBlob(const LPCWSTR fileName, const LPCSTR target, ID3DBlob* er
 		error += "\n";
 		// G[eo̓EBhEɕ\
 		OutputDebugStringA(error.c_str());
+	}
+}
+
+bool BuildShaderArchive(const std::wstring& path, const ShaderSource* sources, size_t count)
+{
+	ShaderArchive previous;
+	previous.Open(path);
+
+	ShaderArchiveWriter writer;
+	size_t compiled = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const ShaderSource& source = sources[i];
+		uint64_t id = ComputeShaderId(source.fileName, "main", source.target, source.defines, SHADER_ARCHIVE_FLAGS);
+		uint64_t key = 0;
+		if (!ComputeShaderKey(source.fileName, key)) { return false; }
+
+		// \[X#includeOƓȂoCgR[hp
+		uint64_t previousKey = 0;
+		const void* code = nullptr;
+		size_t size = 0;
+		if (previous.FindSourceKey(id, previousKey) && previousKey == key && previous.Find(id, code, size))
+		{
+			writer.Add(id, key, code, size);
+			continue;
+		}
+
+		ID3DBlob* blob = nullptr;
+		ID3DBlob* errorBlob = nullptr;
+		HRESULT result = CompileShader(source.fileName, source.target, source.defines, SHADER_ARCHIVE_FLAGS, &blob, &errorBlob);
+		if (FAILED(result))
+		{
+			OutputCompileError(errorBlob);
+			return false;
+		}
+		writer.Add(id, key, blob->GetBufferPointer(), blob->GetBufferSize());
+		blob->Release();
+		compiled++;
+	}
+	// SĈpȂ珑Ȃ
+	if (compiled == 0 && previous.GetCount() == count) { return true; }
+	// ޑOɃ}bv(writer̓Rs[Ă)
+	previous.Close();
+	return writer.Save(path);
+}
+
+ShaderBlob::ShaderBlob(const LPCWSTR fileName, const LPCSTR target, ID3DBlob* errorBlob,
+	const ShaderArchive* archive, const std::vector<ShaderDefine>& defines)
+{
+	// A[JCu̓rhɃ\[X蒼̂ŁAIDňł悢
+	if (archive && archive->Find(ComputeShaderId(fileName, "main", target, defines, SHADER_ARCHIVE_FLAGS), code, size))
+	{
+		return;
+	}
+
+	HRESULT result = CompileShader(fileName, target, defines,
+		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // fobOpݒ
+		&blob, &errorBlob);
+
+	if (FAILED(result)) {
+		OutputCompileError(errorBlob);
 		assert(0);
 	}
+	code = blob->GetBufferPointer();
+	size = blob->GetBufferSize();
 }
 
 // EBhEvV[W
@@ -82,10 +156,10 @@ Pipeline::Pipeline()
 }
 void Pipeline::SetShader(ShaderBlob vs, ShaderBlob ps)
 {
-	desc.VS.pShaderBytecode = vs.blob->GetBufferPointer();
-	desc.VS.BytecodeLength = vs.blob->GetBufferSize();
-	desc.PS.pShaderBytecode = ps.blob->GetBufferPointer();
-	desc.PS.BytecodeLength = ps.blob->GetBufferSize();
+	desc.VS.pShaderBytecode = vs.code;
+	desc.VS.BytecodeLength = vs.size;
+	desc.PS.pShaderBytecode = ps.code;
+	desc.PS.BytecodeLength = ps.size;
 }
 void Pipeline::SetSampleMask()
 {
@@ -112,21 +186,93 @@ void Pipeline::SetOthers()
 	desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; // 0~255wRGBA
 	desc.SampleDesc.Count = 1; // 1sNZɂ1TvO
 }
-void Pipeline::CreatePipelineState(ID3D12Device* device)
+void Pipeline::CreatePipelineState(ID3D12Device* device, PipelineStateCache* cache, uint64_t rootSignatureHash)
 {
+	if (cache)
+	{
+		state = cache->GetOrCreate(device, desc, rootSignatureHash);
+		return;
+	}
 	assert(SUCCEEDED(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&state))));
 }
 
+PipelineStateCache::PipelineStateCache(const std::wstring& path)
+{
+	this->path = path;
+	stats = {};
+	blobs.Load(path); // Ă΋󂩂n߂
+}
+ID3D12PipelineState* PipelineStateCache::GetOrCreate(ID3D12Device* device, D3D12_GRAPHICS_PIPELINE_STATE_DESC desc, uint64_t rootSignatureHash)
+{
+	uint64_t key = HashGraphicsPipelineDesc(desc, rootSignatureHash);
+	// nbVł͕ʂ̐ݒƏՓ˂̂Œgׂ
+	keyWriter.bytes.clear();
+	CanonicalizeGraphicsPipelineDesc(desc, rootSignatureHash, keyWriter);
+	keyWriter.AddValue(desc.pRootSignature);
+	std::vector<State>& bucket = states[key];
+	for (const State& s : bucket)
+	{
+		if (s.key == keyWriter.bytes)
+		{
+			stats.memoryHits++;
+			return s.state;
+		}
+	}
+
+	PROFILE_ZONE("PipelineStateCache::Create");
+	ID3D12PipelineState* state = nullptr;
+	const std::vector<uint8_t>* blob = blobs.Find(key);
+	if (blob)
+	{
+		desc.CachedPSO.pCachedBlob = blob->data();
+		desc.CachedPSO.CachedBlobSizeInBytes = blob->size();
+		HRESULT result = device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&state));
+		if (SUCCEEDED(result)) { stats.diskHits++; }
+		else
+		{
+			// hCoA_v^ςĂ(nbVՓ˂ʂ̐ݒł)蒼ď㏑
+			stats.rejected++;
+			state = nullptr;
+			blobs.Remove(key);
+		}
+		desc.CachedPSO = {};
+	}
+	if (!state)
+	{
+		HRESULT result = device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&state));
+		assert(SUCCEEDED(result));
+		stats.misses++;
+
+		ID3DBlob* cached = nullptr;
+		if (SUCCEEDED(state->GetCachedBlob(&cached)))
+		{
+			blobs.Store(key, cached->GetBufferPointer(), cached->GetBufferSize());
+			cached->Release();
+		}
+	}
+	bucket.push_back({ keyWriter.bytes, state });
+	return state;
+}
+void PipelineStateCache::Save()
+{
+	if (blobs.IsDirty()) { blobs.Save(path); }
+}
+
 RootSignature::RootSignature()
 {
 	params[0] = {};
 	params[1] = {};
+	params[3] = {};
+	params[4] = {};
 	desc = {};
 	rs = nullptr;
+	hash = 0;
 	blob = nullptr;
 }
-void RootSignature::SetParam(D3D12_DESCRIPTOR_RANGE descriptorRange)
+void RootSignature::SetParam(D3D12_DESCRIPTOR_RANGE descriptorRange, UINT bindlessCount)
 {
+	ranges[0] = descriptorRange;
+
 	for (size_t i = 0, j = 0; i < 3; i += 2)
 	{
 		params[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;	// 萔obt@r[
@@ -136,9 +282,27 @@ void RootSignature::SetParam(D3D12_DESCRIPTOR_RANGE descriptorRange)
 	}
 
 	params[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-	params[1].DescriptorTable.pDescriptorRanges = &descriptorRange;
+	params[1].DescriptorTable.pDescriptorRanges = &ranges[0];
 	params[1].DescriptorTable.NumDescriptorRanges = 1;
 	params[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	// XvCg̃CX^Xf[^(StructuredBuffer t1)
+	params[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	params[3].Descriptor.ShaderRegister = 1;
+	params[3].Descriptor.RegisterSpace = 0;
+	params[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	// oChX(q[v̐擪AVF[_͔ԍň)
+	ranges[1] = {};
+	ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	ranges[1].NumDescriptors = bindlessCount;
+	ranges[1].BaseShaderRegister = 0;
+	ranges[1].RegisterSpace = 1;
+	ranges[1].OffsetInDescriptorsFromTableStart = 0;
+	params[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	params[4].DescriptorTable.pDescriptorRanges = &ranges[1];
+	params[4].DescriptorTable.NumDescriptorRanges = 1;
+	params[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 }
 void RootSignature::SetRootSignature(D3D12_STATIC_SAMPLER_DESC samplerDesc)
 {
@@ -153,6 +317,7 @@ void RootSignature::SerializeRootSignature(ID3D12Device* device, ID3DBlob* error
 	HRESULT result = D3D12SerializeRootSignature(&desc,
 		D3D_ROOT_SIGNATURE_VERSION_1_0, &blob, &errorBlob);
 	assert(SUCCEEDED(result));
+	hash = PipelineHasher::Hash(blob->GetBufferPointer(), blob->GetBufferSize());
 	result = device->CreateRootSignature(0, blob->GetBufferPointer(),
 		blob->GetBufferSize(), IID_PPV_ARGS(&rs));
 	assert(SUCCEEDED(result));
@@ -192,6 +357,7 @@ void DirectXInit::AdapterChoice()
 }
 ID3D12Device* DirectXInit::CreateDevice(D3D_FEATURE_LEVEL* levels, size_t levelsNum, ID3D12Device* device)
 {
+	PROFILE_ZONE("D3D12CreateDevice");
 	HRESULT result;
 
 	for (size_t i = 0; i < levelsNum; i++)
@@ -307,50 +473,128 @@ void Blend::SetBlend(BlendMode blendMode)
 	}
 }
 
-ResourceBarrier::ResourceBarrier()
+RenderGraphResources::RenderGraphResources()
+{
+	heap = nullptr;
+	heapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+}
+RenderGraph::ResourceId RenderGraphResources::CreateTransient(ID3D12Device* device, RenderGraph& graph, const std::string& name,
+	const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue)
+{
+	D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+	RenderGraph::ResourceId id = graph.CreateTransient(name, (size_t)info.SizeInBytes, (size_t)info.Alignment);
+	resources.resize(graph.GetResourceCount(), nullptr);
+	descs.resize(graph.GetResourceCount());
+	clearValues.resize(graph.GetResourceCount());
+	hasClearValue.resize(graph.GetResourceCount(), false);
+	discard.resize(graph.GetResourceCount(), false);
+	descs[id] = desc;
+	if (clearValue)
+	{
+		clearValues[id] = *clearValue;
+		hasClearValue[id] = true;
+	}
+	return id;
+}
+void RenderGraphResources::Create(ID3D12Device* device, const RenderGraph& graph)
 {
-	desc = {};
-	desc.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
+	resources.resize(graph.GetResourceCount(), nullptr);
+	descs.resize(graph.GetResourceCount());
+	clearValues.resize(graph.GetResourceCount());
+	hasClearValue.resize(graph.GetResourceCount(), false);
+	discard.resize(graph.GetResourceCount(), false);
+
+	RenderGraph::Stats stats = graph.GetStats();
+	if (stats.aliasedBytes == 0) { return; }
+	D3D12_HEAP_DESC heapDesc{};
+	heapDesc.SizeInBytes = stats.aliasedBytes;
+	heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = heapFlags;
+	HRESULT result = device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap));
+	assert(SUCCEEDED(result));
+
+	for (RenderGraph::ResourceId id = 0; id < graph.GetResourceCount(); id++)
+	{
+		// gȂꎞ\[X͍Ȃ
+		if (!graph.IsTransient(id) || !graph.IsUsed(id)) { continue; }
+		result = device->CreatePlacedResource(heap, graph.GetOffset(id), &descs[id],
+			(D3D12_RESOURCE_STATES)graph.GetInitialState(id),
+			hasClearValue[id] ? &clearValues[id] : nullptr,
+			IID_PPV_ARGS(&resources[id]));
+		assert(SUCCEEDED(result));
+		// DiscardResource͏݂̏ԂłłȂ(ꎞ\[X͎gn߂ɕK̏Ԃł)
+		D3D12_RESOURCE_FLAGS targetFlags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+		uint32_t targetStates = D3D12_RESOURCE_STATE_RENDER_TARGET | D3D12_RESOURCE_STATE_DEPTH_WRITE;
+		discard[id] = (descs[id].Flags & targetFlags) && (graph.GetInitialState(id) & targetStates);
+	}
 }
-void ResourceBarrier::SetState(ID3D12GraphicsCommandList* commandList)
+void RenderGraphResources::SetResource(RenderGraph::ResourceId id, ID3D12Resource* resource)
 {
-	static int state = 0;
-	if (!(state++))
+	if (resources.size() <= id) { resources.resize(id + 1, nullptr); }
+	resources[id] = resource;
+}
+void RenderGraphResources::Barrier(ID3D12GraphicsCommandList* commandList, const std::vector<RenderGraph::Barrier>& graphBarriers)
+{
+	barriers.clear();
+	for (const RenderGraph::Barrier& b : graphBarriers)
 	{
-		desc.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-		desc.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		D3D12_RESOURCE_BARRIER barrier{};
+		if (b.aliasing)
+		{
+			// OɒNgĂȂꏊȂAgn߂łoA͗vȂ
+			if (!b.shared) { continue; }
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			// O̎傪Ȃnull(dȂǂł悢)
+			barrier.Aliasing.pResourceBefore = b.aliasedFrom == RenderGraph::INVALID ? nullptr : resources[b.aliasedFrom];
+			barrier.Aliasing.pResourceAfter = resources[b.resource];
+			barriers.push_back(barrier);
+			continue;
+		}
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = resources[b.resource];
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = (D3D12_RESOURCE_STATES)b.before;
+		barrier.Transition.StateAfter = (D3D12_RESOURCE_STATES)b.after;
+		barriers.push_back(barrier);
 	}
-	else
+	if (!barriers.empty()) { commandList->ResourceBarrier((UINT)barriers.size(), barriers.data()); }
+
+	// d˂Ēu_[^[QbgƐ[x͒gsȂ̂ŁAŏ̑ƂDiscardResource
+	for (const RenderGraph::Barrier& b : graphBarriers)
 	{
-		desc.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-		desc.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		if (b.aliasing && discard[b.resource]) { commandList->DiscardResource(resources[b.resource], nullptr); }
 	}
-	commandList->ResourceBarrier(1, &desc);
-	state %= 2;
 }
 
-Command::Command(ID3D12Device* device)
+Command::Command(ID3D12Device* device, UINT frameCount) :frameCount(frameCount)
 {
-	allocator = nullptr;
 	list = nullptr;
 	queue = nullptr;
 	queueDesc = {};
 	devicePtr = device;
 	cLists = {};
+	frameIndex = 0;
+	fenceVals.resize(frameCount);
 }
 void Command::CreateCommandAllocator()
 {
-	assert(SUCCEEDED(
-		devicePtr->CreateCommandAllocator(
+	// t[ƂɃAP[^AGPUgĂԂ͐GȂ
+	allocators.resize(frameCount);
+	for (size_t i = 0; i < allocators.size(); i++)
+	{
+		HRESULT result = devicePtr->CreateCommandAllocator(
 			D3D12_COMMAND_LIST_TYPE_DIRECT,
-			IID_PPV_ARGS(&allocator))));
+			IID_PPV_ARGS(&allocators[i]));
+		assert(SUCCEEDED(result));
+	}
 }
 void Command::CreateCommandList()
 {
 	assert(SUCCEEDED(
 		devicePtr->CreateCommandList(0,
 			D3D12_COMMAND_LIST_TYPE_DIRECT,
-			allocator, nullptr,
+			allocators[frameIndex], nullptr,
 			IID_PPV_ARGS(&list))));
 }
 void Command::CreateCommandQueue()
@@ -360,51 +604,282 @@ void Command::CreateCommandQueue()
 }
 void Command::Reset()
 {
-	assert(SUCCEEDED(allocator->Reset())); // L[NA
-	assert(SUCCEEDED(list->Reset(allocator, nullptr))); // ĂуR}hXg𒙂߂鏀
+	HRESULT result = allocators[frameIndex]->Reset(); // L[NA
+	assert(SUCCEEDED(result));
+	result = list->Reset(allocators[frameIndex], nullptr); // ĂуR}hXg𒙂߂鏀
+	assert(SUCCEEDED(result));
 }
 void Command::ExecuteCommandLists()
 {
 	cLists = list;
 	queue->ExecuteCommandLists(1, &cLists);
 }
+void Command::ExecuteCommandLists(std::vector<ID3D12CommandList*>& lists)
+{
+	queue->ExecuteCommandLists((UINT)lists.size(), lists.data());
+}
+UINT64 Command::Signal(Fence& fence)
+{
+	// ̃t[̃tFXloĂ
+	fenceVals[frameIndex] = fence.Signal(queue);
+	return fenceVals[frameIndex];
+}
+void Command::NextFrame(Fence& fence)
+{
+	WaitFrame(fence);
+	Reset();
+}
+void Command::WaitFrame(Fence& fence)
+{
+	// frameCountt[O̓AP[^̊҂
+	frameIndex = (frameIndex + 1) % frameCount;
+	fence.Wait(fenceVals[frameIndex]);
+}
+
+PipelineId PipelineTable::Add(ID3D12PipelineState* state, D3D_PRIMITIVE_TOPOLOGY topology)
+{
+	entries.push_back({ state, topology });
+	return (PipelineId)entries.size() - 1;
+}
+RootSignatureId PipelineTable::Add(ID3D12RootSignature* rootSignature)
+{
+	rootSignatures.push_back(rootSignature);
+	return (RootSignatureId)rootSignatures.size() - 1;
+}
+
+BufferId BufferTable::Add(const D3D12_VERTEX_BUFFER_VIEW& view)
+{
+	entries.push_back({ view, {} });
+	return (BufferId)entries.size() - 1;
+}
+BufferId BufferTable::Add(const D3D12_INDEX_BUFFER_VIEW& view)
+{
+	entries.push_back({ {}, view });
+	return (BufferId)entries.size() - 1;
+}
+
+CommandContext::CommandContext(ID3D12Device* device, UINT frameCount, const CommandBindings* bindings) :
+	bindings(bindings)
+{
+	topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	allocators.resize(frameCount);
+	for (size_t i = 0; i < allocators.size(); i++)
+	{
+		HRESULT result = device->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocators[i]));
+		assert(SUCCEEDED(result));
+	}
+	list = nullptr;
+	HRESULT result = device->CreateCommandList(0,
+		D3D12_COMMAND_LIST_TYPE_DIRECT, allocators[0], nullptr, IID_PPV_ARGS(&list));
+	assert(SUCCEEDED(result));
+	list->Close(); // BeginŃZbg܂ŕĂ
+}
+void CommandContext::Begin(size_t frameIndex)
+{
+	// D3D12Queue::NextFramẽt[̊҂Ȃ̂ŃZbgĂ悢
+	HRESULT result = allocators[frameIndex]->Reset();
+	assert(SUCCEEDED(result));
+	result = list->Reset(allocators[frameIndex], nullptr);
+	assert(SUCCEEDED(result));
+	topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	if (bindings->descriptorHeap) { list->SetDescriptorHeaps(1, &bindings->descriptorHeap); }
+}
+void CommandContext::End()
+{
+	HRESULT result = list->Close();
+	assert(SUCCEEDED(result));
+}
+void CommandContext::Barrier(const std::vector<RenderGraph::Barrier>& barriers)
+{
+	bindings->graphResources->Barrier(list, barriers);
+}
+void CommandContext::SetRenderTarget(uint64_t cpuHandle)
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = { (SIZE_T)cpuHandle };
+	list->OMSetRenderTargets(1, &handle, false, nullptr);
+}
+void CommandContext::ClearRenderTarget(uint64_t cpuHandle, const float color[4])
+{
+	list->ClearRenderTargetView({ (SIZE_T)cpuHandle }, color, 0, nullptr);
+}
+void CommandContext::SetViewport(uint32_t width, uint32_t height)
+{
+	D3D12_VIEWPORT viewport{};
+	viewport.Width = (FLOAT)width;
+	viewport.Height = (FLOAT)height;
+	viewport.MaxDepth = 1.0f;
+	list->RSSetViewports(1, &viewport);
+	D3D12_RECT scissorRect = { 0, 0, (LONG)width, (LONG)height };
+	list->RSSetScissorRects(1, &scissorRect);
+}
+void CommandContext::SetVertexBuffer(BufferId buffer)
+{
+	list->IASetVertexBuffers(0, 1, &bindings->buffers->entries[buffer].vertex);
+}
+void CommandContext::SetIndexBuffer(BufferId buffer)
+{
+	list->IASetIndexBuffer(&bindings->buffers->entries[buffer].index);
+}
+void CommandContext::SetRootSignature(RootSignatureId rootSignature)
+{
+	list->SetGraphicsRootSignature(bindings->pipelines->rootSignatures[rootSignature]);
+}
+void CommandContext::SetPipeline(PipelineId pipeline)
+{
+	const PipelineTable::Entry& entry = bindings->pipelines->entries[pipeline];
+	list->SetPipelineState(entry.state);
+	if (topology != entry.topology)
+	{
+		topology = entry.topology;
+		list->IASetPrimitiveTopology(topology);
+	}
+}
+void CommandContext::SetConstantBuffer(uint32_t rootParam, uint64_t gpu)
+{
+	list->SetGraphicsRootConstantBufferView(rootParam, gpu);
+}
+void CommandContext::SetShaderResource(uint32_t rootParam, uint64_t gpu)
+{
+	list->SetGraphicsRootShaderResourceView(rootParam, gpu);
+}
+void CommandContext::SetDescriptorTable(uint32_t rootParam, uint64_t gpuHandle)
+{
+	list->SetGraphicsRootDescriptorTable(rootParam, { gpuHandle });
+}
+void CommandContext::Draw(uint32_t vertexCount, uint32_t instanceCount)
+{
+	list->DrawInstanced(vertexCount, instanceCount, 0, 0);
+}
+void CommandContext::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex)
+{
+	list->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, 0);
+}
+
+D3D12Queue::D3D12Queue(Command& command, Fence& fence, SwapChain& swapChain) :
+	command(command), fence(fence), swapChain(swapChain)
+{
+	HRESULT result = command.list->Close();
+	assert(SUCCEEDED(result));
+}
+void D3D12Queue::Submit(GraphicsCommandList* const* lists, size_t count)
+{
+	nativeLists.clear();
+	for (size_t i = 0; i < count; i++) { nativeLists.push_back(static_cast<CommandContext*>(lists[i])->list); }
+	command.ExecuteCommandLists(nativeLists);
+}
+uint64_t D3D12Queue::Signal()
+{
+	return command.Signal(fence);
+}
+uint64_t D3D12Queue::GetCompletedValue()
+{
+	return fence.f->GetCompletedValue();
+}
+void D3D12Queue::Present()
+{
+	swapChain.Flip();
+}
+void D3D12Queue::NextFrame()
+{
+	command.WaitFrame(fence);
+}
+size_t D3D12Queue::GetFrameIndex()
+{
+	return command.GetFrameIndex();
+}
 
 Fence::Fence()
 {
 	f = nullptr;
 	val = 0;
+	event = nullptr;
+}
+Fence::~Fence()
+{
+	if (event) { CloseHandle(event); }
 }
 void Fence::CreateFence(ID3D12Device* device)
 {
 	assert(SUCCEEDED(device->CreateFence(val, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&f))));
+	// ҂тɍ炸g
+	event = CreateEvent(nullptr, false, false, nullptr);
+	assert(event);
+}
+UINT64 Fence::Signal(ID3D12CommandQueue* queue)
+{
+	HRESULT result = queue->Signal(f, ++val);
+	assert(SUCCEEDED(result));
+	return val;
 }
-void Fence::Wait()
+void Fence::Wait(UINT64 value)
 {
-	if (f->GetCompletedValue() != val)
+	if (f->GetCompletedValue() < value)
 	{
-		HANDLE event = CreateEvent(nullptr, false, false, nullptr);
-		f->SetEventOnCompletion(val, event);
-		if (event != 0)
-		{
-			WaitForSingleObject(event, INFINITE);
-			CloseHandle(event);
-		}
+		HRESULT result = f->SetEventOnCompletion(value, event);
+		assert(SUCCEEDED(result));
+		WaitForSingleObject(event, INFINITE);
 	}
 }
 
-void ShaderResourceView::SetHeapDesc()
+void ShaderResourceView::SetHeapDesc(UINT persistentCount, UINT transientCount)
 {
+	this->persistentCount = persistentCount;
+	this->transientCount = transientCount;
+
 	heapDesc = {};
 	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	heapDesc.NumDescriptors = 2056;
+	heapDesc.NumDescriptors = persistentCount + transientCount;
 }
 void ShaderResourceView::CreateDescriptorHeap(ID3D12Device* device)
 {
 	assert(SUCCEEDED(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&heap))));
+	devicePtr = device;
+	GetDescriptorHandleForHeapStart(CPU);
+	GetDescriptorHandleForHeapStart(GPU);
+	increment = device->GetDescriptorHandleIncrementSize(heapDesc.Type);
+	allocator = DescriptorAllocator(persistentCount, transientCount);
+
+	// oChX̃e[u͏풓̈ŜŵŁAgp̔ԍnull SRVŖ߂Ă
+	// (ꎞ̈͐؂ot[ŕK̂Ŗ߂Ȃ)
+	for (UINT i = 0; i < persistentCount; i++) { CreateNullView(i); }
+}
+void ShaderResourceView::CreateNullView(UINT index)
+{
+	D3D12_SHADER_RESOURCE_VIEW_DESC nullView{};
+	nullView.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	nullView.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	nullView.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	nullView.Texture2D.MipLevels = 1;
+	devicePtr->CreateShaderResourceView(nullptr, &nullView, GetCPUHandle(index));
+}
+void ShaderResourceView::Free(UINT index, UINT64 fenceValue)
+{
+	bool freed = allocator.Free(index, fenceValue);
+	assert(freed);
+}
+void ShaderResourceView::Reclaim(UINT64 completedValue)
+{
+	// _ł͂܂Õt[GPUǂł邩Ȃ̂ŁA͊҂Ă
+	reclaimed.clear();
+	allocator.Reclaim(completedValue, &reclaimed);
+	for (uint32_t index : reclaimed) { CreateNullView(index); }
 }
 void ShaderResourceView::GetDescriptorHandleForHeapStart(Type type)
 {
 	if (type == CPU) { handle = heap->GetCPUDescriptorHandleForHeapStart(); }
 	if (type == GPU) { gpuHandle = heap->GetGPUDescriptorHandleForHeapStart(); }
+}
+D3D12_CPU_DESCRIPTOR_HANDLE ShaderResourceView::GetCPUHandle(UINT index) const
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE result = handle;
+	result.ptr += (SIZE_T)index * increment;
+	return result;
+}
+D3D12_GPU_DESCRIPTOR_HANDLE ShaderResourceView::GetGPUHandle(UINT index) const
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE result = gpuHandle;
+	result.ptr += (UINT64)index * increment;
+	return result;
 }
\ No newline at end of file
@@ -9,6 +9,12 @@
 #include <d3dcompiler.h>
 #include <dinput.h>
 #include <DirectXTex.h>
+#include "CommandJobSystem.h"
+#include "GraphicsBackend.h"
+#include "PipelineCache.h"
+#include "ShaderArchive.h"
+#include "DescriptorAllocator.h"
+#include "RenderGraph.h"
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -20,12 +26,29 @@ using namespace DirectX;
 LRESULT WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam);
 struct Int2 { int width, height; };
 
+// ORpC̐ݒ(IDɂ܂܂̂ŕςƃA[JCu͍蒼ɂȂ)
+const UINT SHADER_ARCHIVE_FLAGS = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+
+// ORpCVF[_(Gg[|Cgmain)
+struct ShaderSource
+{
+	LPCWSTR fileName;
+	LPCSTR target;
+	std::vector<ShaderDefine> defines;
+};
+// sourcespathɂ܂Ƃ߂(Opath\[XςĂȂ̂͂̂܂܎g)
+bool BuildShaderArchive(const std::wstring& path, const ShaderSource* sources, size_t count);
+
 class ShaderBlob
 {
 public:
-	ID3DBlob* blob = nullptr;
+	ID3DBlob* blob = nullptr; // sɃRpC
+	const void* code = nullptr; // oCgR[h(A[JCuǂ񂾎͂̒w)
+	size_t size = 0;
 
-	ShaderBlob(const LPCWSTR fileName, const LPCSTR target, ID3DBlob* errorBlob);
+	// archiveɂ΂gA΃RpC(\[X͓ǂ܂Ȃ)
+	ShaderBlob(const LPCWSTR fileName, const LPCSTR target, ID3DBlob* errorBlob,
+		const ShaderArchive* archive = nullptr, const std::vector<ShaderDefine>& defines = {});
 };
 
 class WindowsAPI
@@ -40,6 +63,36 @@ public:
 	void MyUnregisterClass();
 };
 
+// pCvCXe[g̒u(ݒ͎g񂵁ARpCʂ̓t@CɎc)
+class PipelineStateCache
+{
+private:
+	struct State
+	{
+		std::vector<uint8_t> key; // CanonicalizeGraphicsPipelineDesč(nbVɔׂ)
+		ID3D12PipelineState* state;
+	};
+	PipelineCache blobs;
+	std::unordered_map<uint64_t, std::vector<State>> states;
+	PipelineKeyWriter keyWriter;
+	std::wstring path;
+public:
+	struct Stats
+	{
+		size_t memoryHits; // 쐬ς݂g񂵂
+		size_t diskHits; // t@C̃oCi
+		size_t misses; // ꂩ
+		size_t rejected; // hCöႢȂǂŃoCigȂ
+	};
+	Stats stats;
+
+	PipelineStateCache(const std::wstring& path);
+	// rootSignatureHashRootSignature::hash
+	ID3D12PipelineState* GetOrCreate(ID3D12Device* device, D3D12_GRAPHICS_PIPELINE_STATE_DESC desc, uint64_t rootSignatureHash);
+	// V̂΃t@Cɏo
+	void Save();
+};
+
 class Pipeline
 {
 public:
@@ -53,20 +106,23 @@ public:
 	void SetInputLayout(D3D12_INPUT_ELEMENT_DESC* inputLayout, UINT layoutNum);
 	void SetPrimitiveTopology();
 	void SetOthers();
-	void CreatePipelineState(ID3D12Device* device);
+	void CreatePipelineState(ID3D12Device* device, PipelineStateCache* cache = nullptr, uint64_t rootSignatureHash = 0);
 };
 
 class RootSignature
 {
 private:
-	D3D12_ROOT_PARAMETER params[3];
+	D3D12_ROOT_PARAMETER params[5];
+	D3D12_DESCRIPTOR_RANGE ranges[2]; // VACY܂ŎcĂ
 	D3D12_ROOT_SIGNATURE_DESC desc;
 	ID3DBlob* blob;
 public:
 	ID3D12RootSignature* rs;
+	uint64_t hash; // VACYʂ̃nbV(pCvC̃L[Ɏg)
 
 	RootSignature();
-	void SetParam(D3D12_DESCRIPTOR_RANGE descriptorRange);
+	// bindlessCount̓oChXp̃e[u(t0, space1)̐
+	void SetParam(D3D12_DESCRIPTOR_RANGE descriptorRange, UINT bindlessCount);
 	void SetRootSignature(D3D12_STATIC_SAMPLER_DESC samplerDesc);
 	void SerializeRootSignature(ID3D12Device* device, ID3DBlob* errorBlob);
 };
@@ -135,13 +191,49 @@ public:
 	void SetBlend(BlendMode blendMode);
 };
 
-class ResourceBarrier
+// RenderGraph̃\[X̎̂Aꎞ\[X1̃q[vɏd˂Ēu
+class RenderGraphResources
+{
+private:
+	std::vector<ID3D12Resource*> resources; // ResourceId
+	std::vector<D3D12_RESOURCE_DESC> descs;
+	std::vector<D3D12_CLEAR_VALUE> clearValues;
+	std::vector<bool> hasClearValue;
+	std::vector<bool> discard; // gn߂DiscardResource(_[^[QbgƐ[x)
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+public:
+	ID3D12Heap* heap;
+	// eBA1̃n[hEFAł1̃q[vɒuނ
+	D3D12_HEAP_FLAGS heapFlags;
+
+	RenderGraphResources();
+	// 傫ƔzufoCXɕgraphֈꎞ\[X
+	// ƏdȂ̂ŁA_[^[QbgƐ[xBarriergn߂DiscardResource
+	RenderGraph::ResourceId CreateTransient(ID3D12Device* device, RenderGraph& graph, const std::string& name,
+		const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+	// graph.Compile()̌ŁAq[vꎞ\[Xzu
+	void Create(ID3D12Device* device, const RenderGraph& graph);
+	// O玝񂾃\[X(obNobt@Ȃǂ̓t[Ƃɍւ)
+	void SetResource(RenderGraph::ResourceId id, ID3D12Resource* resource);
+	ID3D12Resource* Get(RenderGraph::ResourceId id) const { return resources[id]; }
+	// oA1ResourceBarrierŐς݁Agn߂ꎞ\[XDiscardResource
+	void Barrier(ID3D12GraphicsCommandList* commandList, const std::vector<RenderGraph::Barrier>& graphBarriers);
+};
+
+class Fence
 {
+private:
+	HANDLE event;
 public:
-	D3D12_RESOURCE_BARRIER desc;
+	ID3D12Fence* f;
+	UINT64 val;
 
-	ResourceBarrier();
-	void SetState(ID3D12GraphicsCommandList* commandList);
+	Fence();
+	~Fence();
+	void CreateFence(ID3D12Device* device);
+	UINT64 Signal(ID3D12CommandQueue* queue);
+	void Wait() { Wait(val); }
+	void Wait(UINT64 value);
 };
 
 class Command
@@ -149,45 +241,145 @@ class Command
 private:
 	ID3D12Device* devicePtr;
 	D3D12_COMMAND_QUEUE_DESC queueDesc;
-	ID3D12CommandAllocator* allocator;
+	std::vector<ID3D12CommandAllocator*> allocators;
+	std::vector<UINT64> fenceVals;
+	UINT frameIndex;
 	ID3D12CommandList* cLists;
 public:
+	static const UINT DEFAULT_FRAME_COUNT = 2;
+
 	ID3D12GraphicsCommandList* list;
 	ID3D12CommandQueue* queue;
+	const UINT frameCount;
 
-	Command(ID3D12Device* device);
+	Command(ID3D12Device* device, UINT frameCount = DEFAULT_FRAME_COUNT);
 	void CreateCommandAllocator();
 	void CreateCommandList();
 	void CreateCommandQueue();
 	void Reset();
 	void ExecuteCommandLists();
+	void ExecuteCommandLists(std::vector<ID3D12CommandList*>& lists);
+	UINT64 Signal(Fence& fence);
+	void NextFrame(Fence& fence);
+	// listgȂ(CommandContextŋL^鎞)̓AP[^߂ɑ҂
+	void WaitFrame(Fence& fence);
+	UINT GetFrameIndex() { return frameIndex; }
 };
 
-class Fence
+// PipelineIdpCvCXe[gƌ`ARootSignatureId烋[gVOl`\
+class PipelineTable
+{
+public:
+	struct Entry
+	{
+		ID3D12PipelineState* state;
+		D3D_PRIMITIVE_TOPOLOGY topology;
+	};
+	std::vector<Entry> entries;
+	std::vector<ID3D12RootSignature*> rootSignatures;
+
+	PipelineId Add(ID3D12PipelineState* state, D3D_PRIMITIVE_TOPOLOGY topology);
+	RootSignatureId Add(ID3D12RootSignature* rootSignature);
+};
+
+// BufferId璸_obt@r[CfbNXobt@r[\
+class BufferTable
+{
+public:
+	struct Entry
+	{
+		D3D12_VERTEX_BUFFER_VIEW vertex;
+		D3D12_INDEX_BUFFER_VIEW index;
+	};
+	std::vector<Entry> entries;
+
+	BufferId Add(const D3D12_VERTEX_BUFFER_VIEW& view);
+	BufferId Add(const D3D12_INDEX_BUFFER_VIEW& view);
+};
+
+// CommandContextԍ(SẴXgŋL)
+struct CommandBindings
+{
+	const PipelineTable* pipelines;
+	const BufferTable* buffers;
+	RenderGraphResources* graphResources;
+	ID3D12DescriptorHeap* descriptorHeap; // BeginŐݒ肷(VF[_猩q[v)
+};
+
+class CommandContext :public GraphicsCommandList
 {
 private:
-	HANDLE event;
+	std::vector<ID3D12CommandAllocator*> allocators;
+	const CommandBindings* bindings;
+	D3D_PRIMITIVE_TOPOLOGY topology; // `󂪕ς鎞ς
 public:
-	ID3D12Fence* f;
-	UINT64 val;
+	ID3D12GraphicsCommandList* list;
 
-	Fence();
-	void CreateFence(ID3D12Device* device);
-	void Wait();
+	CommandContext(ID3D12Device* device, UINT frameCount, const CommandBindings* bindings);
+	void Begin(size_t frameIndex) override;
+	void End() override;
+
+	void Barrier(const std::vector<RenderGraph::Barrier>& barriers) override;
+	void SetRenderTarget(uint64_t cpuHandle) override;
+	void ClearRenderTarget(uint64_t cpuHandle, const float color[4]) override;
+	void SetViewport(uint32_t width, uint32_t height) override;
+	void SetVertexBuffer(BufferId buffer) override;
+	void SetIndexBuffer(BufferId buffer) override;
+	void SetRootSignature(RootSignatureId rootSignature) override;
+	void SetPipeline(PipelineId pipeline) override;
+	void SetConstantBuffer(uint32_t rootParam, uint64_t gpu) override;
+	void SetShaderResource(uint32_t rootParam, uint64_t gpu) override;
+	void SetDescriptorTable(uint32_t rootParam, uint64_t gpuHandle) override;
+	void Draw(uint32_t vertexCount, uint32_t instanceCount) override;
+	void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex) override;
+};
+
+// CommandAFenceASwapChainGraphicsQueueƂĎg
+class D3D12Queue :public GraphicsQueue
+{
+private:
+	Command& command;
+	Fence& fence;
+	SwapChain& swapChain;
+	std::vector<ID3D12CommandList*> nativeLists;
+public:
+	D3D12Queue(Command& command, Fence& fence, SwapChain& swapChain);
+	// listsCommandContextł邱(Command̃Xg͎gȂ̂ŕĂ)
+	void Submit(GraphicsCommandList* const* lists, size_t count) override;
+	uint64_t Signal() override;
+	uint64_t GetCompletedValue() override;
+	void Present() override;
+	void NextFrame() override;
+	size_t GetFrameIndex() override;
 };
 
 class ShaderResourceView
 {
 private:
 	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
+	UINT persistentCount;
+	UINT transientCount;
+	UINT increment;
+	ID3D12Device* devicePtr;
+	std::vector<uint32_t> reclaimed;
+
+	void CreateNullView(UINT index);
 public:
 	enum Type { CPU, GPU };
 
 	ID3D12DescriptorHeap* heap;
-	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle;
-	D3D12_CPU_DESCRIPTOR_HANDLE handle;
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle; // q[v̐擪
+	D3D12_CPU_DESCRIPTOR_HANDLE handle; // q[v̐擪
+	DescriptorAllocator allocator; // ԍ̊蓖(풓̈̓oChX̓YɂȂ)
 
-	void SetHeapDesc();
+	// 풓̈̐ƁAt[܂ŉ񂷈ꎞ̈̐
+	void SetHeapDesc(UINT persistentCount = 1024, UINT transientCount = 256);
 	void CreateDescriptorHeap(ID3D12Device* device);
+	// fenceValue̊ɔԍ󂫂֖߂
+	void Free(UINT index, UINT64 fenceValue);
+	// GPUgIԍ󂫂֖߂Anull SRVŖ߂(ς݂̃\[Xw܂܂ɂȂ)
+	void Reclaim(UINT64 completedValue);
 	void GetDescriptorHandleForHeapStart(Type type);
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCPUHandle(UINT index) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGPUHandle(UINT index) const;
 };
\ No newline at end of file
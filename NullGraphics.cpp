@@ -0,0 +1,71 @@
+﻿#include "NullGraphics.h"
+#include <cstdlib>
+
+void NullCommandList::Begin(size_t)
+{
+	commands.clear();
+	for (size_t& count : counts) { count = 0; }
+}
+
+NullQueue::NullQueue(size_t frameCount)
+{
+	this->frameCount = frameCount == 0 ? 1 : frameCount;
+	frameIndex = 0;
+	fenceValue = 0;
+	presents = 0;
+	frameStats = {};
+	pending = {};
+}
+
+void NullQueue::Submit(GraphicsCommandList* const* lists, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const NullCommandList& list = *static_cast<const NullCommandList*>(lists[i]);
+		pending.lists++;
+		pending.commands += list.GetCommands().size();
+		pending.draws += list.GetCount(NullCommandList::DRAW) + list.GetCount(NullCommandList::DRAW_INDEXED);
+		pending.stateChanges += list.GetCount(NullCommandList::SET_RENDER_TARGET)
+			+ list.GetCount(NullCommandList::SET_VIEWPORT)
+			+ list.GetCount(NullCommandList::SET_VERTEX_BUFFER)
+			+ list.GetCount(NullCommandList::SET_INDEX_BUFFER)
+			+ list.GetCount(NullCommandList::SET_ROOT_SIGNATURE)
+			+ list.GetCount(NullCommandList::SET_PIPELINE)
+			+ list.GetCount(NullCommandList::SET_CONSTANT_BUFFER)
+			+ list.GetCount(NullCommandList::SET_SHADER_RESOURCE)
+			+ list.GetCount(NullCommandList::SET_DESCRIPTOR_TABLE);
+		for (const NullCommandList::Command& command : list.GetCommands())
+		{
+			if (command.op == NullCommandList::BARRIER) { pending.barriers += command.a; }
+		}
+	}
+}
+void NullQueue::NextFrame()
+{
+	frameIndex = (frameIndex + 1) % frameCount;
+	frameStats = pending;
+	pending = {};
+}
+
+bool NullUploadPages::CreatePage(size_t size, UploadPage& page)
+{
+	page.cpu = static_cast<uint8_t*>(malloc(size));
+	if (!page.cpu) { return false; }
+	page.resource = page.cpu;
+	page.gpu = nextAddress;
+	page.size = size;
+	nextAddress += (size + 0xffff) & ~(uint64_t)0xffff;
+	return true;
+}
+void NullUploadPages::DestroyPage(UploadPage& page)
+{
+	free(page.cpu);
+	page = {};
+}
+
+uint64_t NullCopyQueue::Submit()
+{
+	submitted.swap(pending);
+	pending.clear();
+	return ++fenceValue;
+}
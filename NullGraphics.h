@@ -0,0 +1,151 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GraphicsBackend.h"
+#include "TextureUploader.h"
+
+// GPUを使わず、コマンドを覚えるだけのバックエンド(Linuxでも動くのでCPUの負荷を測れる)
+
+class NullCommandList :public GraphicsCommandList
+{
+public:
+	enum Op : uint8_t
+	{
+		BARRIER,
+		SET_RENDER_TARGET,
+		CLEAR_RENDER_TARGET,
+		SET_VIEWPORT,
+		SET_VERTEX_BUFFER,
+		SET_INDEX_BUFFER,
+		SET_ROOT_SIGNATURE,
+		SET_PIPELINE,
+		SET_CONSTANT_BUFFER,
+		SET_SHADER_RESOURCE,
+		SET_DESCRIPTOR_TABLE,
+		DRAW,
+		DRAW_INDEXED,
+		OP_COUNT
+	};
+	struct Command
+	{
+		Op op;
+		uint32_t a; // バリアの数、幅、バッファ、ルートシグネチャ、パイプライン、ルートパラメータ、頂点数
+		uint64_t b; // アドレス、高さ、インスタンス数
+		uint32_t c; // インデックスの開始位置
+	};
+
+	void Begin(size_t frameIndex) override;
+	void End() override {}
+
+	void Barrier(const std::vector<RenderGraph::Barrier>& barriers) override
+	{
+		if (!barriers.empty()) { Push(BARRIER, (uint32_t)barriers.size(), 0); }
+	}
+	void SetRenderTarget(uint64_t cpuHandle) override { Push(SET_RENDER_TARGET, 0, cpuHandle); }
+	void ClearRenderTarget(uint64_t cpuHandle, const float*) override { Push(CLEAR_RENDER_TARGET, 0, cpuHandle); }
+	void SetViewport(uint32_t width, uint32_t height) override { Push(SET_VIEWPORT, width, height); }
+	void SetVertexBuffer(BufferId buffer) override { Push(SET_VERTEX_BUFFER, buffer, 0); }
+	void SetIndexBuffer(BufferId buffer) override { Push(SET_INDEX_BUFFER, buffer, 0); }
+	void SetRootSignature(RootSignatureId rootSignature) override { Push(SET_ROOT_SIGNATURE, rootSignature, 0); }
+	void SetPipeline(PipelineId pipeline) override { Push(SET_PIPELINE, pipeline, 0); }
+	void SetConstantBuffer(uint32_t rootParam, uint64_t gpu) override { Push(SET_CONSTANT_BUFFER, rootParam, gpu); }
+	void SetShaderResource(uint32_t rootParam, uint64_t gpu) override { Push(SET_SHADER_RESOURCE, rootParam, gpu); }
+	void SetDescriptorTable(uint32_t rootParam, uint64_t gpuHandle) override { Push(SET_DESCRIPTOR_TABLE, rootParam, gpuHandle); }
+	void Draw(uint32_t vertexCount, uint32_t instanceCount) override { Push(DRAW, vertexCount, instanceCount); }
+	void DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t) override
+	{
+		Push(DRAW_INDEXED, indexCount, instanceCount, startIndex);
+	}
+
+	// Beginから後に記録したもの
+	const std::vector<Command>& GetCommands() const { return commands; }
+	size_t GetCount(Op op) const { return counts[op]; }
+
+private:
+	std::vector<Command> commands; // 容量はフレームをまたいで使い回す
+	size_t counts[OP_COUNT] = {};
+
+	void Push(Op op, uint32_t a, uint64_t b, uint32_t c = 0)
+	{
+		commands.push_back({ op, a, b, c });
+		counts[op]++;
+	}
+};
+
+// 提出されたらすぐに完了したことにするキュー
+class NullQueue :public GraphicsQueue
+{
+public:
+	// 直前のフレームで提出したもの
+	struct Stats
+	{
+		size_t lists;
+		size_t commands;
+		size_t draws;
+		size_t stateChanges; // パイプライン、ルート引数、バッファ、描画先の設定
+		size_t barriers;
+	};
+
+	NullQueue(size_t frameCount = 2);
+
+	// listsはNullCommandListであること
+	void Submit(GraphicsCommandList* const* lists, size_t count) override;
+	uint64_t Signal() override { return ++fenceValue; }
+	uint64_t GetCompletedValue() override { return fenceValue; }
+	void Present() override { presents++; }
+	void NextFrame() override;
+	size_t GetFrameIndex() override { return frameIndex; }
+
+	Stats GetFrameStats() const { return frameStats; }
+	size_t GetPresentCount() const { return presents; }
+
+private:
+	size_t frameCount;
+	size_t frameIndex;
+	uint64_t fenceValue;
+	size_t presents;
+	Stats frameStats;
+	Stats pending;
+};
+
+// ヒープのメモリをUPLOADヒープの代わりに渡す(GPUアドレスは重ならない偽物)
+class NullUploadPages :public UploadPageProvider
+{
+public:
+	NullUploadPages() : nextAddress(0x10000) {}
+	bool CreatePage(size_t size, UploadPage& page) override;
+	void DestroyPage(UploadPage& page) override;
+
+private:
+	uint64_t nextAddress;
+};
+
+// コピーを覚えて、提出したらすぐに完了したことにするコピーキュー
+class NullCopyQueue :public TextureCopyQueue
+{
+public:
+	struct Copy
+	{
+		void* texture;
+		uint32_t subresource;
+		void* staging;
+		TextureFootprint footprint;
+	};
+
+	NullCopyQueue() : fenceValue(0) {}
+	void CopyTexture(void* texture, uint32_t subresource, void* staging, const TextureFootprint& footprint) override
+	{
+		pending.push_back({ texture, subresource, staging, footprint });
+	}
+	uint64_t Submit() override;
+	uint64_t GetCompletedValue() override { return fenceValue; }
+
+	// 直前のSubmitで実行したもの
+	const std::vector<Copy>& GetSubmitted() const { return submitted; }
+
+private:
+	std::vector<Copy> pending;
+	std::vector<Copy> submitted;
+	uint64_t fenceValue;
+};
@@ -0,0 +1,183 @@
+﻿#include "PipelineCache.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const size_t HEADER_SIZE = 16;
+	const size_t ENTRY_SIZE = 32;
+
+	FILE* OpenFile(const std::wstring& path, const wchar_t* mode)
+	{
+#ifdef _WIN32
+		FILE* fp = nullptr;
+		if (_wfopen_s(&fp, path.c_str(), mode) != 0) { return nullptr; }
+		return fp;
+#else
+		std::string narrow(path.begin(), path.end());
+		std::string narrowMode(mode, mode + wcslen(mode));
+		return fopen(narrow.c_str(), narrowMode.c_str());
+#endif
+	}
+
+	void Write32(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++) { out.push_back((uint8_t)(value >> (i * 8))); }
+	}
+	void Write64(std::vector<uint8_t>& out, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++) { out.push_back((uint8_t)(value >> (i * 8))); }
+	}
+	uint64_t Read(const uint8_t* data, size_t bytes)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < bytes; i++) { value |= (uint64_t)data[i] << (i * 8); }
+		return value;
+	}
+}
+
+void PipelineHasher::Add(const void* data, size_t size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		value ^= p[i];
+		value *= 1099511628211ull;
+	}
+}
+void PipelineHasher::AddString(const char* str)
+{
+	if (!str)
+	{
+		AddValue((uint8_t)0);
+		return;
+	}
+	AddValue((uint8_t)1);
+	Add(str, strlen(str) + 1);
+}
+uint64_t PipelineHasher::Hash(const void* data, size_t size)
+{
+	PipelineHasher h;
+	h.Add(data, size);
+	return h.Get();
+}
+
+void PipelineKeyWriter::Add(const void* data, size_t size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	bytes.insert(bytes.end(), p, p + size);
+}
+void PipelineKeyWriter::AddString(const char* str)
+{
+	if (!str)
+	{
+		AddValue((uint8_t)0);
+		return;
+	}
+	AddValue((uint8_t)1);
+	Add(str, strlen(str) + 1);
+}
+void PipelineKeyWriter::AddBlob(const void* data, size_t size)
+{
+	if (!data) { size = 0; }
+	AddValue((uint64_t)size);
+	Add(data, size);
+}
+
+const std::vector<uint8_t>* PipelineCache::Find(uint64_t key) const
+{
+	auto it = blobs.find(key);
+	return it == blobs.end() ? nullptr : &it->second;
+}
+void PipelineCache::Store(uint64_t key, const void* data, size_t size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	blobs[key].assign(p, p + size);
+	dirty = true;
+}
+void PipelineCache::Remove(uint64_t key)
+{
+	if (blobs.erase(key)) { dirty = true; }
+}
+
+std::vector<uint8_t> PipelineCache::Serialize() const
+{
+	std::vector<uint8_t> out;
+	Write32(out, MAGIC);
+	Write32(out, VERSION);
+	Write32(out, (uint32_t)blobs.size());
+	Write32(out, 0);
+
+	// 目次の後ろに本体を詰める
+	uint64_t offset = HEADER_SIZE + ENTRY_SIZE * blobs.size();
+	for (const auto& blob : blobs)
+	{
+		Write64(out, blob.first);
+		Write64(out, offset);
+		Write64(out, blob.second.size());
+		Write64(out, PipelineHasher::Hash(blob.second.data(), blob.second.size()));
+		offset += blob.second.size();
+	}
+	for (const auto& blob : blobs) { out.insert(out.end(), blob.second.begin(), blob.second.end()); }
+	return out;
+}
+bool PipelineCache::Deserialize(const uint8_t* data, size_t size)
+{
+	if (size < HEADER_SIZE) { return false; }
+	if (Read(data, 4) != MAGIC || Read(data + 4, 4) != VERSION) { return false; }
+	uint64_t count = Read(data + 8, 4);
+	if (count > (size - HEADER_SIZE) / ENTRY_SIZE) { return false; }
+
+	// 全部確かめてから入れ替える
+	// 本体は目次の直後から隙間なく並び、ファイルの終わりで終わる(個数や位置が壊れたものを弾く)
+	std::unordered_map<uint64_t, std::vector<uint8_t>> loaded;
+	uint64_t expected = HEADER_SIZE + ENTRY_SIZE * count;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		const uint8_t* entry = data + HEADER_SIZE + ENTRY_SIZE * i;
+		uint64_t key = Read(entry, 8);
+		uint64_t offset = Read(entry + 8, 8);
+		uint64_t bytes = Read(entry + 16, 8);
+		uint64_t checksum = Read(entry + 24, 8);
+		if (offset != expected || bytes > size - offset) { return false; }
+		if (PipelineHasher::Hash(data + offset, (size_t)bytes) != checksum) { return false; }
+		loaded[key].assign(data + offset, data + offset + bytes);
+		expected += bytes;
+	}
+	if (expected != size) { return false; }
+	blobs.swap(loaded);
+	dirty = false;
+	return true;
+}
+
+bool PipelineCache::Load(const std::wstring& path)
+{
+	FILE* fp = OpenFile(path, L"rb");
+	if (!fp) { return false; }
+	std::vector<uint8_t> data;
+	uint8_t buffer[64 * 1024];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0) { data.insert(data.end(), buffer, buffer + read); }
+	fclose(fp);
+	return Deserialize(data.data(), data.size());
+}
+bool PipelineCache::Save(const std::wstring& path)
+{
+	// 書きかけのファイルを残さないよう一時ファイルに書いてから置き換える
+	std::vector<uint8_t> data = Serialize();
+	std::wstring tmp = path + L".tmp";
+	FILE* fp = OpenFile(tmp, L"wb");
+	if (!fp) { return false; }
+	bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+	ok = (fclose(fp) == 0) && ok;
+	if (ok)
+	{
+#ifdef _WIN32
+		ok = _wrename(tmp.c_str(), path.c_str()) == 0 || (_wremove(path.c_str()) == 0 && _wrename(tmp.c_str(), path.c_str()) == 0);
+#else
+		ok = rename(std::string(tmp.begin(), tmp.end()).c_str(), std::string(path.begin(), path.end()).c_str()) == 0;
+#endif
+	}
+	if (ok) { dirty = false; }
+	return ok;
+}
@@ -0,0 +1,178 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 64bitのFNV-1aハッシュ(パイプラインのキーを作る)
+class PipelineHasher
+{
+public:
+	static const uint64_t OFFSET_BASIS = 14695981039346656037ull;
+
+	PipelineHasher() : value(OFFSET_BASIS) {}
+	void Add(const void* data, size_t size);
+	void AddString(const char* str); // nullptrと空文字列は区別する
+	template<class T> void AddValue(const T& value) { Add(&value, sizeof(value)); }
+	// バイトコードなど大きいものは中身のハッシュだけ混ぜる
+	void AddBlob(const void* data, size_t size) { AddValue(data ? Hash(data, size) : (uint64_t)0); }
+	uint64_t Get() const { return value; }
+
+	static uint64_t Hash(const void* data, size_t size);
+
+private:
+	uint64_t value;
+};
+
+// PipelineHasherと同じ並びで中身をそのまま書き出す(ハッシュが一致した時の比較用)
+class PipelineKeyWriter
+{
+public:
+	std::vector<uint8_t> bytes;
+
+	void Add(const void* data, size_t size);
+	void AddString(const char* str); // nullptrと空文字列は区別する
+	template<class T> void AddValue(const T& value) { Add(&value, sizeof(value)); }
+	// 大きさを付けて中身ごと書く
+	void AddBlob(const void* data, size_t size);
+};
+
+// D3D12_GRAPHICS_PIPELINE_STATE_DESCの結果に関係するものだけを決まった順で並べる
+// ・ポインタではなく中身(シェーダのバイトコード、セマンティクス名)を見る
+// ・使われない値(無効なブレンドの係数、使わないレンダーターゲットなど)は無視する
+// ・ルートシグネチャはシリアライズ結果のハッシュを渡す(CachedPSOは見ない)
+// D3D12のヘッダが無くても同じ名前のメンバを持つ型でテストできるようテンプレートにしてある
+// hはPipelineHasherかPipelineKeyWriter
+template<class Desc, class Sink>
+void CanonicalizeGraphicsPipelineDesc(const Desc& desc, uint64_t rootSignatureHash, Sink& h)
+{
+	h.AddValue(rootSignatureHash);
+
+	// シェーダはバイトコードの中身で比べる
+	auto addShader = [&](const auto& shader) { h.AddBlob(shader.pShaderBytecode, shader.BytecodeLength); };
+	addShader(desc.VS);
+	addShader(desc.PS);
+	addShader(desc.DS);
+	addShader(desc.HS);
+	addShader(desc.GS);
+	h.AddValue((uint32_t)desc.StreamOutput.NumEntries);
+
+	// ブレンド(IndependentBlendEnableが無ければ0番だけが使われる)
+	h.AddValue((uint32_t)desc.BlendState.AlphaToCoverageEnable);
+	h.AddValue((uint32_t)desc.BlendState.IndependentBlendEnable);
+	uint32_t blendCount = desc.BlendState.IndependentBlendEnable ? desc.NumRenderTargets : 1;
+	for (uint32_t i = 0; i < blendCount; i++)
+	{
+		const auto& rt = desc.BlendState.RenderTarget[i];
+		h.AddValue((uint32_t)rt.BlendEnable);
+		if (rt.BlendEnable)
+		{
+			h.AddValue((uint32_t)rt.SrcBlend);
+			h.AddValue((uint32_t)rt.DestBlend);
+			h.AddValue((uint32_t)rt.BlendOp);
+			h.AddValue((uint32_t)rt.SrcBlendAlpha);
+			h.AddValue((uint32_t)rt.DestBlendAlpha);
+			h.AddValue((uint32_t)rt.BlendOpAlpha);
+		}
+		h.AddValue((uint32_t)rt.LogicOpEnable);
+		if (rt.LogicOpEnable) { h.AddValue((uint32_t)rt.LogicOp); }
+		h.AddValue((uint32_t)rt.RenderTargetWriteMask);
+	}
+	h.AddValue((uint32_t)desc.SampleMask);
+
+	const auto& rs = desc.RasterizerState;
+	h.AddValue((uint32_t)rs.FillMode);
+	h.AddValue((uint32_t)rs.CullMode);
+	h.AddValue((uint32_t)rs.FrontCounterClockwise);
+	h.AddValue((int32_t)rs.DepthBias);
+	h.AddValue((float)rs.DepthBiasClamp);
+	h.AddValue((float)rs.SlopeScaledDepthBias);
+	h.AddValue((uint32_t)rs.DepthClipEnable);
+	h.AddValue((uint32_t)rs.MultisampleEnable);
+	h.AddValue((uint32_t)rs.AntialiasedLineEnable);
+	h.AddValue((uint32_t)rs.ForcedSampleCount);
+	h.AddValue((uint32_t)rs.ConservativeRaster);
+
+	// 深度とステンシル(無効なら設定は無視する)
+	const auto& ds = desc.DepthStencilState;
+	h.AddValue((uint32_t)ds.DepthEnable);
+	if (ds.DepthEnable)
+	{
+		h.AddValue((uint32_t)ds.DepthWriteMask);
+		h.AddValue((uint32_t)ds.DepthFunc);
+	}
+	h.AddValue((uint32_t)ds.StencilEnable);
+	if (ds.StencilEnable)
+	{
+		h.AddValue((uint32_t)ds.StencilReadMask);
+		h.AddValue((uint32_t)ds.StencilWriteMask);
+		for (const auto* face : { &ds.FrontFace,&ds.BackFace })
+		{
+			h.AddValue((uint32_t)face->StencilFailOp);
+			h.AddValue((uint32_t)face->StencilDepthFailOp);
+			h.AddValue((uint32_t)face->StencilPassOp);
+			h.AddValue((uint32_t)face->StencilFunc);
+		}
+	}
+	if (ds.DepthEnable || ds.StencilEnable) { h.AddValue((uint32_t)desc.DSVFormat); }
+
+	// 頂点レイアウト
+	h.AddValue((uint32_t)desc.InputLayout.NumElements);
+	for (uint32_t i = 0; i < desc.InputLayout.NumElements; i++)
+	{
+		const auto& e = desc.InputLayout.pInputElementDescs[i];
+		h.AddString(e.SemanticName);
+		h.AddValue((uint32_t)e.SemanticIndex);
+		h.AddValue((uint32_t)e.Format);
+		h.AddValue((uint32_t)e.InputSlot);
+		h.AddValue((uint32_t)e.AlignedByteOffset);
+		h.AddValue((uint32_t)e.InputSlotClass);
+		h.AddValue((uint32_t)e.InstanceDataStepRate);
+	}
+	h.AddValue((uint32_t)desc.IBStripCutValue);
+	h.AddValue((uint32_t)desc.PrimitiveTopologyType);
+
+	h.AddValue((uint32_t)desc.NumRenderTargets);
+	for (uint32_t i = 0; i < desc.NumRenderTargets; i++) { h.AddValue((uint32_t)desc.RTVFormats[i]); }
+	h.AddValue((uint32_t)desc.SampleDesc.Count);
+	h.AddValue((uint32_t)desc.SampleDesc.Quality);
+	h.AddValue((uint32_t)desc.NodeMask);
+	h.AddValue((uint32_t)desc.Flags);
+}
+
+template<class Desc>
+uint64_t HashGraphicsPipelineDesc(const Desc& desc, uint64_t rootSignatureHash)
+{
+	PipelineHasher h;
+	CanonicalizeGraphicsPipelineDesc(desc, rootSignatureHash, h);
+	return h.Get();
+}
+
+// ハッシュをキーにしたコンパイル済みパイプラインのバイナリ置き場(ファイルに保存できる)
+// ファイルの形式(リトルエンディアン)
+//   ヘッダ: magic "PSOC", version(4), count(4), reserved(4)
+//   目次: count個の { key(8), offset(8), size(8), checksum(8) }
+//   本体: 各バイナリを目次の順に隙間なく並べる(offsetはファイル先頭から)
+class PipelineCache
+{
+public:
+	static const uint32_t MAGIC = 0x434f5350; // "PSOC"
+	static const uint32_t VERSION = 1;
+
+	const std::vector<uint8_t>* Find(uint64_t key) const;
+	void Store(uint64_t key, const void* data, size_t size);
+	void Remove(uint64_t key);
+	size_t GetCount() const { return blobs.size(); }
+	bool IsDirty() const { return dirty; }
+
+	// 壊れていたり形式が違えば何も読まずにfalse
+	bool Load(const std::wstring& path);
+	bool Save(const std::wstring& path);
+	bool Deserialize(const uint8_t* data, size_t size);
+	std::vector<uint8_t> Serialize() const;
+
+private:
+	std::unordered_map<uint64_t, std::vector<uint8_t>> blobs;
+	bool dirty = false;
+};
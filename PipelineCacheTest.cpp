@@ -0,0 +1,335 @@
+﻿// PipelineCacheのキーとファイルの読み書きを、D3D12と同じ名前のメンバを持つ型で確かめる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 PipelineCacheTest.cpp PipelineCache.cpp -o PipelineCacheTest
+// 使い方
+//   PipelineCacheTest [--blobs N] [--dir DIR]
+//   一時ファイルはDIR(既定は一時ディレクトリ)に作って消す
+//   ・同じ中身なら、別のメモリにあるバイトコードやセマンティクス名でも同じキーになる
+//   ・使われない値(無効なブレンドの係数、使わないレンダーターゲット、無効な深度のフォーマット)はキーを変えない
+//   ・ブレンド、ラスタライザ、頂点レイアウト、RTVのフォーマット、シェーダ、ルートシグネチャのどれが違っても別のキーになり、
+//     PipelineKeyWriterの並びも別になる
+//   ・N個(既定16、空のものを含む)のバイナリがSerialize/Deserialize、Save/Loadで元に戻る
+//   ・途中で切れたもの、ヘッダ、目次、本体のどこかが壊れたものは読まずにfalseを返し、前の中身が残る
+//   失敗すると理由を出して1を返す
+#include "PipelineCache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		size_t blobs = 16;
+		std::string dir;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--blobs") { options.blobs = strtoul(value, nullptr, 10); }
+			else if (arg == "--dir") { options.dir = value; }
+			else { return false; }
+		}
+		return options.blobs > 0;
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	// D3D12_GRAPHICS_PIPELINE_STATE_DESCのうち、キーが見るメンバだけを同じ名前で持つ
+	struct Shader { const void* pShaderBytecode = nullptr; size_t BytecodeLength = 0; };
+	struct RenderTargetBlend
+	{
+		int BlendEnable = 0, LogicOpEnable = 0;
+		int SrcBlend = 2, DestBlend = 1, BlendOp = 1, SrcBlendAlpha = 2, DestBlendAlpha = 1, BlendOpAlpha = 1;
+		int LogicOp = 4;
+		uint8_t RenderTargetWriteMask = 0xf;
+	};
+	struct BlendDesc { int AlphaToCoverageEnable = 0, IndependentBlendEnable = 0; RenderTargetBlend RenderTarget[8]; };
+	struct RasterizerDesc
+	{
+		int FillMode = 3, CullMode = 3, FrontCounterClockwise = 0;
+		int DepthBias = 0;
+		float DepthBiasClamp = 0.0f, SlopeScaledDepthBias = 0.0f;
+		int DepthClipEnable = 1, MultisampleEnable = 0, AntialiasedLineEnable = 0;
+		unsigned ForcedSampleCount = 0;
+		int ConservativeRaster = 0;
+	};
+	struct StencilFace { int StencilFailOp = 1, StencilDepthFailOp = 1, StencilPassOp = 1, StencilFunc = 8; };
+	struct DepthStencilDesc
+	{
+		int DepthEnable = 1, DepthWriteMask = 1, DepthFunc = 4, StencilEnable = 0;
+		uint8_t StencilReadMask = 0xff, StencilWriteMask = 0xff;
+		StencilFace FrontFace, BackFace;
+	};
+	struct InputElementDesc
+	{
+		const char* SemanticName;
+		unsigned SemanticIndex;
+		int Format;
+		unsigned InputSlot, AlignedByteOffset;
+		int InputSlotClass;
+		unsigned InstanceDataStepRate;
+	};
+	struct InputLayoutDesc { const InputElementDesc* pInputElementDescs = nullptr; unsigned NumElements = 0; };
+	struct Desc
+	{
+		Shader VS, PS, DS, HS, GS;
+		struct { unsigned NumEntries = 0; } StreamOutput;
+		BlendDesc BlendState;
+		unsigned SampleMask = 0xffffffff;
+		RasterizerDesc RasterizerState;
+		DepthStencilDesc DepthStencilState;
+		InputLayoutDesc InputLayout;
+		int IBStripCutValue = 0;
+		int PrimitiveTopologyType = 3;
+		unsigned NumRenderTargets = 1;
+		int RTVFormats[8] = { 29 };
+		int DSVFormat = 45;
+		struct { unsigned Count = 1, Quality = 0; } SampleDesc;
+		unsigned NodeMask = 0;
+		int Flags = 0;
+	};
+
+	// 別のメモリに同じ中身を持たせて、ポインタではなく中身を見るかを確かめる
+	struct Sources
+	{
+		std::vector<uint8_t> vs, ps;
+		std::vector<std::string> names;
+		std::vector<InputElementDesc> layout;
+	};
+
+	Desc MakeDesc(Sources& sources)
+	{
+		sources.vs.assign(64, 0);
+		sources.ps.assign(96, 0);
+		for (size_t i = 0; i < sources.vs.size(); i++) { sources.vs[i] = (uint8_t)(i * 3 + 1); }
+		for (size_t i = 0; i < sources.ps.size(); i++) { sources.ps[i] = (uint8_t)(i * 5 + 2); }
+		sources.names = { "POSITION", "TEXCOORD", "NORMAL" };
+		sources.layout = {
+			{ sources.names[0].c_str(), 0, 2, 0, 0, 0, 0 },
+			{ sources.names[1].c_str(), 0, 16, 0, 16, 0, 0 },
+			{ sources.names[2].c_str(), 0, 6, 0, 24, 0, 0 } };
+
+		Desc desc;
+		desc.VS = { sources.vs.data(), sources.vs.size() };
+		desc.PS = { sources.ps.data(), sources.ps.size() };
+		desc.InputLayout = { sources.layout.data(), (unsigned)sources.layout.size() };
+		return desc;
+	}
+
+	const uint64_t ROOT_SIGNATURE = 0x1234567890abcdefull;
+
+	std::vector<uint8_t> KeyBytes(const Desc& desc, uint64_t rootSignatureHash)
+	{
+		PipelineKeyWriter writer;
+		CanonicalizeGraphicsPipelineDesc(desc, rootSignatureHash, writer);
+		return writer.bytes;
+	}
+
+	bool SameKey(const Desc& a, const Desc& b)
+	{
+		return HashGraphicsPipelineDesc(a, ROOT_SIGNATURE) == HashGraphicsPipelineDesc(b, ROOT_SIGNATURE) &&
+			KeyBytes(a, ROOT_SIGNATURE) == KeyBytes(b, ROOT_SIGNATURE);
+	}
+
+	void TestKeys()
+	{
+		Sources sourcesA, sourcesB;
+		Desc base = MakeDesc(sourcesA);
+		Desc copy = MakeDesc(sourcesB);
+		Check(HashGraphicsPipelineDesc(base, ROOT_SIGNATURE) == HashGraphicsPipelineDesc(base, ROOT_SIGNATURE), "hashing the same desc twice should give the same key");
+		Check(SameKey(base, copy), "equal contents in different memory should give the same key");
+
+		// 使われない値
+		Desc unused = copy;
+		unused.BlendState.RenderTarget[0].SrcBlend = 5; // BlendEnableが0
+		unused.BlendState.RenderTarget[1].BlendEnable = 1; // IndependentBlendEnableが0
+		unused.RTVFormats[3] = 87; // NumRenderTargetsの外
+		Check(SameKey(base, unused), "unused blend and render target values should not change the key");
+		unused.DepthStencilState.DepthEnable = 0;
+		Desc noDepth = unused;
+		noDepth.DSVFormat = 40;
+		noDepth.DepthStencilState.DepthFunc = 2;
+		Check(SameKey(unused, noDepth), "the depth format and function should not matter without depth");
+
+		// 1か所ずつ変えたものは、元とも互いとも違うキーになる
+		std::vector<std::pair<const char*, Desc>> variants;
+		auto add = [&](const char* name, auto&& change)
+			{
+				Desc desc = copy;
+				change(desc);
+				variants.push_back({ name, desc });
+			};
+		add("base", [](Desc&) {});
+		add("blend enable", [](Desc& d) { d.BlendState.RenderTarget[0].BlendEnable = 1; });
+		add("blend factor", [](Desc& d) { d.BlendState.RenderTarget[0].BlendEnable = 1; d.BlendState.RenderTarget[0].SrcBlend = 5; });
+		add("blend op", [](Desc& d) { d.BlendState.RenderTarget[0].BlendEnable = 1; d.BlendState.RenderTarget[0].BlendOp = 2; });
+		add("write mask", [](Desc& d) { d.BlendState.RenderTarget[0].RenderTargetWriteMask = 0x7; });
+		add("alpha to coverage", [](Desc& d) { d.BlendState.AlphaToCoverageEnable = 1; });
+		add("cull mode", [](Desc& d) { d.RasterizerState.CullMode = 1; });
+		add("fill mode", [](Desc& d) { d.RasterizerState.FillMode = 2; });
+		add("depth bias", [](Desc& d) { d.RasterizerState.DepthBias = 1; });
+		add("slope bias", [](Desc& d) { d.RasterizerState.SlopeScaledDepthBias = 1.0f; });
+		add("front ccw", [](Desc& d) { d.RasterizerState.FrontCounterClockwise = 1; });
+		add("layout format", [&](Desc& d)
+			{
+				static std::vector<InputElementDesc> layout;
+				layout = sourcesB.layout;
+				layout[2].Format = 2;
+				d.InputLayout.pInputElementDescs = layout.data();
+			});
+		add("layout offset", [&](Desc& d)
+			{
+				static std::vector<InputElementDesc> layout;
+				layout = sourcesB.layout;
+				layout[1].AlignedByteOffset = 12;
+				d.InputLayout.pInputElementDescs = layout.data();
+			});
+		add("layout semantic", [&](Desc& d)
+			{
+				static std::vector<InputElementDesc> layout;
+				layout = sourcesB.layout;
+				layout[2].SemanticName = "TANGENT";
+				d.InputLayout.pInputElementDescs = layout.data();
+			});
+		add("layout count", [](Desc& d) { d.InputLayout.NumElements = 2; });
+		add("rtv format", [](Desc& d) { d.RTVFormats[0] = 28; });
+		add("rtv count", [](Desc& d) { d.NumRenderTargets = 2; d.RTVFormats[1] = 29; });
+		add("second rtv format", [](Desc& d) { d.NumRenderTargets = 2; d.RTVFormats[1] = 10; });
+		add("dsv format", [](Desc& d) { d.DSVFormat = 40; });
+		add("topology", [](Desc& d) { d.PrimitiveTopologyType = 2; });
+		add("pixel shader", [&](Desc& d)
+			{
+				static std::vector<uint8_t> ps;
+				ps = sourcesB.ps;
+				ps[50] ^= 1;
+				d.PS.pShaderBytecode = ps.data();
+			});
+		add("no pixel shader", [](Desc& d) { d.PS = {}; });
+
+		std::set<uint64_t> keys;
+		std::set<std::vector<uint8_t>> bytes;
+		for (const auto& variant : variants)
+		{
+			bool newKey = keys.insert(HashGraphicsPipelineDesc(variant.second, ROOT_SIGNATURE)).second;
+			bool newBytes = bytes.insert(KeyBytes(variant.second, ROOT_SIGNATURE)).second;
+			if (!newKey || !newBytes) { printf("  %s collides with an earlier variant\n", variant.first); }
+			Check(newKey && newBytes, "changing one used value should change the key");
+		}
+		Check(HashGraphicsPipelineDesc(base, ROOT_SIGNATURE) != HashGraphicsPipelineDesc(base, ROOT_SIGNATURE + 1), "the root signature hash should change the key");
+		printf("%zu variants, %zu distinct keys\n", variants.size(), keys.size());
+	}
+
+	void Fill(PipelineCache& cache, size_t count)
+	{
+		uint32_t seed = 1;
+		for (size_t i = 0; i < count; i++)
+		{
+			// 1つ目は空、あとは大きさを変える
+			std::vector<uint8_t> blob(i == 0 ? 0 : 17 * i + 3);
+			for (uint8_t& b : blob)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				b = (uint8_t)(seed >> 24);
+			}
+			cache.Store(0x9e3779b97f4a7c15ull * (i + 1), blob.data(), blob.size());
+		}
+	}
+
+	bool SameContents(const PipelineCache& a, const PipelineCache& b, size_t count)
+	{
+		if (a.GetCount() != count || b.GetCount() != count) { return false; }
+		for (size_t i = 0; i < count; i++)
+		{
+			const std::vector<uint8_t>* x = a.Find(0x9e3779b97f4a7c15ull * (i + 1));
+			const std::vector<uint8_t>* y = b.Find(0x9e3779b97f4a7c15ull * (i + 1));
+			if (!x || !y || *x != *y) { return false; }
+		}
+		return true;
+	}
+
+	void TestFile(const Options& options)
+	{
+		PipelineCache cache;
+		Fill(cache, options.blobs);
+		Check(cache.IsDirty(), "storing should mark the cache dirty");
+		std::vector<uint8_t> data = cache.Serialize();
+
+		PipelineCache loaded;
+		Check(loaded.Deserialize(data.data(), data.size()), "a serialized cache should deserialize");
+		Check(SameContents(cache, loaded, options.blobs), "deserialized blobs differ");
+		Check(!loaded.IsDirty(), "a freshly deserialized cache should not be dirty");
+
+		std::string dir = options.dir.empty() ? P_tmpdir : options.dir;
+		std::string narrow = dir + "/PipelineCacheTest.bin";
+		std::wstring path(narrow.begin(), narrow.end());
+		Check(cache.Save(path), "saving the cache failed");
+		Check(!cache.IsDirty(), "saving should clear the dirty flag");
+		PipelineCache fromFile;
+		Check(fromFile.Load(path), "loading the saved cache failed");
+		Check(SameContents(cache, fromFile, options.blobs), "loaded blobs differ");
+		remove(narrow.c_str());
+		Check(!fromFile.Load(path), "loading a missing file should fail");
+		Check(SameContents(cache, fromFile, options.blobs), "a failed load should keep the previous blobs");
+
+		// 途中で切れたもの
+		size_t truncated = 0;
+		for (size_t size = 0; size < data.size(); size++)
+		{
+			if (loaded.Deserialize(data.data(), size)) { printf("  accepted %zu of %zu bytes\n", size, data.size()); }
+			else { truncated++; }
+		}
+		Check(truncated == data.size(), "a truncated file should be rejected");
+
+		// ヘッダ(予約以外)、目次の位置、大きさ、チェックサム、本体の1ビットを壊したもの
+		const size_t headerSize = 16, entrySize = 32;
+		std::vector<size_t> corrupt;
+		for (size_t i = 0; i < 12; i++) { corrupt.push_back(i); }
+		for (size_t entry = 0; entry < options.blobs; entry++)
+		{
+			for (size_t i = 8; i < entrySize; i++) { corrupt.push_back(headerSize + entrySize * entry + i); }
+		}
+		for (size_t i = headerSize + entrySize * options.blobs; i < data.size(); i++) { corrupt.push_back(i); }
+		size_t rejected = 0;
+		for (size_t at : corrupt)
+		{
+			std::vector<uint8_t> broken = data;
+			broken[at] ^= 0x10;
+			if (loaded.Deserialize(broken.data(), broken.size())) { printf("  accepted a flipped byte at %zu\n", at); }
+			else { rejected++; }
+		}
+		Check(rejected == corrupt.size(), "a corrupt file should be rejected");
+		Check(SameContents(cache, loaded, options.blobs), "a rejected file should keep the previous blobs");
+		printf("%zu blobs, %zu bytes, %zu truncations and %zu corruptions rejected\n",
+			options.blobs, data.size(), truncated, rejected);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: PipelineCacheTest [--blobs N] [--dir DIR]\n");
+		return 2;
+	}
+
+	TestKeys();
+	TestFile(options);
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+﻿#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// 1つのスレッドが書き、Flushが読む(書き手1つ、読み手1つでロックしない)
+	struct ThreadRing
+	{
+		Profiler::Zone zones[Profiler::RING_CAPACITY];
+		alignas(64) std::atomic<size_t> head{ 0 }; // 次に読む位置
+		alignas(64) std::atomic<size_t> tail{ 0 }; // 次に書く位置
+		std::atomic<size_t> dropped{ 0 };
+		uint32_t id = 0;
+		std::string name;
+	};
+
+	struct FlushedZone
+	{
+		Profiler::Zone zone;
+		uint32_t thread;
+	};
+
+	struct Registry
+	{
+		std::mutex mutex; // リングの登録とFlushされたものだけを守る
+		std::vector<std::unique_ptr<ThreadRing>> rings; // スレッドが終わっても書き出すまで残す
+		std::vector<FlushedZone> flushed; // HISTORY_CAPACITYで折り返すリング
+		size_t next = 0; // 満杯の時に次に上書きする位置(一番古いもの)
+		size_t dropped = 0;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadRing* threadRing = nullptr;
+
+	ThreadRing& GetThreadRing()
+	{
+		if (!threadRing)
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.rings.push_back(std::make_unique<ThreadRing>());
+			threadRing = registry.rings.back().get();
+			threadRing->id = (uint32_t)registry.rings.size();
+		}
+		return *threadRing;
+	}
+
+	void WriteEscaped(FILE* file, const char* text)
+	{
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\') { fputc('\\', file); }
+			if ((unsigned char)*c < 0x20) { continue; }
+			fputc(*c, file);
+		}
+	}
+}
+
+uint64_t Profiler::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::Record(const char* name, uint64_t begin, uint64_t end)
+{
+	ThreadRing& ring = GetThreadRing();
+	size_t t = ring.tail.load(std::memory_order_relaxed);
+	if (t - ring.head.load(std::memory_order_acquire) >= RING_CAPACITY)
+	{
+		ring.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ring.zones[t % RING_CAPACITY] = { name, begin, end };
+	// 中身を書いてから位置を進める
+	ring.tail.store(t + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadRing& ring = GetThreadRing();
+	std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+	ring.name = name;
+}
+
+void Profiler::Flush()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (std::unique_ptr<ThreadRing>& ring : registry.rings)
+	{
+		size_t h = ring->head.load(std::memory_order_relaxed);
+		size_t t = ring->tail.load(std::memory_order_acquire);
+		for (; h != t; h++)
+		{
+			FlushedZone zone = { ring->zones[h % RING_CAPACITY], ring->id };
+			if (registry.flushed.size() < HISTORY_CAPACITY)
+			{
+				registry.flushed.push_back(zone);
+				continue;
+			}
+			registry.flushed[registry.next] = zone;
+			registry.next = (registry.next + 1) % HISTORY_CAPACITY;
+			registry.dropped++;
+		}
+		// 読み終えてから書き手に空きを返す
+		ring->head.store(h, std::memory_order_release);
+		registry.dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+	}
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file) { return false; }
+
+	// tsは最初の区間からのマイクロ秒(小数で1ns単位まで残す)
+	uint64_t origin = UINT64_MAX;
+	for (const FlushedZone& flushed : registry.flushed) { origin = (std::min)(origin, flushed.zone.begin); }
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (const std::unique_ptr<ThreadRing>& ring : registry.rings)
+	{
+		if (ring->name.empty()) { continue; }
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+			first ? "" : ",\n", ring->id);
+		WriteEscaped(file, ring->name.c_str());
+		fprintf(file, "\"}}");
+		first = false;
+	}
+	for (const FlushedZone& flushed : registry.flushed)
+	{
+		const Zone& zone = flushed.zone;
+		uint64_t begin = zone.begin - origin;
+		uint64_t duration = zone.end > zone.begin ? zone.end - zone.begin : 0;
+		fprintf(file, "%s{\"name\":\"", first ? "" : ",\n");
+		WriteEscaped(file, zone.name);
+		fprintf(file, "\",\"ph\":\"X\",\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"pid\":1,\"tid\":%u}",
+			(unsigned long long)(begin / 1000), (unsigned)(begin % 1000),
+			(unsigned long long)(duration / 1000), (unsigned)(duration % 1000), flushed.thread);
+		first = false;
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	bool succeeded = ferror(file) == 0;
+	return fclose(file) == 0 && succeeded;
+}
+
+void Profiler::Clear()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.flushed.clear();
+	registry.next = 0;
+	registry.dropped = 0;
+}
+
+size_t Profiler::GetZoneCount()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	return registry.flushed.size();
+}
+
+size_t Profiler::GetDropped()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	return registry.dropped;
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 区間の計測をChromeのトレース(chrome://tracing、Perfetto)に書き出す
+// PROFILE_ENABLEDを0にするとPROFILE_*は何も残らない(既定ではDebugのみ1)
+// 区間1つの負荷は、時刻を2回取ってスレッドのリングに24バイト書くだけ
+//   Linux x64 -O2の仮想マシン: 有効 約75ns(うち時刻の取得2回で65ns)、無効 0ns
+//   Windowsのsteady_clockはQueryPerformanceCounterなので、ほとんどが時刻の取得になるのは同じ
+// フレームあたり数十区間なら1フレームで数us以下
+#ifndef PROFILE_ENABLED
+#ifdef _DEBUG
+#define PROFILE_ENABLED 1
+#else
+#define PROFILE_ENABLED 0
+#endif
+#endif
+
+class Profiler
+{
+public:
+	// 時刻はナノ秒
+	struct Zone
+	{
+		const char* name; // 文字列リテラルなど、書き出すまで残るもの
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// スレッドごとのリングの大きさ(Flushまでに溢れた区間は捨てて数える)
+	static const size_t RING_CAPACITY = 1 << 14;
+	// Flushで溜める区間の上限(超えたら古いものから捨てて数える、24バイト x 2^16 = 1.5MB)
+	static const size_t HISTORY_CAPACITY = 1 << 16;
+
+	static uint64_t Now();
+
+	// 呼んだスレッドのリングに積む(最初の1回だけ登録でロックする)
+	static void Record(const char* name, uint64_t begin, uint64_t end);
+	// トレースに出すスレッドの名前
+	static void SetThreadName(const char* name);
+
+	// 全てのスレッドのリングから読み出して溜める(書き手は止めない)
+	// 読み手は1つだけなので、呼ぶのは1つのスレッドから
+	static void Flush();
+	// 溜めている直近HISTORY_CAPACITY個を書き出す(呼ぶ前にFlushする)
+	static bool WriteChromeTrace(const std::string& path);
+	static void Clear();
+
+	static size_t GetZoneCount();
+	static size_t GetDropped();
+};
+
+// スコープを出るまでを1つの区間にする
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name) : name(name), begin(Profiler::Now()) {}
+	~ProfileZone() { End(); }
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+	// スコープより先に区間を閉じる
+	void End()
+	{
+		if (!name) { return; }
+		Profiler::Record(name, begin, Profiler::Now());
+		name = nullptr;
+	}
+
+private:
+	const char* name;
+	uint64_t begin;
+};
+
+#if PROFILE_ENABLED
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+// スコープで囲めない所(mainの初期化など)はBEGINとENDで挟む
+#define PROFILE_BEGIN(var, name) ProfileZone var(name)
+#define PROFILE_END(var) var.End()
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_BEGIN(var, name)
+#define PROFILE_END(var)
+#define PROFILE_THREAD(name)
+#endif
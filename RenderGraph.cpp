@@ -0,0 +1,294 @@
+﻿#include "RenderGraph.h"
+#include "ResourceStateTracker.h"
+#include <algorithm>
+
+RenderGraph::RenderGraph(uint32_t readStates)
+{
+	this->readStates = readStates;
+	stats = {};
+}
+
+RenderGraph::ResourceId RenderGraph::CreateTransient(const std::string& name, size_t size, size_t alignment)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) { alignment = 1; }
+	Resource resource{};
+	resource.name = name;
+	resource.imported = false;
+	resource.size = size;
+	resource.alignment = alignment;
+	resources.push_back(resource);
+	return (ResourceId)resources.size() - 1;
+}
+RenderGraph::ResourceId RenderGraph::Import(const std::string& name, uint32_t initialState, uint32_t finalState)
+{
+	Resource resource{};
+	resource.name = name;
+	resource.imported = true;
+	resource.alignment = 1;
+	resource.initialState = initialState;
+	resource.finalState = finalState;
+	resources.push_back(resource);
+	return (ResourceId)resources.size() - 1;
+}
+
+RenderGraph::PassId RenderGraph::AddPass(const std::string& name, bool sideEffect)
+{
+	Pass pass{};
+	pass.name = name;
+	pass.sideEffect = sideEffect;
+	passes.push_back(pass);
+	return (PassId)passes.size() - 1;
+}
+void RenderGraph::Read(PassId pass, ResourceId resource, uint32_t state)
+{
+	passes[pass].accesses.push_back({ resource, state, false });
+}
+void RenderGraph::Write(PassId pass, ResourceId resource, uint32_t state)
+{
+	passes[pass].accesses.push_back({ resource, state, true });
+}
+
+void RenderGraph::Compile()
+{
+	stats = {};
+	Cull();
+	ComputeLifetimes();
+	PlaceTransients();
+	PlanBarriers();
+}
+
+void RenderGraph::Cull()
+{
+	// パスは書いたリソースの数、リソースは読むパスの数を参照数にする
+	// 外部のリソースはフレームの後で読まれるものとして1つ足す
+	for (Resource& resource : resources) { resource.refCount = resource.imported ? 1 : 0; }
+	std::vector<std::vector<PassId>> writers(resources.size());
+	for (PassId i = 0; i < passes.size(); i++)
+	{
+		Pass& pass = passes[i];
+		pass.culled = false;
+		pass.refCount = 0;
+		for (const Access& access : pass.accesses)
+		{
+			if (access.write)
+			{
+				pass.refCount++;
+				writers[access.resource].push_back(i);
+			}
+			else { resources[access.resource].refCount++; }
+		}
+	}
+
+	// 誰も読まないリソースから書き手の参照数を減らし、0になったパスを削る
+	// 削ったパスが読んでいたリソースも読み手が減るので、同じようにたどる
+	std::vector<PassId> culled;
+	std::vector<ResourceId> stack;
+	for (PassId i = 0; i < passes.size(); i++)
+	{
+		if (passes[i].refCount == 0 && !passes[i].sideEffect) { culled.push_back(i); }
+	}
+	for (ResourceId i = 0; i < resources.size(); i++)
+	{
+		if (resources[i].refCount == 0) { stack.push_back(i); }
+	}
+	while (!culled.empty() || !stack.empty())
+	{
+		if (!culled.empty())
+		{
+			Pass& pass = passes[culled.back()];
+			culled.pop_back();
+			pass.culled = true;
+			stats.culledPasses++;
+			for (const Access& access : pass.accesses)
+			{
+				if (!access.write && --resources[access.resource].refCount == 0) { stack.push_back(access.resource); }
+			}
+			continue;
+		}
+
+		ResourceId resource = stack.back();
+		stack.pop_back();
+		for (PassId writer : writers[resource])
+		{
+			Pass& pass = passes[writer];
+			if (pass.sideEffect || pass.refCount == 0) { continue; }
+			if (--pass.refCount == 0) { culled.push_back(writer); }
+		}
+	}
+
+	order.clear();
+	for (PassId i = 0; i < passes.size(); i++)
+	{
+		if (!passes[i].culled) { order.push_back(i); }
+	}
+	stats.passCount = order.size();
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (Resource& resource : resources)
+	{
+		resource.firstUse = INVALID;
+		resource.lastUse = INVALID;
+		resource.offset = 0;
+	}
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		for (const Access& access : passes[order[i]].accesses)
+		{
+			Resource& resource = resources[access.resource];
+			if (resource.firstUse == INVALID)
+			{
+				resource.firstUse = i;
+				// 一時リソースは最初に使う状態で作る
+				if (!resource.imported) { resource.initialState = access.state; }
+			}
+			resource.lastUse = i;
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients()
+{
+	std::vector<ResourceId> transients;
+	for (ResourceId i = 0; i < resources.size(); i++)
+	{
+		const Resource& resource = resources[i];
+		if (resource.imported || resource.firstUse == INVALID) { continue; }
+		transients.push_back(i);
+		stats.unaliasedBytes = (stats.unaliasedBytes + resource.alignment - 1) / resource.alignment * resource.alignment + resource.size;
+	}
+	stats.transientCount = transients.size();
+
+	// 大きいものから、寿命が重なるものとメモリが重ならない一番低い位置に置く
+	std::stable_sort(transients.begin(), transients.end(),
+		[&](ResourceId a, ResourceId b) { return resources[a].size > resources[b].size; });
+	std::vector<ResourceId> placed;
+	for (ResourceId id : transients)
+	{
+		Resource& resource = resources[id];
+		std::vector<const Resource*> live;
+		std::vector<size_t> candidates = { 0 };
+		for (ResourceId other : placed)
+		{
+			const Resource& o = resources[other];
+			if (o.lastUse < resource.firstUse || resource.lastUse < o.firstUse) { continue; }
+			live.push_back(&o);
+			candidates.push_back((o.offset + o.size + resource.alignment - 1) / resource.alignment * resource.alignment);
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for (size_t offset : candidates)
+		{
+			bool fits = true;
+			for (const Resource* o : live)
+			{
+				if (offset < o->offset + o->size && o->offset < offset + resource.size)
+				{
+					fits = false;
+					break;
+				}
+			}
+			if (fits)
+			{
+				resource.offset = offset;
+				break;
+			}
+		}
+		placed.push_back(id);
+		stats.aliasedBytes = (std::max)(stats.aliasedBytes, resource.offset + resource.size);
+	}
+}
+
+void RenderGraph::PlanBarriers()
+{
+	ResourceStateTracker tracker(readStates);
+	for (Resource& resource : resources)
+	{
+		if (resource.imported || resource.firstUse != INVALID) { tracker.Register(&resource, 1, resource.initialState); }
+	}
+
+	std::vector<StateTransition> transitions;
+	auto append = [&](std::vector<Barrier>& out)
+	{
+		transitions.clear();
+		tracker.Flush(transitions);
+		for (const StateTransition& t : transitions)
+		{
+			ResourceId id = (ResourceId)(static_cast<const Resource*>(t.resource) - resources.data());
+			out.push_back({ id, t.before, t.after, false, false, INVALID });
+		}
+		stats.transitionCount += transitions.size();
+	};
+
+	// 一時リソースを使い始める順に並べ、その時に同じ場所を持っているものを求める
+	// 使い始めたものは重なるものを全て手放させる。2フレーム分たどれば、前のフレームから持ち越した分も分かる
+	std::vector<ResourceId> activations;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		for (ResourceId id = 0; id < resources.size(); id++)
+		{
+			if (!resources[id].imported && resources[id].firstUse == i) { activations.push_back(id); }
+		}
+	}
+	std::vector<bool> active(resources.size(), false);
+	std::vector<std::vector<ResourceId>> owners(resources.size());
+	for (int frame = 0; frame < 2; frame++)
+	{
+		for (ResourceId id : activations)
+		{
+			const Resource& resource = resources[id];
+			owners[id].clear();
+			for (ResourceId other = 0; other < resources.size(); other++)
+			{
+				const Resource& o = resources[other];
+				if (other == id || !active[other]) { continue; }
+				if (resource.offset >= o.offset + o.size || o.offset >= resource.offset + resource.size) { continue; }
+				owners[id].push_back(other);
+				active[other] = false;
+			}
+			active[id] = true;
+		}
+	}
+
+	for (Pass& pass : passes) { pass.barriers.clear(); }
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		Pass& pass = passes[order[i]];
+
+		// 前のパスで使い終わった一時リソースを最初の状態に戻す
+		// (メモリを次のものに渡す前に戻すので、次のフレームの最初のバリアと食い違わない)
+		for (Resource& resource : resources)
+		{
+			if (!resource.imported && resource.firstUse != INVALID && resource.lastUse + 1 == i)
+			{
+				tracker.Transition(&resource, resource.initialState);
+			}
+		}
+		append(pass.barriers);
+
+		// ここから使い始める一時リソースと、その場所を前に使っていたものを知らせる
+		for (ResourceId id = 0; id < resources.size(); id++)
+		{
+			const Resource& resource = resources[id];
+			if (resource.imported || resource.firstUse != i) { continue; }
+			bool shared = !owners[id].empty();
+			pass.barriers.push_back({ id, 0, 0, true, shared, owners[id].size() == 1 ? owners[id][0] : INVALID });
+			if (shared) { stats.aliasingCount++; }
+		}
+
+		for (const Access& access : pass.accesses) { tracker.Transition(&resources[access.resource], access.state); }
+		append(pass.barriers);
+	}
+
+	finalBarriers.clear();
+	for (Resource& resource : resources)
+	{
+		if (resource.imported) { tracker.Transition(&resource, resource.finalState); }
+		else if (resource.firstUse != INVALID && resource.lastUse + 1 == order.size())
+		{
+			tracker.Transition(&resource, resource.initialState);
+		}
+	}
+	append(finalBarriers);
+}
@@ -0,0 +1,117 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// パスが読み書きするリソースを宣言し、実行順、バリア、一時リソースのメモリ配置を決める(デバイスに依存しない)
+// ・依存関係は宣言順から決まる(読み込みはそれより前の最後の書き込みを待つ)ので、実行順は残ったパスの宣言順
+// ・外部のリソースにも副作用のあるパスにもつながらないパスは削る
+// ・寿命が重ならない一時リソースは同じメモリに重ねて置く
+// ・一時リソースは使い終わったパスの後で最初の状態に戻すので、毎フレーム同じバリアで回る
+class RenderGraph
+{
+public:
+	using ResourceId = uint32_t;
+	using PassId = uint32_t;
+	static const uint32_t INVALID = UINT32_MAX;
+
+	// パスの前に積むバリア
+	struct Barrier
+	{
+		ResourceId resource;
+		uint32_t before;
+		uint32_t after;
+		// trueなら一時リソースの使い始め(中身は不定なので、レンダーターゲットと深度はクリアかDiscardResourceする)
+		bool aliasing;
+		// 同じ場所を前に使っていたもの(前のフレームの後半のこともある)
+		// 1つならaliasedFrom、複数ならINVALIDでどれか分からない(D3D12ではpResourceBeforeをnullにする)
+		bool shared;
+		ResourceId aliasedFrom;
+	};
+
+	struct Stats
+	{
+		size_t passCount; // 実行するパス
+		size_t culledPasses;
+		size_t transientCount; // 実際に使う一時リソース
+		size_t unaliasedBytes; // 重ねずに置いた時の合計
+		size_t aliasedBytes; // 重ねて置いた時のヒープの大きさ
+		size_t transitionCount;
+		size_t aliasingCount; // 他と場所を共有する使い始め
+	};
+
+	// readStatesはResourceStateTrackerと同じ(読み込み専用の状態のビット)
+	RenderGraph(uint32_t readStates = 0);
+
+	// フレームの中だけで使うリソース(最初に使う状態で作られ、使い終わったらその状態に戻す)
+	ResourceId CreateTransient(const std::string& name, size_t size, size_t alignment);
+	// 外から持ち込むリソース(フレームの最後にfinalStateへ戻す)
+	ResourceId Import(const std::string& name, uint32_t initialState, uint32_t finalState);
+
+	// sideEffectなら出力が読まれなくても削らない
+	PassId AddPass(const std::string& name, bool sideEffect = false);
+	void Read(PassId pass, ResourceId resource, uint32_t state);
+	void Write(PassId pass, ResourceId resource, uint32_t state);
+
+	// 宣言が変わったら呼び直す
+	void Compile();
+
+	const std::vector<PassId>& GetOrder() const { return order; }
+	bool IsCulled(PassId pass) const { return passes[pass].culled; }
+	const std::vector<Barrier>& GetBarriers(PassId pass) const { return passes[pass].barriers; }
+	const std::vector<Barrier>& GetFinalBarriers() const { return finalBarriers; }
+
+	const std::string& GetName(ResourceId resource) const { return resources[resource].name; }
+	bool IsTransient(ResourceId resource) const { return !resources[resource].imported; }
+	bool IsUsed(ResourceId resource) const { return resources[resource].firstUse != INVALID; }
+	size_t GetOffset(ResourceId resource) const { return resources[resource].offset; }
+	size_t GetSize(ResourceId resource) const { return resources[resource].size; }
+	uint32_t GetInitialState(ResourceId resource) const { return resources[resource].initialState; }
+	size_t GetResourceCount() const { return resources.size(); }
+	Stats GetStats() const { return stats; }
+
+private:
+	struct Access
+	{
+		ResourceId resource;
+		uint32_t state;
+		bool write;
+	};
+	struct Pass
+	{
+		std::string name;
+		bool sideEffect;
+		std::vector<Access> accesses;
+		// Compileで決まる
+		bool culled;
+		size_t refCount;
+		std::vector<Barrier> barriers;
+	};
+	struct Resource
+	{
+		std::string name;
+		bool imported;
+		size_t size;
+		size_t alignment;
+		uint32_t initialState;
+		uint32_t finalState;
+		// Compileで決まる
+		size_t refCount;
+		size_t firstUse; // orderの中の位置
+		size_t lastUse;
+		size_t offset;
+	};
+
+	uint32_t readStates;
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+	std::vector<PassId> order;
+	std::vector<Barrier> finalBarriers;
+	Stats stats;
+
+	void Cull();
+	void ComputeLifetimes();
+	void PlaceTransients();
+	void PlanBarriers();
+};
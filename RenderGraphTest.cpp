@@ -0,0 +1,266 @@
+﻿// RenderGraphの削除、メモリの重ね方、バリアを、遅延レンダリングの形のグラフで確かめる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 RenderGraphTest.cpp RenderGraph.cpp ResourceStateTracker.cpp -o RenderGraphTest
+// 使い方
+//   RenderGraphTest [--frames N] [--verbose]
+//   バリアをNフレーム(既定3)続けて当て、毎フレーム次を確かめる
+//   ・遷移のbeforeが、前のフレームから続けて追った状態と一致する
+//   ・パスが使う時に、リソースが宣言した状態にいて、メモリを重ねた相手がその時に使われていない
+//   ・一時リソースは使い始めが知らされてから使われ、重ねた場所の前の持ち主が正しい
+//   失敗すると理由を出して1を返す
+#include "RenderGraph.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// D3D12_RESOURCE_STATESと同じ値
+	enum : uint32_t
+	{
+		PRESENT = 0,
+		RENDER_TARGET = 0x4,
+		UNORDERED_ACCESS = 0x8,
+		DEPTH_WRITE = 0x10,
+		DEPTH_READ = 0x20,
+		NON_PIXEL_SHADER_RESOURCE = 0x40,
+		PIXEL_SHADER_RESOURCE = 0x80,
+	};
+	const uint32_t READ_STATES = DEPTH_READ | NON_PIXEL_SHADER_RESOURCE | PIXEL_SHADER_RESOURCE;
+
+	int failures = 0;
+	void Check(bool condition, const std::string& message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message.c_str());
+		failures++;
+	}
+
+	// テストが宣言したアクセス(RenderGraphは中を見せないので同じものを持っておく)
+	struct Access
+	{
+		RenderGraph::PassId pass;
+		RenderGraph::ResourceId resource;
+		uint32_t state;
+	};
+
+	struct TestGraph
+	{
+		RenderGraph graph{ READ_STATES };
+		std::vector<Access> accesses;
+
+		void Read(RenderGraph::PassId pass, RenderGraph::ResourceId resource, uint32_t state)
+		{
+			graph.Read(pass, resource, state);
+			accesses.push_back({ pass, resource, state });
+		}
+		void Write(RenderGraph::PassId pass, RenderGraph::ResourceId resource, uint32_t state)
+		{
+			graph.Write(pass, resource, state);
+			accesses.push_back({ pass, resource, state });
+		}
+	};
+
+	bool Overlaps(const RenderGraph& graph, RenderGraph::ResourceId a, RenderGraph::ResourceId b)
+	{
+		return graph.GetOffset(a) < graph.GetOffset(b) + graph.GetSize(b)
+			&& graph.GetOffset(b) < graph.GetOffset(a) + graph.GetSize(a);
+	}
+
+	// GPUの代わりにバリアを当てて状態とメモリの持ち主を追う
+	void Simulate(const TestGraph& test, size_t frames, bool verbose)
+	{
+		const RenderGraph& graph = test.graph;
+		size_t count = graph.GetResourceCount();
+		std::vector<uint32_t> states(count);
+		for (RenderGraph::ResourceId id = 0; id < count; id++) { states[id] = graph.GetInitialState(id); }
+		std::vector<bool> active(count, false); // 一時リソースが今メモリを持っているか
+
+		auto apply = [&](const std::vector<RenderGraph::Barrier>& barriers, const std::string& where)
+		{
+			for (const RenderGraph::Barrier& b : barriers)
+			{
+				const std::string& name = graph.GetName(b.resource);
+				if (b.aliasing)
+				{
+					if (verbose)
+					{
+						printf("  %s: activate %s (from %s)\n", where.c_str(), name.c_str(),
+							!b.shared ? "-" : b.aliasedFrom == RenderGraph::INVALID ? "any" : graph.GetName(b.aliasedFrom).c_str());
+					}
+					Check(graph.IsTransient(b.resource), where + ": " + name + " activated but imported");
+					for (RenderGraph::ResourceId other = 0; other < count; other++)
+					{
+						if (other == b.resource || !active[other] || !Overlaps(graph, other, b.resource)) { continue; }
+						// 重なるものは知らされた前の持ち主だけで(INVALIDならどれでもよい)、ここで手放す
+						Check(b.shared && (b.aliasedFrom == RenderGraph::INVALID || other == b.aliasedFrom),
+							where + ": " + name + " overlaps live " + graph.GetName(other));
+						active[other] = false;
+					}
+					active[b.resource] = true;
+					continue;
+				}
+				if (verbose) { printf("  %s: %s %x -> %x\n", where.c_str(), name.c_str(), b.before, b.after); }
+				Check(states[b.resource] == b.before, where + ": " + name + " before " + std::to_string(b.before)
+					+ " but tracked " + std::to_string(states[b.resource]));
+				if (graph.IsTransient(b.resource))
+				{
+					// メモリを渡した後の遷移は、別のリソースの中身を壊す
+					Check(active[b.resource] || states[b.resource] == graph.GetInitialState(b.resource) || b.after == graph.GetInitialState(b.resource),
+						where + ": " + name + " transitioned while its memory belongs to another resource");
+				}
+				states[b.resource] = b.after;
+			}
+		};
+
+		for (size_t frame = 0; frame < frames; frame++)
+		{
+			for (RenderGraph::PassId pass : graph.GetOrder())
+			{
+				std::string where = "frame " + std::to_string(frame) + " pass " + std::to_string(pass);
+				apply(graph.GetBarriers(pass), where);
+				for (const Access& access : test.accesses)
+				{
+					if (access.pass != pass) { continue; }
+					const std::string& name = graph.GetName(access.resource);
+					Check(states[access.resource] == access.state || (states[access.resource] & access.state) == access.state,
+						where + ": " + name + " used in " + std::to_string(access.state) + " but in " + std::to_string(states[access.resource]));
+					if (graph.IsTransient(access.resource))
+					{
+						Check(active[access.resource], where + ": " + name + " used before it was activated");
+					}
+				}
+			}
+			apply(graph.GetFinalBarriers(), "frame " + std::to_string(frame) + " final");
+
+			// フレームの終わりでは全て最初の状態に戻っている
+			for (RenderGraph::ResourceId id = 0; id < count; id++)
+			{
+				if (!graph.IsUsed(id)) { continue; }
+				Check(states[id] == graph.GetInitialState(id) || !graph.IsTransient(id),
+					"frame " + std::to_string(frame) + ": " + graph.GetName(id) + " did not return to its initial state");
+			}
+		}
+	}
+
+	void TestDeferred(size_t frames, bool verbose)
+	{
+		const size_t MB = 1 << 20;
+		const size_t ALIGNMENT = 64 * 1024;
+		TestGraph test;
+		RenderGraph& g = test.graph;
+		RenderGraph::ResourceId back = g.Import("BackBuffer", PRESENT, PRESENT);
+		RenderGraph::ResourceId albedo = g.CreateTransient("Albedo", 8 * MB, ALIGNMENT);
+		RenderGraph::ResourceId normal = g.CreateTransient("Normal", 16 * MB, ALIGNMENT);
+		RenderGraph::ResourceId depth = g.CreateTransient("Depth", 8 * MB, ALIGNMENT);
+		RenderGraph::ResourceId hdr = g.CreateTransient("HDR", 16 * MB, ALIGNMENT);
+		RenderGraph::ResourceId bloom = g.CreateTransient("Bloom", 4 * MB, ALIGNMENT);
+		RenderGraph::ResourceId ldr = g.CreateTransient("LDR", 8 * MB, ALIGNMENT);
+		RenderGraph::ResourceId debug = g.CreateTransient("Debug", 32 * MB, ALIGNMENT);
+
+		RenderGraph::PassId gbuffer = g.AddPass("GBuffer");
+		test.Write(gbuffer, albedo, RENDER_TARGET);
+		test.Write(gbuffer, normal, RENDER_TARGET);
+		test.Write(gbuffer, depth, DEPTH_WRITE);
+		RenderGraph::PassId debugView = g.AddPass("DebugView"); // 誰も読まないので削られる
+		test.Read(debugView, normal, PIXEL_SHADER_RESOURCE);
+		test.Write(debugView, debug, RENDER_TARGET);
+		RenderGraph::PassId lighting = g.AddPass("Lighting");
+		test.Read(lighting, albedo, PIXEL_SHADER_RESOURCE);
+		test.Read(lighting, normal, PIXEL_SHADER_RESOURCE);
+		test.Read(lighting, depth, DEPTH_READ | PIXEL_SHADER_RESOURCE);
+		test.Write(lighting, hdr, RENDER_TARGET);
+		RenderGraph::PassId bloomPass = g.AddPass("Bloom");
+		test.Read(bloomPass, hdr, NON_PIXEL_SHADER_RESOURCE);
+		test.Write(bloomPass, bloom, UNORDERED_ACCESS);
+		RenderGraph::PassId tonemap = g.AddPass("Tonemap");
+		test.Read(tonemap, hdr, PIXEL_SHADER_RESOURCE);
+		test.Read(tonemap, bloom, PIXEL_SHADER_RESOURCE);
+		test.Write(tonemap, ldr, RENDER_TARGET);
+		RenderGraph::PassId ui = g.AddPass("UI");
+		test.Read(ui, ldr, PIXEL_SHADER_RESOURCE);
+		test.Write(ui, back, RENDER_TARGET);
+		g.Compile();
+
+		Check(g.IsCulled(debugView) && !g.IsUsed(debug), "DebugView and its target are culled");
+		Check(!g.IsCulled(gbuffer) && !g.IsCulled(lighting) && !g.IsCulled(bloomPass) && !g.IsCulled(tonemap) && !g.IsCulled(ui),
+			"passes feeding the back buffer are kept");
+		RenderGraph::Stats stats = g.GetStats();
+		Check(stats.aliasedBytes < stats.unaliasedBytes, "transients share memory");
+		// LDRはG-bufferの後に始まるので、G-bufferのどれかの場所を使う
+		bool ldrReuses = Overlaps(g, ldr, albedo) || Overlaps(g, ldr, normal) || Overlaps(g, ldr, depth);
+		Check(ldrReuses, "LDR reuses G-buffer memory");
+
+		printf("deferred: passes %zu culled %zu transients %zu memory %zu/%zu MB transitions %zu aliasing %zu\n",
+			stats.passCount, stats.culledPasses, stats.transientCount, stats.aliasedBytes / MB, stats.unaliasedBytes / MB,
+			stats.transitionCount, stats.aliasingCount);
+		Simulate(test, frames, verbose);
+	}
+
+	// 最後に使うものと最初に使うものが同じ場所なら、次のフレームの使い始めは前のフレームの持ち主から受け取る
+	void TestWrapAround(size_t frames, bool verbose)
+	{
+		TestGraph test;
+		RenderGraph& g = test.graph;
+		RenderGraph::ResourceId back = g.Import("BackBuffer", PRESENT, PRESENT);
+		RenderGraph::ResourceId first = g.CreateTransient("First", 1024, 256);
+		RenderGraph::ResourceId last = g.CreateTransient("Last", 1024, 256);
+		RenderGraph::PassId a = g.AddPass("A");
+		test.Write(a, first, RENDER_TARGET);
+		RenderGraph::PassId b = g.AddPass("B");
+		test.Read(b, first, PIXEL_SHADER_RESOURCE);
+		test.Write(b, back, RENDER_TARGET);
+		RenderGraph::PassId c = g.AddPass("C");
+		test.Read(c, back, PIXEL_SHADER_RESOURCE);
+		test.Write(c, last, RENDER_TARGET);
+		RenderGraph::PassId d = g.AddPass("D");
+		test.Read(d, last, PIXEL_SHADER_RESOURCE);
+		test.Write(d, back, RENDER_TARGET);
+		g.Compile();
+
+		Check(Overlaps(g, first, last), "First and Last share memory");
+		bool wrapped = false;
+		for (const RenderGraph::Barrier& barrier : g.GetBarriers(a))
+		{
+			if (barrier.aliasing && barrier.resource == first) { wrapped = barrier.shared && barrier.aliasedFrom == last; }
+		}
+		Check(wrapped, "First takes its memory from the previous frame's Last");
+		Simulate(test, frames, verbose);
+	}
+
+	// 外に出ないパスの連鎖は全て削られ、副作用のあるパスだけが残る
+	void TestCulling()
+	{
+		RenderGraph g;
+		RenderGraph::ResourceId x = g.CreateTransient("x", 1, 1);
+		RenderGraph::ResourceId y = g.CreateTransient("y", 1, 1);
+		RenderGraph::PassId p0 = g.AddPass("a");
+		g.Write(p0, x, RENDER_TARGET);
+		RenderGraph::PassId p1 = g.AddPass("b");
+		g.Read(p1, x, PIXEL_SHADER_RESOURCE);
+		g.Write(p1, y, RENDER_TARGET);
+		RenderGraph::PassId p2 = g.AddPass("c", true);
+		g.Compile();
+		Check(g.IsCulled(p0) && g.IsCulled(p1) && !g.IsCulled(p2), "unread chain is culled, side-effect pass kept");
+		Check(g.GetFinalBarriers().empty(), "nothing to restore when everything is culled");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t frames = 3;
+	bool verbose = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--frames") && i + 1 < argc) { frames = (size_t)strtoul(argv[++i], nullptr, 10); }
+		else if (!strcmp(argv[i], "--verbose")) { verbose = true; }
+	}
+
+	TestDeferred(frames, verbose);
+	TestWrapAround(frames, verbose);
+	TestCulling();
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
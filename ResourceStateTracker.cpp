@@ -0,0 +1,107 @@
+﻿#include "ResourceStateTracker.h"
+#include <algorithm>
+
+void ResourceStateTracker::Register(const void* resource, uint32_t subresourceCount, uint32_t state)
+{
+	Resource& r = resources[resource];
+	r.flushed.assign((std::max)(subresourceCount, 1u), state);
+	r.current = r.flushed;
+	r.pendingRequests = 0;
+}
+void ResourceStateTracker::Unregister(const void* resource)
+{
+	resources.erase(resource);
+	dirty.erase(std::remove(dirty.begin(), dirty.end(), resource), dirty.end());
+}
+
+bool ResourceStateTracker::Satisfies(uint32_t current, uint32_t requested) const
+{
+	if (current == requested) { return true; }
+	// 読み込み同士なら、今の状態が要求を含んでいれば良い
+	bool readOnly = requested != 0 && (current & ~readStates) == 0 && (requested & ~readStates) == 0;
+	return readOnly && (current & requested) == requested;
+}
+
+void ResourceStateTracker::Transition(const void* resource, uint32_t state, uint32_t subresource)
+{
+	stats.requests++;
+	auto it = resources.find(resource);
+	if (it == resources.end())
+	{
+		stats.removed++;
+		return;
+	}
+	Resource& r = it->second;
+
+	bool changed = false;
+	size_t begin = subresource == ALL_SUBRESOURCES ? 0 : subresource;
+	size_t end = subresource == ALL_SUBRESOURCES ? r.current.size() : (std::min)(size_t(subresource) + 1, r.current.size());
+	for (size_t i = begin; i < end; i++)
+	{
+		if (Satisfies(r.current[i], state)) { continue; }
+		// 読み込み同士は1つの状態にまとめて、次の読み込みで戻さずに済むようにする
+		bool readOnly = r.current[i] != 0 && (r.current[i] & ~readStates) == 0 && (state & ~readStates) == 0;
+		r.current[i] = readOnly ? (r.current[i] | state) : state;
+		changed = true;
+	}
+
+	if (!changed)
+	{
+		// 既に欲しい状態になっている
+		stats.removed++;
+		return;
+	}
+	if (r.pendingRequests++ == 0) { dirty.push_back(resource); }
+}
+
+size_t ResourceStateTracker::Flush(std::vector<StateTransition>& out)
+{
+	size_t added = 0;
+	for (const void* resource : dirty)
+	{
+		Resource& r = resources[resource];
+
+		// 変わるサブリソースを数え、全部が同じ遷移か調べる
+		size_t changes = 0;
+		bool uniform = true;
+		for (size_t i = 0; i < r.current.size(); i++)
+		{
+			if (r.flushed[i] != r.current[i]) { changes++; }
+			if (r.flushed[i] != r.flushed[0] || r.current[i] != r.current[0]) { uniform = false; }
+		}
+
+		size_t issued = 0;
+		if (changes > 0 && uniform && r.current.size() > 1)
+		{
+			out.push_back({ resource, ALL_SUBRESOURCES, r.flushed[0], r.current[0] });
+			issued = 1;
+		}
+		else
+		{
+			for (size_t i = 0; i < r.current.size(); i++)
+			{
+				if (r.flushed[i] == r.current[i]) { continue; }
+				out.push_back({ resource, r.current.size() > 1 ? (uint32_t)i : ALL_SUBRESOURCES, r.flushed[i], r.current[i] });
+				issued++;
+			}
+		}
+		r.flushed = r.current;
+
+		// バリアより多かった要求は打ち消されたか、まとめられた
+		if (r.pendingRequests > issued) { stats.removed += r.pendingRequests - issued; }
+		r.pendingRequests = 0;
+		added += issued;
+	}
+	dirty.clear();
+
+	stats.issued += added;
+	if (added > 0) { stats.flushes++; }
+	return added;
+}
+
+uint32_t ResourceStateTracker::GetState(const void* resource, uint32_t subresource) const
+{
+	auto it = resources.find(resource);
+	if (it == resources.end() || subresource >= it->second.current.size()) { return 0; }
+	return it->second.current[subresource];
+}
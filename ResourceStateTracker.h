@@ -0,0 +1,62 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// 状態遷移1つ分(D3D12_RESOURCE_BARRIERのTransitionになる)
+struct StateTransition
+{
+	const void* resource; // D3D12ならID3D12Resource*
+	uint32_t subresource; // ALL_SUBRESOURCESなら全体
+	uint32_t before;
+	uint32_t after;
+};
+
+// リソースの状態をサブリソースごとに覚え、必要な遷移だけをまとめて出す(デバイスに依存しない)
+// Transitionは欲しい状態を記録するだけで、Flushで前回のFlushからの差分をバリアにする
+// そのため A→B→C は A→C の1つに、A→B→A は何も出さずに消える
+class ResourceStateTracker
+{
+public:
+	static const uint32_t ALL_SUBRESOURCES = 0xffffffff;
+
+	struct Stats
+	{
+		size_t requests; // Transitionの呼び出し回数
+		size_t issued; // 出したバリアの数
+		size_t removed; // バリアにならなかった要求(既に同じ状態、打ち消し、まとめ)
+		size_t flushes; // バリアを出したFlushの回数(ResourceBarrierの呼び出し回数)
+	};
+
+	// readStatesは読み込み専用の状態のビット(その一部しか要らない要求は遷移しない)
+	ResourceStateTracker(uint32_t readStates = 0) : readStates(readStates), stats() {}
+
+	void Register(const void* resource, uint32_t subresourceCount, uint32_t state);
+	void Unregister(const void* resource);
+	bool IsRegistered(const void* resource) const { return resources.count(resource) != 0; }
+
+	void Transition(const void* resource, uint32_t state, uint32_t subresource = ALL_SUBRESOURCES);
+	// 溜まった遷移をoutの末尾に足す(全てのサブリソースが同じ遷移なら1つにまとめる)
+	// 戻り値は足した数
+	size_t Flush(std::vector<StateTransition>& out);
+
+	// Flush前の要求を含めた今の状態
+	uint32_t GetState(const void* resource, uint32_t subresource = 0) const;
+	Stats GetStats() const { return stats; }
+
+private:
+	struct Resource
+	{
+		std::vector<uint32_t> flushed; // 最後のFlush時点の状態
+		std::vector<uint32_t> current; // 要求された状態
+		size_t pendingRequests; // 前回のFlushから状態を変えた要求の数
+	};
+
+	uint32_t readStates;
+	std::unordered_map<const void*, Resource> resources;
+	std::vector<const void*> dirty; // 登録順に処理する
+	Stats stats;
+
+	bool Satisfies(uint32_t current, uint32_t requested) const;
+};
@@ -0,0 +1,244 @@
+﻿// ResourceStateTrackerの遷移のまとめ方とバリアの数を、D3D12と同じ状態の値で確かめる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 ResourceStateTrackerTest.cpp ResourceStateTracker.cpp -o ResourceStateTrackerTest
+// 使い方
+//   ResourceStateTrackerTest [--frames N]
+//   先に次を確かめる
+//   ・サブリソースごとに状態を覚え、変わったサブリソースだけのバリアを出し、全部が同じ遷移なら1つにまとめる
+//   ・いくつのリソースを遷移させても、1回のFlushで出し、flushesは1つだけ増える
+//   ・同じ状態への要求、A→B→A、読み込み同士で既に含む状態への要求はバリアにならず、A→B→CはA→Cになる
+//   ・requests、issued、removed、flushesが出したバリアと合う
+//   そのあとNフレーム(既定1000)ランダムに遷移させ、バリアのbeforeが前のFlushの状態と一致し、
+//   afterが要求後の状態になり、同じサブリソースが1回のFlushに2度出ないことを確かめる
+//   失敗すると理由を出して1を返す
+#include "ResourceStateTracker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		size_t frames = 1000;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--frames") { options.frames = strtoul(value, nullptr, 10); }
+			else { return false; }
+		}
+		return options.frames > 0;
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	// D3D12_RESOURCE_STATESと同じ値
+	enum : uint32_t
+	{
+		COMMON = 0,
+		VERTEX_AND_CONSTANT_BUFFER = 0x1,
+		RENDER_TARGET = 0x4,
+		UNORDERED_ACCESS = 0x8,
+		DEPTH_WRITE = 0x10,
+		DEPTH_READ = 0x20,
+		NON_PIXEL_SHADER_RESOURCE = 0x40,
+		PIXEL_SHADER_RESOURCE = 0x80,
+		COPY_DEST = 0x400,
+		COPY_SOURCE = 0x800,
+	};
+	const uint32_t READ_STATES = VERTEX_AND_CONSTANT_BUFFER | DEPTH_READ | NON_PIXEL_SHADER_RESOURCE | PIXEL_SHADER_RESOURCE | COPY_SOURCE;
+	const uint32_t ALL = ResourceStateTracker::ALL_SUBRESOURCES;
+
+	bool Same(const StateTransition& t, const void* resource, uint32_t subresource, uint32_t before, uint32_t after)
+	{
+		return t.resource == resource && t.subresource == subresource && t.before == before && t.after == after;
+	}
+
+	void TestSubresources()
+	{
+		ResourceStateTracker tracker(READ_STATES);
+		int texture = 0;
+		tracker.Register(&texture, 4, RENDER_TARGET);
+		std::vector<StateTransition> out;
+
+		// ミップ生成のように1枚ずつ読み込みへ
+		tracker.Transition(&texture, PIXEL_SHADER_RESOURCE, 0);
+		Check(tracker.GetState(&texture, 0) == PIXEL_SHADER_RESOURCE && tracker.GetState(&texture, 1) == RENDER_TARGET, "only the requested subresource should change");
+		Check(tracker.Flush(out) == 1 && Same(out[0], &texture, 0, RENDER_TARGET, PIXEL_SHADER_RESOURCE), "one subresource should give one barrier for that subresource");
+
+		// 残りがそろっていなければサブリソースごと
+		out.clear();
+		tracker.Transition(&texture, PIXEL_SHADER_RESOURCE);
+		Check(tracker.Flush(out) == 3, "moving the rest should give one barrier per changed subresource");
+		bool each = out.size() == 3;
+		for (uint32_t i = 0; each && i < 3; i++) { each = Same(out[i], &texture, i + 1, RENDER_TARGET, PIXEL_SHADER_RESOURCE); }
+		Check(each, "per-subresource barriers should name each subresource in order");
+
+		// 全部が同じ遷移なら1つ
+		out.clear();
+		tracker.Transition(&texture, RENDER_TARGET);
+		Check(tracker.Flush(out) == 1 && Same(out[0], &texture, ALL, PIXEL_SHADER_RESOURCE, RENDER_TARGET), "a uniform transition should collapse to ALL_SUBRESOURCES");
+
+		// サブリソースが1つならALL_SUBRESOURCES
+		int buffer = 0;
+		tracker.Register(&buffer, 1, COPY_DEST);
+		out.clear();
+		tracker.Transition(&buffer, VERTEX_AND_CONSTANT_BUFFER, 0);
+		Check(tracker.Flush(out) == 1 && Same(out[0], &buffer, ALL, COPY_DEST, VERTEX_AND_CONSTANT_BUFFER), "a single subresource should use ALL_SUBRESOURCES");
+
+		// 範囲外のサブリソースは何も変えない
+		tracker.Transition(&texture, UNORDERED_ACCESS, 9);
+		out.clear();
+		Check(tracker.Flush(out) == 0 && tracker.GetState(&texture, 9) == 0, "an out-of-range subresource should be ignored");
+	}
+
+	void TestMerging()
+	{
+		ResourceStateTracker tracker(READ_STATES);
+		int a = 0, b = 0, c = 0, d = 0, unknown = 0;
+		tracker.Register(&a, 1, RENDER_TARGET);
+		tracker.Register(&b, 1, RENDER_TARGET);
+		tracker.Register(&c, 1, DEPTH_WRITE);
+		tracker.Register(&d, 1, COPY_DEST);
+		std::vector<StateTransition> out;
+
+		tracker.Transition(&a, PIXEL_SHADER_RESOURCE); // 1つ出る
+		tracker.Transition(&b, PIXEL_SHADER_RESOURCE);
+		tracker.Transition(&b, RENDER_TARGET); // 打ち消し
+		tracker.Transition(&c, DEPTH_READ);
+		tracker.Transition(&c, PIXEL_SHADER_RESOURCE); // 読み込み同士はまとめる
+		tracker.Transition(&d, UNORDERED_ACCESS);
+		tracker.Transition(&d, COPY_SOURCE); // A→B→CはA→C
+		tracker.Transition(&a, PIXEL_SHADER_RESOURCE); // 同じ状態
+		tracker.Transition(&unknown, COPY_DEST); // 登録していない
+
+		Check(tracker.GetState(&c) == (DEPTH_READ | PIXEL_SHADER_RESOURCE), "read states should combine");
+		Check(tracker.Flush(out) == 3, "a flush should issue only the net transitions");
+		Check(out.size() == 3 && Same(out[0], &a, ALL, RENDER_TARGET, PIXEL_SHADER_RESOURCE) &&
+			Same(out[1], &c, ALL, DEPTH_WRITE, DEPTH_READ | PIXEL_SHADER_RESOURCE) &&
+			Same(out[2], &d, ALL, COPY_DEST, COPY_SOURCE), "barriers should follow the order resources were first touched");
+
+		ResourceStateTracker::Stats stats = tracker.GetStats();
+		Check(stats.requests == 9, "every Transition call should count as a request");
+		Check(stats.issued == 3, "issued should match the barriers");
+		Check(stats.removed == 6, "same-state, cancelled, merged and unknown requests should count as removed");
+		Check(stats.flushes == 1, "one flush should be one ResourceBarrier call");
+
+		// 既に含む読み込みは何もしない、空のFlushは数えない
+		out.clear();
+		tracker.Transition(&c, DEPTH_READ);
+		tracker.Transition(&a, NON_PIXEL_SHADER_RESOURCE | PIXEL_SHADER_RESOURCE);
+		Check(tracker.Flush(out) == 1 && Same(out[0], &a, ALL, PIXEL_SHADER_RESOURCE, NON_PIXEL_SHADER_RESOURCE | PIXEL_SHADER_RESOURCE), "a read already included should be dropped");
+		out.clear();
+		Check(tracker.Flush(out) == 0, "an idle flush should issue nothing");
+		stats = tracker.GetStats();
+		Check(stats.requests == 11 && stats.issued == 4 && stats.removed == 7 && stats.flushes == 2, "an empty flush should not count");
+
+		// 書き込みへはまとめずに遷移する
+		tracker.Transition(&a, RENDER_TARGET);
+		Check(tracker.Flush(out) == 1 && Same(out.back(), &a, ALL, NON_PIXEL_SHADER_RESOURCE | PIXEL_SHADER_RESOURCE, RENDER_TARGET), "a write should replace the combined read state");
+
+		// 解除したリソースは保留中でも出さない
+		tracker.Transition(&d, RENDER_TARGET);
+		tracker.Unregister(&d);
+		out.clear();
+		Check(tracker.Flush(out) == 0 && !tracker.IsRegistered(&d), "an unregistered resource should drop its pending transitions");
+	}
+
+	// 出したバリアを、前のFlushから追った状態と比べる
+	void TestRandom(const Options& options)
+	{
+		const uint32_t states[] = { RENDER_TARGET, UNORDERED_ACCESS, DEPTH_WRITE, DEPTH_READ, NON_PIXEL_SHADER_RESOURCE,
+			PIXEL_SHADER_RESOURCE, COPY_DEST, COPY_SOURCE, VERTEX_AND_CONSTANT_BUFFER };
+		const size_t RESOURCES = 16;
+		ResourceStateTracker tracker(READ_STATES);
+		std::vector<int> storage(RESOURCES);
+		std::vector<std::vector<uint32_t>> known(RESOURCES);
+		std::mt19937 rng(1);
+		for (size_t i = 0; i < RESOURCES; i++)
+		{
+			known[i].assign(1 + rng() % 6, COMMON);
+			tracker.Register(&storage[i], (uint32_t)known[i].size(), COMMON);
+		}
+
+		bool beforeMatches = true, afterMatches = true, once = true, noop = false;
+		size_t barriers = 0, flushes = 0;
+		for (size_t frame = 0; frame < options.frames; frame++)
+		{
+			size_t requests = rng() % 24;
+			for (size_t i = 0; i < requests; i++)
+			{
+				size_t r = rng() % RESOURCES;
+				uint32_t state = states[rng() % (sizeof(states) / sizeof(states[0]))];
+				uint32_t subresource = rng() % 3 == 0 ? ALL : (uint32_t)(rng() % known[r].size());
+				tracker.Transition(&storage[r], state, subresource);
+			}
+
+			std::vector<StateTransition> out;
+			size_t added = tracker.Flush(out);
+			barriers += added;
+			flushes += added > 0;
+			std::set<std::pair<const void*, uint32_t>> seen;
+			for (const StateTransition& t : out)
+			{
+				size_t r = (const int*)t.resource - storage.data();
+				std::vector<uint32_t>& tracked = known[r];
+				noop = noop || t.before == t.after;
+				once = once && seen.insert({ t.resource, t.subresource }).second;
+				size_t begin = t.subresource == ALL ? 0 : t.subresource;
+				size_t end = t.subresource == ALL ? tracked.size() : t.subresource + 1;
+				for (size_t s = begin; s < end; s++)
+				{
+					beforeMatches = beforeMatches && tracked[s] == t.before;
+					tracked[s] = t.after;
+				}
+			}
+			for (size_t r = 0; r < RESOURCES; r++)
+			{
+				for (size_t s = 0; s < known[r].size(); s++) { afterMatches = afterMatches && tracker.GetState(&storage[r], (uint32_t)s) == known[r][s]; }
+			}
+		}
+
+		ResourceStateTracker::Stats stats = tracker.GetStats();
+		Check(beforeMatches, "a barrier's before state differs from the state after the previous flush");
+		Check(afterMatches, "the state after the barriers differs from the requested state");
+		Check(once, "a subresource appeared twice in one flush");
+		Check(!noop, "a barrier did not change the state");
+		Check(stats.issued == barriers && stats.flushes == flushes, "issued and flushes should match what Flush returned");
+		printf("%zu frames: %zu requests, %zu barriers in %zu flushes, %zu removed\n",
+			options.frames, stats.requests, stats.issued, stats.flushes, stats.removed);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: ResourceStateTrackerTest [--frames N]\n");
+		return 2;
+	}
+
+	TestSubresources();
+	TestMerging();
+	TestRandom(options);
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
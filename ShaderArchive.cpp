@@ -0,0 +1,315 @@
+﻿#include "ShaderArchive.h"
+#include "PipelineCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const size_t HEADER_SIZE = 16;
+	const size_t ENTRY_SIZE = 32;
+	const size_t CODE_ALIGNMENT = 16;
+
+	std::string Narrow(const std::wstring& str) { return std::string(str.begin(), str.end()); }
+
+	bool LoadSource(const std::wstring& path, std::string& out)
+	{
+#ifdef _WIN32
+		FILE* fp = nullptr;
+		if (_wfopen_s(&fp, path.c_str(), L"rb") != 0) { fp = nullptr; }
+#else
+		FILE* fp = fopen(Narrow(path).c_str(), "rb");
+#endif
+		if (!fp) { return false; }
+		out.clear();
+		char buffer[16 * 1024];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0) { out.append(buffer, read); }
+		fclose(fp);
+		return true;
+	}
+
+	std::wstring GetDirectory(const std::wstring& path)
+	{
+		size_t pos = path.find_last_of(L"/\\");
+		return pos == std::wstring::npos ? L"" : path.substr(0, pos + 1);
+	}
+
+	// 行頭の #include のファイル名を書いた順に集める
+	std::vector<std::string> FindIncludes(const std::string& source)
+	{
+		std::vector<std::string> result;
+		size_t pos = 0;
+		while (pos < source.size())
+		{
+			size_t end = source.find('\n', pos);
+			if (end == std::string::npos) { end = source.size(); }
+
+			size_t i = source.find_first_not_of(" \t", pos);
+			if (i < end && source[i] == '#')
+			{
+				i = source.find_first_not_of(" \t", i + 1);
+				if (i < end && source.compare(i, 7, "include") == 0)
+				{
+					i = source.find_first_not_of(" \t", i + 7);
+					if (i < end && (source[i] == '"' || source[i] == '<'))
+					{
+						char close = source[i] == '"' ? '"' : '>';
+						size_t nameEnd = source.find(close, i + 1);
+						if (nameEnd < end) { result.push_back(source.substr(i + 1, nameEnd - i - 1)); }
+					}
+				}
+			}
+			pos = end + 1;
+		}
+		return result;
+	}
+
+	bool HashSource(const std::wstring& path, PipelineHasher& h, std::set<std::wstring>& visited, bool required)
+	{
+		std::string source;
+		if (!LoadSource(path, source))
+		{
+			// 見つからないインクルードはコンパイラに任せる
+			h.AddValue((uint8_t)0);
+			return !required;
+		}
+		h.AddValue((uint8_t)1);
+		h.AddValue((uint64_t)source.size());
+		h.Add(source.data(), source.size());
+
+		for (const std::string& name : FindIncludes(source))
+		{
+			h.AddString(name.c_str());
+			std::wstring includePath = GetDirectory(path) + std::wstring(name.begin(), name.end());
+			// 2回目以降は名前だけ(#pragma onceと同じ扱い)
+			if (!visited.insert(includePath).second) { continue; }
+			HashSource(includePath, h, visited, false);
+		}
+		return true;
+	}
+
+	void Write32(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++) { out.push_back((uint8_t)(value >> (i * 8))); }
+	}
+	void Write64(std::vector<uint8_t>& out, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++) { out.push_back((uint8_t)(value >> (i * 8))); }
+	}
+	uint64_t Read(const uint8_t* data, size_t bytes)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < bytes; i++) { value |= (uint64_t)data[i] << (i * 8); }
+		return value;
+	}
+}
+
+uint64_t ComputeShaderId(const std::wstring& fileName, const std::string& entry, const std::string& target,
+	const std::vector<ShaderDefine>& defines, uint32_t flags)
+{
+	PipelineHasher h;
+	h.AddString(Narrow(fileName).c_str());
+	h.AddString(entry.c_str());
+	h.AddString(target.c_str());
+	h.AddValue(flags);
+	h.AddValue((uint32_t)defines.size());
+	for (const ShaderDefine& define : defines)
+	{
+		h.AddString(define.name.c_str());
+		h.AddString(define.value.c_str());
+	}
+	return h.Get();
+}
+
+bool ComputeShaderKey(const std::wstring& fileName, uint64_t& key)
+{
+	PipelineHasher h;
+	std::set<std::wstring> visited = { fileName };
+	if (!HashSource(fileName, h, visited, true)) { return false; }
+	key = h.Get();
+	return true;
+}
+
+ShaderArchive::~ShaderArchive()
+{
+	Close();
+}
+bool ShaderArchive::Open(const std::wstring& path)
+{
+	Close();
+#ifdef _WIN32
+	HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) { return false; }
+	file = handle;
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		Close();
+		return false;
+	}
+	view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	viewSize = (size_t)fileSize.QuadPart;
+#else
+	int fd = open(Narrow(path).c_str(), O_RDONLY);
+	if (fd < 0) { return false; }
+	struct stat st {};
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p != MAP_FAILED)
+	{
+		view = static_cast<const uint8_t*>(p);
+		viewSize = (size_t)st.st_size;
+	}
+#endif
+	if (!view)
+	{
+		Close();
+		return false;
+	}
+
+	// 目次が全て範囲内で、キーが昇順か確かめる
+	bool ok = viewSize >= HEADER_SIZE && Read(view, 4) == MAGIC && Read(view + 4, 4) == VERSION;
+	if (ok)
+	{
+		count = (size_t)Read(view + 8, 4);
+		ok = count <= (viewSize - HEADER_SIZE) / ENTRY_SIZE;
+	}
+	for (size_t i = 0; ok && i < count; i++)
+	{
+		const uint8_t* entry = view + HEADER_SIZE + ENTRY_SIZE * i;
+		uint64_t offset = Read(entry + 16, 8);
+		uint64_t size = Read(entry + 24, 8);
+		ok = offset <= viewSize && size <= viewSize - offset;
+		if (ok && i > 0) { ok = Read(entry - ENTRY_SIZE, 8) < Read(entry, 8); }
+	}
+	if (!ok)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+void ShaderArchive::Close()
+{
+#ifdef _WIN32
+	if (view) { UnmapViewOfFile(view); }
+	if (mapping) { CloseHandle(mapping); }
+	if (file) { CloseHandle(file); }
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (view) { munmap(const_cast<uint8_t*>(view), viewSize); }
+#endif
+	view = nullptr;
+	viewSize = 0;
+	count = 0;
+}
+const uint8_t* ShaderArchive::FindEntry(uint64_t id) const
+{
+	// 目次はIDの昇順なので二分探索
+	size_t lo = 0, hi = count;
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		const uint8_t* entry = view + HEADER_SIZE + ENTRY_SIZE * mid;
+		uint64_t midId = Read(entry, 8);
+		if (midId == id) { return entry; }
+		if (midId < id) { lo = mid + 1; }
+		else { hi = mid; }
+	}
+	return nullptr;
+}
+bool ShaderArchive::Find(uint64_t id, const void*& data, size_t& size) const
+{
+	const uint8_t* entry = FindEntry(id);
+	if (!entry) { return false; }
+	data = view + Read(entry + 16, 8);
+	size = (size_t)Read(entry + 24, 8);
+	return true;
+}
+bool ShaderArchive::FindSourceKey(uint64_t id, uint64_t& sourceKey) const
+{
+	const uint8_t* entry = FindEntry(id);
+	if (!entry) { return false; }
+	sourceKey = Read(entry + 8, 8);
+	return true;
+}
+
+void ShaderArchiveWriter::Add(uint64_t id, uint64_t sourceKey, const void* data, size_t size)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	for (Entry& entry : entries)
+	{
+		// 同じID(同じファイルと設定)は1つにまとめる
+		if (entry.id == id)
+		{
+			entry.sourceKey = sourceKey;
+			entry.code.assign(p, p + size);
+			return;
+		}
+	}
+	entries.push_back({ id, sourceKey, std::vector<uint8_t>(p, p + size) });
+}
+std::vector<uint8_t> ShaderArchiveWriter::Serialize() const
+{
+	std::vector<const Entry*> sorted;
+	for (const Entry& entry : entries) { sorted.push_back(&entry); }
+	std::sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) { return a->id < b->id; });
+
+	std::vector<uint8_t> out;
+	Write32(out, ShaderArchive::MAGIC);
+	Write32(out, ShaderArchive::VERSION);
+	Write32(out, (uint32_t)sorted.size());
+	Write32(out, 0);
+
+	uint64_t offset = HEADER_SIZE + ENTRY_SIZE * sorted.size();
+	for (const Entry* entry : sorted)
+	{
+		offset = (offset + CODE_ALIGNMENT - 1) & ~(uint64_t)(CODE_ALIGNMENT - 1);
+		Write64(out, entry->id);
+		Write64(out, entry->sourceKey);
+		Write64(out, offset);
+		Write64(out, entry->code.size());
+		offset += entry->code.size();
+	}
+	for (const Entry* entry : sorted)
+	{
+		out.resize((out.size() + CODE_ALIGNMENT - 1) & ~(CODE_ALIGNMENT - 1));
+		out.insert(out.end(), entry->code.begin(), entry->code.end());
+	}
+	return out;
+}
+bool ShaderArchiveWriter::Save(const std::wstring& path) const
+{
+	std::vector<uint8_t> data = Serialize();
+#ifdef _WIN32
+	FILE* fp = nullptr;
+	if (_wfopen_s(&fp, path.c_str(), L"wb") != 0) { fp = nullptr; }
+#else
+	FILE* fp = fopen(Narrow(path).c_str(), "wb");
+#endif
+	if (!fp) { return false; }
+	bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+	return (fclose(fp) == 0) && ok;
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+// アーカイブを引くためのID(ファイル名、マクロ、エントリー、ターゲット、フラグのハッシュ)
+// ファイルを読まないので実行時はこれだけで探せる
+uint64_t ComputeShaderId(const std::wstring& fileName, const std::string& entry, const std::string& target,
+	const std::vector<ShaderDefine>& defines, uint32_t flags);
+
+// ソースのキー(ソースと#includeしたファイルの中身のハッシュ)
+// ビルド時にだけ使い、変わっていないシェーダはコンパイルし直さない
+// #include "..." と <...> は書いたファイルのフォルダから辿る(見つからなければ名前だけ混ぜる)
+// 読めなければfalse
+bool ComputeShaderKey(const std::wstring& fileName, uint64_t& key);
+
+// 事前にコンパイルしたバイトコードをまとめたファイル(メモリマップして読む)
+// ファイルの形式(リトルエンディアン)
+//   ヘッダ: magic "SHDA", version(4), count(4), reserved(4)
+//   目次: idの昇順にcount個の { id(8), sourceKey(8), offset(8), size(8) }
+//   本体: 各バイトコードをoffsetの位置に並べる(offsetはファイル先頭から)
+class ShaderArchive
+{
+public:
+	static const uint32_t MAGIC = 0x41444853; // "SHDA"
+	static const uint32_t VERSION = 2;
+
+	ShaderArchive() = default;
+	~ShaderArchive();
+
+	ShaderArchive(const ShaderArchive&) = delete;
+	ShaderArchive& operator=(const ShaderArchive&) = delete;
+
+	// 無いか壊れていればfalse(Findは常に失敗する)
+	bool Open(const std::wstring& path);
+	void Close();
+	// 見つかればdataはマップした領域を指す(Closeまで有効)
+	bool Find(uint64_t id, const void*& data, size_t& size) const;
+	// 作ったときのソースのキー
+	bool FindSourceKey(uint64_t id, uint64_t& sourceKey) const;
+	size_t GetCount() const { return count; }
+
+private:
+	const uint8_t* view = nullptr;
+	size_t viewSize = 0;
+	size_t count = 0;
+
+	const uint8_t* FindEntry(uint64_t id) const;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
+
+// ShaderArchiveのファイルを作る
+class ShaderArchiveWriter
+{
+public:
+	void Add(uint64_t id, uint64_t sourceKey, const void* data, size_t size);
+	std::vector<uint8_t> Serialize() const;
+	bool Save(const std::wstring& path) const;
+
+private:
+	struct Entry
+	{
+		uint64_t id;
+		uint64_t sourceKey;
+		std::vector<uint8_t> code;
+	};
+	std::vector<Entry> entries;
+};
@@ -0,0 +1,23 @@
+cbuffer ConstBufferDataTransform : register(b1)
+{
+	matrix mat;
+}
+
+struct SpriteInstance
+{
+	float4 m;
+	float2 t;
+	uint color;
+	uint texture;
+	float4 uv;
+};
+
+StructuredBuffer<SpriteInstance> instances : register(t1);
+
+struct VSOutPut
+{
+	float4 svpos : SV_POSITION;
+	float2 uv : TEXCOORD;
+	float4 color : COLOR;
+	nointerpolation uint texture : TEXTURE;
+};
@@ -0,0 +1,132 @@
+﻿#include "SpriteBatch.h"
+#include <cmath>
+
+namespace
+{
+	uint32_t MakeKey(const Sprite& sprite, bool bindless)
+	{
+		uint32_t texture = bindless ? 0 : (sprite.texture & 0xfffff);
+		return ((sprite.layer & 0xff) << 24) | ((sprite.blendMode & 0xf) << 20) | texture;
+	}
+
+	uint32_t PackColor(const float color[4])
+	{
+		uint32_t result = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			float c = color[i] < 0.0f ? 0.0f : (color[i] > 1.0f ? 1.0f : color[i]);
+			result |= (uint32_t)(c * 255.0f + 0.5f) << (i * 8);
+		}
+		return result;
+	}
+}
+
+void SpriteBatch::Begin()
+{
+	sprites.clear();
+	batches.clear();
+}
+void SpriteBatch::Draw(const Sprite& sprite)
+{
+	sprites.push_back(sprite);
+}
+
+void SpriteBatch::Sort()
+{
+	size_t count = sprites.size();
+	keys.resize(count);
+	order.resize(count);
+	tmpKeys.resize(count);
+	tmpOrder.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		keys[i] = MakeKey(sprites[i], bindless);
+		order[i] = (uint32_t)i;
+	}
+
+	// 8bitずつの安定な基数ソート(全て同じ桁は飛ばす)
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++) { histogram[(keys[i] >> shift) & 0xff]++; }
+		if (histogram[(keys[0] >> shift) & 0xff] == count) { continue; }
+
+		size_t offset = 0;
+		for (size_t& h : histogram)
+		{
+			size_t n = h;
+			h = offset;
+			offset += n;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t dst = histogram[(keys[i] >> shift) & 0xff]++;
+			tmpKeys[dst] = keys[i];
+			tmpOrder[dst] = order[i];
+		}
+		keys.swap(tmpKeys);
+		order.swap(tmpOrder);
+	}
+}
+void SpriteBatch::End(SpriteInstance* dest)
+{
+	batches.clear();
+	if (sprites.empty()) { return; }
+
+	Sort();
+
+	for (size_t i = 0; i < sprites.size(); i++)
+	{
+		const Sprite& sprite = sprites[order[i]];
+
+		// キーが変わったら新しいバッチ
+		if (i == 0 || keys[i] != keys[i - 1])
+		{
+			batches.push_back({ sprite.texture & 0xfffff, sprite.blendMode & 0xf, sprite.layer & 0xff, i, 0 });
+		}
+		batches.back().instanceCount++;
+
+		// 回転 * 大きさ をまとめた行列と、基準点を引いた平行移動
+		float c = cosf(sprite.rotation);
+		float s = sinf(sprite.rotation);
+		SpriteInstance& instance = dest[i];
+		instance.matrix[0] = c * sprite.size[0];
+		instance.matrix[1] = -s * sprite.size[1];
+		instance.matrix[2] = s * sprite.size[0];
+		instance.matrix[3] = c * sprite.size[1];
+		instance.translation[0] = sprite.position[0]
+			- (instance.matrix[0] * sprite.pivot[0] + instance.matrix[1] * sprite.pivot[1]);
+		instance.translation[1] = sprite.position[1]
+			- (instance.matrix[2] * sprite.pivot[0] + instance.matrix[3] * sprite.pivot[1]);
+		instance.color = PackColor(sprite.color);
+		instance.texture = sprite.texture & 0xfffff;
+		for (int j = 0; j < 4; j++) { instance.uv[j] = sprite.uv[j]; }
+	}
+}
+
+void SpriteBatch::Record(GraphicsCommandList& list, size_t begin, size_t end, const SpriteDrawTargets& targets) const
+{
+	if (begin >= end) { return; }
+
+	const PipelineId NONE = UINT32_MAX;
+	PipelineId current = NONE;
+	uint64_t texture = UINT64_MAX;
+	list.SetConstantBuffer(targets.constantsParam, targets.constants);
+	for (size_t i = begin; i < end; i++)
+	{
+		const SpriteDrawBatch& batch = batches[i];
+		if (current != targets.pipelines[batch.blendMode])
+		{
+			current = targets.pipelines[batch.blendMode];
+			list.SetPipeline(current);
+		}
+		if (!bindless && texture != targets.textures + (uint64_t)batch.texture * targets.descriptorSize)
+		{
+			texture = targets.textures + (uint64_t)batch.texture * targets.descriptorSize;
+			list.SetDescriptorTable(targets.texturesParam, texture);
+		}
+		// SV_InstanceIDは開始位置を含まないので、先頭をずらして渡す
+		list.SetShaderResource(targets.instancesParam, targets.instances + batch.firstInstance * sizeof(SpriteInstance));
+		list.Draw(4, (uint32_t)batch.instanceCount);
+	}
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GraphicsBackend.h"
+
+// 1枚のスプライト(座標はピクセル、回転はラジアン)
+struct Sprite
+{
+	float position[2] = { 0.0f,0.0f };
+	float size[2] = { 1.0f,1.0f };
+	float pivot[2] = { 0.5f,0.5f }; // 回転と配置の基準(0~1)
+	float rotation = 0.0f;
+	float uv[4] = { 0.0f,0.0f,1.0f,1.0f }; // 左上uv, 右下uv
+	float color[4] = { 1.0f,1.0f,1.0f,1.0f };
+	uint32_t texture = 0; // テクスチャ番号(20bit、バインドレスならデスクリプタの番号)
+	uint32_t blendMode = 0; // Blend::BlendMode(4bit)
+	uint32_t layer = 0; // 小さい方から先に描く(8bit)
+};
+
+// シェーダのStructuredBufferと同じ並び(48バイト)
+struct SpriteInstance
+{
+	float matrix[4]; // 0~1の四角形を画面へ写す2x2行列(x行, y行)
+	float translation[2];
+	uint32_t color; // RGBA8
+	uint32_t texture; // バインドレスで引くテクスチャの番号
+	float uv[4];
+};
+static_assert(sizeof(SpriteInstance) == 48, "SpriteInstance must match Sprite.hlsli");
+
+// 同じテクスチャとブレンドで続くインスタンスの範囲(1回のインスタンス描画になる)
+struct SpriteDrawBatch
+{
+	uint32_t texture;
+	uint32_t blendMode;
+	uint32_t layer;
+	size_t firstInstance;
+	size_t instanceCount;
+};
+
+// バッチを記録する時に使うパイプラインとアドレス
+struct SpriteDrawTargets
+{
+	const PipelineId* pipelines; // Blend::BlendModeごと
+	uint64_t constants; // 平行投影行列の定数バッファ
+	uint64_t instances; // End()で詰めた先のGPUアドレス
+	uint64_t textures; // バインドレスでない時の、テクスチャ番号0のデスクリプタ
+	uint32_t descriptorSize;
+	// ルートパラメータの番号
+	uint32_t constantsParam = 2;
+	uint32_t instancesParam = 3;
+	uint32_t texturesParam = 1;
+};
+
+// スプライトを集めてレイヤー、ブレンド、テクスチャ順に並べ、インスタンスデータへ詰める
+class SpriteBatch
+{
+public:
+	// trueならテクスチャはシェーダが番号で引くので、テクスチャが違ってもまとめて描く
+	bool bindless = false;
+
+	void Begin();
+	void Draw(const Sprite& sprite);
+	size_t GetSpriteCount() const { return sprites.size(); }
+
+	// 並べ替えてdestへ詰め、バッチを作る(destはGetSpriteCount()個分)
+	// 同じキーの中では描いた順が保たれる
+	void End(SpriteInstance* dest);
+	const std::vector<SpriteDrawBatch>& GetBatches() const { return batches; }
+	// バッチの[begin, end)を記録する(ルートシグネチャなどの共通の設定は済ませておく)
+	void Record(GraphicsCommandList& list, size_t begin, size_t end, const SpriteDrawTargets& targets) const;
+
+private:
+	std::vector<Sprite> sprites;
+	std::vector<uint32_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> tmpKeys;
+	std::vector<uint32_t> tmpOrder;
+	std::vector<SpriteDrawBatch> batches;
+
+	void Sort();
+};
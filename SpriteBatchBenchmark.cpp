@@ -0,0 +1,200 @@
+﻿// SpriteBatchの並べ替えとバッチのまとめ方を確かめ、Begin/Draw/Endの時間を測る(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 SpriteBatchBenchmark.cpp SpriteBatch.cpp -o SpriteBatchBenchmark
+// 使い方
+//   SpriteBatchBenchmark [--passes P] [--counts N,N,...]
+//   先に次を確かめる
+//   ・レイヤー、ブレンド、テクスチャの順に並び、同じキーの中では描いた順が保たれる
+//   ・バインドレスならテクスチャが違ってもレイヤーとブレンドが同じならまとまる
+//   そのあとN個(既定10000,100000,1000000)のスプライトを64枚のテクスチャ、4つのブレンド、4つのレイヤーへ
+//   ランダムに振り、並び順とバッチの数を確かめてから、Begin+Drawと、EndをそれぞれP回(既定10)測って、
+//   一番速い回の1個あたりのナノ秒を出す
+//   失敗すると理由を出して1を返す
+#include "SpriteBatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		size_t passes = 10;
+		std::vector<size_t> counts = { 10000, 100000, 1000000 };
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--passes") { options.passes = strtoul(value, nullptr, 10); }
+			else if (arg == "--counts")
+			{
+				options.counts.clear();
+				for (const char* p = value; *p;)
+				{
+					char* end = nullptr;
+					size_t count = strtoul(p, &end, 10);
+					if (end == p || count == 0) { return false; }
+					options.counts.push_back(count);
+					p = *end == ',' ? end + 1 : end;
+				}
+			}
+			else { return false; }
+		}
+		return options.passes > 0 && !options.counts.empty();
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	// 回転0、大きさ1、基準点0なので、インスタンスの平行移動がそのままpositionになる
+	// position[0]に描いた順番を入れておき、並んだ後の元の順番を読み戻す
+	Sprite MakeSprite(size_t index, uint32_t texture, uint32_t blendMode, uint32_t layer)
+	{
+		Sprite sprite;
+		sprite.position[0] = (float)index;
+		sprite.pivot[0] = 0.0f;
+		sprite.pivot[1] = 0.0f;
+		sprite.texture = texture;
+		sprite.blendMode = blendMode;
+		sprite.layer = layer;
+		return sprite;
+	}
+
+	uint64_t SortKey(const SpriteDrawBatch& batch, bool bindless)
+	{
+		return ((uint64_t)batch.layer << 24) | ((uint64_t)batch.blendMode << 20) | (bindless ? 0 : batch.texture);
+	}
+
+	// バッチが隙間なく全部を覆い、キーが増える順に並び、同じキーの中で描いた順が保たれているか
+	bool Sorted(const SpriteBatch& batch, const std::vector<SpriteInstance>& instances, const std::vector<Sprite>& sprites)
+	{
+		size_t next = 0;
+		uint64_t previous = 0;
+		for (const SpriteDrawBatch& b : batch.GetBatches())
+		{
+			uint64_t key = SortKey(b, batch.bindless);
+			if (b.firstInstance != next || b.instanceCount == 0) { return false; }
+			if (next != 0 && key <= previous) { return false; }
+			previous = key;
+			float last = -1.0f;
+			for (size_t i = b.firstInstance; i < b.firstInstance + b.instanceCount; i++)
+			{
+				float index = instances[i].translation[0];
+				if (index <= last) { return false; }
+				last = index;
+				const Sprite& sprite = sprites[(size_t)index];
+				if (sprite.layer != b.layer || sprite.blendMode != b.blendMode) { return false; }
+				if (!batch.bindless && sprite.texture != b.texture) { return false; }
+				if (instances[i].texture != sprite.texture) { return false; }
+			}
+			next += b.instanceCount;
+		}
+		return next == sprites.size();
+	}
+
+	size_t DistinctKeys(const std::vector<Sprite>& sprites, bool bindless)
+	{
+		std::set<uint32_t> keys;
+		for (const Sprite& sprite : sprites)
+		{
+			keys.insert((sprite.layer << 24) | (sprite.blendMode << 20) | (bindless ? 0 : sprite.texture));
+		}
+		return keys.size();
+	}
+
+	void Fill(SpriteBatch& batch, const std::vector<Sprite>& sprites)
+	{
+		batch.Begin();
+		for (const Sprite& sprite : sprites) { batch.Draw(sprite); }
+	}
+
+	template<class F>
+	double BestNanoseconds(size_t passes, F&& body)
+	{
+		double best = 1e300;
+		for (size_t pass = 0; pass < passes; pass++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			body();
+			best = (std::min)(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: SpriteBatchBenchmark [--passes P] [--counts N,N,...]\n");
+		return 2;
+	}
+
+	// 描いた順とは逆のレイヤーとブレンドで入れ、同じキーを間に挟む
+	std::vector<Sprite> known = {
+		MakeSprite(0, 5, 1, 2), MakeSprite(1, 3, 0, 1), MakeSprite(2, 5, 1, 2),
+		MakeSprite(3, 3, 0, 0), MakeSprite(4, 7, 0, 1), MakeSprite(5, 3, 0, 1) };
+	SpriteBatch batch;
+	std::vector<SpriteInstance> instances(known.size());
+	Fill(batch, known);
+	batch.End(instances.data());
+	const float expected[] = { 3, 1, 5, 4, 0, 2 };
+	bool order = true;
+	for (size_t i = 0; i < known.size(); i++) { order = order && instances[i].translation[0] == expected[i]; }
+	Check(order, "sprites should be ordered by layer, blend and texture, keeping the draw order");
+	Check(batch.GetBatches().size() == 4 && batch.GetBatches()[1].instanceCount == 2, "equal keys should share one batch");
+	Check(Sorted(batch, instances, known), "the known batches are not sorted");
+	batch.bindless = true;
+	Fill(batch, known);
+	batch.End(instances.data());
+	Check(batch.GetBatches().size() == 3 && batch.GetBatches()[1].instanceCount == 3, "bindless batches should ignore the texture");
+	Check(Sorted(batch, instances, known), "the known bindless batches are not sorted");
+	batch.bindless = false;
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<uint32_t> texture(0, 63), state(0, 3);
+	printf("%8s %8s %8s %10s %10s %10s\n", "count", "batches", "bindless", "draw ns", "end ns", "total ns");
+	for (size_t count : options.counts)
+	{
+		std::vector<Sprite> sprites(count);
+		for (size_t i = 0; i < count; i++) { sprites[i] = MakeSprite(i, texture(rng), state(rng), state(rng)); }
+		instances.resize(count);
+
+		batch.bindless = true;
+		Fill(batch, sprites);
+		batch.End(instances.data());
+		size_t bindlessBatches = batch.GetBatches().size();
+		Check(bindlessBatches == DistinctKeys(sprites, true), "bindless batch count differs from the distinct layer and blend pairs");
+		Check(Sorted(batch, instances, sprites), "random bindless sprites are not sorted");
+
+		batch.bindless = false;
+		Fill(batch, sprites);
+		batch.End(instances.data());
+		size_t batches = batch.GetBatches().size();
+		Check(batches == DistinctKeys(sprites, false), "batch count differs from the distinct keys");
+		Check(Sorted(batch, instances, sprites), "random sprites are not sorted");
+
+		double drawNs = BestNanoseconds(options.passes, [&] { Fill(batch, sprites); });
+		double endNs = BestNanoseconds(options.passes, [&] { batch.End(instances.data()); });
+		printf("%8zu %8zu %8zu %10.2f %10.2f %10.2f\n", count, batches, bindlessBatches,
+			drawNs / count, endNs / count, (drawNs + endNs) / count);
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,9 @@
+#include "Sprite.hlsli"
+
+Texture2D<float4> textures[] : register(t0, space1);
+SamplerState smp : register(s0);
+
+float4 main(VSOutPut input) : SV_TARGET
+{
+	return textures[NonUniformResourceIndex(input.texture)].Sample(smp, input.uv) * input.color;
+}
\ No newline at end of file
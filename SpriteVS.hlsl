@@ -0,0 +1,15 @@
+#include "Sprite.hlsli"
+
+VSOutPut main(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID)
+{
+	SpriteInstance s = instances[instanceID];
+	float2 corner = float2(vertexID & 1, vertexID >> 1);
+	float2 pos = float2(dot(s.m.xy, corner), dot(s.m.zw, corner)) + s.t;
+
+	VSOutPut output;
+	output.svpos = mul(mat, float4(pos, 0, 1));
+	output.uv = lerp(s.uv.xy, s.uv.zw, corner);
+	output.color = float4((s.color >> uint4(0, 8, 16, 24)) & 0xff) / 255.0f;
+	output.texture = s.texture;
+	return output;
+}
\ No newline at end of file
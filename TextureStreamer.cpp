@@ -0,0 +1,379 @@
+﻿#include "TextureStreamer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <cwctype>
+
+namespace
+{
+	// 拡張子でローダーを選ぶ
+	HRESULT LoadImageFile(const std::wstring& fileName, ScratchImage& image)
+	{
+		std::wstring ext = fileName.substr(fileName.find_last_of(L'.') + 1);
+		for (wchar_t& c : ext) { c = static_cast<wchar_t>(towlower(c)); }
+
+		if (ext == L"dds") { return LoadFromDDSFile(fileName.c_str(), DDS_FLAGS_NONE, nullptr, image); }
+		if (ext == L"tga") { return LoadFromTGAFile(fileName.c_str(), TGA_FLAGS_NONE, nullptr, image); }
+		if (ext == L"hdr") { return LoadFromHDRFile(fileName.c_str(), nullptr, image); }
+#ifdef _WIN32
+		return LoadFromWICFile(fileName.c_str(), WIC_FLAGS_NONE, nullptr, image);
+#else
+		return E_NOTIMPL; // WICはWindowsのみ
+#endif
+	}
+
+	bool IsDDS(const std::wstring& fileName)
+	{
+		if (fileName.size() < 4) { return false; }
+		std::wstring ext = fileName.substr(fileName.size() - 4);
+		for (wchar_t& c : ext) { c = static_cast<wchar_t>(towlower(c)); }
+		return ext == L".dds";
+	}
+}
+
+TextureStreamer::TextureStreamer() :TextureStreamer(Config{}) {}
+TextureStreamer::TextureStreamer(const Config& config)
+{
+	this->config = config;
+	frame = 0;
+	stats = {};
+	shutdown = false;
+
+	size_t threadCount = (std::max)(config.threadCount, size_t(1));
+	for (size_t i = 0; i < threadCount; i++) { workers.emplace_back(&TextureStreamer::WorkerMain, this); }
+}
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		shutdown = true;
+		jobs.clear(); // 未着手のデコードは捨てる
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) { worker.join(); }
+}
+
+TextureStreamer::Handle TextureStreamer::Request(const std::wstring& fileName, TextureUploadSink* sink, bool sRGB)
+{
+	std::unique_ptr<Entry> entry = std::make_unique<Entry>();
+	entry->fileName = fileName;
+	entry->sink = sink;
+	entry->sRGB = sRGB;
+	return Push(std::move(entry));
+}
+TextureStreamer::Handle TextureStreamer::Request(Decoder decoder, TextureUploadSink* sink, bool sRGB)
+{
+	std::unique_ptr<Entry> entry = std::make_unique<Entry>();
+	entry->decoder = std::move(decoder);
+	entry->sink = sink;
+	entry->sRGB = sRGB;
+	return Push(std::move(entry));
+}
+TextureStreamer::Handle TextureStreamer::Push(std::unique_ptr<Entry> entry)
+{
+	assert(entry->sink);
+	entry->requestTime = Clock::now();
+	entry->lastUsed = frame;
+
+	Entry* job = entry.get();
+	entries.push_back(std::move(entry));
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		jobs.push_back(job);
+	}
+	wake.notify_one();
+	return entries.size() - 1;
+}
+const TextureStreamer::Entry* TextureStreamer::Find(Handle handle) const
+{
+	return handle < entries.size() ? entries[handle].get() : nullptr;
+}
+
+void TextureStreamer::WorkerMain()
+{
+#ifdef _WIN32
+	// WICのデコーダーを使うのでスレッドごとにCOMを初期化する
+	HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+	PROFILE_THREAD("TextureStreamer");
+	while (1)
+	{
+		Entry* entry = nullptr;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&] { return shutdown || !jobs.empty(); });
+			if (shutdown) { break; }
+			entry = jobs.front();
+			jobs.pop_front();
+		}
+		Decode(*entry);
+	}
+#ifdef _WIN32
+	if (SUCCEEDED(com)) { CoUninitialize(); }
+#endif
+}
+void TextureStreamer::Decode(Entry& entry)
+{
+	PROFILE_ZONE("TextureStreamer::Decode");
+	// DDSはミップを粗い方から読んで順に公開する
+	if (!entry.decoder && IsDDS(entry.fileName) && DecodeProgressive(entry)) { return; }
+
+	ScratchImage image;
+	HRESULT result = entry.decoder ? entry.decoder(image) : LoadImageFile(entry.fileName, image);
+	if (FAILED(result)) { entry.failed = true; return; }
+
+	// TextureBufは2Dテクスチャ1枚のみ扱う
+	const TexMetadata& metadata = image.GetMetadata();
+	if (metadata.dimension != TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1 || metadata.depth != 1)
+	{
+		entry.failed = true;
+		return;
+	}
+
+	if (metadata.mipLevels == 1 && !IsCompressed(metadata.format))
+	{
+		ScratchImage mipChain;
+		result = GenerateMipMaps(image.GetImages(), image.GetImageCount(),
+			metadata, TEX_FILTER_DEFAULT, 0, mipChain);
+		if (SUCCEEDED(result)) { image = std::move(mipChain); }
+	}
+
+	Publish(entry, image);
+	entry.decodedMip.store(0, std::memory_order_release);
+}
+bool TextureStreamer::DecodeProgressive(Entry& entry)
+{
+	DDSStreamReader reader;
+	TexMetadata metadata{};
+	if (FAILED(reader.Open(entry.fileName.c_str(), DDS_FLAGS_NONE, &metadata))) { return false; }
+
+	// ミップが無いものはまとめて読み込んでから生成する
+	if (metadata.mipLevels <= 1 || metadata.dimension != TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1)
+	{
+		return false;
+	}
+
+	ScratchImage image;
+	if (FAILED(image.Initialize(metadata))) { return false; }
+	Publish(entry, image);
+
+	for (size_t mip = metadata.mipLevels; mip-- > 0;)
+	{
+		const Image* IMG = entry.image.GetImage(mip, 0, 0);
+		if (FAILED(reader.Seek(mip, 0, 0)) || FAILED(reader.ReadRows(*IMG)))
+		{
+			entry.failed = true;
+			return true;
+		}
+		entry.decodedMip.store(mip, std::memory_order_release);
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (shutdown) { return true; }
+	}
+	return true;
+}
+void TextureStreamer::Publish(Entry& entry, ScratchImage& image)
+{
+	entry.image = std::move(image);
+	entry.metadata = entry.image.GetMetadata();
+	if (entry.sRGB) { entry.metadata.format = MakeSRGB(entry.metadata.format); }
+
+	// coarseSize以下になる最初のミップ
+	size_t mip = 0;
+	while (mip + 1 < entry.metadata.mipLevels &&
+		(std::max)(entry.metadata.width >> mip, entry.metadata.height >> mip) > config.coarseSize)
+	{
+		mip++;
+	}
+	entry.coarseMip = mip;
+
+	entry.metadataReady.store(true, std::memory_order_release);
+}
+
+void TextureStreamer::Touch(Handle handle)
+{
+	if (handle < entries.size()) { entries[handle]->lastUsed = frame; }
+}
+void TextureStreamer::Update()
+{
+	PROFILE_ZONE("TextureStreamer::Update");
+	size_t uploaded = 0;
+
+	// 粗いミップが揃ったものは予算に関係なくすぐ常駐させる
+	std::vector<Entry*> candidates;
+	for (std::unique_ptr<Entry>& entry : entries)
+	{
+		if (entry->failed)
+		{
+			// 途中まで常駐させてから読み込みに失敗したものは手放す
+			if (entry->uploadedMip != SIZE_MAX) { Discard(*entry); }
+			continue;
+		}
+		if (!entry->metadataReady.load(std::memory_order_acquire)) { continue; }
+
+		size_t decoded = entry->decodedMip.load(std::memory_order_acquire);
+		if (decoded >= entry->metadata.mipLevels) { continue; }
+
+		if (entry->residentMip == SIZE_MAX)
+		{
+			// ブロック圧縮は小さすぎるミップを先頭にできないのでcoarseMipまで待つ
+			if (IsCompressed(entry->metadata.format) && decoded > entry->coarseMip) { continue; }
+
+			size_t first = (std::max)(decoded, entry->coarseMip);
+			MakeRoom(*entry, RangeBytes(*entry, first)); // 空けられなくても常駐させる
+			uploaded += SetResidency(*entry, first);
+			entry->firstPixel = std::chrono::duration<double, std::milli>(Clock::now() - entry->requestTime).count();
+		}
+		if (entry->residentMip > decoded) { candidates.push_back(entry.get()); }
+	}
+
+	// 最近使われたものから、粗い段階のものを優先して1段ずつ詳細化する
+	std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b)
+		{
+			if (a->lastUsed != b->lastUsed) { return a->lastUsed > b->lastUsed; }
+			return a->residentMip > b->residentMip;
+		});
+
+	bool refined = false;
+	bool progress = true;
+	while (progress)
+	{
+		progress = false;
+		for (Entry* entry : candidates)
+		{
+			if (refined && uploaded >= config.uploadPerFrame) { break; }
+
+			size_t next = entry->residentMip - 1;
+			if (entry->residentMip == 0 || next < entry->decodedMip.load(std::memory_order_acquire)) { continue; }
+			if (!MakeRoom(*entry, MipBytes(*entry, next))) { continue; }
+
+			uploaded += SetResidency(*entry, next);
+			refined = true;
+			progress = true;
+		}
+	}
+
+	frame++;
+}
+
+size_t TextureStreamer::MipBytes(const Entry& entry, size_t mip) const
+{
+	return entry.image.GetImage(mip, 0, 0)->slicePitch;
+}
+size_t TextureStreamer::RangeBytes(const Entry& entry, size_t first) const
+{
+	size_t bytes = 0;
+	for (size_t mip = first; mip < entry.metadata.mipLevels; mip++) { bytes += MipBytes(entry, mip); }
+	return bytes;
+}
+size_t TextureStreamer::SetResidency(Entry& entry, size_t mostDetailedMip)
+{
+	size_t oldBytes = entry.residentMip == SIZE_MAX ? 0 : RangeBytes(entry, entry.residentMip);
+
+	// リソースは全ミップ分を1度だけ作り、まだ送っていないミップだけを粗い方から送る
+	// 追い出したミップの中身はリソースに残っているので、見せる範囲を戻すだけでよい
+	if (entry.uploadedMip == SIZE_MAX)
+	{
+		entry.sink->Allocate(entry.metadata);
+		entry.uploadedMip = entry.metadata.mipLevels;
+	}
+	size_t uploaded = 0;
+	while (entry.uploadedMip > mostDetailedMip)
+	{
+		entry.uploadedMip--;
+		const Image* IMG = entry.image.GetImage(entry.uploadedMip, 0, 0);
+		entry.sink->Upload(entry.uploadedMip, *IMG);
+		uploaded += IMG->slicePitch;
+	}
+	entry.sink->SetMostDetailedMip(mostDetailedMip);
+	entry.residentMip = mostDetailedMip;
+
+	stats.residentBytes = stats.residentBytes - oldBytes + RangeBytes(entry, mostDetailedMip);
+	stats.peakResidentBytes = (std::max)(stats.peakResidentBytes, stats.residentBytes);
+	stats.uploadedBytes += uploaded;
+	return uploaded;
+}
+void TextureStreamer::Discard(Entry& entry)
+{
+	// ワーカーはfailedを立てた後はimageに触らない
+	if (entry.residentMip != SIZE_MAX) { stats.residentBytes -= RangeBytes(entry, entry.residentMip); }
+	entry.sink->Release();
+	entry.residentMip = SIZE_MAX;
+	entry.uploadedMip = SIZE_MAX;
+	entry.image.Release();
+}
+bool TextureStreamer::MakeRoom(const Entry& entry, size_t bytes)
+{
+	if (stats.residentBytes + bytes <= config.budget) { return true; }
+
+	// entryより長く使われていないものの細かいミップだけが追い出し対象
+	std::vector<Entry*> victims;
+	size_t evictable = 0;
+	for (std::unique_ptr<Entry>& other : entries)
+	{
+		if (other.get() == &entry || other->residentMip == SIZE_MAX || other->lastUsed >= entry.lastUsed) { continue; }
+		if (other->residentMip >= other->coarseMip) { continue; }
+		victims.push_back(other.get());
+		evictable += RangeBytes(*other, other->residentMip) - RangeBytes(*other, other->coarseMip);
+	}
+	if (stats.residentBytes - evictable + bytes > config.budget) { return false; }
+
+	// LRU順に追い出す
+	std::sort(victims.begin(), victims.end(), [](const Entry* a, const Entry* b)
+		{
+			if (a->lastUsed != b->lastUsed) { return a->lastUsed < b->lastUsed; }
+			return a->residentMip < b->residentMip;
+		});
+
+	for (Entry* victim : victims)
+	{
+		size_t mip = victim->residentMip;
+		size_t freed = 0;
+		while (mip < victim->coarseMip && stats.residentBytes - freed + bytes > config.budget)
+		{
+			freed += MipBytes(*victim, mip);
+			mip++;
+		}
+		stats.evictedMips += mip - victim->residentMip;
+		SetResidency(*victim, mip);
+
+		if (stats.residentBytes + bytes <= config.budget) { break; }
+	}
+	return true;
+}
+
+bool TextureStreamer::IsResident(Handle handle) const
+{
+	const Entry* entry = Find(handle);
+	return entry && entry->residentMip != SIZE_MAX;
+}
+bool TextureStreamer::IsComplete(Handle handle) const
+{
+	const Entry* entry = Find(handle);
+	return entry && entry->residentMip == 0;
+}
+bool TextureStreamer::IsFailed(Handle handle) const
+{
+	const Entry* entry = Find(handle);
+	return !entry || entry->failed;
+}
+size_t TextureStreamer::GetMostDetailedMip(Handle handle) const
+{
+	const Entry* entry = Find(handle);
+	return entry ? entry->residentMip : SIZE_MAX;
+}
+double TextureStreamer::GetFirstPixelLatency(Handle handle) const
+{
+	const Entry* entry = Find(handle);
+	return entry ? entry->firstPixel : -1.0;
+}
+TextureStreamer::Stats TextureStreamer::GetStats() const
+{
+	Stats result = stats;
+	result.cpuBytes = 0;
+	for (const std::unique_ptr<Entry>& entry : entries)
+	{
+		if (entry->metadataReady.load(std::memory_order_acquire)) { result.cpuBytes += entry->image.GetPixelsSize(); }
+	}
+	return result;
+}
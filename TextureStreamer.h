@@ -0,0 +1,126 @@
+﻿#pragma once
+#include <DirectXTex.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace DirectX;
+
+// ストリーミングしたミップの転送先(D3D12の実装とテスト用の偽物を差し替えられる)
+class TextureUploadSink
+{
+public:
+	virtual ~TextureUploadSink() = default;
+	// 全ミップを持つリソースを1度だけ作る(SetMostDetailedMipまではどのミップも見せない)
+	virtual void Allocate(const TexMetadata& metadata) = 0;
+	// ミップ1枚分の転送(まだ見せていないミップにだけ来る)
+	virtual void Upload(size_t mip, const Image& image) = 0;
+	// mostDetailedMip以降のミップだけを見せる(SRVのMostDetailedMipとResourceMinLODClamp)
+	virtual void SetMostDetailedMip(size_t mostDetailedMip) = 0;
+	// リソースを手放して何も見せない状態に戻す(デコードが途中で失敗した時)
+	virtual void Release() = 0;
+};
+
+// バックグラウンドでデコードし、粗いミップから順に常駐させるテクスチャストリーマー
+class TextureStreamer
+{
+public:
+	using Decoder = std::function<HRESULT(ScratchImage& image)>;
+	using Handle = size_t;
+
+	struct Config
+	{
+		size_t budget = 64 * 1024 * 1024; // 見せるミップの合計上限(バイト、リソースは最初から全ミップ分ある)
+		size_t uploadPerFrame = 4 * 1024 * 1024; // 1フレームで転送する量の目安(最低1段階は進める)
+		size_t threadCount = 1; // デコードスレッド数
+		size_t coarseSize = 64; // この大きさ以下のミップは予算に関係なく常駐させる
+	};
+
+	struct Stats
+	{
+		size_t residentBytes; // 見せているミップの合計
+		size_t peakResidentBytes; // residentBytesの最大値
+		size_t cpuBytes; // デコード済みでCPUに保持している量
+		size_t uploadedBytes; // 累計転送量
+		size_t evictedMips; // 追い出したミップの累計(転送済みの中身は残るので戻す時は送らない)
+	};
+
+	TextureStreamer();
+	TextureStreamer(const Config& config);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// 拡張子でローダーを選ぶ(dds/tga/hdr、それ以外はWIC)
+	Handle Request(const std::wstring& fileName, TextureUploadSink* sink, bool sRGB = true);
+	Handle Request(Decoder decoder, TextureUploadSink* sink, bool sRGB = true);
+
+	// 範囲外のハンドルは無視する(問い合わせは常駐していない、失敗した扱い)
+	void Touch(Handle handle); // このフレームで使ったことを記録する
+	void Update(); // 毎フレーム、描画コマンドを積む前に呼ぶ
+
+	bool IsResident(Handle handle) const; // 1ミップ以上常駐している
+	bool IsComplete(Handle handle) const; // 全ミップが常駐している
+	bool IsFailed(Handle handle) const;
+	size_t GetMostDetailedMip(Handle handle) const;
+	double GetFirstPixelLatency(Handle handle) const; // リクエストから最初の転送までのミリ秒(未転送なら負)
+	Stats GetStats() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Entry
+	{
+		TextureUploadSink* sink = nullptr;
+		std::wstring fileName;
+		Decoder decoder;
+		bool sRGB = true;
+
+		// ワーカーが書き、metadataReadyの後にメインスレッドが読む
+		ScratchImage image;
+		TexMetadata metadata{};
+		std::atomic<bool> metadataReady{ false };
+		std::atomic<bool> failed{ false };
+		std::atomic<size_t> decodedMip{ SIZE_MAX }; // これ以降のミップはデコード済み
+
+		// メインスレッドのみ
+		size_t residentMip = SIZE_MAX; // 最も詳細な見せているミップ
+		size_t uploadedMip = SIZE_MAX; // これ以降のミップは転送済み(SIZE_MAXならリソースが無い)
+		size_t coarseMip = 0; // これ以降のミップは追い出さない
+		uint64_t lastUsed = 0;
+		Clock::time_point requestTime;
+		double firstPixel = -1.0;
+	};
+
+	Config config;
+	std::vector<std::unique_ptr<Entry>> entries;
+	uint64_t frame;
+	Stats stats;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<Entry*> jobs;
+	bool shutdown;
+	std::vector<std::thread> workers;
+
+	Handle Push(std::unique_ptr<Entry> entry);
+	const Entry* Find(Handle handle) const;
+	void WorkerMain();
+	void Decode(Entry& entry);
+	bool DecodeProgressive(Entry& entry);
+	void Publish(Entry& entry, ScratchImage& image);
+
+	size_t MipBytes(const Entry& entry, size_t mip) const;
+	size_t RangeBytes(const Entry& entry, size_t first) const;
+	size_t SetResidency(Entry& entry, size_t mostDetailedMip);
+	void Discard(Entry& entry);
+	bool MakeRoom(const Entry& entry, size_t bytes);
+};
@@ -0,0 +1,230 @@
+﻿// TextureStreamerの常駐の順番と予算を、偽の転送先で確かめる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread -IDirectXTex TextureStreamerTest.cpp TextureStreamer.cpp Profiler.cpp DirectXTex/DirectXTexDDS.cpp
+//       DirectXTex/DirectXTexTGA.cpp DirectXTex/DirectXTexHDR.cpp DirectXTex/DirectXTexUtil.cpp DirectXTex/DirectXTexImage.cpp
+//       DirectXTex/DirectXTexConvert.cpp DirectXTex/DirectXTexMipmaps.cpp DirectXTex/DirectXTexResize.cpp DirectXTex/DirectXTexCompress.cpp
+//       DirectXTex/BC.cpp DirectXTex/BC4BC5.cpp DirectXTex/BC6HBC7.cpp DirectXTex/DirectXTexThreadPool.cpp -o TextureStreamerTest
+//   (DirectXMathとDirectX-Headersのincludeも通す。WindowsではDirectXTex.libとWICのためにole32.libをリンクする)
+// 使い方
+//   TextureStreamerTest [--textures T] [--size S]
+//   全ミップを持つS x S(既定512)のRGBA8をデコーダーで作り、次を確かめる
+//   ・1枚目は粗いミップから順に1度ずつ転送され、最初に見せるのはcoarseSize以下のミップで、見せる範囲は細かい方へだけ進む
+//   ・T枚(既定8)のうち3枚ずつを使うと、使ったものが全ミップ常駐し、使っていないものが追い出され、
+//     詳細化を終えた時の常駐量が予算を超えない
+//   ・毎フレームの常駐量とその最大値は、予算に関係なく常駐させる粗いミップの分しか予算を超えない
+//   ・追い出したミップへ戻る時は転送し直さない
+//   最後に各テクスチャの最初の画素までの時間とpeakResidentBytesを出す
+//   失敗すると理由を出して1を返す
+#include "TextureStreamer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		size_t textures = 8;
+		size_t size = 512;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--textures") { options.textures = strtoul(value, nullptr, 10); }
+			else if (arg == "--size") { options.size = strtoul(value, nullptr, 10); }
+			else { return false; }
+		}
+		// 3枚ずつ2組使うので6枚以上、ミップが予算を試せるだけある大きさ
+		return options.textures >= 6 && options.size >= 256;
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	// 呼ばれた順番を記録するだけの転送先
+	class FakeSink : public TextureUploadSink
+	{
+	public:
+		size_t allocations = 0;
+		size_t releases = 0;
+		std::vector<size_t> uploads; // 転送したミップの順番
+		std::vector<size_t> visible; // SetMostDetailedMipの順番
+		size_t mipLevels = 0;
+
+		void Allocate(const TexMetadata& metadata) override
+		{
+			allocations++;
+			mipLevels = metadata.mipLevels;
+		}
+		void Upload(size_t mip, const Image&) override { uploads.push_back(mip); }
+		void SetMostDetailedMip(size_t mostDetailedMip) override { visible.push_back(mostDetailedMip); }
+		void Release() override { releases++; }
+	};
+
+	TextureStreamer::Decoder MakeDecoder(size_t size)
+	{
+		return [size](ScratchImage& image)
+			{
+				// ミップの生成はフィルタ次第なので、全ミップを持たせて渡す
+				HRESULT result = image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, 1, 0);
+				if (FAILED(result)) { return result; }
+				uint8_t* pixels = image.GetPixels();
+				for (size_t i = 0; i < image.GetPixelsSize(); i++) { pixels[i] = (uint8_t)(i * 7); }
+				return S_OK;
+			};
+	}
+
+	// ワーカーのデコードを待ちながら、条件が揃うまでフレームを進める
+	template<class F>
+	bool RunUntil(TextureStreamer& streamer, F&& done, const std::vector<size_t>& touched, size_t limit)
+	{
+		for (int frame = 0; frame < 10000; frame++)
+		{
+			for (size_t handle : touched) { streamer.Touch(handle); }
+			streamer.Update();
+			Check(streamer.GetStats().residentBytes <= limit, "resident bytes went over the budget and the coarse mips");
+			if (done()) { return true; }
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return false;
+	}
+
+	// 粗い方から1度ずつ、見せる範囲は細かい方へだけ進む
+	bool CoarseFirst(const FakeSink& sink, size_t coarseMip)
+	{
+		if (sink.allocations != 1 || sink.uploads.size() != sink.mipLevels) { return false; }
+		for (size_t i = 0; i < sink.uploads.size(); i++)
+		{
+			if (sink.uploads[i] != sink.mipLevels - 1 - i) { return false; }
+		}
+		if (sink.visible.empty() || sink.visible.front() != coarseMip || sink.visible.back() != 0) { return false; }
+		for (size_t i = 1; i < sink.visible.size(); i++)
+		{
+			if (sink.visible[i] >= sink.visible[i - 1]) { return false; }
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: TextureStreamerTest [--textures T] [--size S]\n");
+		return 2;
+	}
+
+	// 1枚分の全ミップの大きさと、coarseSize以下になる最初のミップ
+	TextureStreamer::Config config;
+	size_t fullBytes = 0, coarseBytes = 0, coarseMip = SIZE_MAX, mipLevels = 0;
+	for (size_t mip = 0; (options.size >> mip) > 0; mip++)
+	{
+		size_t bytes = (options.size >> mip) * (options.size >> mip) * 4;
+		fullBytes += bytes;
+		if (coarseMip == SIZE_MAX && (options.size >> mip) <= config.coarseSize) { coarseMip = mip; }
+		if (coarseMip != SIZE_MAX) { coarseBytes += bytes; }
+		mipLevels++;
+	}
+
+	// 1枚ずつしか進めない転送量で、粗い方から順に届くか
+	{
+		config.uploadPerFrame = 1;
+		TextureStreamer streamer(config);
+		FakeSink sink;
+		TextureStreamer::Handle handle = streamer.Request(MakeDecoder(options.size), &sink);
+		bool complete = RunUntil(streamer, [&] { return streamer.IsComplete(handle) || streamer.IsFailed(handle); }, { handle }, config.budget);
+		Check(complete && !streamer.IsFailed(handle), "the texture never became complete");
+		Check(sink.mipLevels == mipLevels, "the decoded mip chain has an unexpected length");
+		Check(CoarseFirst(sink, coarseMip), "mips were not uploaded coarse to fine exactly once");
+		Check(sink.visible.size() == coarseMip + 1, "each frame should refine by exactly one mip");
+		Check(streamer.GetFirstPixelLatency(handle) >= 0.0, "the first pixel latency was not recorded");
+		Check(streamer.GetStats().uploadedBytes == fullBytes, "uploaded bytes differ from the mip chain size");
+	}
+
+	// 3枚分と少しの予算で、使う3枚を入れ替える
+	config.uploadPerFrame = 4 * 1024 * 1024;
+	config.budget = fullBytes * 3 + fullBytes / 2;
+	size_t limit = config.budget + coarseBytes * options.textures;
+	TextureStreamer streamer(config);
+	std::vector<FakeSink> sinks(options.textures);
+	std::vector<TextureStreamer::Handle> handles;
+	for (FakeSink& sink : sinks) { handles.push_back(streamer.Request(MakeDecoder(options.size), &sink)); }
+
+	auto allComplete = [&](const std::vector<size_t>& used)
+		{
+			for (size_t handle : used)
+			{
+				if (!streamer.IsComplete(handle)) { return false; }
+			}
+			return true;
+		};
+	auto othersEvicted = [&](const std::vector<size_t>& used)
+		{
+			for (size_t handle : handles)
+			{
+				bool isUsed = false;
+				for (size_t u : used) { isUsed = isUsed || u == handle; }
+				if (!isUsed && streamer.IsComplete(handle)) { return false; }
+			}
+			return true;
+		};
+
+	std::vector<size_t> first = { handles[0], handles[1], handles[2] };
+	std::vector<size_t> second = { handles[3], handles[4], handles[5] };
+	auto allResident = [&]
+		{
+			for (size_t handle : handles)
+			{
+				if (!streamer.IsResident(handle)) { return false; }
+			}
+			return true;
+		};
+	Check(RunUntil(streamer, [&] { return allResident() && allComplete(first); }, first, limit), "the first working set never became complete");
+	Check(othersEvicted(first), "textures outside the first working set should not be complete");
+
+	TextureStreamer::Stats before = streamer.GetStats();
+	Check(RunUntil(streamer, [&] { return allComplete(second); }, second, limit), "the second working set never became complete");
+	Check(othersEvicted(second), "the first working set should have been evicted");
+	Check(streamer.GetStats().residentBytes <= config.budget, "refining the second working set should end under the budget");
+	Check(streamer.GetStats().evictedMips > before.evictedMips, "switching working sets should evict mips");
+
+	// 戻した時は見せる範囲だけを変え、同じミップを2度送らない
+	Check(RunUntil(streamer, [&] { return allComplete(first); }, first, limit), "the first working set never came back");
+	Check(streamer.GetStats().residentBytes <= config.budget, "refining the first working set again should end under the budget");
+	Check(allResident(), "every texture should keep its coarse mips");
+	for (const FakeSink& sink : sinks)
+	{
+		Check(sink.allocations == 1 && sink.releases == 0, "each texture should be allocated once and never released");
+		std::vector<int> seen(sink.mipLevels, 0);
+		bool once = true;
+		for (size_t mip : sink.uploads) { once = once && mip < seen.size() && seen[mip]++ == 0; }
+		Check(once, "an evicted mip was uploaded again");
+	}
+
+	TextureStreamer::Stats stats = streamer.GetStats();
+	Check(stats.peakResidentBytes <= limit, "peak resident bytes went over the budget and the coarse mips");
+	printf("budget %zu KB (+%zu KB coarse), peak resident %zu KB, uploaded %zu KB, evicted mips %zu\n",
+		config.budget / 1024, coarseBytes * options.textures / 1024, stats.peakResidentBytes / 1024,
+		stats.uploadedBytes / 1024, stats.evictedMips);
+	for (size_t i = 0; i < handles.size(); i++)
+	{
+		printf("texture %zu: first pixel %.3f ms, most detailed mip %zu\n",
+			i, streamer.GetFirstPixelLatency(handles[i]), streamer.GetMostDetailedMip(handles[i]));
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
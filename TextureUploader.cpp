@@ -0,0 +1,107 @@
+﻿#include "TextureUploader.h"
+#include <cstring>
+
+uint64_t PlanTextureUpload(const TextureSubresource* subresources, size_t count, TextureFootprint* footprints)
+{
+	uint64_t offset = 0;
+	uint64_t total = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const TextureSubresource& source = subresources[i];
+		TextureFootprint& footprint = footprints[i];
+		uint64_t rowPitch = ((uint64_t)source.rowPitch + TextureUploader::PITCH_ALIGNMENT - 1) & ~(uint64_t)(TextureUploader::PITCH_ALIGNMENT - 1);
+		uint64_t rowCount = source.rowPitch ? source.slicePitch / source.rowPitch : 0;
+		uint32_t depth = source.depth ? source.depth : 1;
+		if (rowPitch > UINT32_MAX || rowCount > UINT32_MAX) { return 0; }
+
+		offset = (offset + TextureUploader::PLACEMENT_ALIGNMENT - 1) & ~(uint64_t)(TextureUploader::PLACEMENT_ALIGNMENT - 1);
+		footprint.offset = offset;
+		footprint.width = source.width;
+		footprint.height = source.height;
+		footprint.depth = depth;
+		footprint.rowPitch = (uint32_t)rowPitch;
+		footprint.rowCount = (uint32_t)rowCount;
+		footprint.rowSize = source.rowPitch;
+
+		// 最後の行は間隔まで伸ばさない
+		uint64_t rows = rowCount * depth;
+		uint64_t size = rows ? rowPitch * (rows - 1) + source.rowPitch : 0;
+		total = offset + size;
+		offset = total;
+	}
+	return total;
+}
+
+void WriteTextureUpload(uint8_t* staging, const TextureSubresource* subresources, size_t count,
+	const TextureFootprint* footprints)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const TextureSubresource& source = subresources[i];
+		const TextureFootprint& footprint = footprints[i];
+		const uint8_t* src = static_cast<const uint8_t*>(source.pixels);
+		uint8_t* dst = staging + footprint.offset;
+		size_t rows = (size_t)footprint.rowCount * footprint.depth;
+		if (footprint.rowPitch == source.rowPitch)
+		{
+			// 間隔が同じなら1回で写す
+			if (rows) { memcpy(dst, src, footprint.rowPitch * (rows - 1) + (size_t)footprint.rowSize); }
+			continue;
+		}
+		for (size_t row = 0; row < rows; row++)
+		{
+			memcpy(dst + footprint.rowPitch * row, src + source.rowPitch * row, (size_t)footprint.rowSize);
+		}
+	}
+}
+
+TextureUploader::TextureUploader(TextureCopyQueue* queue, UploadPageProvider* provider, size_t pageSize) :
+	ring(provider, pageSize)
+{
+	this->queue = queue;
+	pendingCopies = 0;
+	stats = {};
+}
+
+bool TextureUploader::Upload(void* texture, uint32_t firstSubresource, const TextureSubresource* subresources, size_t count)
+{
+	if (count == 0) { return true; }
+	// コピーキューが読み終えたページを再利用する
+	ring.Reclaim(queue->GetCompletedValue());
+
+	footprints.resize(count);
+	uint64_t bytes = PlanTextureUpload(subresources, count, footprints.data());
+	UploadAllocation staging = bytes > 0 && bytes <= SIZE_MAX
+		? ring.Allocate((size_t)bytes, PLACEMENT_ALIGNMENT) : UploadAllocation();
+	if (!staging.cpu)
+	{
+		stats.failedUploads++;
+		return false;
+	}
+	WriteTextureUpload(staging.cpu, subresources, count, footprints.data());
+
+	for (size_t i = 0; i < count; i++)
+	{
+		TextureFootprint footprint = footprints[i];
+		footprint.offset += staging.offset;
+		queue->CopyTexture(texture, firstSubresource + (uint32_t)i, staging.resource, footprint);
+	}
+	pendingCopies += count;
+	stats.copies += count;
+	stats.stagedBytes += staging.size;
+	stats.batchBytes += staging.size;
+	if (stats.batchBytes > stats.peakBatchBytes) { stats.peakBatchBytes = stats.batchBytes; }
+	return true;
+}
+
+uint64_t TextureUploader::Flush()
+{
+	if (pendingCopies == 0) { return 0; }
+	uint64_t fenceValue = queue->Submit();
+	// ステージングはコピーキューのフェンスで返ってくる
+	ring.Finish(fenceValue);
+	pendingCopies = 0;
+	stats.batches++;
+	stats.batchBytes = 0;
+	return fenceValue;
+}
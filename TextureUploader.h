@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "UploadRing.h"
+
+// 転送元の1枚(DirectXTexのPrepareUploadが返すD3D12_SUBRESOURCE_DATAと同じ値と、その大きさ)
+struct TextureSubresource
+{
+	const void* pixels;
+	size_t rowPitch; // 1行(圧縮形式ならブロック1行)のバイト数
+	size_t slicePitch; // 1スライスのバイト数(行数はslicePitch / rowPitch)
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+};
+
+// ステージングでの置き方(ID3D12Device::GetCopyableFootprintsと同じ)
+struct TextureFootprint
+{
+	uint64_t offset; // ステージングの先頭から(512バイト境界)
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint32_t rowPitch; // 256バイト境界に切り上げた行の間隔
+	uint32_t rowCount; // 1スライスの行数
+	uint64_t rowSize; // 1行で写すバイト数
+};
+
+// 戻り値はステージングに要るバイト数(最後の行は詰める)。大き過ぎれば0
+uint64_t PlanTextureUpload(const TextureSubresource* subresources, size_t count, TextureFootprint* footprints);
+// 行の間隔を合わせてステージングへ写す
+void WriteTextureUpload(uint8_t* staging, const TextureSubresource* subresources, size_t count,
+	const TextureFootprint* footprints);
+
+// コピーキューへの記録と提出(D3D12の実装とテスト用の偽物を差し替えられる)
+class TextureCopyQueue
+{
+public:
+	virtual ~TextureCopyQueue() = default;
+	// stagingのfootprint(offsetはstagingのリソース内)からtextureのsubresourceへのコピーを積む
+	virtual void CopyTexture(void* texture, uint32_t subresource, void* staging, const TextureFootprint& footprint) = 0;
+	// 積んだコピーを実行してシグナルし、そのフェンス値を返す
+	virtual uint64_t Submit() = 0;
+	virtual uint64_t GetCompletedValue() = 0;
+};
+
+// テクスチャの転送をステージングのリングに詰め、1フレーム分まとめてコピーキューに提出する
+class TextureUploader
+{
+public:
+	static const size_t PITCH_ALIGNMENT = 256; // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	static const size_t PLACEMENT_ALIGNMENT = 512; // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+	struct Stats
+	{
+		size_t copies; // 累計のサブリソースのコピー数
+		size_t batches; // 累計の提出回数
+		size_t stagedBytes; // 累計のステージング量
+		size_t batchBytes; // 今ためているステージング量
+		size_t peakBatchBytes; // batchBytesの最大値
+		size_t failedUploads; // ステージングが取れなかった回数
+	};
+
+	TextureUploader(TextureCopyQueue* queue, UploadPageProvider* provider, size_t pageSize = 4 * 1024 * 1024);
+
+	TextureUploader(const TextureUploader&) = delete;
+	TextureUploader& operator=(const TextureUploader&) = delete;
+
+	// subresourcesをfirstSubresourceから順に詰め、コピーを積む(ステージングが取れなければfalse)
+	// textureはコピーキューが書ける状態(COMMON)にしておく
+	bool Upload(void* texture, uint32_t firstSubresource, const TextureSubresource* subresources, size_t count);
+	// ためたコピーを提出する。読む側のキューはこの値まで待ってから使う(無ければ0で、待たなくてよい)
+	uint64_t Flush();
+
+	const UploadRing& GetRing() const { return ring; }
+	Stats GetStats() const { return stats; }
+
+private:
+	TextureCopyQueue* queue;
+	UploadRing ring;
+	std::vector<TextureFootprint> footprints;
+	size_t pendingCopies;
+	Stats stats;
+};
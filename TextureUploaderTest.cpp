@@ -0,0 +1,250 @@
+﻿// PlanTextureUploadの置き方を、DirectXTexのPrepareUploadと同じサブリソースで確かめる(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread -IDirectXTex TextureUploaderTest.cpp TextureUploader.cpp UploadRing.cpp NullGraphics.cpp
+//       DirectXTex/DirectXTexDDS.cpp DirectXTex/DirectXTexUtil.cpp DirectXTex/DirectXTexImage.cpp DirectXTex/DirectXTexConvert.cpp
+//       DirectXTex/DirectXTexMipmaps.cpp DirectXTex/DirectXTexResize.cpp DirectXTex/DirectXTexCompress.cpp
+//       DirectXTex/BC.cpp DirectXTex/BC4BC5.cpp DirectXTex/BC6HBC7.cpp DirectXTex/DirectXTexThreadPool.cpp -o TextureUploaderTest
+//   (DirectXMathとDirectX-Headersのincludeも通す)
+// 使い方
+//   TextureUploaderTest [--verbose]
+//   PrepareUploadはデバイスに形式の平面数を問い合わせるので、1平面の形式について同じ並び
+//   (配列の要素ごとにミップ、3Dはミップごとに最初のスライス)でImageからサブリソースを作る
+//   奇数の大きさ、ブロック圧縮、浮動小数点、配列、3Dの各テクスチャで次を確かめる
+//   ・offsetは512バイト、rowPitchは256バイトの境界にそろい、rowPitchは1行のバイト数以上になる
+//   ・行数、大きさ、全体のバイト数が、ComputePitchから求めたGetCopyableFootprintsと同じ値になる
+//   ・サブリソース同士が重ならず、WriteTextureUploadが各行を写して行の隙間と末尾の外には書かない
+//   ・TextureUploaderがコピーキューへ渡すステージングの位置も512バイト境界で、中身が元と一致する
+//   失敗すると理由を出して1を返す
+#include "TextureUploader.h"
+#include "NullGraphics.h"
+#include <DirectXTex.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace DirectX;
+
+namespace
+{
+	struct Options
+	{
+		bool verbose = false;
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (arg == "--verbose") { options.verbose = true; }
+			else { return false; }
+		}
+		return true;
+	}
+
+	int failures = 0;
+	void Check(bool condition, const std::string& message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message.c_str());
+		failures++;
+	}
+
+	struct Case
+	{
+		const char* name;
+		DXGI_FORMAT format;
+		size_t width, height, depth, arraySize;
+		bool volume;
+	};
+
+	uint64_t Align(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+	// PrepareUploadと同じ順番と値でサブリソースを作る(1平面の形式のみ)
+	std::vector<TextureSubresource> PrepareSubresources(const ScratchImage& image)
+	{
+		const TexMetadata& metadata = image.GetMetadata();
+		std::vector<TextureSubresource> subresources;
+		size_t items = metadata.IsVolumemap() ? 1 : metadata.arraySize;
+		for (size_t item = 0; item < items; item++)
+		{
+			size_t depth = metadata.IsVolumemap() ? metadata.depth : 1;
+			for (size_t level = 0; level < metadata.mipLevels; level++)
+			{
+				const Image& img = image.GetImages()[metadata.ComputeIndex(level, item, 0)];
+				subresources.push_back({ img.pixels, img.rowPitch, img.slicePitch,
+					(uint32_t)img.width, (uint32_t)img.height, (uint32_t)depth });
+				if (depth > 1) { depth >>= 1; }
+			}
+		}
+		return subresources;
+	}
+
+	// GetCopyableFootprintsと同じ値を、ImageではなくComputePitchから求める
+	struct Reference
+	{
+		uint64_t offset;
+		uint64_t rowPitch;
+		uint64_t rowCount;
+		uint64_t rowSize;
+	};
+	uint64_t ComputeReference(const TexMetadata& metadata, const std::vector<TextureSubresource>& subresources, std::vector<Reference>& out)
+	{
+		uint64_t total = 0;
+		for (const TextureSubresource& subresource : subresources)
+		{
+			size_t rowPitch = 0, slicePitch = 0;
+			ComputePitch(metadata.format, subresource.width, subresource.height, rowPitch, slicePitch);
+			Reference reference;
+			reference.offset = Align(total, TextureUploader::PLACEMENT_ALIGNMENT);
+			reference.rowSize = rowPitch;
+			reference.rowPitch = Align(rowPitch, TextureUploader::PITCH_ALIGNMENT);
+			reference.rowCount = slicePitch / rowPitch;
+			total = reference.offset + reference.rowPitch * (reference.rowCount * subresource.depth - 1) + reference.rowSize;
+			out.push_back(reference);
+		}
+		return total;
+	}
+
+	void Fill(ScratchImage& image, uint8_t seed)
+	{
+		uint8_t* pixels = image.GetPixels();
+		for (size_t i = 0; i < image.GetPixelsSize(); i++) { pixels[i] = (uint8_t)(i * 31 + seed + (i >> 8)); }
+	}
+
+	// 写した行が元と一致し、行の隙間と末尾の外が書かれていないか
+	bool CheckStaging(const uint8_t* staging, size_t stagingSize, uint64_t total,
+		const std::vector<TextureSubresource>& subresources, const std::vector<TextureFootprint>& footprints, uint8_t fill)
+	{
+		std::vector<uint8_t> written(stagingSize, 0);
+		for (size_t i = 0; i < subresources.size(); i++)
+		{
+			const TextureSubresource& source = subresources[i];
+			const TextureFootprint& footprint = footprints[i];
+			size_t rows = (size_t)footprint.rowCount * footprint.depth;
+			for (size_t row = 0; row < rows; row++)
+			{
+				const uint8_t* dst = staging + footprint.offset + footprint.rowPitch * row;
+				const uint8_t* src = static_cast<const uint8_t*>(source.pixels) + source.rowPitch * row;
+				if (memcmp(dst, src, (size_t)footprint.rowSize) != 0) { return false; }
+				memset(&written[footprint.offset + footprint.rowPitch * row], 1, (size_t)footprint.rowSize);
+			}
+		}
+		for (size_t i = 0; i < stagingSize; i++)
+		{
+			if (!written[i] && staging[i] != fill) { return false; }
+			if (written[i] && i >= total) { return false; }
+		}
+		return true;
+	}
+
+	void TestCase(const Case& c, const Options& options, TextureUploader& uploader, NullCopyQueue& queue)
+	{
+		ScratchImage image;
+		HRESULT result = c.volume
+			? image.Initialize3D(c.format, c.width, c.height, c.depth, 0)
+			: image.Initialize2D(c.format, c.width, c.height, c.arraySize, 0);
+		Check(SUCCEEDED(result), std::string(c.name) + ": creating the image failed");
+		if (FAILED(result)) { return; }
+		Fill(image, (uint8_t)c.width);
+
+		std::vector<TextureSubresource> subresources = PrepareSubresources(image);
+		std::vector<TextureFootprint> footprints(subresources.size());
+		uint64_t total = PlanTextureUpload(subresources.data(), subresources.size(), footprints.data());
+		std::vector<Reference> references;
+		uint64_t referenceTotal = ComputeReference(image.GetMetadata(), subresources, references);
+
+		bool aligned = true, matches = true, separate = true;
+		uint64_t previousEnd = 0;
+		for (size_t i = 0; i < footprints.size(); i++)
+		{
+			const TextureFootprint& f = footprints[i];
+			const Reference& r = references[i];
+			aligned = aligned && f.offset % TextureUploader::PLACEMENT_ALIGNMENT == 0 &&
+				f.rowPitch % TextureUploader::PITCH_ALIGNMENT == 0 && f.rowPitch >= f.rowSize;
+			matches = matches && f.offset == r.offset && f.rowPitch == r.rowPitch && f.rowCount == r.rowCount &&
+				f.rowSize == r.rowSize && f.width == subresources[i].width && f.height == subresources[i].height &&
+				f.depth == subresources[i].depth;
+			separate = separate && f.offset >= previousEnd;
+			previousEnd = f.offset + (uint64_t)f.rowPitch * (f.rowCount * f.depth - 1) + f.rowSize;
+			if (options.verbose)
+			{
+				printf("  %s[%zu] %ux%ux%u offset %llu rowPitch %u rows %u rowSize %llu\n", c.name, i, f.width, f.height, f.depth,
+					(unsigned long long)f.offset, f.rowPitch, f.rowCount, (unsigned long long)f.rowSize);
+			}
+		}
+		Check(aligned, std::string(c.name) + ": offsets and row pitches should follow the D3D12 alignment");
+		Check(matches, std::string(c.name) + ": footprints differ from GetCopyableFootprints");
+		Check(separate, std::string(c.name) + ": subresources overlap in the staging buffer");
+		Check(total == referenceTotal && total == previousEnd, std::string(c.name) + ": the total size differs from GetCopyableFootprints");
+
+		// 行の間隔を変えて写す
+		const uint8_t FILL = 0xcd;
+		std::vector<uint8_t> staging((size_t)total + TextureUploader::PLACEMENT_ALIGNMENT, FILL);
+		WriteTextureUpload(staging.data(), subresources.data(), subresources.size(), footprints.data());
+		Check(CheckStaging(staging.data(), staging.size(), total, subresources, footprints, FILL),
+			std::string(c.name) + ": the staging copy differs from the source or wrote outside the rows");
+
+		// リングから取ったステージングでも同じ
+		Check(uploader.Upload(&image, 0, subresources.data(), subresources.size()), std::string(c.name) + ": Upload failed");
+		uploader.Flush();
+		const std::vector<NullCopyQueue::Copy>& copies = queue.GetSubmitted();
+		bool copied = copies.size() == subresources.size();
+		for (size_t i = 0; copied && i < copies.size(); i++)
+		{
+			const NullCopyQueue::Copy& copy = copies[i];
+			const TextureFootprint& f = copy.footprint;
+			copied = copy.texture == &image && copy.subresource == i && f.offset % TextureUploader::PLACEMENT_ALIGNMENT == 0 &&
+				f.rowPitch == footprints[i].rowPitch && f.offset - copies[0].footprint.offset == footprints[i].offset;
+			const uint8_t* base = static_cast<const uint8_t*>(copy.staging) + f.offset;
+			for (size_t row = 0; copied && row < (size_t)f.rowCount * f.depth; row++)
+			{
+				copied = memcmp(base + (size_t)f.rowPitch * row, static_cast<const uint8_t*>(subresources[i].pixels) + subresources[i].rowPitch * row, (size_t)f.rowSize) == 0;
+			}
+		}
+		Check(copied, std::string(c.name) + ": the copies handed to the queue differ from the plan");
+
+		printf("%-22s %3zu subresources, staging %8llu bytes, tight %8zu bytes\n", c.name, subresources.size(),
+			(unsigned long long)total, image.GetPixelsSize());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: TextureUploaderTest [--verbose]\n");
+		return 2;
+	}
+
+	const Case cases[] = {
+		{ "RGBA8 37x19", DXGI_FORMAT_R8G8B8A8_UNORM, 37, 19, 1, 1, false },
+		{ "RGBA8 256x128", DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 256, 128, 1, 1, false },
+		{ "R8 1x1", DXGI_FORMAT_R8_UNORM, 1, 1, 1, 1, false },
+		{ "RGBA32F 70x33", DXGI_FORMAT_R32G32B32A32_FLOAT, 70, 33, 1, 1, false },
+		{ "BC1 37x19", DXGI_FORMAT_BC1_UNORM, 37, 19, 1, 1, false },
+		{ "BC7 300x200", DXGI_FORMAT_BC7_UNORM_SRGB, 300, 200, 1, 1, false },
+		{ "BC3 array 66x66x3", DXGI_FORMAT_BC3_UNORM, 66, 66, 1, 3, false },
+		{ "RGBA8 array 17x9x4", DXGI_FORMAT_R8G8B8A8_UNORM, 17, 9, 1, 4, false },
+		{ "RG16 volume 20x12x5", DXGI_FORMAT_R16G16_UNORM, 20, 12, 5, 1, true },
+		{ "BC4 volume 9x9x3", DXGI_FORMAT_BC4_UNORM, 9, 9, 3, 1, true },
+	};
+
+	NullCopyQueue queue;
+	NullUploadPages pages;
+	{
+		TextureUploader uploader(&queue, &pages, 1024 * 1024);
+		for (const Case& c : cases) { TestCase(c, options, uploader, queue); }
+		TextureUploader::Stats stats = uploader.GetStats();
+		Check(stats.failedUploads == 0 && stats.batches == sizeof(cases) / sizeof(cases[0]), "every case should upload in its own batch");
+	}
+
+	// 行数が大き過ぎるものは0を返す
+	TextureSubresource huge = { nullptr, 1, (size_t)UINT32_MAX + 2, 1, 1, 1 };
+	TextureFootprint footprint{};
+	Check(PlanTextureUpload(&huge, 1, &footprint) == 0, "a row count beyond 32 bits should be rejected");
+
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
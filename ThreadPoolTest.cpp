@@ -0,0 +1,266 @@
+﻿// DirectXTexのスレッドプール(Internal::ParallelFor)を確かめ、BC1の圧縮を並べた時のスレッド数ごとの伸びを測る(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread -IDirectXTex ThreadPoolTest.cpp DirectXTex/DirectXTexThreadPool.cpp DirectXTex/BC.cpp -o ThreadPoolTest
+//   (DirectXMathとDirectX-Headersのincludeも通す。Windowsではcl /std:c++17 /O2 /EHsc /IDirectXTexで同じファイルをビルドする)
+// 使い方
+//   ThreadPoolTest [--size N] [--threads T,T,...] [--passes P]
+//   先に次を確かめる
+//   ・どの要素もちょうど1回ずつ、grainごとの区切りで渡される
+//   ・入れ子の呼び出しと、別のスレッドから同時に来た呼び出しも、止まらずに全部の要素を動かす
+//   ・失敗した区切りがあれば、その結果が返る
+//   ・SetMaxThreadCount(1)では呼んだスレッドしか使わない
+//   そのあとN×N(既定2048)の画像のブロックの行を、CompressBCと同じく1行ずつ並べてBC1で圧縮し、
+//   Tスレッドごと(既定1,2,4,8,0。0は全部のハードウェアスレッド)にP回(既定3)で一番速い時間と伸びを出す
+//   失敗すると理由を出して1を返す
+#include "DirectXTexP.h"
+#include "BC.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::Internal;
+
+namespace
+{
+	struct Options
+	{
+		size_t size = 2048;
+		size_t passes = 3;
+		std::vector<size_t> threads = { 1, 2, 4, 8, 0 };
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--size") { options.size = strtoul(value, nullptr, 10); }
+			else if (arg == "--passes") { options.passes = strtoul(value, nullptr, 10); }
+			else if (arg == "--threads")
+			{
+				options.threads.clear();
+				for (const char* p = value; *p;)
+				{
+					char* end = nullptr;
+					size_t count = strtoul(p, &end, 10);
+					if (end == p) { return false; }
+					options.threads.push_back(count);
+					p = *end == ',' ? end + 1 : end;
+				}
+			}
+			else { return false; }
+		}
+		return options.size >= 4 && options.passes > 0 && !options.threads.empty();
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	// どの要素もちょうど1回ずつ、grainの区切り(そのまま動く時は全体)で渡されるか
+	// ハードウェアスレッドが少なくてもワーカーが動くよう、8スレッドにしておく
+	void TestCoverage()
+	{
+		SetMaxThreadCount(8);
+		for (size_t iteration = 0; iteration < 2000; iteration++)
+		{
+			const size_t count = 1 + (iteration * 37) % 5000;
+			const size_t grain = 1 + iteration % 7;
+			std::vector<std::atomic<int>> hits(count);
+			std::atomic<bool> misaligned(false), nestedFailed(false);
+			auto body = [&](size_t begin, size_t end) noexcept -> HRESULT
+			{
+				bool whole = begin == 0 && end == count;
+				if (!whole && (begin % grain || end - begin > grain || (end - begin < grain && end != count))) { misaligned = true; }
+				for (size_t i = begin; i < end; i++) { hits[i]++; }
+
+				// 入れ子も止まらずに全部動く
+				std::atomic<size_t> innerCount(0);
+				auto inner = [&](size_t innerBegin, size_t innerEnd) noexcept -> HRESULT
+				{
+					innerCount += innerEnd - innerBegin;
+					return S_OK;
+				};
+				if (ParallelFor(10, 1, true, inner) != S_OK || innerCount != 10) { nestedFailed = true; }
+				return S_OK;
+			};
+			Check(ParallelFor(count, grain, true, body) == S_OK, "ParallelFor returned a failure");
+			Check(!misaligned, "a range does not follow the grain");
+			Check(!nestedFailed, "a nested ParallelFor did not cover its range");
+			for (size_t i = 0; i < count; i++)
+			{
+				if (hits[i] != 1)
+				{
+					printf("FAIL: count %zu grain %zu item %zu was run %d times\n", count, grain, i, hits[i].load());
+					failures++;
+					break;
+				}
+			}
+		}
+	}
+
+	// 失敗した区切りの結果が返るか
+	void TestFailure()
+	{
+		SetMaxThreadCount(4);
+		for (size_t grain : { 1, 100 })
+		{
+			auto body = [&](size_t begin, size_t end) noexcept -> HRESULT
+			{
+				return (begin <= 500 && 500 < end) ? E_FAIL : S_OK;
+			};
+			Check(ParallelFor(1000, grain, true, body) == E_FAIL, "a failure was not returned");
+		}
+	}
+
+	// 別のスレッドから同時に呼んでも、それぞれ全部の要素を1回ずつ動かすか
+	void TestConcurrentCallers()
+	{
+		SetMaxThreadCount(8);
+		const size_t CALLERS = 4;
+		const size_t COUNT = 20000;
+		std::vector<std::vector<std::atomic<int>>> hits(CALLERS);
+		for (auto& h : hits) { h = std::vector<std::atomic<int>>(COUNT); }
+		std::vector<std::thread> callers;
+		std::atomic<int> bad(0);
+		for (size_t c = 0; c < CALLERS; c++)
+		{
+			callers.emplace_back([&, c]
+			{
+				for (size_t repeat = 0; repeat < 50; repeat++)
+				{
+					auto body = [&](size_t begin, size_t end) noexcept -> HRESULT
+					{
+						for (size_t i = begin; i < end; i++) { hits[c][i]++; }
+						return S_OK;
+					};
+					if (ParallelFor(COUNT, 64, true, body) != S_OK) { bad++; }
+				}
+			});
+		}
+		for (auto& t : callers) { t.join(); }
+		Check(bad == 0, "a concurrent ParallelFor returned a failure");
+		for (size_t c = 0; c < CALLERS; c++)
+		{
+			for (size_t i = 0; i < COUNT; i++)
+			{
+				if (hits[c][i] != 50)
+				{
+					printf("FAIL: caller %zu item %zu was run %d times\n", c, i, hits[c][i].load());
+					failures++;
+					break;
+				}
+			}
+		}
+	}
+
+	// 1スレッドに絞ると呼んだスレッドしか使わないか
+	void TestSingleThread()
+	{
+		SetMaxThreadCount(1);
+		Check(GetMaxThreadCount() == 1, "GetMaxThreadCount does not return the cap");
+		const std::thread::id self = std::this_thread::get_id();
+		bool otherThread = false;
+		auto body = [&](size_t, size_t) noexcept -> HRESULT
+		{
+			if (std::this_thread::get_id() != self) { otherThread = true; }
+			return S_OK;
+		};
+		Check(ParallelFor(1000, 1, true, body) == S_OK && !otherThread, "a capped ParallelFor used another thread");
+		SetMaxThreadCount(0);
+		Check(GetMaxThreadCount() == (std::max)(std::thread::hardware_concurrency(), 1u), "0 does not mean every hardware thread");
+	}
+
+	// BC1で圧縮するテクスチャらしい画像(なだらかな色の傾きにノイズ)を作る
+	void MakeImage(std::vector<XMVECTOR>& pixels, size_t size)
+	{
+		std::mt19937 rng(3);
+		std::normal_distribution<float> noise(0.0f, 0.02f);
+		pixels.resize(size * size);
+		for (size_t y = 0; y < size; y++)
+		{
+			for (size_t x = 0; x < size; x++)
+			{
+				float u = (float)x / size, v = (float)y / size;
+				auto c = [&](float f) { return (std::min)(1.0f, (std::max)(0.0f, f + noise(rng))); };
+				pixels[y * size + x] = XMVectorSet(c(u), c(v), c(0.5f * (u + v)), 1.0f);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: ThreadPoolTest [--size N] [--threads T,T,...] [--passes P]\n");
+		return 2;
+	}
+
+	TestCoverage();
+	TestFailure();
+	TestConcurrentCallers();
+	TestSingleThread();
+
+	const size_t size = options.size / 4 * 4;
+	const size_t blocksPerRow = size / 4;
+	std::vector<XMVECTOR> pixels;
+	MakeImage(pixels, size);
+	std::vector<uint8_t> out(blocksPerRow * blocksPerRow * 8), reference;
+
+	// CompressBCと同じく、ブロックの1行を1つの区切りにする
+	auto compressRows = [&](size_t begin, size_t end) noexcept -> HRESULT
+	{
+		XMVECTOR block[NUM_PIXELS_PER_BLOCK];
+		for (size_t row = begin; row < end; row++)
+		{
+			for (size_t bx = 0; bx < blocksPerRow; bx++)
+			{
+				for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
+				{
+					block[i] = pixels[(row * 4 + i / 4) * size + bx * 4 + i % 4];
+				}
+				D3DXEncodeBC1(&out[(row * blocksPerRow + bx) * 8], block, TEX_THRESHOLD_DEFAULT, 0);
+			}
+		}
+		return S_OK;
+	};
+
+	printf("BC1 %zux%zu, %zu block rows, %u hardware threads\n", size, size, blocksPerRow, std::thread::hardware_concurrency());
+	printf("%8s %10s %8s\n", "threads", "ms", "speedup");
+	double single = 0.0;
+	for (size_t threads : options.threads)
+	{
+		SetMaxThreadCount(threads);
+		double best = 0.0;
+		for (size_t pass = 0; pass < options.passes; pass++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			HRESULT hr = ParallelFor(blocksPerRow, 1, true, compressRows);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			Check(hr == S_OK, "compressing returned a failure");
+			if (pass == 0 || ms < best) { best = ms; }
+		}
+		// スレッド数によらず同じ結果になる
+		if (reference.empty()) { reference = out; }
+		Check(out == reference, "the output depends on the thread count");
+		if (single == 0.0) { single = best; }
+		printf("%8zu %10.2f %8.2f\n", GetMaxThreadCount(), best, single / best);
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+﻿#include "TransformHierarchy.h"
+#include "CommandJobSystem.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	template<class T>
+	void Permute(std::vector<T>& values, const std::vector<uint32_t>& order, std::vector<T>& tmp)
+	{
+		tmp.resize(values.size());
+		for (size_t i = 0; i < order.size(); i++) { tmp[i] = values[order[i]]; }
+		values.swap(tmp);
+	}
+}
+
+const TransformHierarchy::NodeId TransformHierarchy::INVALID;
+
+TransformHierarchy::TransformHierarchy()
+{
+	lastDest = nullptr;
+	lastStride = 0;
+	structureChanged = false;
+	stats = {};
+}
+
+TransformHierarchy::NodeId TransformHierarchy::Create(NodeId parent)
+{
+	NodeId node = (NodeId)slotOf.size();
+	uint32_t slot = (uint32_t)nodeOf.size();
+
+	// 末尾に足し、並べ直しは次のUpdateでまとめてする
+	positionX.push_back(0.0f);
+	positionY.push_back(0.0f);
+	positionZ.push_back(0.0f);
+	rotationX.push_back(0.0f);
+	rotationY.push_back(0.0f);
+	rotationZ.push_back(0.0f);
+	rotationW.push_back(1.0f);
+	scaleX.push_back(1.0f);
+	scaleY.push_back(1.0f);
+	scaleZ.push_back(1.0f);
+	parentSlot.push_back(parent == INVALID ? INVALID : slotOf[parent]);
+	dirty.push_back(1);
+	nodeOf.push_back(node);
+	world.resize(world.size() + 16, 0.0f);
+
+	slotOf.push_back(slot);
+	parentOf.push_back(parent);
+	structureChanged = true;
+	return node;
+}
+
+void TransformHierarchy::SetParent(NodeId node, NodeId parent)
+{
+	if (parentOf[node] == parent) { return; }
+	parentOf[node] = parent;
+	parentSlot[slotOf[node]] = parent == INVALID ? INVALID : slotOf[parent];
+	dirty[slotOf[node]] = 1;
+	structureChanged = true;
+}
+void TransformHierarchy::SetPosition(NodeId node, float x, float y, float z)
+{
+	uint32_t slot = slotOf[node];
+	positionX[slot] = x;
+	positionY[slot] = y;
+	positionZ[slot] = z;
+	dirty[slot] = 1;
+}
+void TransformHierarchy::SetRotation(NodeId node, float x, float y, float z, float w)
+{
+	uint32_t slot = slotOf[node];
+	rotationX[slot] = x;
+	rotationY[slot] = y;
+	rotationZ[slot] = z;
+	rotationW[slot] = w;
+	dirty[slot] = 1;
+}
+void TransformHierarchy::SetScale(NodeId node, float x, float y, float z)
+{
+	uint32_t slot = slotOf[node];
+	scaleX[slot] = x;
+	scaleY[slot] = y;
+	scaleZ[slot] = z;
+	dirty[slot] = 1;
+}
+
+void TransformHierarchy::Rebuild()
+{
+	// 番号ごとの深さ(親の番号が後ろのこともあるので、分かっている所まで遡る)
+	size_t count = slotOf.size();
+	std::vector<uint32_t> depth(count, INVALID);
+	std::vector<NodeId> path;
+	for (NodeId node = 0; node < count; node++)
+	{
+		NodeId n = node;
+		while (n != INVALID && depth[n] == INVALID)
+		{
+			path.push_back(n);
+			n = parentOf[n];
+		}
+		uint32_t d = n == INVALID ? 0 : depth[n] + 1;
+		while (!path.empty())
+		{
+			depth[path.back()] = d++;
+			path.pop_back();
+		}
+	}
+
+	// 深さで数え上げソートする(同じ深さの中は番号順)
+	uint32_t maxDepth = 0;
+	for (uint32_t d : depth) { maxDepth = (std::max)(maxDepth, d); }
+	levels.assign(maxDepth + 2, 0);
+	for (uint32_t d : depth) { levels[d + 1]++; }
+	for (size_t i = 1; i < levels.size(); i++) { levels[i] += levels[i - 1]; }
+
+	std::vector<size_t> next(levels.begin(), levels.end() - 1);
+	std::vector<uint32_t> order(count); // 新しいスロット -> 古いスロット
+	for (NodeId node = 0; node < count; node++) { order[next[depth[node]]++] = slotOf[node]; }
+
+	std::vector<float> tmp;
+	Permute(positionX, order, tmp);
+	Permute(positionY, order, tmp);
+	Permute(positionZ, order, tmp);
+	Permute(rotationX, order, tmp);
+	Permute(rotationY, order, tmp);
+	Permute(rotationZ, order, tmp);
+	Permute(rotationW, order, tmp);
+	Permute(scaleX, order, tmp);
+	Permute(scaleY, order, tmp);
+	Permute(scaleZ, order, tmp);
+	std::vector<uint8_t> tmpDirty;
+	Permute(dirty, order, tmpDirty);
+	std::vector<NodeId> tmpNodes;
+	Permute(nodeOf, order, tmpNodes);
+
+	tmp.resize(world.size());
+	for (size_t i = 0; i < count; i++) { memcpy(&tmp[i * 16], &world[order[i] * 16], sizeof(float) * 16); }
+	world.swap(tmp);
+
+	for (uint32_t slot = 0; slot < count; slot++) { slotOf[nodeOf[slot]] = slot; }
+	for (uint32_t slot = 0; slot < count; slot++)
+	{
+		NodeId parent = parentOf[nodeOf[slot]];
+		parentSlot[slot] = parent == INVALID ? INVALID : slotOf[parent];
+	}
+	structureChanged = false;
+	stats.rebuilds++;
+}
+
+size_t TransformHierarchy::UpdateRange(size_t begin, size_t end, uint8_t* dest, size_t stride, bool writeAll)
+{
+	size_t updated = 0;
+	for (size_t slot = begin; slot < end; slot++)
+	{
+		uint32_t parent = parentSlot[slot];
+		// 親が計算し直されたら子も計算し直す(親は前の階層なので、もう決まっている)
+		if (parent != INVALID) { dirty[slot] |= dirty[parent]; }
+
+		float* w = &world[slot * 16];
+		if (dirty[slot])
+		{
+			float x = rotationX[slot], y = rotationY[slot], z = rotationZ[slot], qw = rotationW[slot];
+			float sx = scaleX[slot], sy = scaleY[slot], sz = scaleZ[slot];
+			// S * R * T の行(DirectXMathのXMMatrixAffineTransformationと同じ)
+			float local[4][3] =
+			{
+				{ (1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + qw * z) * sx, 2.0f * (x * z - qw * y) * sx },
+				{ 2.0f * (x * y - qw * z) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + qw * x) * sy },
+				{ 2.0f * (x * z + qw * y) * sz, 2.0f * (y * z - qw * x) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz },
+				{ positionX[slot], positionY[slot], positionZ[slot] },
+			};
+
+			if (parent == INVALID)
+			{
+				for (size_t r = 0; r < 4; r++)
+				{
+					w[r * 4 + 0] = local[r][0];
+					w[r * 4 + 1] = local[r][1];
+					w[r * 4 + 2] = local[r][2];
+					w[r * 4 + 3] = r == 3 ? 1.0f : 0.0f;
+				}
+			}
+			else
+			{
+				const float* p = &world[parent * 16];
+				for (size_t r = 0; r < 4; r++)
+				{
+					for (size_t c = 0; c < 4; c++)
+					{
+						float v = local[r][0] * p[c] + local[r][1] * p[4 + c] + local[r][2] * p[8 + c];
+						w[r * 4 + c] = r == 3 ? v + p[12 + c] : v;
+					}
+				}
+			}
+			updated++;
+			if (dest) { memcpy(dest + nodeOf[slot] * stride, w, sizeof(float) * 16); }
+		}
+		else if (dest && writeAll) { memcpy(dest + nodeOf[slot] * stride, w, sizeof(float) * 16); }
+	}
+	return updated;
+}
+
+void TransformHierarchy::Update(CommandJobSystem* jobSystem, void* dest, size_t stride, size_t minItemsPerJob)
+{
+	if (structureChanged) { Rebuild(); }
+
+	stats.nodeCount = slotOf.size();
+	stats.levelCount = levels.empty() ? 0 : levels.size() - 1;
+	stats.updated = 0;
+	uint8_t* out = static_cast<uint8_t*>(dest);
+	// 同じ書き先なら変わっていないノードは前回の値が残っている
+	bool writeAll = dest != lastDest || stride != lastStride;
+	lastDest = dest;
+	lastStride = stride;
+
+	// 浅い階層から順に、階層の中は並列に計算する
+	for (size_t level = 0; level + 1 < levels.size(); level++)
+	{
+		size_t begin = levels[level];
+		size_t end = levels[level + 1];
+		if (!jobSystem)
+		{
+			stats.updated += UpdateRange(begin, end, out, stride, writeAll);
+			continue;
+		}
+		jobUpdated.resize(jobSystem->GetThreadCount());
+		size_t jobs = jobSystem->ParallelFor(end - begin, minItemsPerJob,
+			[&](size_t job, size_t jobBegin, size_t jobEnd)
+			{
+				jobUpdated[job] = UpdateRange(begin + jobBegin, begin + jobEnd, out, stride, writeAll);
+			});
+		for (size_t job = 0; job < jobs; job++) { stats.updated += jobUpdated[job]; }
+	}
+	stats.written = !dest ? 0 : writeAll ? stats.nodeCount : stats.updated;
+
+	// 全ての階層が子へ伝えたので消す
+	std::fill(dirty.begin(), dirty.end(), uint8_t(0));
+}
@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CommandJobSystem;
+
+// ノードのローカルな位置、回転、拡縮をSoAで深さ順に持ち、ワールド行列を階層ごとに求める(デバイスに依存しない)
+// ・変更したノードとその子孫だけを計算し直す
+// ・同じ深さのノードは互いに依存しないので、階層ごとにjobSystemで分けて計算する
+// ・行列は行ベクトル(v * M)でDirectXMathのXMFLOAT4X4と同じ並び(world = S * R * T * 親のworld)
+class TransformHierarchy
+{
+public:
+	using NodeId = uint32_t;
+	static const NodeId INVALID = UINT32_MAX;
+
+	struct Stats
+	{
+		size_t nodeCount;
+		size_t levelCount;
+		size_t updated; // 直前のUpdateで計算し直した数
+		size_t written; // 直前のUpdateでdestへ書いた数
+		size_t rebuilds; // 親子関係が変わって並べ直した回数
+	};
+
+	TransformHierarchy();
+
+	// 番号は作った順で、並べ直しても変わらない
+	NodeId Create(NodeId parent = INVALID);
+	// 自分の子孫を親にしてはいけない
+	void SetParent(NodeId node, NodeId parent);
+	void SetPosition(NodeId node, float x, float y, float z);
+	// 四元数(x, y, z, w)
+	void SetRotation(NodeId node, float x, float y, float z, float w);
+	void SetScale(NodeId node, float x, float y, float z);
+
+	// destがあればワールド行列をdest + 番号 * strideへ書く(マップしたメモリへ直接書く)
+	// 前回と同じdestとstrideなら計算し直したノードだけを書くので、destは前回の内容を保っていること
+	// (違うdestを渡すと全てのノードを書く)
+	void Update(CommandJobSystem* jobSystem = nullptr, void* dest = nullptr, size_t stride = sizeof(float) * 16,
+		size_t minItemsPerJob = 4096);
+
+	// 直前のUpdateの結果(16個)
+	const float* GetWorld(NodeId node) const { return &world[slotOf[node] * 16]; }
+	NodeId GetParent(NodeId node) const { return parentOf[node]; }
+	size_t Size() const { return slotOf.size(); }
+	Stats GetStats() const { return stats; }
+
+private:
+	// 以下は深さ順に並べた位置(スロット)ごと
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<uint32_t> parentSlot;
+	std::vector<uint8_t> dirty;
+	std::vector<NodeId> nodeOf;
+	std::vector<float> world;
+
+	// 以下は番号ごと
+	std::vector<uint32_t> slotOf;
+	std::vector<NodeId> parentOf;
+
+	std::vector<size_t> levels; // 各深さの先頭のスロット(最後は全体の数)
+	std::vector<size_t> jobUpdated;
+	void* lastDest;
+	size_t lastStride;
+	bool structureChanged;
+	Stats stats;
+
+	void Rebuild();
+	size_t UpdateRange(size_t begin, size_t end, uint8_t* dest, size_t stride, bool writeAll);
+};
@@ -0,0 +1,282 @@
+﻿// TransformHierarchyのワールド行列を再帰で求めた参照と比べ、更新の時間を測る(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 -pthread TransformHierarchyBenchmark.cpp TransformHierarchy.cpp CommandJobSystem.cpp Profiler.cpp -o TransformHierarchyBenchmark
+// 使い方
+//   TransformHierarchyBenchmark [--threads K] [--passes P] [--counts N,N,...]
+//   先に200個ほどの木で次を確かめる
+//   ・親が後から作られたノードでも、付け替えたあとでも、ワールド行列が参照と一致する
+//   ・変更がなければ何も計算せず、変更したノードの子孫だけを計算し直す
+//   ・destへ書いた行列はGetWorldと同じで、同じdestなら計算し直したノードだけを書く
+//   そのあとN個(既定10000,100000,1000000)のノードの4分木をKスレッド(既定はコア数)で更新し、
+//   全部変更、1%変更、変更なしでdestへ書く、変更なしでdestなしの時間をP回(既定10)のうち一番速い回で出す
+//   失敗すると理由を出して1を返す
+#include "TransformHierarchy.h"
+#include "CommandJobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using NodeId = TransformHierarchy::NodeId;
+
+	struct Options
+	{
+		size_t threads = 0;
+		size_t passes = 10;
+		std::vector<size_t> counts = { 10000, 100000, 1000000 };
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--threads") { options.threads = strtoul(value, nullptr, 10); }
+			else if (arg == "--passes") { options.passes = strtoul(value, nullptr, 10); }
+			else if (arg == "--counts")
+			{
+				options.counts.clear();
+				for (const char* p = value; *p;)
+				{
+					char* end = nullptr;
+					size_t count = strtoul(p, &end, 10);
+					if (end == p || count == 0) { return false; }
+					options.counts.push_back(count);
+					p = *end == ',' ? end + 1 : end;
+				}
+			}
+			else { return false; }
+		}
+		return options.passes > 0 && !options.counts.empty();
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	struct Local
+	{
+		float position[3];
+		float rotation[4];
+		float scale[3];
+	};
+
+	// S * R * T(XMMatrixAffineTransformationと同じ)
+	void Compose(const Local& local, float out[16])
+	{
+		float x = local.rotation[0], y = local.rotation[1], z = local.rotation[2], w = local.rotation[3];
+		const float rotation[3][3] = {
+			{ 1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y) },
+			{ 2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x) },
+			{ 2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y) } };
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++) { out[r * 4 + c] = rotation[r][c] * local.scale[r]; }
+			out[r * 4 + 3] = 0.0f;
+		}
+		out[12] = local.position[0];
+		out[13] = local.position[1];
+		out[14] = local.position[2];
+		out[15] = 1.0f;
+	}
+
+	void Multiply(const float a[16], const float b[16], float out[16])
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 4; k++) { sum += a[r * 4 + k] * b[k * 4 + c]; }
+				out[r * 4 + c] = sum;
+			}
+		}
+	}
+
+	// 設定した値を覚えておき、親をたどって参照のワールド行列を作る
+	class Reference
+	{
+	public:
+		void Set(TransformHierarchy& hierarchy, NodeId node, std::mt19937& rng)
+		{
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			Local local;
+			for (float& v : local.position) { v = unit(rng) * 10.0f; }
+			float length = 0.0f;
+			for (float& v : local.rotation) { v = unit(rng); length += v * v; }
+			length = sqrtf(length);
+			for (float& v : local.rotation) { v /= length; }
+			for (float& v : local.scale) { v = 0.9f + 0.1f * unit(rng); }
+			if (locals.size() <= node) { locals.resize(node + 1); }
+			locals[node] = local;
+			hierarchy.SetPosition(node, local.position[0], local.position[1], local.position[2]);
+			hierarchy.SetRotation(node, local.rotation[0], local.rotation[1], local.rotation[2], local.rotation[3]);
+			hierarchy.SetScale(node, local.scale[0], local.scale[1], local.scale[2]);
+		}
+
+		void World(const TransformHierarchy& hierarchy, NodeId node, float out[16]) const
+		{
+			float local[16];
+			Compose(locals[node], local);
+			NodeId parent = hierarchy.GetParent(node);
+			if (parent == TransformHierarchy::INVALID)
+			{
+				memcpy(out, local, sizeof(local));
+				return;
+			}
+			float parentWorld[16];
+			World(hierarchy, parent, parentWorld);
+			Multiply(local, parentWorld, out);
+		}
+
+		bool Matches(const TransformHierarchy& hierarchy) const
+		{
+			for (NodeId node = 0; node < hierarchy.Size(); node++)
+			{
+				float expected[16];
+				World(hierarchy, node, expected);
+				const float* actual = hierarchy.GetWorld(node);
+				for (int i = 0; i < 16; i++)
+				{
+					if (fabsf(expected[i] - actual[i]) > 1e-3f * (1.0f + fabsf(expected[i]))) { return false; }
+				}
+			}
+			return true;
+		}
+
+	private:
+		std::vector<Local> locals;
+	};
+
+	// 20個おきに書かせ、GetWorldと同じかを見る
+	const size_t STRIDE = sizeof(float) * 20;
+	bool Written(const TransformHierarchy& hierarchy, const std::vector<float>& dest)
+	{
+		for (NodeId node = 0; node < hierarchy.Size(); node++)
+		{
+			if (memcmp(&dest[node * 20], hierarchy.GetWorld(node), sizeof(float) * 16) != 0) { return false; }
+		}
+		return true;
+	}
+
+	void TestHierarchy()
+	{
+		std::mt19937 rng(3);
+		TransformHierarchy hierarchy;
+		Reference reference;
+		for (NodeId i = 0; i < 200; i++)
+		{
+			NodeId node = hierarchy.Create(i ? static_cast<NodeId>(rng() % i) : TransformHierarchy::INVALID);
+			reference.Set(hierarchy, node, rng);
+		}
+		// 根を後から作ったノードの子にする
+		NodeId late = hierarchy.Create();
+		reference.Set(hierarchy, late, rng);
+		hierarchy.SetParent(0, late);
+
+		CommandJobSystem jobs(3);
+		std::vector<float> dest(hierarchy.Size() * 20);
+		hierarchy.Update(&jobs, dest.data(), STRIDE, 8);
+		Check(reference.Matches(hierarchy), "world matrices differ from the reference");
+		Check(Written(hierarchy, dest), "dest differs from GetWorld");
+		Check(hierarchy.GetStats().updated == hierarchy.Size(), "the first Update did not compute every node");
+
+		hierarchy.Update(&jobs, nullptr, STRIDE, 8);
+		Check(hierarchy.GetStats().updated == 0, "an Update without changes computed nodes");
+
+		reference.Set(hierarchy, 5, rng);
+		hierarchy.Update(&jobs, nullptr, STRIDE, 8);
+		Check(reference.Matches(hierarchy), "world matrices differ after changing one node");
+		Check(hierarchy.GetStats().updated > 0 && hierarchy.GetStats().updated < hierarchy.Size(), "changing one node did not update only its subtree");
+
+		hierarchy.SetParent(7, late);
+		hierarchy.Update(nullptr);
+		Check(reference.Matches(hierarchy), "world matrices differ after SetParent");
+
+		// 同じdestなら変わったノードだけ書く
+		hierarchy.Update(&jobs, dest.data(), STRIDE, 8);
+		Check(hierarchy.GetStats().written == hierarchy.Size(), "an Update after a dest without writing did not write every node");
+		reference.Set(hierarchy, 9, rng);
+		hierarchy.Update(&jobs, dest.data(), STRIDE, 8);
+		TransformHierarchy::Stats stats = hierarchy.GetStats();
+		Check(reference.Matches(hierarchy) && Written(hierarchy, dest), "dest differs after changing one node");
+		Check(stats.written == stats.updated && stats.updated < hierarchy.Size(), "the same dest was written beyond the recomputed nodes");
+		hierarchy.Update(&jobs, dest.data(), STRIDE, 8);
+		Check(hierarchy.GetStats().written == 0, "an Update without changes wrote to the same dest");
+	}
+
+	template<class F>
+	double BestMilliseconds(size_t passes, F&& body)
+	{
+		double best = 1e300;
+		for (size_t pass = 0; pass < passes; pass++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			body();
+			best = (std::min)(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: TransformHierarchyBenchmark [--threads K] [--passes P] [--counts N,N,...]\n");
+		return 2;
+	}
+
+	TestHierarchy();
+
+	CommandJobSystem jobs(options.threads);
+	std::mt19937 rng(3);
+	printf("%zu threads\n", jobs.GetThreadCount());
+	printf("%8s %7s %10s %8s %10s %9s %10s %10s\n", "nodes", "levels", "all (ms)", "ns/node", "1% (ms)", "updated", "write (ms)", "clean (ms)");
+	for (size_t count : options.counts)
+	{
+		TransformHierarchy hierarchy;
+		Reference reference;
+		for (size_t i = 0; i < count; i++)
+		{
+			NodeId node = hierarchy.Create(i ? static_cast<NodeId>((i - 1) / 4) : TransformHierarchy::INVALID);
+			reference.Set(hierarchy, node, rng);
+		}
+		std::vector<float> dest(count * 16);
+		hierarchy.Update(&jobs, dest.data());
+
+		double all = BestMilliseconds(options.passes, [&]
+		{
+			for (NodeId node = 0; node < count; node++) { hierarchy.SetPosition(node, 1.0f, 2.0f, 3.0f); }
+			hierarchy.Update(&jobs, dest.data());
+		});
+		std::vector<NodeId> few;
+		for (size_t i = 0; i < count / 100; i++) { few.push_back(static_cast<NodeId>(rng() % count)); }
+		double some = BestMilliseconds(options.passes, [&]
+		{
+			for (NodeId node : few) { hierarchy.SetPosition(node, 1.0f, 2.0f, 3.0f); }
+			hierarchy.Update(&jobs, dest.data());
+		});
+		size_t updated = hierarchy.GetStats().updated;
+		double write = BestMilliseconds(options.passes, [&] { hierarchy.Update(&jobs, dest.data()); });
+		double clean = BestMilliseconds(options.passes, [&] { hierarchy.Update(&jobs); });
+		printf("%8zu %7zu %10.2f %8.1f %10.2f %9zu %10.3f %10.3f\n", count, hierarchy.GetStats().levelCount,
+			all, all * 1e6 / count, some, updated, write, clean);
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
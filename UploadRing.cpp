@@ -0,0 +1,160 @@
+﻿#include "UploadRing.h"
+
+UploadRing::UploadRing(UploadPageProvider* provider, size_t pageSize, size_t largePoolBytes, size_t largeIdleFrames)
+{
+	this->provider = provider;
+	this->pageSize = (pageSize + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	this->largePoolBytes = largePoolBytes;
+	this->largeIdleFrames = largeIdleFrames;
+	reclaimCount = 0;
+	head = 0;
+	stats = {};
+}
+UploadRing::~UploadRing()
+{
+	// GPUが全て使い終わってから破棄すること
+	if (current.cpu) { Release(current); }
+	for (UploadPage& page : frameUsed) { Release(page); }
+	for (Retired& r : retired) { Release(r.page); }
+	for (UploadPage& page : freePages) { Release(page); }
+	for (IdlePage& idle : freeLargePages) { Release(idle.page); }
+}
+
+UploadAllocation UploadRing::Allocate(size_t size, size_t alignment)
+{
+	UploadAllocation result;
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) { alignment = ALIGNMENT; }
+	size_t aligned = ((size ? size : 1) + alignment - 1) & ~(alignment - 1);
+
+	if (aligned > pageSize)
+	{
+		// ページに収まらないものは専用のページを使う(足りる中で一番小さいものを再利用する)
+		// 小さな要求が大きなページを抱え込まないよう、2倍を超えるページは使わない
+		UploadPage page;
+		size_t best = freeLargePages.size();
+		for (size_t i = 0; i < freeLargePages.size(); i++)
+		{
+			size_t size = freeLargePages[i].page.size;
+			if (size < aligned || size / 2 > aligned) { continue; }
+			if (best == freeLargePages.size() || size < freeLargePages[best].page.size) { best = i; }
+		}
+		if (best < freeLargePages.size())
+		{
+			page = freeLargePages[best].page;
+			freeLargePages.erase(freeLargePages.begin() + best);
+			stats.idleLargeBytes -= page.size;
+		}
+		else
+		{
+			size_t bytes = (aligned + pageSize - 1) / pageSize * pageSize;
+			if (!provider->CreatePage(bytes, page)) { return result; }
+			stats.pagesCreated++;
+			stats.pageCount++;
+			stats.reservedBytes += page.size;
+		}
+		frameUsed.push_back(page);
+
+		result.resource = page.resource;
+		result.cpu = page.cpu;
+		result.gpu = page.gpu;
+	}
+	else
+	{
+		size_t offset = (head + alignment - 1) & ~(alignment - 1);
+		if (!current.cpu || offset + aligned > current.size)
+		{
+			if (!NextPage()) { return result; }
+			offset = 0;
+		}
+		head = offset + aligned;
+
+		result.resource = current.resource;
+		result.cpu = current.cpu + offset;
+		result.gpu = current.gpu + offset;
+		result.offset = offset;
+	}
+	result.size = aligned;
+
+	stats.allocations++;
+	stats.frameBytes += aligned;
+	if (stats.frameBytes > stats.peakFrameBytes) { stats.peakFrameBytes = stats.frameBytes; }
+	return result;
+}
+bool UploadRing::NextPage()
+{
+	if (current.cpu) { frameUsed.push_back(current); }
+	current = {};
+	head = 0;
+
+	if (!freePages.empty())
+	{
+		current = freePages.back();
+		freePages.pop_back();
+		return true;
+	}
+
+	// 足りなければページを増やす
+	if (!provider->CreatePage(pageSize, current))
+	{
+		current = {};
+		return false;
+	}
+	stats.pagesCreated++;
+	stats.pageCount++;
+	stats.reservedBytes += current.size;
+	return true;
+}
+
+void UploadRing::Finish(uint64_t fenceValue)
+{
+	// 途中まで使ったページもGPUが読むので一緒に待たせる
+	if (current.cpu && head > 0)
+	{
+		frameUsed.push_back(current);
+		current = {};
+		head = 0;
+	}
+	for (UploadPage& page : frameUsed) { retired.push_back({ page, fenceValue }); }
+	frameUsed.clear();
+	stats.frameBytes = 0;
+}
+void UploadRing::Reclaim(uint64_t completedValue)
+{
+	reclaimCount++;
+	while (!retired.empty() && retired.front().fenceValue <= completedValue)
+	{
+		UploadPage page = retired.front().page;
+		retired.pop_front();
+
+		if (page.size == pageSize) { freePages.push_back(page); }
+		else
+		{
+			freeLargePages.push_back({ page, reclaimCount });
+			stats.idleLargeBytes += page.size;
+		}
+	}
+
+	// 長く使われていない専用ページと、上限を超えた分を古い方から破棄する
+	size_t kept = 0;
+	for (size_t i = 0; i < freeLargePages.size(); i++)
+	{
+		IdlePage& idle = freeLargePages[i];
+		bool expired = reclaimCount - idle.idleSince > largeIdleFrames;
+		if (expired || stats.idleLargeBytes > largePoolBytes)
+		{
+			stats.idleLargeBytes -= idle.page.size;
+			stats.largePagesReleased++;
+			Release(idle.page);
+			continue;
+		}
+		freeLargePages[kept++] = idle;
+	}
+	freeLargePages.resize(kept);
+}
+void UploadRing::Release(UploadPage& page)
+{
+	stats.pageCount--;
+	stats.reservedBytes -= page.size;
+	provider->DestroyPage(page);
+	page = {};
+}
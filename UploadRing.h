@@ -0,0 +1,98 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// UPLOADヒープのページ(中身はバックエンドが決める)
+struct UploadPage
+{
+	void* resource = nullptr; // D3D12ならID3D12Resource*
+	uint8_t* cpu = nullptr; // 永続的にマップされた先頭アドレス
+	uint64_t gpu = 0; // GPU仮想アドレス
+	size_t size = 0;
+};
+
+// ページの作成と破棄(D3D12の実装とテスト用の偽物を差し替えられる)
+class UploadPageProvider
+{
+public:
+	virtual ~UploadPageProvider() = default;
+	virtual bool CreatePage(size_t size, UploadPage& page) = 0;
+	virtual void DestroyPage(UploadPage& page) = 0;
+};
+
+// リングから切り出した領域
+struct UploadAllocation
+{
+	void* resource = nullptr;
+	uint8_t* cpu = nullptr;
+	uint64_t gpu = 0;
+	size_t offset = 0; // resource内のオフセット
+	size_t size = 0;
+};
+
+// フレームごとに線形に切り出し、フェンスが進んだらページを再利用するアップロード用アロケータ
+class UploadRing
+{
+public:
+	static const size_t ALIGNMENT = 256; // 定数バッファの配置境界
+
+	struct Stats
+	{
+		size_t allocations; // 累計の切り出し回数
+		size_t pageCount; // 確保中のページ数(大きな専用ページを含む)
+		size_t reservedBytes; // 確保中のページの合計
+		size_t pagesCreated; // CreatePageを呼んだ回数
+		size_t frameBytes; // 今のフレームで切り出した量
+		size_t peakFrameBytes; // frameBytesの最大値
+		size_t idleLargeBytes; // 再利用を待っている専用ページの合計
+		size_t largePagesReleased; // 上限や放置で破棄した専用ページの数
+	};
+
+	// 使っていない専用ページはlargePoolBytesまで、largeIdleFrames回のReclaimの間だけ残す
+	UploadRing(UploadPageProvider* provider, size_t pageSize = 64 * 1024,
+		size_t largePoolBytes = 32 * 1024 * 1024, size_t largeIdleFrames = 120);
+	~UploadRing();
+
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+
+	// 失敗するとcpuがnullptrのまま返る
+	UploadAllocation Allocate(size_t size, size_t alignment = ALIGNMENT);
+	// このフレームで使ったページを、fenceValueの完了まで使用中にする
+	void Finish(uint64_t fenceValue);
+	// completedValueまで完了したページを再利用に回す(1フレームに1回呼ぶ)
+	void Reclaim(uint64_t completedValue);
+
+	Stats GetStats() const { return stats; }
+
+private:
+	struct Retired
+	{
+		UploadPage page;
+		uint64_t fenceValue;
+	};
+	struct IdlePage
+	{
+		UploadPage page;
+		uint64_t idleSince; // 空いた時のreclaimCount
+	};
+
+	UploadPageProvider* provider;
+	size_t pageSize;
+	size_t largePoolBytes;
+	size_t largeIdleFrames;
+	uint64_t reclaimCount;
+
+	UploadPage current; // 切り出し中のページ
+	size_t head; // currentの次の空き位置
+	std::vector<UploadPage> frameUsed; // このフレームで使い切ったページ
+	std::deque<Retired> retired; // GPUの完了待ち(フェンス値の昇順)
+	std::vector<UploadPage> freePages; // 再利用できるページ
+	std::vector<IdlePage> freeLargePages; // 再利用できる専用ページ(空いた順)
+	Stats stats;
+
+	bool NextPage();
+	void Release(UploadPage& page);
+};
@@ -0,0 +1,243 @@
+﻿// UploadRingの切り出し、ページの再利用、専用ページの保持と破棄を確かめ、1フレームの定数バッファの数ごとに速さを測る(GPUもWindowsも要らない)
+// CG2には含めず、単体でビルドする
+//   g++ -std=c++17 -O2 UploadRingTest.cpp UploadRing.cpp -o UploadRingTest
+// 使い方
+//   UploadRingTest [--frames F] [--counts N,N,...]
+//   先に次を確かめる
+//   ・切り出しが256バイト(指定があればその値)境界にそろい、ページが足りなくなった時だけ増える
+//   ・フェンスが完了したページだけが再利用され、使用中のページが同じフレームの間に2度渡されない
+//   ・専用ページは大きさの合うものが再利用され、放置されたものと上限を超えたものは破棄される
+//   ・破棄した時に全てのページが返る
+//   そのあと1フレームにN個(既定1000,10000,100000)の定数バッファをFフレーム(既定100、3フレーム先行)切り出し、
+//   1回のAllocateの時間と、残ったページの数を1つずつのリソースで作った場合と比べて出す
+//   失敗すると理由を出して1を返す
+#include "UploadRing.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		size_t frames = 100;
+		std::vector<size_t> counts = { 1000, 10000, 100000 };
+	};
+
+	bool Parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			const char* value = argv[++i];
+			if (arg == "--frames") { options.frames = strtoul(value, nullptr, 10); }
+			else if (arg == "--counts")
+			{
+				options.counts.clear();
+				for (const char* p = value; *p;)
+				{
+					char* end = nullptr;
+					size_t count = strtoul(p, &end, 10);
+					if (end == p || count == 0) { return false; }
+					options.counts.push_back(count);
+					p = *end == ',' ? end + 1 : end;
+				}
+			}
+			else { return false; }
+		}
+		return options.frames > 0 && !options.counts.empty();
+	}
+
+	int failures = 0;
+	void Check(bool condition, const char* message)
+	{
+		if (condition) { return; }
+		printf("FAIL: %s\n", message);
+		failures++;
+	}
+
+	// mallocしたページに偽のGPUアドレスを付けて渡し、生きているページを数える
+	class CountingPages :public UploadPageProvider
+	{
+	public:
+		size_t live = 0;
+		bool CreatePage(size_t size, UploadPage& page) override
+		{
+			page.cpu = static_cast<uint8_t*>(malloc(size));
+			if (!page.cpu) { return false; }
+			page.resource = page.cpu;
+			page.gpu = nextAddress;
+			page.size = size;
+			nextAddress += (size + 0xffff) & ~(uint64_t)0xffff;
+			live++;
+			return true;
+		}
+		void DestroyPage(UploadPage& page) override
+		{
+			live--;
+			free(page.cpu);
+			page = {};
+		}
+
+	private:
+		uint64_t nextAddress = 0x10000;
+	};
+
+	void TestAllocate()
+	{
+		CountingPages pages;
+		{
+			UploadRing ring(&pages, 4096);
+			UploadAllocation a = ring.Allocate(1);
+			UploadAllocation b = ring.Allocate(300);
+			UploadAllocation c = ring.Allocate(16, 16);
+			Check(a.offset == 0 && b.offset == 256 && c.offset == 768, "allocations are not packed on 256-byte boundaries");
+			Check(a.size == 256 && b.size == 512 && c.size == 16, "allocation sizes are not rounded to the alignment");
+			Check(a.gpu % 256 == 0 && b.gpu % 256 == 0 && b.cpu == a.cpu + 256 && b.gpu == a.gpu + 256, "CPU and GPU addresses do not match");
+
+			// 1ページ目が埋まったら2ページ目を作る
+			for (int i = 0; i < 14; i++) { ring.Allocate(256); }
+			Check(ring.GetStats().pagesCreated == 2, "a second page was not created when the first was full");
+
+			// ページより大きなものは専用ページ(ページの大きさの倍数)
+			UploadAllocation big = ring.Allocate(10000);
+			Check(big.cpu && big.offset == 0 && big.size == 10240, "a large allocation failed");
+			Check(ring.GetStats().pagesCreated == 3 && ring.GetStats().reservedBytes == 4096 * 2 + 12288, "the dedicated page has the wrong size");
+
+			// 完了するまでは何も戻らない
+			ring.Finish(1);
+			ring.Reclaim(0);
+			ring.Allocate(256);
+			Check(ring.GetStats().pagesCreated == 4, "a page was reused before its fence completed");
+
+			// 完了したら通常のページは再利用に、専用ページは保持に回る
+			ring.Reclaim(1);
+			Check(pages.live == 4 && ring.GetStats().idleLargeBytes == 12288, "the dedicated page was not kept for reuse");
+			ring.Finish(2);
+			ring.Reclaim(2);
+			for (int i = 0; i < 32; i++) { ring.Allocate(256); }
+			Check(ring.GetStats().pagesCreated == 4, "completed pages were not reused");
+			Check(ring.GetStats().allocations == 3 + 14 + 1 + 1 + 32, "the allocation count is wrong");
+		}
+		Check(pages.live == 0, "the destructor did not release every page");
+	}
+
+	void TestLargePages()
+	{
+		CountingPages pages;
+		{
+			// 専用ページは24KBまで、10回のReclaimの間だけ残す
+			UploadRing ring(&pages, 4096, 24576, 10);
+			uint64_t fence = 0;
+			auto nextFrame = [&]
+			{
+				ring.Finish(++fence);
+				ring.Reclaim(fence);
+			};
+
+			ring.Allocate(10000); // 12KB
+			nextFrame();
+			size_t created = ring.GetStats().pagesCreated;
+
+			// 足りて2倍以内なら再利用する
+			UploadAllocation reused = ring.Allocate(9000);
+			Check(reused.cpu && ring.GetStats().pagesCreated == created && ring.GetStats().idleLargeBytes == 0, "a fitting dedicated page was not reused");
+			// 2倍を超える大きさのページは小さな要求に使わない
+			nextFrame();
+			ring.Allocate(5000);
+			Check(ring.GetStats().pagesCreated == created + 1, "a dedicated page more than twice the request was reused");
+			nextFrame();
+			Check(ring.GetStats().idleLargeBytes == 12288 + 8192 && ring.GetStats().largePagesReleased == 0, "idle dedicated pages were not kept");
+
+			// 上限を超えた分は古い方から破棄する
+			ring.Allocate(20000);
+			nextFrame();
+			Check(ring.GetStats().idleLargeBytes <= 24576 && ring.GetStats().largePagesReleased > 0, "the idle pool exceeds its limit");
+
+			// 使われないまま10回を超えたら破棄する
+			for (int i = 0; i < 11; i++) { nextFrame(); }
+			Check(ring.GetStats().idleLargeBytes == 0, "idle dedicated pages were not released");
+		}
+		Check(pages.live == 0, "the destructor did not release every page");
+	}
+
+	// 3フレーム先行で、GPUが使っているページを別のフレームに渡さない
+	void TestInFlight()
+	{
+		const uint64_t IN_FLIGHT = 3;
+		CountingPages pages;
+		UploadRing ring(&pages, 65536);
+		std::vector<std::set<void*>> used(IN_FLIGHT + 1);
+		uint64_t fence = 0;
+		bool reused = false;
+		for (int frame = 0; frame < 200; frame++)
+		{
+			uint64_t completed = fence >= IN_FLIGHT ? fence - (IN_FLIGHT - 1) : 0;
+			ring.Reclaim(completed);
+			std::set<void*>& current = used[(fence + 1) % used.size()];
+			current.clear();
+			int count = 100 + (frame * 37) % 900;
+			for (int i = 0; i < count; i++)
+			{
+				UploadAllocation a = ring.Allocate(i % 97 == 0 ? 100000 : 256);
+				for (uint64_t f = completed + 1; f <= fence; f++)
+				{
+					if (used[f % used.size()].count(a.resource)) { reused = true; }
+				}
+				current.insert(a.resource);
+			}
+			ring.Finish(++fence);
+		}
+		Check(!reused, "a page still in flight was handed out again");
+		printf("in flight: %zu pages created, %zu KB reserved, peak frame %zu KB\n",
+			ring.GetStats().pagesCreated, ring.GetStats().reservedBytes / 1024, ring.GetStats().peakFrameBytes / 1024);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!Parse(argc, argv, options))
+	{
+		fprintf(stderr, "usage: UploadRingTest [--frames F] [--counts N,N,...]\n");
+		return 2;
+	}
+
+	TestAllocate();
+	TestLargePages();
+	TestInFlight();
+
+	// main.cppの定数バッファ(行列1つ)と同じ64バイトずつ切り出す
+	const uint64_t IN_FLIGHT = 3;
+	printf("%10s %12s %14s %16s\n", "CBs/frame", "ns/Allocate", "pages (64 KB)", "committed (MB)");
+	for (size_t count : options.counts)
+	{
+		CountingPages pages;
+		UploadRing ring(&pages);
+		uint64_t fence = 0;
+		double ns = 0.0;
+		volatile uint8_t sink = 0;
+		for (size_t frame = 0; frame < options.frames; frame++)
+		{
+			ring.Reclaim(fence >= IN_FLIGHT ? fence - (IN_FLIGHT - 1) : 0);
+			auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < count; i++)
+			{
+				UploadAllocation a = ring.Allocate(64);
+				a.cpu[0] = (uint8_t)i;
+			}
+			ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			ring.Finish(++fence);
+		}
+		(void)sink;
+		// 1つずつコミット済みリソースにすると、最小の64KBが定数バッファの数だけ要る
+		printf("%10zu %12.1f %7zu (%zu MB) %16zu\n", count, ns / ((double)options.frames * count),
+			ring.GetStats().pageCount, ring.GetStats().reservedBytes >> 20, count * 64 / 1024);
+	}
+	printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
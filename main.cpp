@@ -1,12 +1,58 @@
 ﻿#include "MyClass.h"
 #include "Buffer.h"
 #include "Input.h"
+#include "SpriteBatch.h"
+#include "FrameRenderer.h"
+#include "FrustumCuller.h"
+#include "Meshlet.h"
+#include "MeshLod.h"
+#include "TransformHierarchy.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 using namespace DirectX;
 
-int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+// 起動と終了の時に計測結果をデバッグ出力へ書く(既定ではDebugのみ1)
+#ifndef STATS_REPORT
+#ifdef _DEBUG
+#define STATS_REPORT 1
+#else
+#define STATS_REPORT 0
+#endif
+#endif
+
+// 使うシェーダの一覧(-buildshadersでまとめてコンパイルする)
+const wchar_t* SHADER_ARCHIVE_PATH = L"Shaders.bin";
+const ShaderSource SHADERS[] =
 {
+	{ L"BasicVS.hlsl", "vs_5_0" },
+	{ L"BasicPS.hlsl", "ps_5_0" },
+	{ L"SpriteVS.hlsl", "vs_5_1" },
+	{ L"SpritePS.hlsl", "ps_5_1" }, // バインドレスのテクスチャ配列を使う
+};
+
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR lpCmdLine, int)
+{
+	// ビルド後に呼ばれ、シェーダをまとめてコンパイルするだけのモード
+	if (strstr(lpCmdLine, "-buildshaders"))
+	{
+		return BuildShaderArchive(SHADER_ARCHIVE_PATH, SHADERS, _countof(SHADERS)) ? 0 : 1;
+	}
+
+	// 初期化からゲームループに入るまでを区間に分けて測る(Debugのみ、終了時に直近の区間をTrace.jsonへ書き出す)
+	PROFILE_THREAD("Main");
+#if PROFILE_ENABLED
+	// DirectXTexの重い関数(Compress、Convert、Resize、GenerateMipMaps、LoadFrom*)も区間にする
+	// ライブラリはCG2を知らないので、始まりの時刻を受け渡すコールバックでつなぐ
+	DirectX::SetProfileCallbacks(
+		[](const char*) { return Profiler::Now(); },
+		[](const char* name, uint64_t begin) { Profiler::Record(name, begin, Profiler::Now()); });
+#endif
+	PROFILE_BEGIN(startupZone, "Startup");
 #pragma region WindowsAPI初期化処理
+	PROFILE_BEGIN(windowZone, "Window");
 	// ウィンドウサイズ
 	const Int2 WIN_SIZE = { 1280,720 }; // 横幅
 	// ウィンドウクラスの設定
@@ -16,8 +62,10 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 	ShowWindow(wAPI.hwnd, SW_SHOW);
 
 	MSG msg{}; // メッセージ
+	PROFILE_END(windowZone);
 #pragma endregion 
 #pragma region DirectX初期化処理
+	PROFILE_BEGIN(deviceZone, "Device");
 #ifdef _DEBUG
 //デバッグレイヤーをオンに
 	ID3D12Debug* debugController;
@@ -40,7 +88,10 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 	directX.AdapterChoice();
 	device = directX.CreateDevice(levels, _countof(levels), device);
 
-	Command command(device);
+	// CPUがGPUより何フレーム先行してよいか
+	const UINT FRAME_COUNT = Command::DEFAULT_FRAME_COUNT;
+
+	Command command(device, FRAME_COUNT);
 	// コマンドアロケータを生成
 	command.CreateCommandAllocator();
 
@@ -60,91 +111,102 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 	fence.CreateFence(device);
 
 	// DirectInputの初期化&キーボードデバイスの生成
+	InputQueue inputQueue{}; // キーボードのスレッドより長く生かす
 	Keyboard keyboard;
 	keyboard.GetInstance(wAPI.w);
 	keyboard.SetDataStdFormat(); // 入力データ形式を標準設定でセット
 	keyboard.SetCooperativeLevel(wAPI.hwnd); // 排他制御レベルのセット
+	keyboard.StartEventThread(inputQueue); // 押した、離したを別スレッドで受け取る
+	PROFILE_END(deviceZone);
 #pragma endregion
 #pragma region 描画初期化処理
 #pragma region 定数バッファ
+	PROFILE_BEGIN(resourceZone, "Resources");
+	// 定数バッファは毎フレームこのリングから切り出す
+	UploadHeap uploadHeap(device);
+	UploadRing uploadRing(&uploadHeap);
+
 	ConstBuf cb[2] = { ConstBuf::Type::Material,ConstBuf::Type::Transform };
 	for (size_t i = 0; i < _countof(cb); i++)
 	{
 		cb[i].SetResource(cb[i].size, 1, D3D12_RESOURCE_DIMENSION_BUFFER);
-		cb[i].SetHeapProp(D3D12_HEAP_TYPE_UPLOAD); // ヒープ設定
-		cb[i].CreateBuffer(device);
-		cb[i].Mapping(); // 定数バッファのマッピング
 	}
 
-	cb[ConstBuf::Type::Transform].mapTransform->mat = XMMatrixOrthographicOffCenterLH(
-		0, WIN_SIZE.width, WIN_SIZE.height, 0, 0, 1.0f);
+	// スプライト用の平行投影行列(左上原点のピクセル座標)
+	ConstBuf spriteCb = ConstBuf::Type::Transform;
+	spriteCb.SetResource(spriteCb.size, 1, D3D12_RESOURCE_DIMENSION_BUFFER);
+	XMMATRIX matSprite = XMMatrixOrthographicOffCenterLH(0.0f, (float)WIN_SIZE.width, (float)WIN_SIZE.height, 0.0f, 0.0f, 1.0f);
 
 	// ビュー変換行列
 	XMMATRIX matView;
 	XMFLOAT3 eye(0, 100, -100), target(0, 0, 0), up(0, 1, 0);
 	matView = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMLoadFloat3(&up));
 
-	// 射影変換行列 
+	// 射影変換行列(遠くで粗いLODになるところまで見えるようにする)
+	const float FOV_Y = XMConvertToRadians(45.0f);
 	XMMATRIX matProjection = XMMatrixPerspectiveFovLH(
-		XMConvertToRadians(45.0f), (float)WIN_SIZE.width / WIN_SIZE.height, 0.1f, 1000.0f);
-
-	// 行列の合成
-	cb[ConstBuf::Type::Transform].mapTransform->mat = matView * matProjection;
-
-	// 値を書き込むと自動的に転送される
-	cb[ConstBuf::Type::Material].mapMaterial->color = XMFLOAT4(1, 1, 1, 1);
+		FOV_Y, (float)WIN_SIZE.width / WIN_SIZE.height, 0.1f, 10000.0f);
 #pragma endregion
 #pragma region 頂点バッファ
-	// 頂点データ
-	VertexBuf::Vertex vertices[] =
+	// 事前に直したメッシュ(MeshCooker --quantize --meshlets --lodsでResources/Sphere.objから作る)
+	MeshFile mesh{};
+	if (!mesh.Load(L"Resources/Sphere.mesh"))
 	{
-		{{ -50.0f,-50.0f,0.0f },{0.0f,1.0f}}, // 左下
-		{{ -50.0f, 50.0f,0.0f },{0.0f,0.0f}}, // 左上
-		{{  50.0f,-50.0f,0.0f },{1.0f,1.0f}}, // 右下
-		{{  50.0f, 50.0f,0.0f },{1.0f,0.0f}}, // 右上
-	};
+		// 無いか形式が古ければ、空のバッファで描かずに終える
+		MessageBoxW(wAPI.hwnd, L"Resources/Sphere.meshを読み込めません。MeshCookerで作り直してください。", L"CG2", MB_OK | MB_ICONERROR);
+		return 1;
+	}
 
-	VertexBuf vertex(static_cast<UINT>(sizeof(vertices[0]) * _countof(vertices)));
-	vertex.SetResource(vertex.size, 1, D3D12_RESOURCE_DIMENSION_BUFFER);
-	vertex.SetHeapProp(D3D12_HEAP_TYPE_UPLOAD);
-	vertex.CreateBuffer(device);
-	vertex.Mapping(vertices, _countof(vertices));
-	vertex.CreateView(); // 頂点バッファビューの作成
+	VertexBuf vertex(0);
+	vertex.Create(device, mesh); // 頂点バッファとビューの作成
 #pragma endregion
 #pragma region インデックスバッファ
-	// インデックスデータ
-	uint16_t indices[] =
-	{
-		0,1,2,
-		1,2,3,
-	};
-
-	IndexBuf index(static_cast<UINT>(sizeof(uint16_t) * _countof(indices)));
-	index.SetResource(index.size, 1, D3D12_RESOURCE_DIMENSION_BUFFER);
-	index.SetHeapProp(D3D12_HEAP_TYPE_UPLOAD);
-	index.CreateBuffer(device);
-	index.Mapping(indices, _countof(indices));
-	index.CreateView(); // インデックスビューの作成
+	IndexBuf index(0);
+	index.Create(device, mesh); // インデックスバッファとビューの作成(LODの分も続けて置く)
 #pragma endregion
 #pragma region テクスチャバッファ
-	TextureBuf texture{};
-	texture.SetResource();
-	texture.SetHeapProp(D3D12_HEAP_TYPE_CUSTOM, D3D12_CPU_PAGE_PROPERTY_WRITE_BACK, D3D12_MEMORY_POOL_L0);
-	texture.CreateBuffer(device);
-	texture.Transfer();
-
+	// テクスチャはヒープから番号をもらい、シェーダはその番号で引く
 	ShaderResourceView srv{};
-	srv.SetHeapDesc();
+	srv.SetHeapDesc(1024, 256);
 	srv.CreateDescriptorHeap(device);
-	srv.GetDescriptorHandleForHeapStart(ShaderResourceView::Type::CPU);
 
-	texture.CreateView();
-	device->CreateShaderResourceView(texture.buff, &texture.view, srv.handle);
+	// テクスチャはDEFAULTヒープに置き、ステージングに詰めてコピーキューで送る
+	Fence copyFence{};
+	copyFence.CreateFence(device);
+	CopyQueue copyQueue(device, &copyFence);
+	TextureUploader textureUploader(&copyQueue, &uploadHeap);
+
+	// 読み込みはバックグラウンドで行い、粗いミップから順に常駐する
+	TextureStreamer streamer{};
+	TextureBuf texture(device, &fence, &srv, &textureUploader);
+	texture.SetHeapProp(D3D12_HEAP_TYPE_DEFAULT);
+	TextureStreamer::Handle textureHandle = streamer.Request(L"Resources/Map.png", &texture);
+	PROFILE_END(resourceZone);
 #pragma endregion
 #pragma region シェーダ
+	PROFILE_BEGIN(shaderZone, "Shaders");
+	// 事前コンパイルしたアーカイブをマップし、無いものだけ実行時にコンパイルする(ソースはビルド時に見ている)
+#if STATS_REPORT
+	auto shaderStart = std::chrono::steady_clock::now();
+#endif
+	ShaderArchive shaderArchive;
+	shaderArchive.Open(SHADER_ARCHIVE_PATH);
+
 	ID3DBlob* errorBlob = nullptr; // エラーオブジェクト
-	ShaderBlob vs = { L"BasicVS.hlsl", "vs_5_0", errorBlob }; // 頂点シェーダの読み込みとコンパイル
-	ShaderBlob ps = { L"BasicPS.hlsl", "ps_5_0", errorBlob }; // ピクセルシェーダの読み込みとコンパイル
+	ShaderBlob vs = { SHADERS[0].fileName, SHADERS[0].target, errorBlob, &shaderArchive }; // 頂点シェーダの読み込みとコンパイル
+	ShaderBlob ps = { SHADERS[1].fileName, SHADERS[1].target, errorBlob, &shaderArchive }; // ピクセルシェーダの読み込みとコンパイル
+	ShaderBlob spriteVs = { SHADERS[2].fileName, SHADERS[2].target, errorBlob, &shaderArchive };
+	ShaderBlob spritePs = { SHADERS[3].fileName, SHADERS[3].target, errorBlob, &shaderArchive };
+
+#if STATS_REPORT
+	size_t shaderCompiled = (vs.blob != nullptr) + (ps.blob != nullptr) + (spriteVs.blob != nullptr) + (spritePs.blob != nullptr);
+	double shaderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+	std::string shaderReport = "Shader: " + std::to_string(shaderMs) + "ms"
+		+ " archive " + std::to_string(4 - shaderCompiled)
+		+ " compiled " + std::to_string(shaderCompiled) + "\n";
+	OutputDebugStringA(shaderReport.c_str());
+#endif
+	PROFILE_END(shaderZone);
 
 	// 頂点レイアウト
 	D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
@@ -159,15 +221,33 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0
 		}
 	};
+	// 量子化したメッシュはsnorm16の座標(wは1)とhalfのuvで読む
+	D3D12_INPUT_ELEMENT_DESC packedInputLayout[] = {
+		{
+			"POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0,
+			D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0
+		},
+		{
+			"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0,
+			D3D12_APPEND_ALIGNED_ELEMENT,
+			D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0
+		}
+	};
+	bool quantized = (mesh.GetFlags() & MeshFile::QUANTIZED) != 0;
 #pragma endregion
 #pragma region パイプライン
+	PROFILE_BEGIN(pipelineZone, "Pipelines");
 	// グラフィックスパイプライン設定
 	Pipeline pipeline{};
 
 	pipeline.SetShader(vs, ps); // シェーダーの設定
 	pipeline.SetSampleMask(); // サンプルマスクの設定
 	pipeline.SetRasterizer(); // ラスタライザの設定
-	pipeline.SetInputLayout(inputLayout, _countof(inputLayout)); // 頂点レイアウトの設定
+	pipeline.desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK; // 閉じたメッシュなので裏面は描かない
+	// 頂点レイアウトの設定
+	if (quantized) { pipeline.SetInputLayout(packedInputLayout, _countof(packedInputLayout)); }
+	else { pipeline.SetInputLayout(inputLayout, _countof(inputLayout)); }
 	pipeline.SetPrimitiveTopology(); // 図形の形状設定
 	pipeline.SetOthers(); // その他の設定
 
@@ -194,26 +274,160 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 	samplerDesc.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
 	RootSignature rootSignature{};								// ルートシグネチャ
-	rootSignature.SetParam(descriptorRange);					// ルートパラメータの設定
+	rootSignature.SetParam(descriptorRange, srv.allocator.GetPersistentCount()); // ルートパラメータの設定
 	rootSignature.SetRootSignature(samplerDesc);				// ルートシグネチャの設定
 	rootSignature.SerializeRootSignature(device, errorBlob);	// ルートシグネチャのシリアライズ
 	// パイプラインにルートシグネチャをセット
 	pipeline.desc.pRootSignature = rootSignature.rs;
 
-	// パイプランステートの生成
-	pipeline.CreatePipelineState(device);
+	// パイプランステートの生成(同じ設定は使い回し、前回のコンパイル結果があればそれを使う)
+#if STATS_REPORT
+	auto psoStart = std::chrono::steady_clock::now();
+#endif
+	PipelineStateCache psoCache(L"PipelineCache.bin");
+	pipeline.CreatePipelineState(device, &psoCache, rootSignature.hash);
+
+	// スプライトはブレンドモードごとにパイプラインを作る(頂点はSV_VertexIDから作るので入力なし)
+	Pipeline spritePipelines[Blend::BlendMode::ALPHA + 1];
+	for (size_t i = 0; i < _countof(spritePipelines); i++)
+	{
+		spritePipelines[i].SetShader(spriteVs, spritePs);
+		spritePipelines[i].SetSampleMask();
+		spritePipelines[i].SetRasterizer();
+		spritePipelines[i].SetInputLayout(nullptr, 0);
+		spritePipelines[i].SetPrimitiveTopology();
+		spritePipelines[i].SetOthers();
+		Blend spriteBlend(&spritePipelines[i].desc.BlendState.RenderTarget[0]);
+		spriteBlend.UseBlendMode();
+		spriteBlend.SetBlend((Blend::BlendMode)i);
+		spritePipelines[i].desc.pRootSignature = rootSignature.rs;
+		spritePipelines[i].CreatePipelineState(device, &psoCache, rootSignature.hash);
+	}
+	psoCache.Save();
+
+#if STATS_REPORT
+	double psoMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - psoStart).count();
+	std::string psoReport = "PSO: " + std::to_string(psoMs) + "ms"
+		+ " memory " + std::to_string(psoCache.stats.memoryHits)
+		+ " disk " + std::to_string(psoCache.stats.diskHits)
+		+ " compiled " + std::to_string(psoCache.stats.misses)
+		+ " rejected " + std::to_string(psoCache.stats.rejected) + "\n";
+	OutputDebugStringA(psoReport.c_str());
+#endif
+	PROFILE_END(pipelineZone);
 #pragma endregion
 #pragma endregion
 #pragma region ゲームループで使う変数の定義
 	float angle = 0.0f;
-	ResourceBarrier barrier{};
-	FLOAT clearColor[] = { 0.1f,0.25f,0.5f,0.0f }; // 青っぽい色
-	D3D12_VIEWPORT viewport{};
-	D3D12_RECT scissorRect{};
+	float eyeDistance = 100.0f; // 注視点からの水平と垂直の距離
+	const float EYE_DISTANCE_MIN = 60.0f;
+	const float EYE_DISTANCE_MAX = 5000.0f; // 一番粗いLODまで届く
+	// シミュレーションはフレームと関係なく一定の間隔で進め、その間に起きた入力だけを反映する
+	const uint64_t SIM_TICK = 1000000 / 60; // マイクロ秒
+	const uint64_t SIM_MAX_LAG = SIM_TICK * 8; // これより遅れたら追いつくのを諦める
+	InputState input{};
+	uint64_t simTime = InputQueue::Now();
+	// フレームのパスと読み書きするリソースを宣言し、バリアは最初に1回だけ決めておく
+	RenderGraph graph(D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+	RenderGraphResources graphResources{};
+	RenderGraph::ResourceId backBufferId = graph.Import("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+	RenderGraph::PassId scenePass = graph.AddPass("Scene");
+	graph.Write(scenePass, backBufferId, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	graph.Compile();
+	graphResources.Create(device, graph);
+#if STATS_REPORT
+	RenderGraph::Stats graphStats = graph.GetStats();
+	std::string graphReport = "RenderGraph: passes " + std::to_string(graphStats.passCount)
+		+ " culled " + std::to_string(graphStats.culledPasses)
+		+ " transients " + std::to_string(graphStats.transientCount)
+		+ " memory " + std::to_string(graphStats.aliasedBytes) + "/" + std::to_string(graphStats.unaliasedBytes) + "bytes"
+		+ " barriers " + std::to_string(graphStats.transitionCount + graphStats.aliasingCount) + "\n";
+	OutputDebugStringA(graphReport.c_str());
+#endif
+	// スプライトはブレンドごとにまとめ、1バッチ1回のインスタンス描画にする
+	SpriteBatch spriteBatch{};
+	spriteBatch.bindless = true; // Sprite::textureはデスクリプタの番号
+
+	// 描画コマンドはワーカーごとのコマンドリストへ並列に記録する
+	CommandJobSystem jobSystem{};
+	// パイプライン、ルートシグネチャ、バッファは番号で指す(スプライトはBlend::BlendModeの順)
+	PipelineTable pipelineTable{};
+	RootSignatureId rootSignatureId = pipelineTable.Add(rootSignature.rs);
+	PipelineId meshPipeline = pipelineTable.Add(pipeline.state, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	PipelineId spritePipelineIds[_countof(spritePipelines)];
+	for (size_t i = 0; i < _countof(spritePipelines); i++)
+	{
+		spritePipelineIds[i] = pipelineTable.Add(spritePipelines[i].state, D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	}
+	BufferTable bufferTable{};
+	BufferId vertexBufferId = bufferTable.Add(vertex.view);
+	BufferId indexBufferId = bufferTable.Add(index.view);
+	CommandBindings bindings = { &pipelineTable, &bufferTable, &graphResources, srv.heap };
+	std::vector<CommandContext> contexts;
+	std::vector<GraphicsCommandList*> workers;
+	for (size_t i = 0; i < jobSystem.GetThreadCount(); i++) { contexts.emplace_back(device, FRAME_COUNT, &bindings); }
+	for (CommandContext& context : contexts) { workers.push_back(&context); }
+	CommandContext pre(device, FRAME_COUNT, &bindings); // バリアとクリア用
+	CommandContext post(device, FRAME_COUNT, &bindings); // リソースバリアを戻す用
+	D3D12Queue queue(command, fence, swapChain);
+	FrameRenderer renderer(jobSystem, queue, uploadRing, workers, pre, post, graph, scenePass);
+	FrameScene scene{};
+	scene.clearColor[0] = 0.1f; // 青っぽい色
+	scene.clearColor[1] = 0.25f;
+	scene.clearColor[2] = 0.5f;
+	scene.clearColor[3] = 0.0f;
+	scene.width = WIN_SIZE.width;
+	scene.height = WIN_SIZE.height;
+	scene.rootSignature = rootSignatureId;
+	scene.bindless = srv.gpuHandle.ptr; // バインドレスはヒープの先頭から
+	scene.pipeline = meshPipeline;
+	scene.vertexBuffer = vertexBufferId;
+	scene.indexBuffer = indexBufferId;
+	scene.spriteTargets.pipelines = spritePipelineIds;
+
+	const size_t DRAW_COUNT = 1; // 描画する数
+
+	// メッシュの姿勢(変えた時だけワールド行列を計算し直す)
+	const float MESH_SCALE = 50.0f; // 半径1の球を板ポリゴンと同じくらいの大きさにする
+	TransformHierarchy transforms{};
+	TransformHierarchy::NodeId meshNode = transforms.Create();
+	transforms.SetScale(meshNode, MESH_SCALE, MESH_SCALE, MESH_SCALE);
+	// 量子化した座標を物体の座標へ戻す行列(ワールド行列の前に掛ける)
+	const MeshQuantization& quantization = mesh.GetQuantization();
+	XMMATRIX matDequantize = XMMatrixScaling(quantization.scale[0], quantization.scale[1], quantization.scale[2])
+		* XMMatrixTranslation(quantization.offset[0], quantization.offset[1], quantization.offset[2]);
+
+	// 描画する物の境界球を並べ、見えるものだけを描く
+	float meshCenter[3], meshRadius;
+	mesh.GetBoundingSphere(meshCenter, meshRadius);
+	FrustumCuller culler{};
+	BoundingSpheres drawBounds{};
+	for (size_t i = 0; i < DRAW_COUNT; i++)
+	{
+		drawBounds.Add(meshCenter[0] * MESH_SCALE, meshCenter[1] * MESH_SCALE, meshCenter[2] * MESH_SCALE, meshRadius * MESH_SCALE);
+	}
+	std::vector<uint32_t> visibleDraws;
+
+	// 見えた物は画面上の誤差が1ピクセル以下で一番粗いLODを選ぶ
+	LodSelector lodSelector{};
+	lodSelector.SetProjection(FOV_Y, (float)WIN_SIZE.height);
+	std::vector<MeshLod> meshLods(mesh.GetLodCount());
+	for (size_t i = 0; i < meshLods.size(); i++) { meshLods[i] = mesh.GetLod(i); }
+
+	// 一番細かいLODの時はメッシュレットごとに視錐台と裏向きで絞り、残った範囲だけを描く
+	ClusterCuller clusterCuller{};
+	clusterCuller.SetMeshlets(mesh.GetMeshlets(), mesh.GetMeshletBounds(), mesh.GetMeshletCount());
+	FrustumCuller meshFrustum{};
+	std::vector<ClusterDraw> meshDraws;
+
+	const int SPRITE_GRID = 16; // 縦横に並べる数
+	float spriteAngle = 0.0f;
+	PROFILE_END(startupZone);
 #pragma endregion
 	// ゲームループ
 	while (1)
 	{
+		PROFILE_ZONE("Frame");
 #pragma region ウィンドウメッセージ処理
 		// メッセージがある?
 		if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
@@ -227,84 +441,203 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 #pragma endregion
 #pragma region DirectX毎フレーム処理
 #pragma region 更新処理
-		keyboard.device->Acquire(); // キーボード情報の取得開始
-		// 全キーの入力状態を取得する
-		keyboard.GetDeviceState();
-
-		if (keyboard.isInput(DIK_D) || keyboard.isInput(DIK_A))
+		PROFILE_BEGIN(updateZone, "Update");
+		uint64_t frameTime = InputQueue::Now();
+		if (frameTime - simTime > SIM_MAX_LAG) { simTime = frameTime - SIM_MAX_LAG; }
+		bool viewChanged = false;
+		while (simTime + SIM_TICK <= frameTime)
 		{
-			angle += (keyboard.isInput(DIK_D) - keyboard.isInput(DIK_A)) * XMConvertToRadians(1.0f);
-
-			eye.x = -100 * sinf(angle);
-			eye.z = -100 * cosf(angle);
+			simTime += SIM_TICK;
+			input.BeginTick();
+			input.Consume(inputQueue, simTime, InputQueue::Now());
+
+			// tickの中で押して離しただけでも1回分は回す
+			int right = input.IsDown(DIK_D) || input.IsPressed(DIK_D);
+			int left = input.IsDown(DIK_A) || input.IsPressed(DIK_A);
+			if (right || left)
+			{
+				angle += (right - left) * XMConvertToRadians(1.0f);
+				viewChanged = true;
+			}
+			// Wで近づき、Sで離れる
+			int back = input.IsDown(DIK_S) || input.IsPressed(DIK_S);
+			int forward = input.IsDown(DIK_W) || input.IsPressed(DIK_W);
+			if (back || forward)
+			{
+				eyeDistance *= powf(1.02f, (float)(back - forward));
+				eyeDistance = (std::min)((std::max)(eyeDistance, EYE_DISTANCE_MIN), EYE_DISTANCE_MAX);
+				viewChanged = true;
+			}
+		}
+		if (viewChanged)
+		{
+			eye.x = -eyeDistance * sinf(angle);
+			eye.y = eyeDistance;
+			eye.z = -eyeDistance * cosf(angle);
 
 			matView = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMLoadFloat3(&up));
-			cb[ConstBuf::Type::Transform].mapTransform->mat = matView * matProjection;
 		}
-#pragma endregion
-		// 1.リソースバリアで書き込み可能に変更
-		barrier.desc.Transition.pResource = swapChain.GetBackBuffersPtr(); // バックバッファを指定
-		barrier.SetState(command.list);
 
-		// 2.描画先の変更
-		swapChain.GetHandle();
-		command.list->OMSetRenderTargets(1, &swapChain.rtvHandle, false, nullptr);
-
-		// 3.画面クリアRGBA
-		command.list->ClearRenderTargetView(swapChain.rtvHandle, clearColor, 0, nullptr);
-#pragma region 描画コマンド
-		// ビューポート設定コマンド
-		viewport.Width = WIN_SIZE.width;
-		viewport.Height = WIN_SIZE.height;
-		viewport.TopLeftX = 0;
-		viewport.TopLeftY = 0;
-		viewport.MinDepth = 0.0f;
-		viewport.MaxDepth = 1.0f;
-
-		// シザー矩形
-		scissorRect.left = 0; // 切り抜き座標左
-		scissorRect.right = scissorRect.left + WIN_SIZE.width; // 切り抜き座標右
-		scissorRect.top = 0; // 切り抜き座標上
-		scissorRect.bottom = scissorRect.top + WIN_SIZE.height; // 切り抜き座標下
-
-		// シザー矩形設定コマンドを、コマンドリストに積む
-		command.list->RSSetScissorRects(1, &scissorRect);
-		// パイプラインステートとルートシグネチャの設定コマンド
-		command.list->SetPipelineState(pipeline.state);
-		command.list->SetGraphicsRootSignature(rootSignature.rs);
-		command.list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST); // プリミティブ形状の設定コマンド
-		command.list->IASetVertexBuffers(0, 1, &vertex.view); // 頂点バッファビューの設定コマンド
-		command.list->IASetIndexBuffer(&index.view); // 頂点バッファビューの設定コマンド
-		command.list->RSSetViewports(1, &viewport); // ビューポート設定コマンドを、コマンドリストに積む
-		// 定数バッファビューの設定コマンド
-		command.list->SetGraphicsRootConstantBufferView(0, cb[ConstBuf::Type::Material].buff->GetGPUVirtualAddress());
-		command.list->SetGraphicsRootConstantBufferView(2, cb[ConstBuf::Type::Transform].buff->GetGPUVirtualAddress());
-		command.list->SetDescriptorHeaps(1, &srv.heap);
-		srv.GetDescriptorHandleForHeapStart(ShaderResourceView::Type::GPU);
-		command.list->SetGraphicsRootDescriptorTable(1, srv.gpuHandle);
-
-		// 描画コマンド
-		command.list->DrawIndexedInstanced(_countof(indices), 1, 0, 0, 0); // 全ての頂点を使って描画
+		// GPUが読み終えたページを再利用し、このフレームの定数バッファを切り出す
+		uploadRing.Reclaim(queue.GetCompletedValue());
+		for (size_t i = 0; i < _countof(cb); i++)
+		{
+			cb[i].CreateBuffer(uploadRing);
+			cb[i].Mapping(); // 定数バッファのマッピング
+		}
+		// 値を書き込むと自動的に転送される
+		cb[ConstBuf::Type::Material].mapMaterial->color = XMFLOAT4(1, 1, 1, 1);
+		XMMATRIX matViewProjection = matView * matProjection; // 行列の合成
+		transforms.Update(&jobSystem);
+		XMFLOAT4X4 meshWorld;
+		memcpy(&meshWorld, transforms.GetWorld(meshNode), sizeof(meshWorld));
+		cb[ConstBuf::Type::Transform].mapTransform->mat = matDequantize * XMLoadFloat4x4(&meshWorld) * matViewProjection;
+		// 同じ行列から視錐台を取り出して、描く物を絞る
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, matViewProjection);
+		culler.SetViewProjection(&viewProjection._11);
+		size_t visibleCount = culler.Cull(jobSystem, drawBounds, visibleDraws);
+		meshDraws.clear();
+		XMMATRIX matWorld = XMLoadFloat4x4(&meshWorld);
+		size_t meshLod = 0;
+		if (visibleCount > 0)
+		{
+			XMVECTOR centerWorld = XMVector3TransformCoord(XMVectorSet(meshCenter[0], meshCenter[1], meshCenter[2], 1.0f), matWorld);
+			float meshDistance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&eye), centerWorld)));
+			meshLod = lodSelector.Select(meshLods.data(), meshLods.size(), MESH_SCALE, meshDistance, meshRadius);
+		}
+		if (visibleCount > 0 && (meshLod > 0 || mesh.GetMeshletCount() == 0))
+		{
+			// 粗いLODはINDXの後ろに続けて置いてあるので、範囲をそのまま描く(メッシュレットはLOD0にしか無い)
+			meshDraws.push_back({ meshLods[meshLod].indexOffset, meshLods[meshLod].indexCount });
+		}
+		else if (visibleCount > 0)
+		{
+			// メッシュレットの境界はメッシュの座標なので、視錐台はワールド行列も掛けて作り、カメラは逆行列で戻す
+			XMFLOAT4X4 meshViewProjection;
+			XMStoreFloat4x4(&meshViewProjection, matWorld * matViewProjection);
+			meshFrustum.SetViewProjection(&meshViewProjection._11);
+			XMFLOAT3 meshEye;
+			XMStoreFloat3(&meshEye, XMVector3TransformCoord(XMLoadFloat3(&eye), XMMatrixInverse(nullptr, matWorld)));
+			clusterCuller.Cull(meshFrustum, &meshEye.x, meshDraws);
+		}
+		spriteCb.CreateBuffer(uploadRing);
+		spriteCb.Mapping();
+		spriteCb.mapTransform->mat = matSprite;
+
+		// GPUが使い終わったデスクリプタと、完了したフレームの一時領域を戻す
+		srv.Reclaim(queue.GetCompletedValue());
+
+		// テクスチャのミップを予算内で詳細化する(番号が変わるのでスプライトより先に)
+		streamer.Touch(textureHandle);
+		streamer.Update();
+		// このフレームのコピーを先に提出して描画の記録と重ね、描画キューには使う前に完了を待たせる
+		copyQueue.HandOff(command.queue, textureUploader.Flush());
+
+		// スプライトを並べ替えてインスタンスデータを詰める
+		spriteAngle += XMConvertToRadians(1.0f);
+		spriteBatch.Begin();
+		for (int y = 0; y < SPRITE_GRID; y++)
+		{
+			for (int x = 0; x < SPRITE_GRID; x++)
+			{
+				Sprite sprite;
+				sprite.position[0] = 40.0f + x * 24.0f;
+				sprite.position[1] = 40.0f + y * 24.0f;
+				sprite.size[0] = sprite.size[1] = 20.0f;
+				sprite.rotation = spriteAngle + (x + y) * 0.1f;
+				sprite.color[0] = (float)x / SPRITE_GRID;
+				sprite.color[1] = (float)y / SPRITE_GRID;
+				sprite.blendMode = (x + y) % 2 ? Blend::BlendMode::ADD : Blend::BlendMode::ALPHA;
+				sprite.texture = texture.index;
+				spriteBatch.Draw(sprite);
+			}
+		}
+		UploadAllocation spriteInstances = uploadRing.Allocate(spriteBatch.GetSpriteCount() * sizeof(SpriteInstance), 16);
+		if (spriteInstances.cpu)
+		{
+			spriteBatch.End((SpriteInstance*)spriteInstances.cpu);
+			scene.sprites = &spriteBatch;
+			scene.spriteTargets.constants = spriteCb.GetGPUVirtualAddress();
+			scene.spriteTargets.instances = spriteInstances.gpu;
+		}
+		else
+		{
+			// リングから取れなければこのフレームはスプライトを描かない
+			scene.sprites = nullptr;
+		}
+		PROFILE_END(updateZone);
 #pragma endregion
+		PROFILE_BEGIN(recordZone, "Record");
+		// バックバッファを差し替えて描画先にする
+		graphResources.SetResource(backBufferId, swapChain.GetBackBuffersPtr());
+		swapChain.GetHandle();
+		scene.renderTarget = swapChain.rtvHandle.ptr;
+		scene.material = cb[ConstBuf::Type::Material].GetGPUVirtualAddress();
+		scene.transform = cb[ConstBuf::Type::Transform].GetGPUVirtualAddress();
+		scene.texture = texture.WriteTransientView().ptr; // メッシュのテーブルはこのフレームの一時領域に書く
+		scene.draws = meshDraws.data();
+		scene.drawCount = meshDraws.size();
+		renderer.Record(scene);
+		PROFILE_END(recordZone);
 #pragma endregion
 #pragma region 画面入れ替え
-		// 5.リソースバリアを戻す
-		barrier.SetState(command.list);
-		// 命令のクローズ
-		assert(SUCCEEDED(command.list->Close()));
-		// コマンドリストの実行
-		command.ExecuteCommandLists();
-		// 画面に表示するバッファをフリップ(裏表の入替え)
-		swapChain.Flip();
-
-		// コマンドの実行完了を待つ
-		command.queue->Signal(fence.f, ++fence.val);
-		fence.Wait();
-
-		command.Reset();
+		// 記録した順に1回で実行してフリップし、FRAME_COUNTフレーム先行した時だけ待つ
+		PROFILE_BEGIN(submitZone, "Submit");
+		srv.allocator.Finish(fence.val + 1); // このフレームの一時領域は、Submitで送るフェンスの完了まで使う
+		renderer.Submit();
+		PROFILE_END(submitZone);
 #pragma endregion
+#if PROFILE_ENABLED
+		// スレッドごとのリングが溢れないよう毎フレーム回収する(溜めるのは直近の分だけ)
+		Profiler::Flush();
+#endif
 	}
 
+	// GPUが全て使い終わってから破棄する
+	fence.Wait();
+
+#if STATS_REPORT
+	InputState::Latency inputLatency = input.GetLatency();
+	std::string inputReport = "Input: events " + std::to_string(inputLatency.count)
+		+ " average " + std::to_string(inputLatency.count ? inputLatency.total / inputLatency.count : 0) + "us"
+		+ " max " + std::to_string(inputLatency.max) + "us"
+		+ " dropped " + std::to_string(inputQueue.GetDropped()) + "\n";
+	OutputDebugStringA(inputReport.c_str());
+#endif
+#if STATS_REPORT
+	TextureUploader::Stats uploadStats = textureUploader.GetStats();
+	std::string uploadReport = "Texture upload: copies " + std::to_string(uploadStats.copies)
+		+ " batches " + std::to_string(uploadStats.batches)
+		+ " staged " + std::to_string(uploadStats.stagedBytes) + "B"
+		+ " peak batch " + std::to_string(uploadStats.peakBatchBytes) + "B"
+		+ " failed " + std::to_string(uploadStats.failedUploads) + "\n";
+	OutputDebugStringA(uploadReport.c_str());
+#endif
+#if STATS_REPORT
+	DescriptorAllocator::Stats descriptorStats = srv.allocator.GetStats();
+	std::string descriptorReport = "Descriptors: persistent peak " + std::to_string(descriptorStats.persistentPeak)
+		+ "/" + std::to_string(srv.allocator.GetPersistentCount())
+		+ " transient peak " + std::to_string(descriptorStats.transientPeak)
+		+ "/" + std::to_string(srv.allocator.GetCapacity() - srv.allocator.GetPersistentCount())
+		+ " failed " + std::to_string(descriptorStats.transientFailures) + "\n";
+	OutputDebugStringA(descriptorReport.c_str());
+#endif
+	keyboard.StopEventThread();
+
+#if PROFILE_ENABLED
+	Profiler::Flush();
+	bool traceWritten = Profiler::WriteChromeTrace("Trace.json");
+#if STATS_REPORT
+	std::string profileReport = "Profile: zones " + std::to_string(Profiler::GetZoneCount())
+		+ " dropped " + std::to_string(Profiler::GetDropped())
+		+ (traceWritten ? " -> Trace.json\n" : " (Trace.json failed)\n");
+	OutputDebugStringA(profileReport.c_str());
+#else
+	(void)traceWritten;
+#endif
+#endif
+
 	// ウィンドウクラスを登録解除
 	wAPI.MyUnregisterClass();
 